@@ -0,0 +1,269 @@
+/**
+ * Measures how many commands per second can be executed via the openMSX
+ * control socket, in the different ways a client can send them:
+ *
+ *   sequential  send a <command>, wait for its reply, send the next one
+ *   pipelined   keep up to <window> <command>s in flight
+ *   batch       send <batch>es of <window> commands
+ *   raw         like batch, but with the length prefixed "!raw" framing
+ *
+ *  requires: libxml2
+ *  compile:
+ *    g++ -O2 `xml2-config --cflags` openmsx-control-bench.cc \
+ *        `xml2-config --libs` -o openmsx-control-bench
+ *  usage:
+ *    openmsx-control-bench <mode> [<count> [<window> [<command>]]]
+ *  example:
+ *    openmsx-control-bench pipelined 100000 64 "debug read memory 0"
+ *
+ * Only for *nix (unix domain socket). Public domain, see
+ * README.openmsx-control.
+ */
+
+#include <algorithm>
+#include <string>
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pwd.h>
+#include <libxml/parser.h>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::string;
+
+enum Mode { SEQUENTIAL, PIPELINED, BATCH, RAW };
+
+static double now()
+{
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static int sd;
+static unsigned replies = 0;
+static unsigned failed = 0;
+
+static void sendAll(const string& data)
+{
+	const char* p = data.data();
+	size_t left = data.size();
+	while (left) {
+		ssize_t n = write(sd, p, left);
+		if (n <= 0) {
+			cerr << "Error while sending" << endl;
+			exit(1);
+		}
+		p += n;
+		left -= n;
+	}
+}
+
+// XML output: only count the replies.
+static bool inReply = false;
+
+static void cb_start_element(void*, const xmlChar* name, const xmlChar** attrs)
+{
+	if (strcmp((const char*)name, "reply") != 0) return;
+	inReply = true;
+	for (const char** a = (const char**)attrs; a && *a; a += 2) {
+		if ((strcmp(a[0], "result") == 0) &&
+		    (strcmp(a[1], "ok") != 0)) {
+			++failed;
+		}
+	}
+}
+
+static void cb_end_element(void*, const xmlChar* /*name*/)
+{
+	if (inReply) {
+		++replies;
+		inReply = false;
+	}
+}
+
+// Raw output: "<keyword> ... <length>\n<payload>", for updates the payload
+// length is the sum of the last three numbers. Lines starting with '<' were
+// sent before the framing was switched (e.g. the opening tag).
+static string rawInput;
+
+static void parseRaw(const char* buf, size_t len)
+{
+	rawInput.append(buf, len);
+	size_t pos = 0;
+	while (true) {
+		size_t eol = rawInput.find('\n', pos);
+		if (eol == string::npos) break;
+		string header = rawInput.substr(pos, eol - pos);
+		if (header.empty() || (header[0] == '<')) {
+			pos = eol + 1;
+			continue;
+		}
+		size_t payload = 0;
+		unsigned a, b, c;
+		if (sscanf(header.c_str(), "update %*s %u %u %u", &a, &b, &c) == 3) {
+			payload = a + b + c;
+		} else {
+			payload = strtoul(header.substr(header.rfind(' ') + 1).c_str(),
+			                  NULL, 10);
+		}
+		if ((rawInput.size() - (eol + 1)) < payload) break;
+		if (header.compare(0, 3, "ok ") == 0) {
+			++replies;
+		} else if (header.compare(0, 4, "nok ") == 0) {
+			++replies;
+			++failed;
+		}
+		pos = eol + 1 + payload;
+	}
+	rawInput.erase(0, pos);
+}
+
+static xmlParserCtxt* parser;
+
+static void receive()
+{
+	char buf[65536];
+	ssize_t n = read(sd, buf, sizeof(buf));
+	if (n <= 0) {
+		cerr << "Connection closed" << endl;
+		exit(1);
+	}
+	if (parser) {
+		xmlParseChunk(parser, buf, n, 0);
+	} else {
+		parseRaw(buf, n);
+	}
+}
+
+static string rawCommand(const string& command)
+{
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%u\n", unsigned(command.size()));
+	return buf + command;
+}
+
+static int openSocket(const string& socketName)
+{
+	int s = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (s == -1) return -1;
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, socketName.c_str(), sizeof(addr.sun_path) - 1);
+	if (connect(s, (sockaddr*)&addr, sizeof(addr)) == -1) {
+		close(s);
+		return -1;
+	}
+	return s;
+}
+
+// See openmsx-control-socket.cc for a more careful version.
+static int findServer()
+{
+	const char* tmp = getenv("TMPDIR");
+	if (!tmp) tmp = "/tmp";
+	passwd* pw = getpwuid(getuid());
+	string dir = string(tmp) + "/openmsx-" + (pw ? pw->pw_name : "");
+	DIR* d = opendir(dir.c_str());
+	if (!d) return -1;
+	int s = -1;
+	while (dirent* entry = readdir(d)) {
+		if (strncmp(entry->d_name, "socket.", 7) != 0) continue;
+		s = openSocket(dir + '/' + entry->d_name);
+		if (s != -1) break;
+	}
+	closedir(d);
+	return s;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		cerr << "Usage: " << argv[0] << " sequential|pipelined|batch|raw "
+		        "[<count> [<window> [<command>]]]" << endl;
+		return 1;
+	}
+	Mode mode;
+	if      (strcmp(argv[1], "sequential") == 0) mode = SEQUENTIAL;
+	else if (strcmp(argv[1], "pipelined")  == 0) mode = PIPELINED;
+	else if (strcmp(argv[1], "batch")      == 0) mode = BATCH;
+	else if (strcmp(argv[1], "raw")        == 0) mode = RAW;
+	else {
+		cerr << "Unknown mode: " << argv[1] << endl;
+		return 1;
+	}
+	unsigned count  = (argc > 2) ? atoi(argv[2]) : 10000;
+	unsigned window = (argc > 3) ? atoi(argv[3]) : 64;
+	string command  = (argc > 4) ? argv[4] : "debug read memory 0";
+	if (mode == SEQUENTIAL) window = 1;
+	if (window == 0) window = 1;
+
+	sd = findServer();
+	if (sd == -1) {
+		cout << "No running openmsx found." << endl;
+		return 1;
+	}
+
+	if (mode == RAW) {
+		parser = NULL;
+		sendAll("!raw\n");
+	} else {
+		xmlSAXHandler sax;
+		memset(&sax, 0, sizeof(sax));
+		sax.startElement = cb_start_element;
+		sax.endElement   = cb_end_element;
+		parser = xmlCreatePushParserCtxt(&sax, NULL, NULL, 0, NULL);
+		sendAll("<openmsx-control>");
+	}
+
+	string xmlCommand = "<command>" + command + "</command>";
+	double begin = now();
+	unsigned sent = 0;
+	while (replies < count) {
+		if ((sent < count) && ((sent - replies) < window)) {
+			// As much as fits in the window, in one message.
+			unsigned n = std::min(window - (sent - replies), count - sent);
+			if ((mode == BATCH) || (mode == RAW)) {
+				// only send complete batches
+				if ((sent - replies) != 0) n = 0;
+			}
+			if (n) {
+				string msg;
+				if (mode == BATCH) msg += "<batch>";
+				if (mode == RAW) {
+					char buf[32];
+					snprintf(buf, sizeof(buf), "batch %u\n", n);
+					msg += buf;
+				}
+				for (unsigned i = 0; i < n; ++i) {
+					msg += (mode == RAW) ? rawCommand(command)
+					                     : xmlCommand;
+				}
+				if (mode == BATCH) msg += "</batch>";
+				sendAll(msg);
+				sent += n;
+				continue;
+			}
+		}
+		receive();
+	}
+	double t = now() - begin;
+
+	cout << argv[1] << ": " << count << " commands in " << t << "s, "
+	     << count / t << " commands/s";
+	if (failed) cout << ", " << failed << " failed";
+	cout << endl;
+	if (parser) xmlFreeParserCtxt(parser);
+	close(sd);
+	return 0;
+}
@@ -0,0 +1,372 @@
+/**
+ * Throughput test for the 'debug set_stream' subcommand.
+ *
+ * Connects to a running openMSX (via its control socket), follows a block of
+ * a debuggable and every few seconds prints how many updates and bytes were
+ * received. The received changes are applied to a local copy of the block,
+ * like a VRAM viewer or an external debugger would do.
+ * For comparison the same block can also be polled with 'debug read_block'.
+ *
+ *  requires: libxml2
+ *  compile:
+ *    g++ -O2 `xml2-config --cflags` -I ../src/utils openmsx-debug-stream.cc \
+ *        ../src/utils/Base64.cc `xml2-config --libs` -o openmsx-debug-stream
+ *  usage:
+ *    openmsx-debug-stream [stream|poll] [<debuggable> [<seconds>]]
+ *  example:
+ *    openmsx-debug-stream stream VRAM 30
+ *    openmsx-debug-stream poll VRAM 30
+ *
+ * Only for *nix (unix domain socket). Public domain, see
+ * README.openmsx-control.
+ */
+
+#include "Base64.hh"
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <sys/types.h>
+#include <sys/select.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pwd.h>
+#include <libxml/parser.h>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+
+static double now()
+{
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+// Same as DebugStream::decodeDiff() in openMSX, see 'help debug set_stream'.
+static bool getNumber(const unsigned char*& p, const unsigned char* end,
+                      unsigned& n)
+{
+	n = 0;
+	for (unsigned shift = 0; shift < 32; shift += 7) {
+		if (p == end) return false;
+		unsigned char b = *p++;
+		n |= unsigned(b & 0x7F) << shift;
+		if (!(b & 0x80)) return true;
+	}
+	return false;
+}
+
+static bool applyDiff(const string& diff, vector<unsigned char>& data,
+                      unsigned& changed)
+{
+	const unsigned char* p = (const unsigned char*)diff.data();
+	const unsigned char* end = p + diff.size();
+	unsigned size = data.size();
+	unsigned pos = 0;
+	while (p != end) {
+		unsigned skip, len;
+		if (!getNumber(p, end, skip) || !getNumber(p, end, len)) {
+			return false;
+		}
+		if (skip > (size - pos)) return false;
+		pos += skip;
+		if ((len > (size - pos)) || (len > unsigned(end - p))) {
+			return false;
+		}
+		memcpy(&data[pos], p, len);
+		p += len;
+		pos += len;
+		changed += len;
+	}
+	return true;
+}
+
+static unsigned hexValue(char c)
+{
+	return (c <= '9') ? (c - '0') : ((c | 0x20) - 'a' + 10);
+}
+
+
+class DebugStreamClient
+{
+public:
+	DebugStreamClient(int sd, bool poll, const string& debuggable);
+	~DebugStreamClient();
+
+	void run(double seconds);
+
+private:
+	static void cb_start_element(DebugStreamClient* client,
+	                             const xmlChar* name, const xmlChar** attrs);
+	static void cb_end_element(DebugStreamClient* client,
+	                           const xmlChar* name);
+	static void cb_text(DebugStreamClient* client,
+	                    const xmlChar* chars, int len);
+
+	void sendCommand(const string& command);
+	void doReply();
+	void doUpdate();
+	void report(double interval);
+
+	int sd;
+	bool poll;
+	string debuggable;
+	string pollCommand;
+	vector<unsigned char> data;
+
+	xmlSAXHandler sax_handler;
+	xmlParserCtxt* parser_context;
+	enum { NONE, REPLY, UPDATE } tag;
+	bool replyOk;
+	bool isDebuggableUpdate;
+	string content;
+
+	// statistics (since last report)
+	unsigned messages;
+	unsigned long long received; // payload bytes
+	unsigned long long changed;  // bytes in the local copy
+	unsigned errors;
+};
+
+DebugStreamClient::DebugStreamClient(int sd_, bool poll_,
+                                     const string& debuggable_)
+	: sd(sd_), poll(poll_), debuggable(debuggable_)
+	, tag(NONE), replyOk(false), isDebuggableUpdate(false)
+	, messages(0), received(0), changed(0), errors(0)
+{
+	memset(&sax_handler, 0, sizeof(sax_handler));
+	sax_handler.startElement = (startElementSAXFunc)cb_start_element;
+	sax_handler.endElement   = (endElementSAXFunc)  cb_end_element;
+	sax_handler.characters   = (charactersSAXFunc)  cb_text;
+	parser_context = xmlCreatePushParserCtxt(&sax_handler, this, 0, 0, 0);
+}
+
+DebugStreamClient::~DebugStreamClient()
+{
+	xmlFreeParserCtxt(parser_context);
+}
+
+void DebugStreamClient::cb_start_element(DebugStreamClient* client,
+                                         const xmlChar* name,
+                                         const xmlChar** attrs)
+{
+	client->content.clear();
+	const char* n = (const char*)name;
+	if (strcmp(n, "reply") == 0) {
+		client->tag = REPLY;
+		client->replyOk = false;
+		for (const char** a = (const char**)attrs; a && *a; a += 2) {
+			if ((strcmp(a[0], "result") == 0) &&
+			    (strcmp(a[1], "ok") == 0)) {
+				client->replyOk = true;
+			}
+		}
+	} else if (strcmp(n, "update") == 0) {
+		client->tag = UPDATE;
+		client->isDebuggableUpdate = false;
+		for (const char** a = (const char**)attrs; a && *a; a += 2) {
+			if ((strcmp(a[0], "type") == 0) &&
+			    (strcmp(a[1], "debuggable") == 0)) {
+				client->isDebuggableUpdate = true;
+			}
+		}
+	} else {
+		client->tag = NONE;
+	}
+}
+
+void DebugStreamClient::cb_end_element(DebugStreamClient* client,
+                                       const xmlChar* /*name*/)
+{
+	if (client->tag == REPLY) {
+		client->doReply();
+	} else if (client->tag == UPDATE) {
+		client->doUpdate();
+	}
+	client->tag = NONE;
+}
+
+void DebugStreamClient::cb_text(DebugStreamClient* client,
+                                const xmlChar* chars, int len)
+{
+	if (client->tag != NONE) {
+		client->content.append((const char*)chars, len);
+	}
+}
+
+void DebugStreamClient::sendCommand(const string& command)
+{
+	string msg = "<command>" + command + "</command>";
+	if (write(sd, msg.data(), msg.size()) != ssize_t(msg.size())) {
+		cerr << "Error while sending command" << endl;
+		exit(1);
+	}
+}
+
+void DebugStreamClient::doReply()
+{
+	if (!replyOk) {
+		cerr << "Command failed: " << content << endl;
+		exit(1);
+	}
+	if (data.empty()) {
+		// reply on 'debug size'
+		unsigned size = strtoul(content.c_str(), NULL, 0);
+		if (size == 0) {
+			cerr << "Empty debuggable" << endl;
+			exit(1);
+		}
+		data.resize(size);
+		char buf[100];
+		snprintf(buf, sizeof(buf), "0 %u", size);
+		if (poll) {
+			pollCommand = "binary scan [debug read_block {" +
+			              debuggable + "} " + buf + "] H* h; set h";
+			sendCommand(pollCommand);
+		} else {
+			sendCommand("openmsx_update enable debuggable");
+			sendCommand("debug set_stream {" + debuggable + "} " + buf);
+		}
+		return;
+	}
+	if (!poll) return;
+
+	// reply on 'debug read_block' (hex encoded)
+	++messages;
+	received += content.size();
+	if (content.size() == (2 * data.size())) {
+		for (unsigned i = 0; i < data.size(); ++i) {
+			unsigned char b = (hexValue(content[2 * i + 0]) << 4) |
+			                   hexValue(content[2 * i + 1]);
+			if (data[i] != b) {
+				data[i] = b;
+				++changed;
+			}
+		}
+	} else {
+		++errors;
+	}
+	sendCommand(pollCommand);
+}
+
+void DebugStreamClient::doUpdate()
+{
+	if (!isDebuggableUpdate) return;
+	++messages;
+	received += content.size();
+	unsigned num = 0;
+	if (applyDiff(Base64::decode(content), data, num)) {
+		changed += num;
+	} else {
+		++errors;
+	}
+}
+
+void DebugStreamClient::report(double interval)
+{
+	cout << (poll ? "poll:   " : "stream: ")
+	     << messages / interval << " msg/s, "
+	     << received / interval / 1024 << " kB/s received, "
+	     << changed / interval / 1024 << " kB/s changed";
+	if (errors) cout << ", " << errors << " errors";
+	cout << endl;
+	messages = 0;
+	received = 0;
+	changed = 0;
+	errors = 0;
+}
+
+void DebugStreamClient::run(double seconds)
+{
+	const char* start = "<openmsx-control>";
+	if (write(sd, start, strlen(start)) != ssize_t(strlen(start))) {
+		cerr << "Error while sending" << endl;
+		return;
+	}
+	sendCommand("debug size {" + debuggable + '}');
+
+	double begin = now();
+	double lastReport = begin;
+	while (true) {
+		double t = now();
+		if ((t - lastReport) >= 5.0) {
+			report(t - lastReport);
+			lastReport = t;
+		}
+		if ((t - begin) >= seconds) break;
+
+		fd_set rdfs;
+		FD_ZERO(&rdfs);
+		FD_SET(sd, &rdfs);
+		timeval timeout = { 0, 100000 };
+		if (select(sd + 1, &rdfs, NULL, NULL, &timeout) <= 0) continue;
+		char buf[65536];
+		ssize_t size = read(sd, buf, sizeof(buf));
+		if (size <= 0) {
+			cerr << "Connection closed" << endl;
+			break;
+		}
+		xmlParseChunk(parser_context, buf, size, 0);
+	}
+}
+
+
+static int openSocket(const string& socketName)
+{
+	int sd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sd == -1) return -1;
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, socketName.c_str(), sizeof(addr.sun_path) - 1);
+	if (connect(sd, (sockaddr*)&addr, sizeof(addr)) == -1) {
+		close(sd);
+		return -1;
+	}
+	return sd;
+}
+
+// See openmsx-control-socket.cc for a more careful version.
+static int findServer()
+{
+	const char* tmp = getenv("TMPDIR");
+	if (!tmp) tmp = "/tmp";
+	passwd* pw = getpwuid(getuid());
+	string dir = string(tmp) + "/openmsx-" + (pw ? pw->pw_name : "");
+	DIR* d = opendir(dir.c_str());
+	if (!d) return -1;
+	int sd = -1;
+	while (dirent* entry = readdir(d)) {
+		if (strncmp(entry->d_name, "socket.", 7) != 0) continue;
+		sd = openSocket(dir + '/' + entry->d_name);
+		if (sd != -1) break;
+	}
+	closedir(d);
+	return sd;
+}
+
+int main(int argc, char** argv)
+{
+	bool poll = (argc > 1) && (strcmp(argv[1], "poll") == 0);
+	string debuggable = (argc > 2) ? argv[2] : "VRAM";
+	double seconds = (argc > 3) ? atof(argv[3]) : 30.0;
+
+	int sd = findServer();
+	if (sd == -1) {
+		cout << "No running openmsx found." << endl;
+		return 1;
+	}
+	DebugStreamClient client(sd, poll, debuggable);
+	client.run(seconds);
+	close(sd);
+	return 0;
+}
@@ -57,6 +57,13 @@ class NftwFunction(SystemFunction):
 	def iterHeaders(cls, targetPlatform):
 		yield '<ftw.h>'
 
+class InotifyInit1Function(SystemFunction):
+	name = 'inotify_init1'
+
+	@classmethod
+	def iterHeaders(cls, targetPlatform):
+		yield '<sys/inotify.h>'
+
 # Build a list of system functions using introspection.
 def _discoverSystemFunctions(localObjects):
 	for obj in localObjects:
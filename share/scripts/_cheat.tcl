@@ -1,7 +1,7 @@
-package provide cheatfinder 0.5
+package provide cheatfinder 0.6
 
 set_help_text findcheat \
-{Cheat finder version 0.5
+{Cheat finder version 0.6
 
 Welcome to the openMSX cheat finder. Please visit
   http://forum.vampier.net/viewtopic.php?t=32 and
@@ -28,35 +28,35 @@ Examples:
 namespace eval cheat_finder {
 
 variable max_num_results 15 ;# maximum to display cheats
-variable mem
 
-# build translation dictionary for convenience expressions
+# translation dictionary for convenience expressions, these map directly on
+# a 'debug search' subcommand
 variable translate [dict create \
-	""         "true"       \
+	""         "ge 0"       \
 	                        \
-	"smaller"  "new < old"  \
-	"less"     "new < old"  \
-	"bigger"   "new > old"  \
-	"more"     "new > old"  \
-	"greater"  "new > old"  \
+	"smaller"  "lt"         \
+	"less"     "lt"         \
+	"bigger"   "gt"         \
+	"more"     "gt"         \
+	"greater"  "gt"         \
 	                        \
-	"le"       "new <= old" \
-	"loe"      "new <= old" \
-	"ge"       "new >= old" \
-	"goe"      "new >= old" \
-	"moe"      "new >= old" \
+	"le"       "le"         \
+	"loe"      "le"         \
+	"ge"       "ge"         \
+	"goe"      "ge"         \
+	"moe"      "ge"         \
 	                        \
-	"equal"    "new == old" \
-	"eq"       "new == old" \
-	"notequal" "new != old" \
-	"ne"       "new != old" \
+	"equal"    "eq"         \
+	"eq"       "eq"         \
+	"notequal" "ne"         \
+	"ne"       "ne"         \
 	                        \
-	"<="       "new <= old" \
-	">="       "new >= old" \
-	"<"        "new <  old" \
-	">"        "new <  old" \
-	"=="       "new == old" \
-	"!="       "new != old"]
+	"<="       "le"         \
+	">="       "ge"         \
+	"<"        "lt"         \
+	">"        "gt"         \
+	"=="       "eq"         \
+	"!="       "ne"]
 
 set_tabcompletion_proc findcheat [namespace code tab_cheat_type]
 
@@ -70,44 +70,32 @@ proc tab_cheat_type {args} {
 
 # Restart cheat finder.
 proc start {} {
-	variable mem [dict create]
-
-	set mymem [debug read_block memory 0 0x10000]
-	binary scan $mymem c* values
-	set addr 0
-	foreach val $values {
-		dict append mem $addr $val
-		incr addr
-	}
+	debug search start memory
 }
 
-# Helper function to do the actual search.
-# Returns a list of triplets (addr, old, new)
+# Helper function for expressions that can't be handled natively by
+# 'debug search': evaluate the expression for each remaining candidate.
 proc search {expression} {
-	variable mem
-
-	set result [list]
-	dict for {addr old} $mem {
+	set keep [list]
+	foreach candidate [debug search list] {
+		# 'old' is the value at the previous step
+		lassign $candidate addr dummy old
 		set new [debug read memory $addr]
 		#note: NO braces around $expression
 		if $expression {
-			dict set mem $addr $new
-			lappend result [list $addr $old $new]
-		} else {
-			dict unset mem $addr
+			lappend keep $addr
 		}
 	}
-	return $result
+	debug search keep $keep
 }
 
 # main routine
 proc findcheat {args} {
-	variable mem
 	variable max_num_results
 	variable translate
 
-	# create mem dictionary
-	if {![info exists mem]} start
+	# start a search if there is none yet
+	if {[catch {debug search count}]} start
 
 	# parse options
 	while (1) {
@@ -128,27 +116,23 @@ proc findcheat {args} {
 	set expression [join $args]
 
 	if {[dict exists $translate $expression]} {
-		# translate a convenience expression into a real expression
-		set expression [dict get $translate $expression]
-	} elseif {[string is integer $expression]} {
+		# convenience expression
+		set num [debug search {*}[dict get $translate $expression]]
+	} elseif {[string is integer -strict $expression]} {
 		# search for a specific value
-		set expression "new == $expression"
+		set num [debug search eq $expression]
+	} else {
+		# prefix 'old', 'new' and 'addr' with '$'
+		set expression [string map {old $old new $new addr $addr} $expression]
+		set num [search $expression]
 	}
 
-	# prefix 'old', 'new' and 'addr' with '$'
-	set expression [string map {old $old new $new addr $addr} $expression]
-
-	# search memory
-	set result [search $expression]
-
 	# display the result
-	set num [llength $result]
 	if {$num == 0} {
 		return "No results left"
 	} elseif {$num <= $max_num_results} {
 		set output ""
-		set sorted [lsort -integer -index 0 $result]
-		foreach {addr old new} [join $sorted] {
+		foreach {addr old new} [join [debug search list]] {
 			append output [format "0x%04X : %d -> %d\n" $addr $old $new]
 		}
 		return $output
@@ -11,7 +11,8 @@ to list which channels are currently being recorded.
   record_channels  stop   [<device> [<channels>]]
   record_channels  list
 When starting recording, you can optionally specify a prefix for the
-destination file names with the -prefix option.
+destination file names with the -prefix option. With the -compress option
+the channels are recorded to gzip compressed .wav.gz files.
 
 Some examples will make it much clearer:
   - To start recording:
@@ -22,6 +23,8 @@ Some examples will make it much clearer:
       record_channels all            record all channels of all devices
       record_channels all -prefix t  record all channels of all devices using
                                      prefix 't'
+      record_channels all -compress  record all channels of all devices to
+                                     compressed files
   - To stop recording
       record_channels stop           stop all recording
       record_channels stop PSG       stop recording all PSG channels
@@ -183,6 +186,12 @@ proc record_channels {args} {
 	}
 
 	if {$start} {
+		set extension ".wav"
+		set compress_index [lsearch -exact $args "-compress"]
+		if {$compress_index >= 0} {
+			set extension ".wav.gz"
+			set args [lreplace $args $compress_index $compress_index]
+		}
 		set prefix [utils::filename_clean [guess_title]]
 		# see if there's a -prefix option to override the default
 		set prefix_index [lsearch -exact $args "-prefix"]
@@ -216,7 +225,7 @@ proc record_channels {args} {
 				if {$software_section ne ""} {
 					set software_section "${software_section}-"
 				}
-				set $var [file join $directory ${software_section}${device}-ch${ch}.wav]
+				set $var [file join $directory ${software_section}${device}-ch${ch}${extension}]
 				append retval "Recording $device channel $ch to [set $var]...\n"
 			} else {
 				if {[set $var] ne ""} {
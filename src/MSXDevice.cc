@@ -469,6 +469,11 @@ byte MSXDevice::peekMem(word address, EmuTime::param /*time*/) const
 	}
 }
 
+int MSXDevice::getSegment(word /*address*/) const
+{
+	return -1; // no segments
+}
+
 void MSXDevice::globalWrite(word /*address*/, byte /*value*/,
                             EmuTime::param /*time*/)
 {
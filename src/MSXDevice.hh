@@ -182,6 +182,16 @@ public:
 	 */
 	virtual byte peekMem(word address, EmuTime::param time) const;
 
+	/**
+	 * Returns the number of the (mapper or ROM) segment that is currently
+	 * visible at the given memory location, or -1 when this device has
+	 * no segments. The segment number can only change when the device
+	 * calls invalidateMemCache() for that location.
+	 * This method is not used by the emulation, only by the execution
+	 * profiler (see CPUProfiler).
+	 */
+	virtual int getSegment(word address) const;
+
 	/** Global writes.
 	  * Some devices violate the MSX standard by ignoring the SLOT-SELECT
 	  * signal; they react to writes to a certain address in _any_ slot.
@@ -1348,6 +1348,10 @@ const string& MSXMotherBoard::getMachineID()
 {
 	return pimpl->getMachineID();
 }
+const string& MSXMotherBoard::getMachineName() const
+{
+	return pimpl->getMachineName();
+}
 bool MSXMotherBoard::execute()
 {
 	return pimpl->execute();
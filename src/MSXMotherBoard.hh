@@ -45,6 +45,8 @@ public:
 	~MSXMotherBoard();
 
 	const std::string& getMachineID();
+	/** Name of the loaded machine config (empty if none loaded yet). */
+	const std::string& getMachineName() const;
 
 	/** Run emulation.
 	 * @return True if emulation steps were done,
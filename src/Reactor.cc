@@ -8,6 +8,7 @@
 #include "DiskManipulator.hh"
 #include "DiskChanger.hh"
 #include "FilePool.hh"
+#include "ConfigCache.hh"
 #include "UserSettings.hh"
 #include "RomDatabase.hh"
 #include "TclCallbackMessages.hh"
@@ -22,6 +23,7 @@
 #include "Display.hh"
 #include "Mixer.hh"
 #include "AviRecorder.hh"
+#include "SoundChipReplayCommand.hh"
 #include "Alarm.hh"
 #include "GlobalSettings.hh"
 #include "BooleanSetting.hh"
@@ -217,6 +219,8 @@ void Reactor::init()
 		*diskFactory, *diskManipulator, true);
 	filePool = make_unique<FilePool>(
 		*globalCommandController, *eventDistributor);
+	configCache = make_unique<ConfigCache>(
+		getOpenMSXInfoCommand());
 	userSettings = make_unique<UserSettings>(
 		*globalCommandController);
 	softwareDatabase = make_unique<RomDatabase>(
@@ -244,6 +248,8 @@ void Reactor::init()
 	restoreMachineCommand = make_unique<RestoreMachineCommand>(
 		*globalCommandController, *this);
 	aviRecordCommand = make_unique<AviRecorder>(*this);
+	soundChipReplayCommand = make_unique<SoundChipReplayCommand>(
+		*globalCommandController, *this);
 	extensionInfo = make_unique<ConfigInfo>(
 		getOpenMSXInfoCommand(), "extensions");
 	machineInfo   = make_unique<ConfigInfo>(
@@ -326,6 +332,11 @@ FilePool& Reactor::getFilePool()
 	return *filePool;
 }
 
+ConfigCache& Reactor::getConfigCache()
+{
+	return *configCache;
+}
+
 DiskManipulator& Reactor::getDiskManipulator()
 {
 	return *diskManipulator;
@@ -27,6 +27,7 @@ class DiskFactory;
 class DiskManipulator;
 class DiskChanger;
 class FilePool;
+class ConfigCache;
 class UserSettings;
 class RomDatabase;
 class TclCallbackMessages;
@@ -44,6 +45,7 @@ class ListMachinesCommand;
 class ActivateMachineCommand;
 class StoreMachineCommand;
 class RestoreMachineCommand;
+class SoundChipReplayCommand;
 class AviRecorder;
 class ConfigInfo;
 class RealTimeInfo;
@@ -86,6 +88,7 @@ public:
 	EnumSetting<int>& getMachineSetting();
 	RomDatabase& getSoftwareDatabase();
 	FilePool& getFilePool();
+	ConfigCache& getConfigCache();
 
 	void switchMachine(const std::string& machine);
 	MSXMotherBoard* getMotherBoard() const;
@@ -144,6 +147,7 @@ private:
 	std::unique_ptr<DiskManipulator> diskManipulator;
 	std::unique_ptr<DiskChanger> virtualDrive;
 	std::unique_ptr<FilePool> filePool;
+	std::unique_ptr<ConfigCache> configCache;
 
 	std::unique_ptr<EnumSetting<int>> machineSetting;
 	std::unique_ptr<UserSettings> userSettings;
@@ -161,6 +165,7 @@ private:
 	std::unique_ptr<StoreMachineCommand> storeMachineCommand;
 	std::unique_ptr<RestoreMachineCommand> restoreMachineCommand;
 	std::unique_ptr<AviRecorder> aviRecordCommand;
+	std::unique_ptr<SoundChipReplayCommand> soundChipReplayCommand;
 	std::unique_ptr<ConfigInfo> extensionInfo;
 	std::unique_ptr<ConfigInfo> machineInfo;
 	std::unique_ptr<RealTimeInfo> realTimeInfo;
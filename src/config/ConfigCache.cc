@@ -0,0 +1,160 @@
+#include "ConfigCache.hh"
+#include "InfoTopic.hh"
+#include "TclObject.hh"
+#include "CommandException.hh"
+#include "File.hh"
+#include "FileException.hh"
+#include "FileOperations.hh"
+#include "memory.hh"
+
+using std::string;
+using std::vector;
+using std::unique_ptr;
+
+namespace openmsx {
+
+class ConfigCacheInfo : public InfoTopic
+{
+public:
+	ConfigCacheInfo(InfoCommand& openMSXInfoCommand, ConfigCache& cache);
+	virtual void execute(const vector<TclObject>& tokens,
+	                     TclObject& result) const;
+	virtual string help(const vector<string>& tokens) const;
+private:
+	ConfigCache& cache;
+};
+
+
+ConfigCache::ConfigCache(InfoCommand& openMSXInfoCommand)
+	: configHits(0), configMisses(0)
+	, romHits(0), romMisses(0)
+	, info(make_unique<ConfigCacheInfo>(openMSXInfoCommand, *this))
+{
+	for (auto& t : timing) t = 0;
+}
+
+ConfigCache::~ConfigCache()
+{
+}
+
+XMLElement ConfigCache::getConfig(const string& filename,
+                                  const std::function<XMLElement()>& load)
+{
+	FileOperations::Stat st;
+	if (!FileOperations::getStat(filename, st)) {
+		// let the load function report the error
+		configs.erase(filename);
+		return load();
+	}
+	auto it = configs.find(filename);
+	if ((it != configs.end()) &&
+	    (it->second.time == st.st_mtime) &&
+	    (it->second.size == size_t(st.st_size))) {
+		++configHits;
+		return it->second.config;
+	}
+	++configMisses;
+	auto& entry = configs[filename];
+	try {
+		entry.config = load();
+	} catch (...) {
+		configs.erase(filename);
+		throw;
+	}
+	entry.time = st.st_mtime;
+	entry.size = st.st_size;
+	return entry.config;
+}
+
+unique_ptr<File> ConfigCache::findRom(const string& key, Sha1Sum& sha1)
+{
+	auto it = roms.find(key);
+	if (it == roms.end()) {
+		++romMisses;
+		return nullptr;
+	}
+	try {
+		auto file = make_unique<File>(it->second.filename);
+		if (file->getModificationDate() == it->second.time) {
+			sha1 = it->second.sha1;
+			++romHits;
+			return file;
+		}
+	} catch (FileException&) {
+		// removed in the mean time
+	}
+	roms.erase(it);
+	++romMisses;
+	return nullptr;
+}
+
+void ConfigCache::storeRom(const string& key, File& file, const Sha1Sum& sha1)
+{
+	try {
+		auto& entry = roms[key];
+		entry.filename = file.getURL();
+		entry.time = file.getModificationDate();
+		entry.sha1 = sha1;
+	} catch (FileException&) {
+		roms.erase(key);
+	}
+}
+
+void ConfigCache::startTiming(const string& name)
+{
+	timingName = name;
+	for (auto& t : timing) t = 0;
+}
+
+void ConfigCache::addTime(Phase phase, uint64_t duration)
+{
+	timing[phase] += duration;
+}
+
+
+// class ConfigCacheInfo
+
+ConfigCacheInfo::ConfigCacheInfo(InfoCommand& openMSXInfoCommand,
+                                 ConfigCache& cache_)
+	: InfoTopic(openMSXInfoCommand, "config_cache")
+	, cache(cache_)
+{
+}
+
+void ConfigCacheInfo::execute(const vector<TclObject>& tokens,
+                              TclObject& result) const
+{
+	if (tokens.size() != 2) {
+		throw CommandException("Too many parameters");
+	}
+	static const char* const phaseNames[ConfigCache::NUM_PHASES] = {
+		"parse_time", "slots_time", "devices_time", "roms_time"
+	};
+	result.addListElement("config_hits");
+	result.addListElement(int(cache.configHits));
+	result.addListElement("config_misses");
+	result.addListElement(int(cache.configMisses));
+	result.addListElement("rom_hits");
+	result.addListElement(int(cache.romHits));
+	result.addListElement("rom_misses");
+	result.addListElement(int(cache.romMisses));
+	result.addListElement("last_config");
+	result.addListElement(cache.timingName);
+	for (int i = 0; i < ConfigCache::NUM_PHASES; ++i) {
+		result.addListElement(phaseNames[i]);
+		result.addListElement(cache.timing[i] / 1000000.0);
+	}
+}
+
+string ConfigCacheInfo::help(const vector<string>& /*tokens*/) const
+{
+	return "Shows how often a hardware configuration file and a ROM file "
+	       "could be taken from the cache (hits) or had to be loaded or "
+	       "searched for (misses). Also shows the time in seconds spent "
+	       "in the phases of the last machine or extension creation: "
+	       "loading the configuration, setting up the slots, creating "
+	       "the devices, and the part of the latter spent on locating "
+	       "and checking ROM files.\n";
+}
+
+} // namespace openmsx
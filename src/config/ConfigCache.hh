@@ -0,0 +1,89 @@
+#ifndef CONFIGCACHE_HH
+#define CONFIGCACHE_HH
+
+#include "XMLElement.hh"
+#include "sha1.hh"
+#include "noncopyable.hh"
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <ctime>
+#include <cstdint>
+
+namespace openmsx {
+
+class InfoCommand;
+class File;
+class ConfigCacheInfo;
+
+/** Speeds up the (repeated) creation of the same machine or extension.
+  *
+  * - The parsed (and validated) hardware configuration files are kept, as
+  *   long as the modification time and size of a file don't change it's not
+  *   parsed again.
+  * - For each <rom> description the file that was found for it is kept
+  *   (together with its sha1sum), so the next time the file doesn't need to
+  *   be searched for (possibly via the file pool) and hashed again.
+  *
+  * It also keeps the time spent in the different phases of the last machine
+  * or extension creation, see "openmsx_info config_cache".
+  */
+class ConfigCache : private noncopyable
+{
+public:
+	enum Phase { PARSE, SLOTS, DEVICES, ROMS, NUM_PHASES };
+
+	explicit ConfigCache(InfoCommand& openMSXInfoCommand);
+	~ConfigCache();
+
+	/** Returns a copy of the cached content of the given configuration
+	  * file, when needed it's (re)loaded with the given function.
+	  * Exceptions from that function are passed on.
+	  */
+	XMLElement getConfig(const std::string& filename,
+	                     const std::function<XMLElement()>& load);
+
+	/** Open the file that was previously found for the ROM with the
+	  * given key, if it wasn't changed since then.
+	  * @param key Identifies the ROM description, see Rom.
+	  * @param sha1 Set to the sha1sum of the file (only when found).
+	  * @result The opened file or nullptr when not found.
+	  */
+	std::unique_ptr<File> findRom(const std::string& key, Sha1Sum& sha1);
+	void storeRom(const std::string& key, File& file, const Sha1Sum& sha1);
+
+	/** Start timing the creation of a new machine or extension. */
+	void startTiming(const std::string& name);
+	void addTime(Phase phase, uint64_t duration);
+
+private:
+	struct ConfigEntry {
+		time_t time;
+		size_t size;
+		XMLElement config;
+	};
+	struct RomEntry {
+		std::string filename;
+		time_t time;
+		Sha1Sum sha1;
+	};
+
+	std::unordered_map<std::string, ConfigEntry> configs;
+	std::unordered_map<std::string, RomEntry> roms;
+
+	unsigned configHits;
+	unsigned configMisses;
+	unsigned romHits;
+	unsigned romMisses;
+
+	std::string timingName;
+	uint64_t timing[NUM_PHASES]; // in us
+
+	friend class ConfigCacheInfo;
+	const std::unique_ptr<ConfigCacheInfo> info;
+};
+
+} // namespace openmsx
+
+#endif
@@ -7,6 +7,8 @@
 #include "FileContext.hh"
 #include "FileOperations.hh"
 #include "MSXMotherBoard.hh"
+#include "Reactor.hh"
+#include "ConfigCache.hh"
 #include "CartridgeSlotManager.hh"
 #include "MSXCPUInterface.hh"
 #include "DeviceFactory.hh"
@@ -14,6 +16,7 @@
 #include "serialize.hh"
 #include "serialize_stl.hh"
 #include "StringOp.hh"
+#include "Timer.hh"
 #include "memory.hh"
 #include "unreachable.hh"
 #include "xrange.hh"
@@ -30,6 +33,7 @@ namespace openmsx {
 unique_ptr<HardwareConfig> HardwareConfig::createMachineConfig(
 	MSXMotherBoard& motherBoard, const string& machineName)
 {
+	motherBoard.getReactor().getConfigCache().startTiming(machineName);
 	auto result = make_unique<HardwareConfig>(motherBoard, machineName);
 	result->load("machines");
 	return result;
@@ -38,6 +42,7 @@ unique_ptr<HardwareConfig> HardwareConfig::createMachineConfig(
 unique_ptr<HardwareConfig> HardwareConfig::createExtensionConfig(
 	MSXMotherBoard& motherBoard, const string& extensionName, const string& slotname)
 {
+	motherBoard.getReactor().getConfigCache().startTiming(extensionName);
 	auto result = make_unique<HardwareConfig>(motherBoard, extensionName);
 	result->load("extensions");
 	result->setName(extensionName);
@@ -49,6 +54,7 @@ unique_ptr<HardwareConfig> HardwareConfig::createRomConfig(
 	MSXMotherBoard& motherBoard, const string& romfile,
 	const string& slotname, const vector<string>& options)
 {
+	motherBoard.getReactor().getConfigCache().startTiming(romfile);
 	auto result = make_unique<HardwareConfig>(motherBoard, "rom");
 	const auto& sramfile = FileOperations::getFilename(romfile);
 	auto context = make_unique<UserFileContext>("roms/" + sramfile);
@@ -244,8 +250,11 @@ string HardwareConfig::getFilename(string_ref type, string_ref name)
 
 void HardwareConfig::load(string_ref type)
 {
+	auto start = Timer::getTime();
 	string filename = getFilename(type, hwName);
-	setConfig(loadConfig(filename));
+	auto& cache = motherBoard.getReactor().getConfigCache();
+	setConfig(cache.getConfig(filename, [&] { return loadConfig(filename); }));
+	cache.addTime(ConfigCache::PARSE, Timer::getTime() - start);
 
 	assert(!userName.empty());
 	const auto& baseName = FileOperations::getBaseName(filename);
@@ -255,6 +264,7 @@ void HardwareConfig::load(string_ref type)
 
 void HardwareConfig::parseSlots()
 {
+	auto start = Timer::getTime();
 	// TODO this code does parsing for both 'expanded' and 'external' slots
 	//      once machine and extensions are parsed separately move parsing
 	//      of 'expanded' to MSXCPUInterface
@@ -293,11 +303,16 @@ void HardwareConfig::parseSlots()
 			}
 		}
 	}
+	motherBoard.getReactor().getConfigCache().addTime(
+		ConfigCache::SLOTS, Timer::getTime() - start);
 }
 
 void HardwareConfig::createDevices()
 {
+	auto start = Timer::getTime();
 	createDevices(getDevices(), nullptr, nullptr);
+	motherBoard.getReactor().getConfigCache().addTime(
+		ConfigCache::DEVICES, Timer::getTime() - start);
 }
 
 void HardwareConfig::createDevices(const XMLElement& elem,
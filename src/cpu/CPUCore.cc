@@ -160,6 +160,7 @@
 
 #include "CPUCore.hh"
 #include "MSXCPUInterface.hh"
+#include "CPUProfiler.hh"
 #include "Scheduler.hh"
 #include "MSXMotherBoard.hh"
 #include "CliComm.hh"
@@ -306,6 +307,7 @@ template<class T> CPUCore<T>::CPUCore(
 	, motherboard(motherboard_)
 	, scheduler(motherboard.getScheduler())
 	, interface(nullptr)
+	, profiler(nullptr)
 	, traceSetting(traceSetting_)
 	, diHaltCallback(diHaltCallback_)
 	, IRQStatus(motherboard.getDebugger(), name + ".pendingIRQ",
@@ -344,6 +346,11 @@ template<class T> void CPUCore<T>::setInterface(MSXCPUInterface* interf)
 	interface = interf;
 }
 
+template<class T> void CPUCore<T>::setProfiler(CPUProfiler* profiler_)
+{
+	profiler = profiler_;
+}
+
 template<class T> void CPUCore<T>::warp(EmuTime::param time)
 {
 	assert(T::getTimeFast() <= time);
@@ -800,6 +807,7 @@ template<class T> inline void CPUCore<T>::nmi()
 	PUSH<T::EE_NMI_1>(getPC());
 	setPC(0x0066);
 	T::add(T::CC_NMI);
+	profileCall(0);
 }
 
 // IM0 interrupt
@@ -816,6 +824,7 @@ template<class T> inline void CPUCore<T>::irq0()
 	setPC(0x0038);
 	T::setMemPtr(getPC());
 	T::add(T::CC_IRQ0);
+	profileCall(0);
 }
 
 // IM1 interrupt
@@ -829,6 +838,7 @@ template<class T> inline void CPUCore<T>::irq1()
 	setPC(0x0038);
 	T::setMemPtr(getPC());
 	T::add(T::CC_IRQ1);
+	profileCall(0);
 }
 
 // IM2 interrupt
@@ -843,6 +853,7 @@ template<class T> inline void CPUCore<T>::irq2()
 	setPC(RD_WORD(x, T::CC_IRQ2_2));
 	T::setMemPtr(getPC());
 	T::add(T::CC_IRQ2);
+	profileCall(0);
 }
 
 template<class T>
@@ -2458,6 +2469,28 @@ template<class T> void CPUCore<T>::cpuTracePost_slow()
 	     << std::endl << std::dec;
 }
 
+// Only called for control transfers that are taken, 'cc' is the duration of
+// the instruction (it's not yet added to the clock).
+template<class T> inline void CPUCore<T>::profileJump(int cc)
+{
+	if (unlikely(profiler != nullptr)) {
+		profiler->jump(getPC(), T::getTimeFast(cc));
+	}
+}
+template<class T> inline void CPUCore<T>::profileCall(int cc)
+{
+	if (unlikely(profiler != nullptr)) {
+		profiler->call(getPC(), getSP(), T::getTimeFast(cc));
+	}
+}
+template<class T> inline void CPUCore<T>::profileRet(int cc)
+{
+	if (unlikely(profiler != nullptr)) {
+		// the return address was already popped
+		profiler->ret(getPC(), (getSP() - 2) & 0xFFFF, T::getTimeFast(cc));
+	}
+}
+
 template<class T> void CPUCore<T>::executeSlow()
 {
 	if (unlikely(false && nmiEdge)) {
@@ -3813,6 +3846,7 @@ template<class T> template<typename COND> int CPUCore<T>::call(COND cond) {
 	if (cond(getF())) {
 		PUSH<T::EE_CALL>(getPC());
 		setPC(addr);
+		profileCall(T::CC_CALL_A);
 		return T::CC_CALL_A;
 	} else {
 		return T::CC_CALL_B;
@@ -3825,6 +3859,7 @@ template<class T> template<unsigned ADDR> int CPUCore<T>::rst() {
 	PUSH<0>(getPC());
 	T::setMemPtr(ADDR);
 	setPC(ADDR);
+	profileCall(T::CC_RST);
 	return T::CC_RST;
 }
 
@@ -3835,6 +3870,7 @@ template<class T> template<int EE, typename COND> inline int CPUCore<T>::RET(CON
 		unsigned addr = POP<EE>();
 		T::setMemPtr(addr);
 		setPC(addr);
+		profileRet(T::CC_RET_A + EE);
 		return T::CC_RET_A + EE;
 	} else {
 		return T::CC_RET_B + EE;
@@ -3855,7 +3891,9 @@ template<class T> int CPUCore<T>::retn() { // also reti
 
 // JP ss
 template<class T> template<Reg16 REG, int EE> int CPUCore<T>::jp_SS() {
-	setPC(get16<REG>()); T::R800ForcePageBreak(); return T::CC_JP_HL + EE;
+	setPC(get16<REG>()); T::R800ForcePageBreak();
+	profileJump(T::CC_JP_HL + EE);
+	return T::CC_JP_HL + EE;
 }
 
 // JP nn / JP cc,nn
@@ -3865,6 +3903,7 @@ template<class T> template<typename COND> int CPUCore<T>::jp(COND cond) {
 	if (cond(getF())) {
 		setPC(addr);
 		T::R800ForcePageBreak();
+		profileJump(T::CC_JP_A);
 		return T::CC_JP_A;
 	} else {
 		return T::CC_JP_B;
@@ -3907,6 +3946,7 @@ template<class T> template<typename COND> int CPUCore<T>::jr(COND cond) {
 		}
 		setPC((getPC() + ofst) & 0xFFFF);
 		T::setMemPtr(getPC());
+		profileJump(T::CC_JR_A);
 		return T::CC_JR_A;
 	} else {
 		return T::CC_JR_B;
@@ -3925,6 +3965,7 @@ template<class T> int CPUCore<T>::djnz() {
 		}
 		setPC((getPC() + ofst) & 0xFFFF);
 		T::setMemPtr(getPC());
+		profileJump(T::CC_JR_A + T::EE_DJNZ);
 		return T::CC_JR_A + T::EE_DJNZ;
 	} else {
 		return T::CC_JR_B + T::EE_DJNZ;
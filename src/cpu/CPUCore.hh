@@ -13,6 +13,7 @@
 namespace openmsx {
 
 class MSXCPUInterface;
+class CPUProfiler;
 class Scheduler;
 class MSXMotherBoard;
 class BooleanSetting;
@@ -35,6 +36,10 @@ public:
 
 	void setInterface(MSXCPUInterface* interf);
 
+	/** Start (non-null) or stop (nullptr) informing the profiler about
+	  * the executed control transfers. */
+	void setProfiler(CPUProfiler* profiler);
+
 	/**
 	 * Reset the CPU.
 	 */
@@ -115,6 +120,7 @@ private:
 	MSXMotherBoard& motherboard;
 	Scheduler& scheduler;
 	MSXCPUInterface* interface;
+	CPUProfiler* profiler; // nullptr when not profiling
 
 	const BooleanSetting& traceSetting;
 	TclCallback& diHaltCallback;
@@ -151,6 +157,10 @@ private:
 	inline void cpuTracePost();
 	void cpuTracePost_slow();
 
+	inline void profileJump(int cc);
+	inline void profileCall(int cc);
+	inline void profileRet(int cc);
+
 	inline byte READ_PORT(unsigned port, unsigned cc);
 	inline void WRITE_PORT(unsigned port, byte value, unsigned cc);
 
@@ -0,0 +1,172 @@
+#include "CPUProfiler.hh"
+#include "MSXMotherBoard.hh"
+#include "MSXCPUInterface.hh"
+#include "MSXDevice.hh"
+#include <algorithm>
+
+using std::vector;
+
+namespace openmsx {
+
+// Maximum depth of the shadow call stack. Deeper calls are not tracked (a
+// program that never returns from its calls would otherwise let it grow
+// forever).
+static const unsigned MAX_DEPTH = 1024;
+
+CPUProfiler::CPUProfiler(MSXMotherBoard& motherBoard_)
+	: motherBoard(motherBoard_)
+	, current(&unknown)
+	, lastTime(EmuTime::zero)
+	, elapsed(0)
+{
+	unknown.key = uint64_t(-1);
+	unknown.time = 0;
+	unknown.count = 0;
+	invalidate(0, 0x10000);
+}
+
+CPUProfiler::~CPUProfiler()
+{
+}
+
+void CPUProfiler::start(EmuTime::param time)
+{
+	// only allocated when actually used (512kB on 64-bit hosts)
+	blockCache.resize(0x10000, nullptr);
+	invalidate(0, 0x10000);
+	stack.clear();
+	current = &unknown;
+	lastTime = time;
+}
+
+void CPUProfiler::clear()
+{
+	blocks.clear();
+	edges.clear();
+	stack.clear();
+	std::fill(blockCache.begin(), blockCache.end(), nullptr);
+	unknown.time = 0;
+	current = &unknown;
+	elapsed = 0;
+}
+
+void CPUProfiler::invalidate(unsigned start, unsigned size)
+{
+	unsigned first = start / CacheLine::SIZE;
+	unsigned num = (size + CacheLine::SIZE - 1) / CacheLine::SIZE;
+	std::fill(&regions[first], &regions[first + num], INVALID_REGION);
+}
+
+// A region is the combination of slot and segment of a cache line:
+//   bits  0-15: segment (0xFFFF if none)
+//   bits 16-17: primary slot
+//   bits 18-20: secondary slot + 1 (0 if not expanded)
+unsigned CPUProfiler::lookupRegion(unsigned address)
+{
+	auto& interface = motherBoard.getCPUInterface();
+	int page = address >> 14;
+	int ps = interface.getPrimarySlot(page);
+	int ss = interface.isExpanded(ps) ? interface.getSecondarySlot(page) : -1;
+	int segment = interface.getVisibleMSXDevice(page)->getSegment(address);
+	unsigned region = (unsigned(segment) & 0xFFFF) | (ps << 16) |
+	                  ((ss + 1) << 18);
+	regions[address >> CacheLine::BITS] = region;
+	return region;
+}
+
+CPUProfiler::Location CPUProfiler::getLocation(uint64_t key)
+{
+	unsigned region = unsigned(key >> 16);
+	unsigned segment = region & 0xFFFF;
+	Location result;
+	result.ps = (region >> 16) & 3;
+	result.ss = int((region >> 18) & 7) - 1;
+	result.segment = (segment == 0xFFFF) ? -1 : int(segment);
+	result.address = key & 0xFFFF;
+	return result;
+}
+
+CPUProfiler::Block* CPUProfiler::lookupBlock(uint64_t key)
+{
+	auto it = blocks.find(key);
+	if (it == blocks.end()) {
+		Block block;
+		block.key = key;
+		block.time = 0;
+		block.count = 0;
+		it = blocks.insert(std::make_pair(key, block)).first;
+	}
+	Block* result = &it->second;
+	blockCache[key & 0xFFFF] = result;
+	return result;
+}
+
+void CPUProfiler::pushFrame(unsigned sp)
+{
+	if (stack.size() == MAX_DEPTH) return;
+	uint64_t caller = stack.empty() ? uint64_t(-1) : stack.back().callee;
+	Edge& edge = edges[EdgeKey(caller, current->key)];
+	++edge.count;
+	Frame frame;
+	frame.sp = sp;
+	frame.callee = current->key;
+	frame.edge = &edge;
+	frame.start = elapsed;
+	stack.push_back(frame);
+}
+
+void CPUProfiler::popFrame(unsigned sp)
+{
+	// Frames below the current stack pointer were abandoned (e.g. the
+	// return address was popped and the routine exited with a jump).
+	while (!stack.empty() && (stack.back().sp < sp)) {
+		stack.pop_back();
+	}
+	// A 'ret' that doesn't match a call (e.g. 'push hl ; ret') is only a
+	// jump.
+	if (!stack.empty() && (stack.back().sp == sp)) {
+		auto& frame = stack.back();
+		frame.edge->time += elapsed - frame.start;
+		stack.pop_back();
+	}
+}
+
+vector<CPUProfiler::HotSpot> CPUProfiler::getHotSpots(unsigned max) const
+{
+	vector<HotSpot> result;
+	result.reserve(blocks.size());
+	for (auto& p : blocks) {
+		HotSpot spot;
+		spot.location = getLocation(p.second.key);
+		spot.time = p.second.time;
+		spot.count = p.second.count;
+		result.push_back(spot);
+	}
+	auto middle = result.begin() + std::min<size_t>(max, result.size());
+	std::partial_sort(result.begin(), middle, result.end(),
+		[](const HotSpot& x, const HotSpot& y) { return x.time > y.time; });
+	result.erase(middle, result.end());
+	return result;
+}
+
+vector<CPUProfiler::CallEdge> CPUProfiler::getCallEdges(unsigned max) const
+{
+	vector<CallEdge> result;
+	result.reserve(edges.size());
+	for (auto& p : edges) {
+		CallEdge edge;
+		edge.hasCaller = p.first.first != uint64_t(-1);
+		edge.caller = getLocation(edge.hasCaller ? p.first.first : 0);
+		edge.callee = getLocation(p.first.second);
+		edge.time = p.second.time;
+		edge.count = p.second.count;
+		result.push_back(edge);
+	}
+	auto middle = result.begin() + std::min<size_t>(max, result.size());
+	std::partial_sort(result.begin(), middle, result.end(),
+		[](const CallEdge& x, const CallEdge& y) { return x.time > y.time; });
+	result.erase(middle, result.end());
+	return result;
+}
+
+} // namespace openmsx
@@ -0,0 +1,164 @@
+#ifndef CPUPROFILER_HH
+#define CPUPROFILER_HH
+
+#include "CacheLine.hh"
+#include "EmuTime.hh"
+#include "noncopyable.hh"
+#include "likely.hh"
+#include <unordered_map>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+namespace openmsx {
+
+class MSXMotherBoard;
+
+/** Execution profiler for the Z80/R800.
+  *
+  * The CPU only informs the profiler about control transfers that are
+  * actually taken (jumps, calls, returns and accepted interrupts), so about
+  * the boundaries of the executed basic blocks. The emulated time between
+  * two such transfers is attributed to the block that starts at the target
+  * of the first one (this includes the time spent in HALT). A block is
+  * identified by its start address together with the slot and the (mapper
+  * or ROM) segment that were visible at that address.
+  *
+  * Calls (including interrupts) and returns are matched with a shadow call
+  * stack. This gives, per caller-callee pair, the number of calls and the
+  * time spent in the callee (including its sub-calls).
+  *
+  * Not stored in savestates.
+  */
+class CPUProfiler : private noncopyable
+{
+public:
+	/** Slot, segment and address of a block. 'ss' is -1 for a
+	  * non-expanded slot, 'segment' is -1 if the device has no segments.
+	  */
+	struct Location {
+		int ps;
+		int ss;
+		int segment;
+		unsigned address;
+	};
+	struct HotSpot {
+		Location location;
+		uint64_t time;  // EmuDuration units
+		uint64_t count; // number of times the block was entered
+	};
+	struct CallEdge {
+		bool hasCaller; // false for calls made from the top level
+		Location caller;
+		Location callee;
+		uint64_t time;  // including sub-calls, EmuDuration units
+		uint64_t count;
+	};
+
+	explicit CPUProfiler(MSXMotherBoard& motherBoard);
+	~CPUProfiler();
+
+	/** (Re)start measuring, previous results are kept. */
+	void start(EmuTime::param time);
+	/** Discard all results. */
+	void clear();
+
+	/** Must be called when the memory mapping changes, see
+	  * MSXCPU::invalidateMemCache(). */
+	void invalidate(unsigned start, unsigned size);
+
+	// Called by CPUCore on taken control transfers. 'pc' is the new
+	// program counter, 'sp' the address of the return address on the
+	// stack and 'time' the time at the end of the instruction.
+	inline void jump(unsigned pc, EmuTime::param time) {
+		advance(time);
+		enter(pc);
+	}
+	inline void call(unsigned pc, unsigned sp, EmuTime::param time) {
+		advance(time);
+		enter(pc);
+		pushFrame(sp);
+	}
+	inline void ret(unsigned pc, unsigned sp, EmuTime::param time) {
+		advance(time);
+		popFrame(sp);
+		enter(pc);
+	}
+
+	/** Total measured time (EmuDuration units). */
+	uint64_t getTotalTime() const { return elapsed; }
+	/** The (at most 'max') blocks with the most time, sorted on time. */
+	std::vector<HotSpot> getHotSpots(unsigned max) const;
+	/** The (at most 'max') call edges with the most time, sorted on time. */
+	std::vector<CallEdge> getCallEdges(unsigned max) const;
+
+private:
+	// A block key is ((region << 16) | address), see lookupRegion().
+	struct Block {
+		uint64_t key;
+		uint64_t time;
+		uint64_t count;
+	};
+	struct Edge {
+		uint64_t time;
+		uint64_t count;
+	};
+	typedef std::pair<uint64_t, uint64_t> EdgeKey; // caller, callee
+	struct EdgeHash {
+		size_t operator()(const EdgeKey& k) const {
+			return size_t(k.first * 0x9E3779B97F4A7C15ull ^ k.second);
+		}
+	};
+	struct Frame {
+		unsigned sp;
+		uint64_t callee;
+		Edge* edge;
+		uint64_t start; // value of 'elapsed' at the time of the call
+	};
+
+	inline void advance(EmuTime::param time) {
+		if (likely(time > lastTime)) {
+			uint64_t duration = (time - lastTime).length();
+			current->time += duration;
+			elapsed += duration;
+		}
+		lastTime = time;
+	}
+	inline void enter(unsigned pc) {
+		unsigned region = regions[pc >> CacheLine::BITS];
+		if (unlikely(region == INVALID_REGION)) {
+			region = lookupRegion(pc);
+		}
+		uint64_t key = (uint64_t(region) << 16) | pc;
+		Block* block = blockCache[pc];
+		if (unlikely(!block || (block->key != key))) {
+			block = lookupBlock(key);
+		}
+		++block->count;
+		current = block;
+	}
+	unsigned lookupRegion(unsigned address);
+	Block* lookupBlock(uint64_t key);
+	void pushFrame(unsigned sp);
+	void popFrame(unsigned sp);
+	static Location getLocation(uint64_t key);
+
+	static const unsigned INVALID_REGION = unsigned(-1);
+
+	MSXMotherBoard& motherBoard;
+	std::unordered_map<uint64_t, Block> blocks;
+	std::unordered_map<EdgeKey, Edge, EdgeHash> edges;
+	std::vector<Frame> stack;
+	// Most recently used block per address and the region (slot and
+	// segment) per cache line, to avoid most hash map lookups.
+	std::vector<Block*> blockCache;
+	unsigned regions[CacheLine::NUM];
+	Block unknown; // time before the first control transfer
+	Block* current;
+	EmuTime lastTime;
+	uint64_t elapsed;
+};
+
+} // namespace openmsx
+
+#endif
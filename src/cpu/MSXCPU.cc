@@ -7,6 +7,7 @@
 #include "IntegerSetting.hh"
 #include "TclCallback.hh"
 #include "CPUCore.hh"
+#include "CPUProfiler.hh"
 #include "Z80.hh"
 #include "R800.hh"
 #include "InfoTopic.hh"
@@ -81,7 +82,9 @@ MSXCPU::MSXCPU(MSXMotherBoard& motherboard_)
 			motherboard.getMachineInfoCommand(), "r800_freq", *r800)
 		: nullptr)
 	, debuggable(make_unique<MSXCPUDebuggable>(motherboard_, *this))
+	, profiler(make_unique<CPUProfiler>(motherboard_))
 	, reference(EmuTime::zero)
+	, profiling(false)
 {
 	z80Active = true; // setActiveCPU(CPU_Z80);
 	newZ80Active = z80Active;
@@ -193,10 +196,16 @@ void MSXCPU::updateVisiblePage(byte page, byte primarySlot, byte secondarySlot)
 	if (r800) r800->updateVisiblePage(page, primarySlot, secondarySlot);
 }
 
+void MSXCPU::updateVisibleSlot(byte page)
+{
+	if (profiling) profiler->invalidate(page * 0x4000, 0x4000);
+}
+
 void MSXCPU::invalidateMemCache(word start, unsigned size)
 {
 	z80Active ? z80 ->invalidateMemCache(start, size)
 	          : r800->invalidateMemCache(start, size);
+	if (profiling) profiler->invalidate(start, size);
 }
 
 void MSXCPU::raiseIRQ()
@@ -275,6 +284,23 @@ void MSXCPU::disasmCommand(const vector<TclObject>& tokens,
 	          : r800->disasmCommand(tokens, result);
 }
 
+void MSXCPU::setProfiling(bool enabled)
+{
+	if (enabled && !profiling) {
+		profiler->start(getCurrentTime());
+	}
+	profiling = enabled;
+	CPUProfiler* p = enabled ? profiler.get() : nullptr;
+	          z80 ->setProfiler(p);
+	if (r800) r800->setProfiler(p);
+}
+
+unsigned MSXCPU::getFreq() const
+{
+	return z80Active ? z80 ->getFreq()
+	                 : r800->getFreq();
+}
+
 void MSXCPU::setPaused(bool paused)
 {
 	if (z80Active) {
@@ -15,6 +15,7 @@ class MSXMotherBoard;
 class MSXCPUInterface;
 class BooleanSetting;
 class CPURegs;
+class CPUProfiler;
 class Z80TYPE;
 class R800TYPE;
 template <typename T> class CPUCore;
@@ -49,6 +50,11 @@ public:
 	  * update memory timings on R800. */
 	void updateVisiblePage(byte page, byte primarySlot, byte secondarySlot);
 
+	/** Inform CPU of a slot switch that didn't change the visible device
+	  * (e.g. between two empty slots). Only the profiler needs this, it
+	  * identifies code by slot. */
+	void updateVisibleSlot(byte page);
+
 	/** Invalidate the CPU its cache for the interval [start, start + size)
 	  * For example MSXMemoryMapper and MSXGameCartrigde need to call this
 	  * method when a 'memory switch' occurs. */
@@ -103,6 +109,15 @@ public:
 	void disasmCommand(const std::vector<TclObject>& tokens,
                            TclObject& result) const;
 
+	/** Start/stop the execution profiler (of both Z80 and R800).
+	  * The results are kept when profiling is stopped. */
+	void setProfiling(bool enabled);
+	bool isProfiling() const { return profiling; }
+	CPUProfiler& getProfiler() { return *profiler; }
+
+	/** Clock frequency of the active CPU. */
+	unsigned getFreq() const;
+
 	/** (un)pause CPU. During pause the CPU executes NOP instructions
 	  * continuously (just like during HALT). Used by turbor hw pause. */
 	void setPaused(bool paused);
@@ -145,10 +160,12 @@ private:
 	const std::unique_ptr<CPUFreqInfoTopic> z80FreqInfo;
 	const std::unique_ptr<CPUFreqInfoTopic> r800FreqInfo;
 	const std::unique_ptr<MSXCPUDebuggable> debuggable;
+	const std::unique_ptr<CPUProfiler> profiler;
 
 	EmuTime reference;
 	bool z80Active;
 	bool newZ80Active;
+	bool profiling;
 };
 SERIALIZE_CLASS_VERSION(MSXCPU, 2);
 
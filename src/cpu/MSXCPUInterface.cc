@@ -28,6 +28,7 @@
 #include <iomanip>
 #include <algorithm>
 #include <iostream>
+#include <cassert>
 #include <cstring>
 #include <iterator>
 
@@ -45,6 +46,7 @@ public:
 	            MSXMotherBoard& motherBoard);
 	virtual byte read(unsigned address, EmuTime::param time);
 	virtual void write(unsigned address, byte value, EmuTime::param time);
+	virtual void readBlock(unsigned start, byte* output, unsigned num);
 private:
 	MSXCPUInterface& interface;
 };
@@ -56,6 +58,7 @@ public:
 	                   MSXMotherBoard& motherBoard);
 	virtual byte read(unsigned address, EmuTime::param time);
 	virtual void write(unsigned address, byte value, EmuTime::param time);
+	virtual void readBlock(unsigned start, byte* output, unsigned num);
 private:
 	MSXCPUInterface& interface;
 };
@@ -627,6 +630,8 @@ ALWAYS_INLINE void MSXCPUInterface::updateVisible(int page, int ps, int ss)
 	if (visibleDevices[page] != newDevice) {
 		visibleDevices[page] = newDevice;
 		msxcpu.updateVisiblePage(page, ps, ss);
+	} else {
+		msxcpu.updateVisibleSlot(page);
 	}
 }
 void MSXCPUInterface::updateVisible(int page)
@@ -734,6 +739,57 @@ byte MSXCPUInterface::peekSlottedMem(unsigned address, EmuTime::param time) cons
 	}
 }
 
+// Copies the part of a cache line starting at 'address' (at most 'num'
+// bytes) when the device allows it (see MSXDevice::peekMem()). Returns the
+// number of copied bytes, 0 when the line is not cacheable.
+static unsigned peekCacheLine(const MSXDevice& device, word address,
+                              byte* output, unsigned num)
+{
+	unsigned offset = address & CacheLine::LOW;
+	if ((address | CacheLine::LOW) == 0xFFFF) {
+		// might contain the secondary slot select register
+		return 0;
+	}
+	const byte* line = device.getReadCacheLine(address & CacheLine::HIGH);
+	if (!line) return 0;
+	unsigned n = std::min(num, CacheLine::SIZE - offset);
+	memcpy(output, line + offset, n);
+	return n;
+}
+
+void MSXCPUInterface::peekMemBlock(unsigned start, byte* output,
+                                   unsigned num, EmuTime::param time) const
+{
+	assert((start + num) <= 0x10000);
+	while (num) {
+		unsigned n = peekCacheLine(*visibleDevices[start >> 14],
+		                           start, output, num);
+		if (n == 0) {
+			*output = peekMem(start, time);
+			n = 1;
+		}
+		start += n; output += n; num -= n;
+	}
+}
+
+void MSXCPUInterface::peekSlottedMemBlock(unsigned start, byte* output,
+                                          unsigned num, EmuTime::param time) const
+{
+	assert((start + num) <= 0x10000 * 4 * 4);
+	while (num) {
+		unsigned primSlot = (start & 0xC0000) >> 18;
+		unsigned subSlot = isExpanded(primSlot) ? (start & 0x30000) >> 16 : 0;
+		unsigned page = (start & 0x0C000) >> 14;
+		unsigned n = peekCacheLine(*slotLayout[primSlot][subSlot][page],
+		                           start & 0xFFFF, output, num);
+		if (n == 0) {
+			*output = peekSlottedMem(start, time);
+			n = 1;
+		}
+		start += n; output += n; num -= n;
+	}
+}
+
 byte MSXCPUInterface::readSlottedMem(unsigned address, EmuTime::param time)
 {
 	byte primSlot = (address & 0xC0000) >> 18;
@@ -1058,6 +1114,12 @@ void MemoryDebug::write(unsigned address, byte value,
 	return interface.writeMem(address, value, time);
 }
 
+void MemoryDebug::readBlock(unsigned start, byte* output, unsigned num)
+{
+	interface.peekMemBlock(start, output, num,
+	                       getMotherBoard().getCurrentTime());
+}
+
 
 // class SlottedMemoryDebug
 
@@ -1080,6 +1142,12 @@ void SlottedMemoryDebug::write(unsigned address, byte value,
 	return interface.writeSlottedMem(address, value, time);
 }
 
+void SlottedMemoryDebug::readBlock(unsigned start, byte* output, unsigned num)
+{
+	interface.peekSlottedMemBlock(start, output, num,
+	                              getMotherBoard().getCurrentTime());
+}
+
 
 // class SubSlottedInfo
 
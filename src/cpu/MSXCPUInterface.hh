@@ -181,6 +181,12 @@ public:
 	 */
 	byte peekMem(word address, EmuTime::param time) const;
 	byte peekSlottedMem(unsigned address, EmuTime::param time) const;
+	/** Same as peekMem() / peekSlottedMem() for 'num' consecutive
+	  * addresses, but cacheable regions are copied in one go. */
+	void peekMemBlock(unsigned start, byte* output, unsigned num,
+	                  EmuTime::param time) const;
+	void peekSlottedMemBlock(unsigned start, byte* output, unsigned num,
+	                         EmuTime::param time) const;
 	byte readSlottedMem(unsigned address, EmuTime::param time);
 	void writeSlottedMem(unsigned address, byte value,
 	                     EmuTime::param time);
@@ -189,6 +195,12 @@ public:
 	void unsetExpanded(int ps);
 	void testUnsetExpanded(int ps, std::vector<MSXDevice*> allowed) const;
 	inline bool isExpanded(int ps) const { return expanded[ps] != 0; }
+
+	/** The currently selected primary/secondary slot and the device that
+	  * is visible in the given page [0..3]. */
+	int getPrimarySlot  (int page) const { return primarySlotState[page]; }
+	int getSecondarySlot(int page) const { return secondarySlotState[page]; }
+	MSXDevice* getVisibleMSXDevice(int page) const { return visibleDevices[page]; }
 	void changeExpanded(bool isExpanded);
 
 	DummyDevice& getDummyDevice();
@@ -157,4 +157,9 @@ byte* MSXMultiMemDevice::getWriteCacheLine(word start) const
 	return searchDevice(start)->getWriteCacheLine(start);
 }
 
+int MSXMultiMemDevice::getSegment(word address) const
+{
+	return searchDevice(address)->getSegment(address);
+}
+
 } // namespace openmsx
@@ -26,6 +26,7 @@ public:
 	virtual void writeMem(word address, byte value, EmuTime::param time);
 	virtual const byte* getReadCacheLine(word start) const;
 	virtual byte* getWriteCacheLine(word start) const;
+	virtual int getSegment(word address) const;
 
 private:
 	struct Range {
@@ -0,0 +1,203 @@
+#include "DebugStream.hh"
+#include "Debuggable.hh"
+#include "MSXMotherBoard.hh"
+#include "Reactor.hh"
+#include "EventDistributor.hh"
+#include "FinishFrameEvent.hh"
+#include "CliComm.hh"
+#include "Base64.hh"
+#include "StringOp.hh"
+#include "checked_cast.hh"
+#include <cstring>
+#include <cassert>
+
+using std::string;
+using std::vector;
+
+namespace openmsx {
+
+// Changed bytes separated by at most this many unchanged bytes are put in the
+// same record (a new record costs at least 2 bytes).
+static const unsigned MAX_GAP = 2;
+
+unsigned DebugStream::lastId = 0;
+
+DebugStream::DebugStream(
+		MSXMotherBoard& motherBoard_, Debuggable& debuggable_,
+		const string& debuggableName_, unsigned start_, unsigned size_,
+		Type type_, unsigned frames_, EmuDuration::param period_,
+		unsigned newId /*= -1*/)
+	: Schedulable(motherBoard_.getScheduler())
+	, motherBoard(motherBoard_)
+	, debuggable(debuggable_)
+	, debuggableName(debuggableName_)
+	, start(start_)
+	, size(size_)
+	, type(type_)
+	, frames(frames_)
+	, period(period_)
+	, id((newId == unsigned(-1)) ? ++lastId : newId)
+	, snapshot(size)
+	, current(size)
+	, frameCount(0)
+	, valid(false)
+{
+	if (type == FRAME) {
+		assert(frames != 0);
+		motherBoard.getReactor().getEventDistributor().registerEventListener(
+			OPENMSX_FINISH_FRAME_EVENT, *this);
+	} else {
+		assert(period != EmuDuration::zero);
+		setSyncPoint(getCurrentTime() + period);
+	}
+}
+
+DebugStream::~DebugStream()
+{
+	if (type == FRAME) {
+		motherBoard.getReactor().getEventDistributor().unregisterEventListener(
+			OPENMSX_FINISH_FRAME_EVENT, *this);
+	}
+}
+
+void DebugStream::copySnapshot(const DebugStream& other)
+{
+	if (other.valid && (other.size == size)) {
+		memcpy(snapshot.data(), other.snapshot.data(), size);
+		valid = true;
+	}
+}
+
+void DebugStream::check()
+{
+	debuggable.readBlock(start, current.data(), size);
+	encodeDiff(valid ? snapshot.data() : nullptr, current.data(), size, diff);
+	snapshot.swap(current);
+	valid = true;
+	if (diff.empty()) return;
+
+	motherBoard.getMSXCliComm().update(
+		CliComm::DEBUGGABLE, StringOp::Builder() << "ds#" << id,
+		Base64::encode(diff.data(), diff.size()));
+}
+
+void DebugStream::executeUntil(EmuTime::param time, int /*userData*/)
+{
+	check();
+	setSyncPoint(time + period);
+}
+
+int DebugStream::signalEvent(const std::shared_ptr<const Event>& event)
+{
+	// There's an event per video source, only count the one of the
+	// selected source. Other (inactive) machines don't advance.
+	auto& ffe = checked_cast<const FinishFrameEvent&>(*event);
+	if (ffe.getSource() != ffe.getSelectedSource()) return 0;
+	if (!motherBoard.isActive()) return 0;
+
+	if (++frameCount < frames) return 0;
+	frameCount = 0;
+	check();
+	return 0;
+}
+
+
+static void putNumber(vector<byte>& result, unsigned n)
+{
+	while (n >= 0x80) {
+		result.push_back(byte(n) | 0x80);
+		n >>= 7;
+	}
+	result.push_back(byte(n));
+}
+
+static bool getNumber(const byte*& p, const byte* end, unsigned& n)
+{
+	n = 0;
+	for (unsigned shift = 0; shift < 32; shift += 7) {
+		if (p == end) return false;
+		byte b = *p++;
+		n |= unsigned(b & 0x7F) << shift;
+		if (!(b & 0x80)) return true;
+	}
+	return false;
+}
+
+// Returns the position of the first differing byte at or after 'pos', or
+// 'size' when there is none.
+static unsigned findChanged(const byte* oldData, const byte* newData,
+                            unsigned pos, unsigned size)
+{
+	// usually most of the range is unchanged, skip that in big steps
+	static const unsigned CHUNK = 64;
+	while (((size - pos) >= CHUNK) &&
+	       (memcmp(oldData + pos, newData + pos, CHUNK) == 0)) {
+		pos += CHUNK;
+	}
+	while ((pos < size) && (oldData[pos] == newData[pos])) {
+		++pos;
+	}
+	return pos;
+}
+
+void DebugStream::encodeDiff(const byte* oldData, const byte* newData,
+                             unsigned size, vector<byte>& result)
+{
+	result.clear();
+	if (!oldData) {
+		if (size) {
+			putNumber(result, 0);
+			putNumber(result, size);
+			result.insert(result.end(), newData, newData + size);
+		}
+		return;
+	}
+
+	unsigned last = 0;
+	unsigned pos = 0;
+	while ((pos = findChanged(oldData, newData, pos, size)) != size) {
+		unsigned end = pos + 1;
+		while (end < size) {
+			if (oldData[end] != newData[end]) {
+				++end;
+				continue;
+			}
+			unsigned gapEnd = end + 1;
+			while ((gapEnd < size) && ((gapEnd - end) <= MAX_GAP) &&
+			       (oldData[gapEnd] == newData[gapEnd])) {
+				++gapEnd;
+			}
+			if ((gapEnd == size) || ((gapEnd - end) > MAX_GAP)) break;
+			end = gapEnd; // small gap, continue this record
+		}
+		putNumber(result, pos - last);
+		putNumber(result, end - pos);
+		result.insert(result.end(), newData + pos, newData + end);
+		last = pos = end;
+	}
+}
+
+bool DebugStream::decodeDiff(const byte* diff, size_t diffSize,
+                             byte* data, unsigned size)
+{
+	const byte* p = diff;
+	const byte* end = diff + diffSize;
+	unsigned pos = 0;
+	while (p != end) {
+		unsigned skip, len;
+		if (!getNumber(p, end, skip) || !getNumber(p, end, len)) {
+			return false;
+		}
+		if (skip > (size - pos)) return false;
+		pos += skip;
+		if ((len > (size - pos)) || (len > size_t(end - p))) {
+			return false;
+		}
+		memcpy(data + pos, p, len);
+		p += len;
+		pos += len;
+	}
+	return true;
+}
+
+} // namespace openmsx
@@ -0,0 +1,106 @@
+#ifndef DEBUGSTREAM_HH
+#define DEBUGSTREAM_HH
+
+#include "Schedulable.hh"
+#include "EventListener.hh"
+#include "EmuDuration.hh"
+#include "MemBuffer.hh"
+#include "openmsx.hh"
+#include <string>
+#include <vector>
+
+namespace openmsx {
+
+class MSXMotherBoard;
+class Debuggable;
+
+/** Pushes the changes in a range of a debuggable to the CliComm listeners.
+  *
+  * Once per (N) frame(s) or once per time interval the range is read (in one
+  * go, see Debuggable::readBlock()) and compared with the content of the
+  * previous check. The changed bytes are sent as a 'debuggable' update with
+  * the id of the stream as name, so external tools don't have to poll with
+  * (many) 'debug read_block' commands. The first update contains the whole
+  * range. Nothing is sent when nothing changed.
+  *
+  * See encodeDiff() for the format of the update.
+  */
+class DebugStream : private Schedulable, private EventListener
+{
+public:
+	enum Type { FRAME, TIME };
+
+	DebugStream(MSXMotherBoard& motherBoard, Debuggable& debuggable,
+	            const std::string& debuggableName,
+	            unsigned start, unsigned size,
+	            Type type, unsigned frames, EmuDuration::param period,
+	            unsigned newId = -1);
+	~DebugStream();
+
+	unsigned getId() const { return id; }
+	const std::string& getDebuggableName() const { return debuggableName; }
+	const Debuggable& getDebuggable() const { return debuggable; }
+	unsigned getStart() const { return start; }
+	unsigned getSize() const { return size; }
+	Type getType() const { return type; }
+	unsigned getFrames() const { return frames; }
+	EmuDuration::param getPeriod() const { return period; }
+
+	/** Continue where the given stream (of a previous machine, see
+	  * Debugger::transfer()) left off: only send what changed since its
+	  * last update. */
+	void copySnapshot(const DebugStream& other);
+
+	/** Compare the range with the previous check and send the changes. */
+	void check();
+
+	/** Encode the differences between two buffers of the given size.
+	  * The result is a sequence of records:
+	  *   <skip> <length> <length bytes>
+	  * where skip is the number of unchanged bytes since the end of the
+	  * previous record (or since the start of the range) and both skip
+	  * and length are unsigned LEB128 numbers (7 bits per byte, least
+	  * significant group first, the high bit is set on all but the last
+	  * byte). Changed bytes that are only separated by a few unchanged
+	  * bytes are put in the same record. When 'oldData' is nullptr
+	  * all bytes are taken as changed.
+	  * The result is empty when nothing changed.
+	  */
+	static void encodeDiff(const byte* oldData, const byte* newData,
+	                       unsigned size, std::vector<byte>& result);
+
+	/** Apply the result of encodeDiff() to the given buffer.
+	  * @result false when the diff is malformed or doesn't fit.
+	  */
+	static bool decodeDiff(const byte* diff, size_t diffSize,
+	                       byte* data, unsigned size);
+
+private:
+	// Schedulable
+	virtual void executeUntil(EmuTime::param time, int userData);
+
+	// EventListener
+	virtual int signalEvent(const std::shared_ptr<const Event>& event);
+
+	MSXMotherBoard& motherBoard;
+	Debuggable& debuggable;
+	const std::string debuggableName;
+	const unsigned start;
+	const unsigned size;
+	const Type type;
+	const unsigned frames;
+	const EmuDuration period;
+	const unsigned id;
+
+	MemBuffer<byte> snapshot;
+	MemBuffer<byte> current;
+	std::vector<byte> diff;
+	unsigned frameCount;
+	bool valid; // has snapshot been filled in?
+
+	static unsigned lastId;
+};
+
+} // namespace openmsx
+
+#endif
@@ -14,6 +14,22 @@ public:
 	virtual byte read(unsigned address) = 0;
 	virtual void write(unsigned address, byte value) = 0;
 
+	/** Read or write 'num' consecutive bytes, starting at 'start'. The
+	  * range must lie within [0, getSize()). The default implementations
+	  * simply handle the bytes one by one, debuggables that can do this
+	  * faster (e.g. plain memory) override them.
+	  */
+	virtual void readBlock(unsigned start, byte* output, unsigned num) {
+		for (unsigned i = 0; i < num; ++i) {
+			output[i] = read(start + i);
+		}
+	}
+	virtual void writeBlock(unsigned start, const byte* input, unsigned num) {
+		for (unsigned i = 0; i < num; ++i) {
+			write(start + i, input[i]);
+		}
+	}
+
 protected:
 	Debuggable() {}
 	virtual ~Debuggable() {}
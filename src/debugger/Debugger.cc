@@ -2,9 +2,11 @@
 #include "Debuggable.hh"
 #include "Probe.hh"
 #include "ProbeBreakPoint.hh"
+#include "MemorySearch.hh"
 #include "MSXMotherBoard.hh"
 #include "Reactor.hh"
 #include "MSXCPU.hh"
+#include "CPUProfiler.hh"
 #include "MSXCPUInterface.hh"
 #include "BreakPoint.hh"
 #include "DebugCondition.hh"
@@ -17,6 +19,7 @@
 #include "KeyRange.hh"
 #include "unreachable.hh"
 #include "memory.hh"
+#include <algorithm>
 #include <cassert>
 
 using std::shared_ptr;
@@ -78,6 +81,22 @@ private:
 	                     TclObject& result);
 	void listConditions(const vector<TclObject>& tokens,
 	                    TclObject& result);
+	void setStream(const vector<TclObject>& tokens,
+	               TclObject& result);
+	void removeStream(const vector<TclObject>& tokens,
+	                  TclObject& result);
+	void listStreams(const vector<TclObject>& tokens,
+	                 TclObject& result);
+	vector<string> getStreamIds() const;
+	void search(const vector<TclObject>& tokens,
+	            TclObject& result);
+	void searchStart(const vector<TclObject>& tokens,
+	                 TclObject& result);
+	void searchList(const vector<TclObject>& tokens,
+	                TclObject& result);
+	MemorySearch& getSearch(Debuggable*& debuggable);
+	void profile(const vector<TclObject>& tokens,
+	             TclObject& result);
 	void probe(const vector<TclObject>& tokens,
 	           TclObject& result);
 	void probeList(const vector<TclObject>& tokens,
@@ -132,6 +151,12 @@ void Debugger::unregisterDebuggable(string_ref name, Debuggable& debuggable)
 	auto it = debuggables.find(name);
 	assert(it != debuggables.end() && (it->second == &debuggable));
 	debuggables.erase(it);
+
+	// streams on this debuggable end together with it
+	debugStreams.erase(std::remove_if(debugStreams.begin(), debugStreams.end(),
+		[&](DebugStreams::value_type& v) {
+			return &v->getDebuggable() == &debuggable; }),
+		debugStreams.end());
 }
 
 Debuggable* Debugger::findDebuggable(string_ref name)
@@ -258,6 +283,34 @@ unsigned Debugger::setWatchPoint(TclObject command, TclObject condition,
 	return wp->getId();
 }
 
+unsigned Debugger::insertDebugStream(
+	Debuggable& debuggable, string_ref name,
+	unsigned start, unsigned size, DebugStream::Type type,
+	unsigned frames, EmuDuration::param period, unsigned newId /*= -1*/)
+{
+	auto stream = make_unique<DebugStream>(
+		motherBoard, debuggable, name.str(), start, size,
+		type, frames, period, newId);
+	unsigned result = stream->getId();
+	debugStreams.push_back(std::move(stream));
+	return result;
+}
+
+void Debugger::removeDebugStream(string_ref name)
+{
+	if (name.starts_with("ds#")) {
+		unsigned id = stoi(name.substr(3));
+		for (auto it = debugStreams.begin();
+		     it != debugStreams.end(); ++it) {
+			if ((*it)->getId() == id) {
+				debugStreams.erase(it);
+				return;
+			}
+		}
+	}
+	throw CommandException("No such stream: " + name);
+}
+
 void Debugger::transfer(Debugger& other)
 {
 	// Copy watchpoints to new machine.
@@ -278,6 +331,24 @@ void Debugger::transfer(Debugger& other)
 		}
 	}
 
+	// Copy streams to new machine, continue from their last state.
+	assert(debugStreams.empty());
+	for (auto& ds : other.debugStreams) {
+		if (Debuggable* debuggable = findDebuggable(ds->getDebuggableName())) {
+			if ((ds->getStart() + ds->getSize()) > debuggable->getSize()) {
+				continue;
+			}
+			insertDebugStream(*debuggable, ds->getDebuggableName(),
+			                  ds->getStart(), ds->getSize(),
+			                  ds->getType(), ds->getFrames(),
+			                  ds->getPeriod(), ds->getId());
+			debugStreams.back()->copySnapshot(*ds);
+		}
+	}
+
+	// Continue the memory search (if any) on the new machine.
+	memorySearch = std::move(other.memorySearch);
+
 	// Breakpoints and conditions are (currently) global, so no need to
 	// copy those.
 }
@@ -368,6 +439,16 @@ void DebugCmd::execute(const vector<TclObject>& tokens,
 		removeCondition(tokens, result);
 	} else if (subCmd == "list_conditions") {
 		listConditions(tokens, result);
+	} else if (subCmd == "set_stream") {
+		setStream(tokens, result);
+	} else if (subCmd == "remove_stream") {
+		removeStream(tokens, result);
+	} else if (subCmd == "list_streams") {
+		listStreams(tokens, result);
+	} else if (subCmd == "search") {
+		search(tokens, result);
+	} else if (subCmd == "profile") {
+		profile(tokens, result);
 	} else if (subCmd == "probe") {
 		probe(tokens, result);
 	} else {
@@ -428,9 +509,7 @@ void DebugCmd::readBlock(const vector<TclObject>& tokens, TclObject& result)
 	}
 
 	MemBuffer<byte> buf(num);
-	for (unsigned i = 0; i < num; ++i) {
-		buf[i] = device.read(addr + i);
-	}
+	device.readBlock(addr, buf.data(), num);
 	result.setBinary(buf.data(), num);
 }
 
@@ -471,9 +550,7 @@ void DebugCmd::writeBlock(const vector<TclObject>& tokens,
 		throw CommandException("Invalid size");
 	}
 
-	for (unsigned i = 0; i < num; ++i) {
-		device.write(addr + i, static_cast<byte>(buf[i]));
-	}
+	device.writeBlock(addr, buf, num);
 }
 
 void DebugCmd::setBreakPoint(const vector<TclObject>& tokens,
@@ -749,6 +826,304 @@ void DebugCmd::listConditions(const vector<TclObject>& /*tokens*/,
 }
 
 
+void DebugCmd::setStream(const vector<TclObject>& tokens,
+                         TclObject& result)
+{
+	if ((tokens.size() != 5) && (tokens.size() != 7)) {
+		throw SyntaxError();
+	}
+	string_ref name = tokens[2].getString();
+	Debuggable& device = debugger.getDebuggable(name);
+	unsigned size = device.getSize();
+	unsigned addr = tokens[3].getInt();
+	if (addr >= size) {
+		throw CommandException("Invalid address");
+	}
+	unsigned num = tokens[4].getInt();
+	if ((num == 0) || (num > (size - addr))) {
+		throw CommandException("Invalid size");
+	}
+
+	DebugStream::Type type = DebugStream::FRAME;
+	unsigned frames = 1;
+	EmuDuration period;
+	if (tokens.size() == 7) {
+		string_ref typeStr = tokens[5].getString();
+		if (typeStr == "frame") {
+			int n = tokens[6].getInt();
+			if (n <= 0) {
+				throw CommandException("Invalid number of frames");
+			}
+			frames = n;
+		} else if (typeStr == "time") {
+			double time = tokens[6].getDouble();
+			if (time <= 0.0) {
+				throw CommandException("Invalid time");
+			}
+			type = DebugStream::TIME;
+			period = EmuDuration(time);
+			if (period == EmuDuration::zero) {
+				throw CommandException("Invalid time");
+			}
+		} else {
+			throw SyntaxError();
+		}
+	}
+
+	unsigned id = debugger.insertDebugStream(
+		device, name, addr, num, type, frames, period);
+	result.setString(StringOp::Builder() << "ds#" << id);
+}
+
+void DebugCmd::removeStream(const vector<TclObject>& tokens,
+                            TclObject& /*result*/)
+{
+	if (tokens.size() != 3) {
+		throw SyntaxError();
+	}
+	debugger.removeDebugStream(tokens[2].getString());
+}
+
+void DebugCmd::listStreams(const vector<TclObject>& /*tokens*/,
+                           TclObject& result)
+{
+	string res;
+	for (auto& ds : debugger.debugStreams) {
+		TclObject line(result.getInterpreter());
+		line.addListElement(StringOp::Builder() << "ds#" << ds->getId());
+		line.addListElement(ds->getDebuggableName());
+		line.addListElement(int(ds->getStart()));
+		line.addListElement(int(ds->getSize()));
+		if (ds->getType() == DebugStream::FRAME) {
+			line.addListElement("frame");
+			line.addListElement(int(ds->getFrames()));
+		} else {
+			line.addListElement("time");
+			line.addListElement(ds->getPeriod().toDouble());
+		}
+		res += line.getString() + '\n';
+	}
+	result.setString(res);
+}
+
+
+MemorySearch& DebugCmd::getSearch(Debuggable*& debuggable)
+{
+	if (!debugger.memorySearch) {
+		throw CommandException("No search started");
+	}
+	auto& search = *debugger.memorySearch;
+	debuggable = &debugger.getDebuggable(search.getDebuggableName());
+	return search;
+}
+
+void DebugCmd::search(const vector<TclObject>& tokens,
+                      TclObject& result)
+{
+	if (tokens.size() < 3) {
+		throw CommandException("Missing argument");
+	}
+	static const struct {
+		const char* name;
+		MemorySearch::Op op;
+	} compareOps[] = {
+		{ "eq", MemorySearch::EQUAL },
+		{ "ne", MemorySearch::NOT_EQUAL },
+		{ "lt", MemorySearch::LESS },
+		{ "gt", MemorySearch::GREATER },
+		{ "le", MemorySearch::LESS_EQUAL },
+		{ "ge", MemorySearch::GREATER_EQUAL },
+	};
+	string_ref subCmd = tokens[2].getString();
+	if (subCmd == "start") {
+		searchStart(tokens, result);
+		return;
+	} else if (subCmd == "list") {
+		searchList(tokens, result);
+		return;
+	}
+
+	Debuggable* debuggable;
+	MemorySearch& search = getSearch(debuggable);
+	unsigned maxValue = (search.getWidth() == 1) ? 0xFF : 0xFFFF;
+	const MemorySearch::Op* op = nullptr;
+	for (auto& c : compareOps) {
+		if (subCmd == c.name) op = &c.op;
+	}
+	if (op) {
+		if (tokens.size() == 3) {
+			search.compareOld(*debuggable, *op);
+		} else if (tokens.size() == 4) {
+			unsigned value = tokens[3].getInt();
+			if (value > maxValue) {
+				throw CommandException("Value out of range");
+			}
+			search.compareValue(*debuggable, *op, value);
+		} else {
+			throw SyntaxError();
+		}
+	} else if ((subCmd == "changed") || (subCmd == "unchanged")) {
+		if (tokens.size() != 3) {
+			throw SyntaxError();
+		}
+		search.compareOld(*debuggable, (subCmd == "changed")
+			? MemorySearch::NOT_EQUAL : MemorySearch::EQUAL);
+	} else if (subCmd == "delta") {
+		if (tokens.size() != 4) {
+			throw SyntaxError();
+		}
+		search.compareOld(*debuggable, MemorySearch::EQUAL,
+		                  tokens[3].getInt());
+	} else if (subCmd == "range") {
+		if (tokens.size() != 5) {
+			throw SyntaxError();
+		}
+		search.keepRange(*debuggable,
+		                 tokens[3].getInt(), tokens[4].getInt());
+	} else if (subCmd == "keep") {
+		if (tokens.size() != 4) {
+			throw SyntaxError();
+		}
+		vector<unsigned> addresses;
+		unsigned num = tokens[3].getListLength();
+		for (unsigned i = 0; i < num; ++i) {
+			addresses.push_back(tokens[3].getListIndex(i).getInt());
+		}
+		search.keepAddresses(*debuggable, addresses);
+	} else if (subCmd == "count") {
+		if (tokens.size() != 3) {
+			throw SyntaxError();
+		}
+	} else {
+		throw SyntaxError();
+	}
+	result.setInt(search.count());
+}
+
+void DebugCmd::searchStart(const vector<TclObject>& tokens,
+                           TclObject& result)
+{
+	if ((tokens.size() != 4) && (tokens.size() != 5)) {
+		throw SyntaxError();
+	}
+	string_ref name = tokens[3].getString();
+	Debuggable& debuggable = debugger.getDebuggable(name);
+	unsigned width = 1;
+	if (tokens.size() == 5) {
+		int bits = tokens[4].getInt();
+		if ((bits != 8) && (bits != 16)) {
+			throw CommandException("Width must be 8 or 16");
+		}
+		width = bits / 8;
+	}
+	debugger.memorySearch = make_unique<MemorySearch>(
+		debuggable, name.str(), width);
+	result.setInt(debugger.memorySearch->count());
+}
+
+void DebugCmd::searchList(const vector<TclObject>& tokens,
+                          TclObject& result)
+{
+	unsigned max = unsigned(-1);
+	if (tokens.size() == 4) {
+		max = tokens[3].getInt();
+	} else if (tokens.size() != 3) {
+		throw SyntaxError();
+	}
+	Debuggable* debuggable;
+	MemorySearch& search = getSearch(debuggable);
+	for (auto& r : search.getCandidates(max)) {
+		TclObject line(result.getInterpreter());
+		line.addListElement(int(r.address));
+		line.addListElement(int(r.oldValue));
+		line.addListElement(int(r.newValue));
+		result.addListElement(line);
+	}
+}
+
+static void addLocation(TclObject& result,
+                        const CPUProfiler::Location& location)
+{
+	result.addListElement(location.ps);
+	if (location.ss == -1) {
+		result.addListElement("X");
+	} else {
+		result.addListElement(location.ss);
+	}
+	if (location.segment == -1) {
+		result.addListElement("X");
+	} else {
+		result.addListElement(location.segment);
+	}
+	result.addListElement(int(location.address));
+}
+
+void DebugCmd::profile(const vector<TclObject>& tokens,
+                       TclObject& result)
+{
+	if (tokens.size() < 3) {
+		throw CommandException("Missing argument");
+	}
+	MSXCPU& cpu = *debugger.cpu;
+	CPUProfiler& profiler = cpu.getProfiler();
+	// report in cycles of the active CPU
+	double cyclesPerUnit = double(cpu.getFreq()) / MAIN_FREQ;
+	auto toCycles = [&](uint64_t time) {
+		return StringOp::toString(
+			static_cast<unsigned long long>(time * cyclesPerUnit));
+	};
+
+	string_ref subCmd = tokens[2].getString();
+	unsigned max = unsigned(-1);
+	if ((subCmd == "hotspots") || (subCmd == "calls")) {
+		if (tokens.size() == 4) {
+			max = tokens[3].getInt();
+		} else if (tokens.size() != 3) {
+			throw SyntaxError();
+		}
+	} else if (tokens.size() != 3) {
+		throw SyntaxError();
+	}
+
+	if (subCmd == "start") {
+		cpu.setProfiling(true);
+	} else if (subCmd == "stop") {
+		cpu.setProfiling(false);
+	} else if (subCmd == "clear") {
+		profiler.clear();
+	} else if (subCmd == "enabled") {
+		result.setInt(cpu.isProfiling());
+	} else if (subCmd == "total") {
+		result.setString(toCycles(profiler.getTotalTime()));
+	} else if (subCmd == "hotspots") {
+		for (auto& spot : profiler.getHotSpots(max)) {
+			TclObject line(result.getInterpreter());
+			addLocation(line, spot.location);
+			line.addListElement(toCycles(spot.time));
+			line.addListElement(StringOp::toString(
+				static_cast<unsigned long long>(spot.count)));
+			result.addListElement(line);
+		}
+	} else if (subCmd == "calls") {
+		for (auto& edge : profiler.getCallEdges(max)) {
+			TclObject caller(result.getInterpreter());
+			if (edge.hasCaller) addLocation(caller, edge.caller);
+			TclObject callee(result.getInterpreter());
+			addLocation(callee, edge.callee);
+			TclObject line(result.getInterpreter());
+			line.addListElement(caller);
+			line.addListElement(callee);
+			line.addListElement(StringOp::toString(
+				static_cast<unsigned long long>(edge.count)));
+			line.addListElement(toCycles(edge.time));
+			result.addListElement(line);
+		}
+	} else {
+		throw SyntaxError();
+	}
+}
+
+
 void DebugCmd::probe(const vector<TclObject>& tokens,
                      TclObject& result)
 {
@@ -868,6 +1243,11 @@ string DebugCmd::help(const vector<string>& tokens) const
 		"    set_condition     insert a new condition\n"
 		"    remove_condition  remove a certain condition\n"
 		"    list_conditions   list the active conditions\n"
+		"    set_stream        push the changes in a debuggable\n"
+		"    remove_stream     remove a certain stream\n"
+		"    list_streams      list the active streams\n"
+		"    search            search for values in a debuggable\n"
+		"    profile           profile the executed code\n"
 		"    probe             probe related subcommands\n"
 		"    cont              continue execution after break\n"
 		"    step              execute one instruction\n"
@@ -998,6 +1378,87 @@ string DebugCmd::help(const vector<string>& tokens) const
 		"  Lists all active conditions. The result is similar to the "
 		"'list_bp' subcommand, but without the 2nd column that would "
 		"show the address.\n";
+	static const string setStreamHelp =
+		"debug set_stream <name> <addr> <size> [frame <n> | time <seconds>]\n"
+		"  Send the changes in the given block of the given debuggable "
+		"to the controlling applications (see the openMSX control "
+		"protocol), instead of having them poll it with the 'read_block' "
+		"subcommand. The block is checked at the end of every <n> frames "
+		"(by default every frame) or every <seconds> of emulated time.\n"
+		"  The changes are sent as an update of type 'debuggable' (use "
+		"'openmsx_update enable debuggable' to receive them) with the ID "
+		"of the stream as name. The first update contains the whole "
+		"block, no update is sent when nothing changed. The content of "
+		"an update is base64 encoded, the decoded data is a sequence "
+		"of records: <skip> <length> <length bytes>. Skip is the number "
+		"of unchanged bytes since the end of the previous record (or "
+		"since the start of the block), both skip and length are "
+		"unsigned LEB128 numbers.\n"
+		"  The result of this command is a stream ID. This ID can later "
+		"be used to remove this stream again.\n"
+		"Example:\n"
+		"  debug set_stream VRAM 0 0x4000\n";
+	static const string removeStreamHelp =
+		"debug remove_stream <id>\n"
+		"  Remove the stream with given ID again. You can use the "
+		"'list_streams' subcommand to see all valid IDs.\n";
+	static const string listStreamsHelp =
+		"debug list_streams\n"
+		"  Lists all active streams. The result is printed in 6 columns: "
+		"the stream ID, the debuggable, the start address, the size and "
+		"the interval ('frame' and a number of frames or 'time' and a "
+		"number of seconds).\n";
+	static const string searchHelp =
+		"debug search <subcommand> [<arguments>]\n"
+		"  Search a debuggable for the addresses of which the value "
+		"changes in a certain way (e.g. to find cheats). All addresses "
+		"are candidates at the start, each step reads the debuggable "
+		"again and only keeps the candidates for which the new value "
+		"matches. Possible subcommands are:\n"
+		"    start <name> [8|16]      start a new search (8 or 16 bit values)\n"
+		"    eq|ne|lt|gt|le|ge        compare new and previous value\n"
+		"    eq|ne|lt|gt|le|ge <val>  compare new value with <val>\n"
+		"    changed                  same as 'ne'\n"
+		"    unchanged                same as 'eq'\n"
+		"    delta <d>                new value is previous value + <d>\n"
+		"    range <begin> <end>      only keep addresses in this range\n"
+		"    keep <addresses>         only keep the addresses in this list\n"
+		"    count                    returns the number of candidates\n"
+		"    list [<max>]             returns (at most <max>) candidates\n"
+		"  The steps return the number of remaining candidates. The 'list' "
+		"subcommand returns a list of {address previous_value new_value} "
+		"triplets. 16 bit values are little endian, all values are "
+		"unsigned.\n"
+		"Example:\n"
+		"  debug search start memory\n"
+		"  debug search delta -1\n";
+	static const string profileHelp =
+		"debug profile <subcommand> [<arguments>]\n"
+		"  Execution profiler. Counts the time spent in each executed "
+		"block of code, a block starts at the target of a jump, call, "
+		"return or interrupt and is identified by its slot, mapper or "
+		"ROM segment and address. Possible subcommands are:\n"
+		"    start            start (or continue) profiling\n"
+		"    stop             stop profiling, the results are kept\n"
+		"    clear            discard the results\n"
+		"    enabled          returns '1' while profiling, '0' otherwise\n"
+		"    total            returns the total profiled number of cycles\n"
+		"    hotspots [<max>] returns the blocks with the most cycles\n"
+		"    calls [<max>]    returns the call graph edges with the most "
+		"cycles\n"
+		"  'hotspots' returns a list of {ps ss segment address cycles "
+		"count} elements, where count is the number of times the block "
+		"was entered. 'ss' and 'segment' are 'X' when not applicable.\n"
+		"  'calls' returns a list of {caller callee count cycles} "
+		"elements, where caller and callee are {ps ss segment address} "
+		"lists (caller is empty for calls that were made outside of any "
+		"tracked routine) and cycles includes the time spent in "
+		"sub-calls. Interrupts count as calls.\n"
+		"  Cycles are expressed in the clock of the active CPU. The "
+		"results are not stored in savestates (and are lost on reverse).\n"
+		"Example:\n"
+		"  debug profile start\n"
+		"  after time 10 {debug profile stop; puts [debug profile hotspots 10]}\n";
 	static const string probeHelp =
 		"debug probe <subcommand> [<arguments>]\n"
 		"  Possible subcommands are:\n"
@@ -1070,6 +1531,16 @@ string DebugCmd::help(const vector<string>& tokens) const
 		return removeCondHelp;
 	} else if (tokens[1] == "list_conditions") {
 		return listCondHelp;
+	} else if (tokens[1] == "set_stream") {
+		return setStreamHelp;
+	} else if (tokens[1] == "remove_stream") {
+		return removeStreamHelp;
+	} else if (tokens[1] == "list_streams") {
+		return listStreamsHelp;
+	} else if (tokens[1] == "search") {
+		return searchHelp;
+	} else if (tokens[1] == "profile") {
+		return profileHelp;
 	} else if (tokens[1] == "probe") {
 		return probeHelp;
 	} else if (tokens[1] == "cont") {
@@ -1105,6 +1576,14 @@ vector<string> DebugCmd::getWatchPointIds() const
 	}
 	return wpids;
 }
+vector<string> DebugCmd::getStreamIds() const
+{
+	vector<string> dsids;
+	for (auto& ds : debugger.debugStreams) {
+		dsids.push_back(StringOp::Builder() << "ds#" << ds->getId());
+	}
+	return dsids;
+}
 vector<string> DebugCmd::getConditionIds() const
 {
 	vector<string> condids;
@@ -1120,15 +1599,16 @@ void DebugCmd::tabCompletion(vector<string>& tokens) const
 	static const char* const singleArgCmds[] = {
 		"list", "step", "cont", "break", "breaked",
 		"list_bp", "list_watchpoints", "list_conditions",
+		"list_streams",
 	};
 	static const char* const debuggableArgCmds[] = {
 		"desc", "size", "read", "read_block",
-		"write", "write_block",
+		"write", "write_block", "set_stream",
 	};
 	static const char* const otherCmds[] = {
 		"disasm", "set_bp", "remove_bp", "set_watchpoint",
 		"remove_watchpoint", "set_condition", "remove_condition",
-		"probe",
+		"remove_stream", "search", "profile", "probe",
 	};
 	switch (tokens.size()) {
 	case 2: {
@@ -1157,6 +1637,9 @@ void DebugCmd::tabCompletion(vector<string>& tokens) const
 			} else if (tokens[1] == "remove_condition") {
 				// this one takes a cond id
 				completeString(tokens, getConditionIds());
+			} else if (tokens[1] == "remove_stream") {
+				// this one takes a stream id
+				completeString(tokens, getStreamIds());
 			} else if (tokens[1] == "set_watchpoint") {
 				static const char* const types[] = {
 					"write_io", "write_mem",
@@ -1169,6 +1652,19 @@ void DebugCmd::tabCompletion(vector<string>& tokens) const
 					"remove_bp", "list_bp",
 				};
 				completeString(tokens, subCmds);
+			} else if (tokens[1] == "search") {
+				static const char* const subCmds[] = {
+					"start", "eq", "ne", "lt", "gt", "le", "ge",
+					"changed", "unchanged", "delta", "range",
+					"keep", "count", "list",
+				};
+				completeString(tokens, subCmds);
+			} else if (tokens[1] == "profile") {
+				static const char* const subCmds[] = {
+					"start", "stop", "clear", "enabled",
+					"total", "hotspots", "calls",
+				};
+				completeString(tokens, subCmds);
 			}
 		}
 		break;
@@ -1177,6 +1673,14 @@ void DebugCmd::tabCompletion(vector<string>& tokens) const
 		    ((tokens[2] == "desc") || (tokens[2] == "read") ||
 		     (tokens[2] == "set_bp"))) {
 			completeString(tokens, keys(debugger.probes));
+		} else if ((tokens[1] == "search") && (tokens[2] == "start")) {
+			completeString(tokens, keys(debugger.debuggables));
+		}
+		break;
+	case 6:
+		if (tokens[1] == "set_stream") {
+			static const char* const types[] = { "frame", "time" };
+			completeString(tokens, types);
 		}
 		break;
 	}
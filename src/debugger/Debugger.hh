@@ -2,6 +2,7 @@
 #define DEBUGGER_HH
 
 #include "WatchPoint.hh"
+#include "DebugStream.hh"
 #include "StringMap.hh"
 #include "string_ref.hh"
 #include "noncopyable.hh"
@@ -16,6 +17,7 @@ class ProbeBase;
 class ProbeBreakPoint;
 class MSXCPU;
 class DebugCmd;
+class MemorySearch;
 
 class Debugger : private noncopyable
 {
@@ -50,6 +52,13 @@ private:
 	                       unsigned beginAddr, unsigned endAddr,
 	                       unsigned newId = -1);
 
+	unsigned insertDebugStream(Debuggable& debuggable, string_ref name,
+	                           unsigned start, unsigned size,
+	                           DebugStream::Type type, unsigned frames,
+	                           EmuDuration::param period,
+	                           unsigned newId = -1);
+	void removeDebugStream(string_ref name);
+
 	MSXMotherBoard& motherBoard;
 	friend class DebugCmd;
 	const std::unique_ptr<DebugCmd> debugCmd;
@@ -58,6 +67,9 @@ private:
 	StringMap<ProbeBase*>  probes;
 	typedef std::vector<std::unique_ptr<ProbeBreakPoint>> ProbeBreakPoints;
 	ProbeBreakPoints probeBreakPoints;
+	typedef std::vector<std::unique_ptr<DebugStream>> DebugStreams;
+	DebugStreams debugStreams;
+	std::unique_ptr<MemorySearch> memorySearch;
 	MSXCPU* cpu;
 };
 
@@ -0,0 +1,251 @@
+#include "MemorySearch.hh"
+#include "Debuggable.hh"
+#include "CommandException.hh"
+#include "Math.hh"
+#include <functional>
+#include <cstring>
+#include <cassert>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using std::string;
+using std::vector;
+
+namespace openmsx {
+
+// The predicates are evaluated per block of this many addresses (one word of
+// the candidates bitmap).
+static const unsigned BLOCK = 64;
+
+template<unsigned WIDTH> static inline unsigned load(const byte* p)
+{
+	return (WIDTH == 1) ? p[0] : (p[0] | (p[1] << 8));
+}
+
+// Evaluate 'cmp(new, rhs)' for a block of addresses, where rhs is either
+// 'old + operand' (useOld) or 'operand'.
+template<unsigned WIDTH, typename Cmp>
+static inline uint64_t evalScalar(const byte* newP, const byte* oldP,
+                                  bool useOld, unsigned operand, Cmp cmp)
+{
+	static const unsigned MASK = (WIDTH == 1) ? 0xFF : 0xFFFF;
+	uint64_t result = 0;
+	for (unsigned i = 0; i < BLOCK; ++i) {
+		unsigned n = load<WIDTH>(newP + i);
+		unsigned r = useOld ? ((load<WIDTH>(oldP + i) + operand) & MASK)
+		                    : operand;
+		result |= uint64_t(cmp(n, r)) << i;
+	}
+	return result;
+}
+
+#ifdef __SSE2__
+static inline unsigned compareSSE2(MemorySearch::Op op, __m128i n, __m128i r)
+{
+	// SSE2 only has signed byte compares
+	const __m128i bias = _mm_set1_epi8(char(0x80));
+	__m128i sn = _mm_xor_si128(n, bias);
+	__m128i sr = _mm_xor_si128(r, bias);
+	switch (op) {
+	case MemorySearch::EQUAL:
+		return _mm_movemask_epi8(_mm_cmpeq_epi8(n, r));
+	case MemorySearch::NOT_EQUAL:
+		return ~_mm_movemask_epi8(_mm_cmpeq_epi8(n, r)) & 0xFFFF;
+	case MemorySearch::LESS:
+		return _mm_movemask_epi8(_mm_cmplt_epi8(sn, sr));
+	case MemorySearch::GREATER:
+		return _mm_movemask_epi8(_mm_cmpgt_epi8(sn, sr));
+	case MemorySearch::LESS_EQUAL:
+		return ~_mm_movemask_epi8(_mm_cmpgt_epi8(sn, sr)) & 0xFFFF;
+	default: // GREATER_EQUAL
+		return ~_mm_movemask_epi8(_mm_cmplt_epi8(sn, sr)) & 0xFFFF;
+	}
+}
+
+// Same as evalScalar<1>, 16 addresses at a time.
+static inline uint64_t evalSSE2(MemorySearch::Op op,
+                                const byte* newP, const byte* oldP,
+                                bool useOld, unsigned operand)
+{
+	const __m128i c = _mm_set1_epi8(char(operand));
+	uint64_t result = 0;
+	for (unsigned i = 0; i < BLOCK; i += 16) {
+		__m128i n = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(newP + i));
+		__m128i r = useOld
+		          ? _mm_add_epi8(_mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(oldP + i)), c)
+		          : c;
+		result |= uint64_t(compareSSE2(op, n, r)) << i;
+	}
+	return result;
+}
+#endif
+
+
+MemorySearch::MemorySearch(Debuggable& debuggable, const string& name,
+                           unsigned width_)
+	: debuggableName(name)
+	, width(width_)
+	, size(debuggable.getSize())
+	, limit((size >= width) ? (size - width + 1) : 0)
+	, candidates((limit + BLOCK - 1) / BLOCK, ~uint64_t(0))
+	// one extra block, 16 bit values and SSE2 may read past the end
+	, prevData((candidates.size() + 1) * BLOCK)
+	, lastData((candidates.size() + 1) * BLOCK)
+{
+	assert((width == 1) || (width == 2));
+	if (limit % BLOCK) {
+		candidates.back() = (uint64_t(1) << (limit % BLOCK)) - 1;
+	}
+	memset(lastData.data(), 0, lastData.size());
+	debuggable.readBlock(0, lastData.data(), size);
+	memcpy(prevData.data(), lastData.data(), lastData.size());
+}
+
+void MemorySearch::step(Debuggable& debuggable)
+{
+	if (debuggable.getSize() != size) {
+		throw CommandException(
+			"Size of debuggable changed, start a new search.");
+	}
+	prevData.swap(lastData);
+	debuggable.readBlock(0, lastData.data(), size);
+}
+
+template<typename Pred> void MemorySearch::filter(Pred pred)
+{
+	for (unsigned i = 0; i < candidates.size(); ++i) {
+		// skip blocks without candidates (most of them after a few steps)
+		if (candidates[i]) {
+			candidates[i] &= pred(i * BLOCK);
+		}
+	}
+}
+
+template<typename Cmp>
+void MemorySearch::compareScalar(Cmp cmp, bool useOld, unsigned operand)
+{
+	const byte* newP = lastData.data();
+	const byte* oldP = prevData.data();
+	if (width == 1) {
+		filter([&](unsigned pos) {
+			return evalScalar<1>(newP + pos, oldP + pos,
+			                     useOld, operand, cmp); });
+	} else {
+		filter([&](unsigned pos) {
+			return evalScalar<2>(newP + pos, oldP + pos,
+			                     useOld, operand, cmp); });
+	}
+}
+
+void MemorySearch::compare(Op op, bool useOld, unsigned operand)
+{
+#ifdef __SSE2__
+	if (width == 1) {
+		const byte* newP = lastData.data();
+		const byte* oldP = prevData.data();
+		filter([&](unsigned pos) {
+			return evalSSE2(op, newP + pos, oldP + pos,
+			                useOld, operand); });
+		return;
+	}
+#endif
+	switch (op) {
+	case EQUAL:
+		compareScalar(std::equal_to<unsigned>(), useOld, operand);
+		break;
+	case NOT_EQUAL:
+		compareScalar(std::not_equal_to<unsigned>(), useOld, operand);
+		break;
+	case LESS:
+		compareScalar(std::less<unsigned>(), useOld, operand);
+		break;
+	case GREATER:
+		compareScalar(std::greater<unsigned>(), useOld, operand);
+		break;
+	case LESS_EQUAL:
+		compareScalar(std::less_equal<unsigned>(), useOld, operand);
+		break;
+	case GREATER_EQUAL:
+		compareScalar(std::greater_equal<unsigned>(), useOld, operand);
+		break;
+	}
+}
+
+void MemorySearch::compareOld(Debuggable& debuggable, Op op, unsigned delta)
+{
+	step(debuggable);
+	unsigned mask = (width == 1) ? 0xFF : 0xFFFF;
+	compare(op, true, delta & mask);
+}
+
+void MemorySearch::compareValue(Debuggable& debuggable, Op op, unsigned value)
+{
+	step(debuggable);
+	compare(op, false, value);
+}
+
+void MemorySearch::keepRange(Debuggable& debuggable,
+                             unsigned begin, unsigned end)
+{
+	step(debuggable);
+	filter([&](unsigned pos) {
+		uint64_t result = 0;
+		for (unsigned i = 0; i < BLOCK; ++i) {
+			unsigned addr = pos + i;
+			result |= uint64_t((begin <= addr) && (addr <= end)) << i;
+		}
+		return result;
+	});
+}
+
+void MemorySearch::keepAddresses(Debuggable& debuggable,
+                                 const vector<unsigned>& addresses)
+{
+	step(debuggable);
+	vector<uint64_t> selected(candidates.size(), 0);
+	for (auto& addr : addresses) {
+		if (addr < limit) {
+			selected[addr / BLOCK] |= uint64_t(1) << (addr % BLOCK);
+		}
+	}
+	for (unsigned i = 0; i < candidates.size(); ++i) {
+		candidates[i] &= selected[i];
+	}
+}
+
+unsigned MemorySearch::count() const
+{
+	unsigned result = 0;
+	for (auto& c : candidates) {
+		result += Math::countBits(c);
+	}
+	return result;
+}
+
+unsigned MemorySearch::getValue(const byte* data, unsigned address) const
+{
+	return (width == 1) ? load<1>(data + address) : load<2>(data + address);
+}
+
+vector<MemorySearch::Result> MemorySearch::getCandidates(unsigned max) const
+{
+	vector<Result> result;
+	for (unsigned i = 0; i < candidates.size(); ++i) {
+		uint64_t c = candidates[i];
+		for (unsigned addr = i * BLOCK; c; ++addr, c >>= 1) {
+			if (!(c & 1)) continue;
+			if (result.size() == max) return result;
+			Result r;
+			r.address  = addr;
+			r.oldValue = getValue(prevData.data(), addr);
+			r.newValue = getValue(lastData.data(), addr);
+			result.push_back(r);
+		}
+	}
+	return result;
+}
+
+} // namespace openmsx
@@ -0,0 +1,83 @@
+#ifndef MEMORYSEARCH_HH
+#define MEMORYSEARCH_HH
+
+#include "MemBuffer.hh"
+#include "openmsx.hh"
+#include "noncopyable.hh"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace openmsx {
+
+class Debuggable;
+
+/** Searches a debuggable for addresses whose value behaves in a certain way,
+  * e.g. to find the address of the 'number of lives' in a game (see the
+  * 'findcheat' script).
+  *
+  * A search starts with all addresses as candidates. Each filter step reads
+  * the whole debuggable and only keeps the candidates for which the new value
+  * has a certain relation with either the value at the previous step or with
+  * a given value. Values are 8 or 16 bit (little endian) unsigned numbers.
+  *
+  * The candidates are kept in a bitmap, the predicates are evaluated for 64
+  * addresses at once (for 8 bit values with SSE2 when available).
+  */
+class MemorySearch : private noncopyable
+{
+public:
+	enum Op { EQUAL, NOT_EQUAL, LESS, GREATER, LESS_EQUAL, GREATER_EQUAL };
+
+	/** Start a new search, all addresses are candidates.
+	  * @param width Size of the values in bytes: 1 or 2.
+	  */
+	MemorySearch(Debuggable& debuggable, const std::string& debuggableName,
+	             unsigned width);
+
+	const std::string& getDebuggableName() const { return debuggableName; }
+	unsigned getWidth() const { return width; }
+
+	/** Keep the candidates for which 'new <op> old + delta'. */
+	void compareOld(Debuggable& debuggable, Op op, unsigned delta = 0);
+	/** Keep the candidates for which 'new <op> value'. */
+	void compareValue(Debuggable& debuggable, Op op, unsigned value);
+	/** Keep the candidates in the range [begin, end]. */
+	void keepRange(Debuggable& debuggable, unsigned begin, unsigned end);
+	/** Keep the candidates that are in the given (sorted) list. */
+	void keepAddresses(Debuggable& debuggable,
+	                   const std::vector<unsigned>& addresses);
+
+	/** Number of remaining candidates. */
+	unsigned count() const;
+
+	struct Result {
+		unsigned address;
+		unsigned oldValue; // value at the step before the last one
+		unsigned newValue; // value at the last step
+	};
+	/** Get (at most 'max') remaining candidates, ordered on address. */
+	std::vector<Result> getCandidates(unsigned max) const;
+
+private:
+	void step(Debuggable& debuggable);
+	void compare(Op op, bool useOld, unsigned operand);
+	template<typename Cmp> void compareScalar(
+		Cmp cmp, bool useOld, unsigned operand);
+	template<typename Pred> void filter(Pred pred);
+	unsigned getValue(const byte* data, unsigned address) const;
+
+	const std::string debuggableName;
+	const unsigned width;
+	const unsigned size;   // of the debuggable
+	const unsigned limit;  // number of possible candidate addresses
+	std::vector<uint64_t> candidates;
+	// Values at the previous and the last step, padded so that the
+	// predicates can always be evaluated for a whole block of addresses.
+	MemBuffer<byte> prevData;
+	MemBuffer<byte> lastData;
+};
+
+} // namespace openmsx
+
+#endif
@@ -26,6 +26,7 @@
 #endif
 
 using std::string;
+using std::vector;
 
 namespace openmsx {
 
@@ -34,14 +35,14 @@ namespace openmsx {
 class CliCommandEvent : public Event
 {
 public:
-	CliCommandEvent(string command_, const CliConnection* id_)
+	CliCommandEvent(vector<string> commands_, const CliConnection* id_)
 		: Event(OPENMSX_CLICOMMAND_EVENT)
-		, command(std::move(command_)), id(id_)
+		, commands(std::move(commands_)), id(id_)
 	{
 	}
-	const string& getCommand() const
+	const vector<string>& getCommands() const
 	{
-		return command;
+		return commands;
 	}
 	const CliConnection* getId() const
 	{
@@ -50,15 +51,17 @@ public:
 	virtual void toStringImpl(TclObject& result) const
 	{
 		result.addListElement("CliCmd");
-		result.addListElement(getCommand());
+		for (auto& command : getCommands()) {
+			result.addListElement(command);
+		}
 	}
 	virtual bool lessImpl(const Event& other) const
 	{
 		auto& otherCmdEvent = checked_cast<const CliCommandEvent&>(other);
-		return getCommand() < otherCmdEvent.getCommand();
+		return getCommands() < otherCmdEvent.getCommands();
 	}
 private:
-	const string command;
+	const vector<string> commands;
 	const CliConnection* id;
 };
 
@@ -70,6 +73,9 @@ CliConnection::CliConnection(CommandController& commandController_,
 	: thread(this)
 	, commandController(commandController_)
 	, eventDistributor(eventDistributor_)
+	, framing(FRAMING_UNKNOWN)
+	, rawBatchLeft(0)
+	, rawOutput(false)
 {
 	user_data.state = START;
 	user_data.unknownLevel = 0;
@@ -109,6 +115,12 @@ bool CliConnection::getUpdateEnable(CliComm::UpdateType type) const
 void CliConnection::log(CliComm::LogLevel level, string_ref message)
 {
 	auto levelStr = CliComm::getLevelStrings();
+	if (rawOutput) {
+		output(StringOp::Builder() <<
+			"log " << levelStr[level] << ' ' << message.size() <<
+			'\n' << message);
+		return;
+	}
 	output(StringOp::Builder() <<
 		"<log level=\"" << levelStr[level] << "\">" <<
 		XMLElement::XMLEscape(message.str()) << "</log>\n");
@@ -120,6 +132,13 @@ void CliConnection::update(CliComm::UpdateType type, string_ref machine,
 	if (!getUpdateEnable(type)) return;
 
 	auto updateStr = CliComm::getUpdateStrings();
+	if (rawOutput) {
+		output(StringOp::Builder() <<
+			"update " << updateStr[type] << ' ' << machine.size() <<
+			' ' << name.size() << ' ' << value.size() << '\n' <<
+			machine << name << value);
+		return;
+	}
 	StringOp::Builder tmp;
 	tmp << "<update type=\"" << updateStr[type] << '\"';
 	if (!machine.empty()) {
@@ -145,19 +164,117 @@ void CliConnection::start()
 
 void CliConnection::end()
 {
-	output("</openmsx-output>\n");
+	if (!rawOutput) {
+		output("</openmsx-output>\n");
+	}
 	close();
 }
 
-void CliConnection::execute(const string& command)
+void CliConnection::execute(vector<string> commands)
 {
-	PRT_DEBUG("CliConnection::execute: " << command);
+	PRT_DEBUG("CliConnection::execute: " << commands.size() << " command(s)");
 	eventDistributor.distributeEvent(
-		std::make_shared<CliCommandEvent>(command, this));
+		std::make_shared<CliCommandEvent>(std::move(commands), this));
+}
+
+bool CliConnection::parseInput(const char* buf, size_t len)
+{
+	// runs in helper thread
+	if (len == 0) return true;
+	if (framing == FRAMING_UNKNOWN) {
+		framing = (buf[0] == '!') ? FRAMING_RAW : FRAMING_XML;
+	}
+	if (framing == FRAMING_RAW) {
+		return parseRawInput(buf, len);
+	} else {
+		xmlParseChunk(parser_context, buf, int(len), 0);
+		return true;
+	}
+}
+
+static bool parseNumber(string_ref str, unsigned& result)
+{
+	if (str.empty() || (str.size() > 9)) return false;
+	result = 0;
+	for (char c : str) {
+		if ((c < '0') || (c > '9')) return false;
+		result = 10 * result + (c - '0');
+	}
+	return true;
+}
+
+// The raw framing avoids the cost of XML (un)escaping and parsing, it's
+// selected by starting the input with the line "!raw". After that the input
+// is a sequence of
+//   <length> '\n' <command>           a single command
+//   "batch " <n> '\n'                 the next n commands form a batch
+// Replies, logs and updates are sent as
+//   "ok " | "nok " <length> '\n' <result>
+//   "log " <level> ' ' <length> '\n' <message>
+//   "update " <type> ' ' <length1> ' ' <length2> ' ' <length3> '\n'
+//             <machine> <name> <value>
+// (The opening "<openmsx-output>" line can be sent before the client selects
+// this framing.)
+bool CliConnection::parseRawInput(const char* buf, size_t len)
+{
+	rawInput.append(buf, len);
+	size_t pos = 0;
+	while (true) {
+		auto eol = rawInput.find('\n', pos);
+		if (eol == string::npos) break;
+		string_ref header(rawInput.data() + pos, eol - pos);
+		if (!header.empty() && (header.back() == '\r')) {
+			header.pop_back();
+		}
+		if (header == "!raw") {
+			rawOutput = true;
+			pos = eol + 1;
+			continue;
+		}
+		if (header.starts_with("batch ")) {
+			unsigned n;
+			if (rawBatchLeft || !parseNumber(header.substr(6), n)) {
+				break; // invalid (or nested) batch, see below
+			}
+			rawBatchLeft = n;
+			pos = eol + 1;
+			continue;
+		}
+		unsigned cmdLen;
+		if (!parseNumber(header, cmdLen)) break;
+		if ((rawInput.size() - (eol + 1)) < cmdLen) {
+			// wait for the rest of the command
+			rawInput.erase(0, pos);
+			return true;
+		}
+		string command = rawInput.substr(eol + 1, cmdLen);
+		pos = eol + 1 + cmdLen;
+		if (rawBatchLeft) {
+			rawBatch.push_back(std::move(command));
+			if (--rawBatchLeft == 0) {
+				execute(std::move(rawBatch));
+				rawBatch.clear();
+			}
+		} else {
+			execute(vector<string>(1, std::move(command)));
+		}
+	}
+	if (rawInput.find('\n', pos) != string::npos) {
+		// invalid header, the client is out of sync
+		rawInput.clear();
+		return false;
+	}
+	rawInput.erase(0, pos);
+	return true;
 }
 
-static string reply(const string& message, bool status)
+string CliConnection::reply(const string& message, bool status) const
 {
+	if (rawOutput) {
+		return StringOp::Builder() <<
+			(status ? "ok " : "nok ") << message.size() << '\n' <<
+			message;
+	}
 	return StringOp::Builder() <<
 		"<reply result=\"" << (status ? "ok" : "nok") << "\">" <<
 		XMLElement::XMLEscape(message) << "</reply>\n";
@@ -167,14 +284,16 @@ int CliConnection::signalEvent(const std::shared_ptr<const Event>& event)
 {
 	auto& commandEvent = checked_cast<const CliCommandEvent&>(*event);
 	if (commandEvent.getId() == this) {
-		try {
-			string result = commandController.executeCommand(
-				commandEvent.getCommand(), this);
-			PRT_DEBUG("CliConnection::signalEvent result: " << result);
-			output(reply(result, true));
-		} catch (CommandException& e) {
-			string result = e.getMessage() + '\n';
-			output(reply(result, false));
+		for (auto& command : commandEvent.getCommands()) {
+			try {
+				string result = commandController.executeCommand(
+					command, this);
+				PRT_DEBUG("CliConnection::signalEvent result: " << result);
+				output(reply(result, true));
+			} catch (CommandException& e) {
+				string result = e.getMessage() + '\n';
+				output(reply(result, false));
+			}
 		}
 	}
 	return 0;
@@ -205,6 +324,18 @@ void CliConnection::cb_start_element(
 			if (strcmp(reinterpret_cast<const char*>(localname),
 					"command") == 0) {
 				parseState->state = TAG_COMMAND;
+			} else if (strcmp(reinterpret_cast<const char*>(localname),
+					"batch") == 0) {
+				parseState->state = TAG_BATCH;
+				parseState->batch.clear();
+			} else {
+				++(parseState->unknownLevel);
+			}
+			break;
+		case TAG_BATCH:
+			if (strcmp(reinterpret_cast<const char*>(localname),
+					"command") == 0) {
+				parseState->state = TAG_BATCH_COMMAND;
 			} else {
 				++(parseState->unknownLevel);
 			}
@@ -233,7 +364,20 @@ void CliConnection::cb_end_element(
 			parseState->state = END;
 			break;
 		case TAG_COMMAND:
-			parseState->object->execute(parseState->content);
+			parseState->object->execute(
+				vector<string>(1, std::move(parseState->content)));
+			parseState->state = TAG_OPENMSX;
+			break;
+		case TAG_BATCH_COMMAND:
+			parseState->batch.push_back(std::move(parseState->content));
+			parseState->state = TAG_BATCH;
+			break;
+		case TAG_BATCH:
+			if (!parseState->batch.empty()) {
+				parseState->object->execute(
+					std::move(parseState->batch));
+				parseState->batch.clear();
+			}
 			parseState->state = TAG_OPENMSX;
 			break;
 		default:
@@ -244,7 +388,8 @@ void CliConnection::cb_end_element(
 void CliConnection::cb_text(void* user_data, const xmlChar* chars, int len)
 {
 	auto parseState = static_cast<ParseState*>(user_data);
-	if (parseState->state == TAG_COMMAND) {
+	if ((parseState->state == TAG_COMMAND) ||
+	    (parseState->state == TAG_BATCH_COMMAND)) {
 		parseState->content.append(reinterpret_cast<const char*>(chars), len);
 	}
 }
@@ -272,9 +417,7 @@ void StdioConnection::run()
 	while (ok) {
 		char buf[BUF_SIZE];
 		int n = read(STDIN_FILENO, buf, sizeof(buf));
-		if (n > 0) {
-			xmlParseChunk(parser_context, buf, n, 0);
-		} else if (n < 0) {
+		if ((n < 0) || ((n > 0) && !parseInput(buf, n))) {
 			close();
 			break;
 		}
@@ -370,7 +513,9 @@ void PipeConnection::run()
 			if (!GetOverlappedResult(pipeHandle, &overlapped, &bytesRead, TRUE)) {
 				break; // Pipe broke
 			}
-			xmlParseChunk(parser_context, buf, bytesRead, 0);
+			if (!parseInput(buf, bytesRead)) {
+				break; // Client out of sync
+			}
 		}
 		else if (wait == WAIT_OBJECT_0) {
 			break; // Shutdown
@@ -447,9 +592,7 @@ void SocketConnection::run()
 		if (sd == OPENMSX_INVALID_SOCKET) return;
 		char buf[BUF_SIZE];
 		int n = sock_recv(sd, buf, BUF_SIZE);
-		if (n > 0) {
-			xmlParseChunk(parser_context, buf, n, 0);
-		} else if (n < 0) {
+		if ((n < 0) || ((n > 0) && !parseInput(buf, n))) {
 			close();
 			break;
 		}
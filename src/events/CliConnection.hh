@@ -9,6 +9,8 @@
 #include "CliComm.hh"
 #include <libxml/parser.h>
 #include <string>
+#include <vector>
+#include <atomic>
 
 namespace openmsx {
 
@@ -55,11 +57,27 @@ protected:
 	  */
 	void startOutput();
 
+	/** Process input received from the client, called from the helper
+	  * thread. The framing is determined by the first byte: input that
+	  * starts with "!raw" uses length prefixed commands (see
+	  * parseRawInput()), everything else is passed to the XML parser.
+	  * Returns false when the input can't be parsed anymore, then the
+	  * caller should stop reading (it must not call close() for that: in
+	  * some subclasses close() waits for the helper thread to finish).
+	  */
+	bool parseInput(const char* buf, size_t len);
+
 	xmlParserCtxt* parser_context;
 	Thread thread; // TODO: Possible to make this private?
 
 private:
-	void execute(const std::string& command);
+	/** Execute the given commands in the main thread, all in the same
+	  * event delivery (so without emulation in between). The replies are
+	  * sent in the same order.
+	  */
+	void execute(std::vector<std::string> commands);
+	bool parseRawInput(const char* buf, size_t len);
+	std::string reply(const std::string& message, bool status) const;
 
 	// CliListener
 	virtual void log(CliComm::LogLevel level, string_ref message);
@@ -70,12 +88,13 @@ private:
 	virtual int signalEvent(const std::shared_ptr<const Event>& event);
 
 	enum State {
-		START, TAG_OPENMSX, TAG_COMMAND, END
+		START, TAG_OPENMSX, TAG_COMMAND, TAG_BATCH, TAG_BATCH_COMMAND, END
 	};
 	struct ParseState {
 		State state;
 		unsigned unknownLevel;
 		std::string content;
+		std::vector<std::string> batch;
 		CliConnection* object;
 	};
 
@@ -95,6 +114,14 @@ private:
 	EventDistributor& eventDistributor;
 
 	bool updateEnabled[CliComm::NUM_UPDATES];
+
+	// Only used in the helper thread.
+	enum Framing { FRAMING_UNKNOWN, FRAMING_XML, FRAMING_RAW } framing;
+	std::string rawInput;
+	std::vector<std::string> rawBatch;
+	unsigned rawBatchLeft;
+	// Determines the output format, read in the main thread.
+	std::atomic<bool> rawOutput;
 };
 
 class StdioConnection : public CliConnection
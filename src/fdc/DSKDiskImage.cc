@@ -6,6 +6,7 @@ namespace openmsx {
 DSKDiskImage::DSKDiskImage(const Filename& fileName)
 	: SectorBasedDisk(fileName)
 	, file(std::make_shared<File>(fileName, File::PRE_CACHE))
+	, cache(*file)
 {
 	setNbSectors(file->getSize() / sizeof(SectorBuffer));
 }
@@ -14,6 +15,7 @@ DSKDiskImage::DSKDiskImage(const Filename& fileName,
                            const std::shared_ptr<File>& file_)
 	: SectorBasedDisk(fileName)
 	, file(file_)
+	, cache(*file)
 {
 	setNbSectors(file->getSize() / sizeof(SectorBuffer));
 }
@@ -24,14 +26,12 @@ DSKDiskImage::~DSKDiskImage()
 
 void DSKDiskImage::readSectorImpl(size_t sector, SectorBuffer& buf)
 {
-	file->seek(sector * sizeof(buf));
-	file->read(&buf, sizeof(buf));
+	cache.read(sector, buf);
 }
 
 void DSKDiskImage::writeSectorImpl(size_t sector, const SectorBuffer& buf)
 {
-	file->seek(sector * sizeof(buf));
-	file->write(&buf, sizeof(buf));
+	cache.write(sector, buf);
 }
 
 bool DSKDiskImage::isWriteProtectedImpl() const
@@ -39,6 +39,11 @@ bool DSKDiskImage::isWriteProtectedImpl() const
 	return file->isReadOnly();
 }
 
+const SectorCache* DSKDiskImage::getSectorCache() const
+{
+	return &cache;
+}
+
 Sha1Sum DSKDiskImage::getSha1Sum()
 {
 	if (hasPatches()) {
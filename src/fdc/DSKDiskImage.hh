@@ -2,6 +2,7 @@
 #define DSKDISKIMAGE_HH
 
 #include "SectorBasedDisk.hh"
+#include "SectorCache.hh"
 #include <memory>
 
 namespace openmsx {
@@ -20,8 +21,10 @@ private:
 	virtual void writeSectorImpl(size_t sector, const SectorBuffer& buf);
 	virtual bool isWriteProtectedImpl() const;
 	virtual Sha1Sum getSha1Sum();
+	virtual const SectorCache* getSectorCache() const;
 
 	const std::shared_ptr<File> file;
+	SectorCache cache;
 };
 
 } // namespace openmsx
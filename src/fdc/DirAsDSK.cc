@@ -201,14 +201,32 @@ bool DirAsDSK::checkMSXFileExists(
 // is not mapped in the virtual disk.
 DirAsDSK::DirIndex DirAsDSK::findHostFileInDSK(const string& hostName)
 {
-	for (auto& p : mapDirs) {
-		if (p.second.hostName == hostName) {
-			return p.first;
+	auto it = hostNameIndex.find(hostName);
+	if (it != hostNameIndex.end()) {
+		auto it2 = mapDirs.find(it->second);
+		if ((it2 != mapDirs.end()) && (it2->second.hostName == hostName)) {
+			return it->second;
 		}
+		// stale entry, the mapping was removed in the mean time
+		hostNameIndex.erase(it);
 	}
 	return DirIndex(unsigned(-1), unsigned(-1));
 }
 
+void DirAsDSK::setHostName(DirIndex dirIndex, const string& hostName)
+{
+	mapDirs[dirIndex].hostName = hostName;
+	hostNameIndex[hostName] = dirIndex;
+	if (hostNameIndex.size() > 2 * mapDirs.size() + 64) {
+		// Removed mappings are only dropped from the index when they
+		// are looked up, so occasionally rebuild it.
+		hostNameIndex.clear();
+		for (auto& p : mapDirs) {
+			hostNameIndex[p.second.hostName] = p.first;
+		}
+	}
+}
+
 // Check if a host file is already mapped in the virtual disk.
 bool DirAsDSK::checkFileUsedInDSK(const string& hostName)
 {
@@ -258,6 +276,8 @@ DirAsDSK::DirAsDSK(DiskChanger& diskChanger_, CliComm& cliComm_,
 	, hostDir(hostDir_.getResolved() + '/')
 	, syncMode(syncMode_)
 	, lastAccess(EmuTime::zero)
+	, watcher(hostDir)
+	, addFailed(false)
 	, nofSectors((diskChanger_.isDoubleSidedDrive() ? 2 : 1) * SECTORS_PER_TRACK * NUM_TRACKS)
 	, nofSectorsPerFat((((3 * nofSectors) / (2 * SECTORS_PER_CLUSTER)) + SECTOR_SIZE - 1) / SECTOR_SIZE)
 	, firstSector2ndFAT(FIRST_FAT_SECTOR + nofSectorsPerFat)
@@ -321,6 +341,13 @@ bool DirAsDSK::isWriteProtectedImpl() const
 	return syncMode == SYNC_READONLY;
 }
 
+bool DirAsDSK::supportsOverlay() const
+{
+	// Writes are synced to the host directory and changes in the host
+	// directory are synced back, an overlay would conflict with both.
+	return false;
+}
+
 void DirAsDSK::checkCaches()
 {
 	bool needSync;
@@ -374,44 +401,66 @@ void DirAsDSK::readSectorImpl(size_t sector, SectorBuffer& buf)
 
 void DirAsDSK::syncWithHost()
 {
-	// Check for removed host files. This frees up space in the virtual
-	// disk. Do this first because otherwise later actions may fail (run
-	// out of virtual disk space) for no good reason.
-	checkDeletedHostFiles();
+	std::set<string> names, dirs;
+	bool incremental = watcher.getChanges(names, dirs);
+	if (incremental && names.empty()) {
+		// Nothing changed on the host since the previous sync.
+		return;
+	}
 
-	// Next update existing files. This may enlarge or shrink virtual
-	// files. In case not all host files fit on the virtual disk it's
+	// Check for removed and modified host files. Removed files free up
+	// space in the virtual disk, so handle those first because otherwise
+	// later actions may fail (run out of virtual disk space) for no good
+	// reason. In case not all host files fit on the virtual disk it's
 	// better to update the existing files than to (partly) add a too big
 	// new file and have no space left to enlarge the existing files.
-	checkModifiedHostFiles();
+	checkHostFiles(incremental ? &names : nullptr);
 
 	// Last add new host files (this can only consume virtual disk space).
-	addNewHostFiles("", firstDirSector);
+	bool retry = addFailed;
+	addFailed = false;
+	if (!incremental || retry) {
+		addNewHostFiles("", firstDirSector, true);
+		watcher.fullScanDone();
+		return;
+	}
+	for (auto& dir : dirs) {
+		// Only (re-)read the directories in which something was
+		// created, new subdirectories are read completely.
+		if (dir.empty()) {
+			addNewHostFiles(dir, firstDirSector, false);
+			continue;
+		}
+		DirIndex dirIndex = findHostFileInDSK(
+			dir.substr(0, dir.size() - 1)); // drop trailing '/'
+		if (dirIndex.sector == unsigned(-1)) {
+			// Parent directory isn't mapped (yet) either, e.g.
+			// because it couldn't be added. Check everything.
+			addNewHostFiles("", firstDirSector, true);
+			return;
+		}
+		unsigned cluster = msxDir(dirIndex).startCluster;
+		if ((msxDir(dirIndex).attrib & MSXDirEntry::ATT_DIRECTORY) &&
+		    (FIRST_CLUSTER <= cluster) && (cluster < maxCluster)) {
+			addNewHostFiles(dir, clusterToSector(cluster), false);
+		}
+	}
 }
 
-void DirAsDSK::checkDeletedHostFiles()
+void DirAsDSK::checkHostFiles(const std::set<string>* names)
 {
-	// This handles both host files and directories.
-	auto copy = mapDirs;
-	for (auto& p : copy) {
-		if (mapDirs.find(p.first) == mapDirs.end()) {
-			// While iterating over (the copy of) mapDirs we delete
-			// entries of mapDirs (when we delete files only the
-			// current entry is deleted, when we delete
-			// subdirectories possibly many entries are deleted).
-			// At this point in the code we've reached such an
-			// entry that's still in the original (copy of) mapDirs
-			// but has already been deleted from the current
-			// mapDirs. Ignore it.
-			continue;
-		}
-		const DirIndex& dirIndex = p.first;
-		MapDir& mapDir = p.second;
+	// This handles both host files and directories. Check either all
+	// mapped files or only the given (changed) host files. Each file is
+	// stat-ed only once, the actions are performed afterwards because
+	// they modify mapDirs.
+	vector<DirIndex> deleted;
+	vector<std::pair<DirIndex, FileOperations::Stat>> modified;
+	auto check = [&](DirIndex dirIndex, const MapDir& mapDir) {
 		string fullHostName = hostDir + mapDir.hostName;
 		bool isMSXDirectory = (msxDir(dirIndex).attrib &
 		                       MSXDirEntry::ATT_DIRECTORY) != 0;
 		FileOperations::Stat fst;
-		if ((!FileOperations::getStat(fullHostName, fst) != 0) ||
+		if (!FileOperations::getStat(fullHostName, fst) ||
 		    (FileOperations::isDirectory(fst) != isMSXDirectory)) {
 			// TODO also check access permission
 			// Error stat-ing file, or directory/file type is not
@@ -419,9 +468,49 @@ void DirAsDSK::checkDeletedHostFiles()
 			// has been removed and a host directory with the same
 			// name has been created). In both cases delete the msx
 			// entry (if needed it will be recreated soon).
-			deleteMSXFile(dirIndex);
+			deleted.push_back(dirIndex);
+		} else if (!isMSXDirectory &&
+		           ((mapDir.mtime    != fst.st_mtime) ||
+		            (mapDir.filesize != size_t(fst.st_size)))) {
+			// Detect changes in host file.
+			// Heuristic: we use filesize and modification time to
+			// detect changes in file content.
+			//  TODO do we need both filesize and mtime or is mtime
+			//       alone enough?
+			// We ignore time/size changes in directories,
+			// typically such a change indicates one of the files
+			// in that directory is changed/added/removed. But such
+			// changes are handled elsewhere.
+			modified.emplace_back(dirIndex, fst);
+		}
+	};
+	if (names) {
+		for (auto& name : *names) {
+			DirIndex dirIndex = findHostFileInDSK(name);
+			if (dirIndex.sector == unsigned(-1)) continue;
+			check(dirIndex, mapDirs[dirIndex]);
+		}
+	} else {
+		for (auto& p : mapDirs) {
+			check(p.first, p.second);
 		}
 	}
+
+	for (auto& dirIndex : deleted) {
+		if (mapDirs.find(dirIndex) == mapDirs.end()) {
+			// Deleting a subdirectory also deletes the entries of
+			// the files in that directory, ignore those.
+			continue;
+		}
+		deleteMSXFile(dirIndex);
+	}
+	for (auto& p : modified) {
+		if (mapDirs.find(p.first) == mapDirs.end()) {
+			// in a directory that was deleted above
+			continue;
+		}
+		importHostFile(p.first, p.second);
+	}
 }
 
 void DirAsDSK::deleteMSXFile(DirIndex dirIndex)
@@ -480,44 +569,6 @@ void DirAsDSK::freeFATChain(unsigned cluster)
 	}
 }
 
-void DirAsDSK::checkModifiedHostFiles()
-{
-	auto copy = mapDirs;
-	for (auto& p : copy) {
-		if (mapDirs.find(p.first) == mapDirs.end()) {
-			// See comment in checkDeletedHostFiles().
-			continue;
-		}
-		const DirIndex& dirIndex = p.first;
-		MapDir& mapDir = p.second;
-		string fullHostName = hostDir + mapDir.hostName;
-		bool isMSXDirectory = (msxDir(dirIndex).attrib &
-		                       MSXDirEntry::ATT_DIRECTORY) != 0;
-		FileOperations::Stat fst;
-		if ((!FileOperations::getStat(fullHostName, fst) == 0) &&
-		    (FileOperations::isDirectory(fst) == isMSXDirectory)) {
-			// Detect changes in host file.
-			// Heuristic: we use filesize and modification time to detect
-			// changes in file content.
-			//  TODO do we need both filesize and mtime or is mtime alone
-			//       enough?
-			// We ignore time/size changes in directories,
-			// typically such a change indicates one of the files
-			// in that directory is changed/added/removed. But such
-			// changes are handled elsewhere.
-			if (!isMSXDirectory &&
-			    ((mapDir.mtime    != fst.st_mtime) ||
-			     (mapDir.filesize != size_t(fst.st_size)))) {
-				importHostFile(dirIndex, fst);
-			}
-		} else {
-			// Only very rarely happens (because checkDeletedHostFiles()
-			// checked this just recently).
-			deleteMSXFile(dirIndex);
-		}
-	}
-}
-
 void DirAsDSK::importHostFile(DirIndex dirIndex, FileOperations::Stat& fst)
 {
 	assert(!(msxDir(dirIndex).attrib & MSXDirEntry::ATT_DIRECTORY));
@@ -674,11 +725,16 @@ static size_t weight(const string& hostName)
 	return result;
 }
 
-void DirAsDSK::addNewHostFiles(const string& hostSubDir, unsigned msxDirSector)
+void DirAsDSK::addNewHostFiles(const string& hostSubDir, unsigned msxDirSector,
+                               bool scanSubDirs)
 {
 	assert(!StringOp::startsWith(hostSubDir, '/'));
 	assert(hostSubDir.empty() || StringOp::endsWith(hostSubDir, '/'));
 
+	// Start watching before reading the directory, so that no changes
+	// get lost.
+	watcher.addDir(hostSubDir);
+
 	vector<string> hostNames;
 	{
 		ReadDir dir(hostDir + hostSubDir);
@@ -690,6 +746,17 @@ void DirAsDSK::addNewHostFiles(const string& hostSubDir, unsigned msxDirSector)
 	     [](const string& l, const string& r) { return weight(l) < weight(r); });
 
 	for (auto& hostName : hostNames) {
+		if ((hostName == "..") || (hostName == ".")) {
+			continue;
+		}
+		DirIndex dirIndex = findHostFileInDSK(hostSubDir + hostName);
+		if ((dirIndex.sector != unsigned(-1)) &&
+		    (!scanSubDirs ||
+		     !(msxDir(dirIndex).attrib & MSXDirEntry::ATT_DIRECTORY))) {
+			// Already present in the virtual disk (changes are
+			// handled in checkHostFiles()), no need to stat it.
+			continue;
+		}
 		try {
 			string fullHostName = hostDir + hostSubDir + hostName;
 			FileOperations::Stat fst;
@@ -697,10 +764,8 @@ void DirAsDSK::addNewHostFiles(const string& hostSubDir, unsigned msxDirSector)
 				throw MSXException("Error accessing " + fullHostName);
 			}
 			if (FileOperations::isDirectory(fst)) {
-				if ((hostName == "..") || (hostName == ".")) {
-					continue;
-				}
-				addNewDirectory(hostSubDir, hostName, msxDirSector, fst);
+				addNewDirectory(hostSubDir, hostName, msxDirSector, fst,
+				                scanSubDirs);
 			} else if (FileOperations::isRegularFile(fst)) {
 				addNewHostFile(hostSubDir, hostName, msxDirSector, fst);
 			} else {
@@ -709,12 +774,14 @@ void DirAsDSK::addNewHostFiles(const string& hostSubDir, unsigned msxDirSector)
 			}
 		} catch (MSXException& e) {
 			cliComm.printWarning(e.getMessage());
+			addFailed = true;
 		}
 	}
 }
 
 void DirAsDSK::addNewDirectory(const string& hostSubDir, const string& hostName,
-                               unsigned msxDirSector, FileOperations::Stat& fst)
+                               unsigned msxDirSector, FileOperations::Stat& fst,
+                               bool scanSubDirs)
 {
 	string hostPath = hostSubDir + hostName;
 	DirIndex dirIndex = findHostFileInDSK(hostPath);
@@ -757,7 +824,7 @@ void DirAsDSK::addNewDirectory(const string& hostSubDir, const string& hostName,
 		                          ? 0 : sectorToCluster(msxDirSector);
 	} else {
 		if (!(msxDir(dirIndex).attrib & MSXDirEntry::ATT_DIRECTORY)) {
-			// Should rarely happen because checkDeletedHostFiles()
+			// Should rarely happen because checkHostFiles()
 			// recently checked this. (It could happen when a host
 			// directory is *just*recently* created with the same
 			// name as an existing msx file). Ignore, it will be
@@ -773,7 +840,8 @@ void DirAsDSK::addNewDirectory(const string& hostSubDir, const string& hostName,
 	}
 
 	// Recursively process this directory.
-	addNewHostFiles(hostSubDir + hostName + '/', newMsxDirSector);
+	addNewHostFiles(hostSubDir + hostName + '/', newMsxDirSector,
+	                scanSubDirs);
 }
 
 void DirAsDSK::addNewHostFile(const string& hostSubDir, const string& hostName,
@@ -815,7 +883,7 @@ DirAsDSK::DirIndex DirAsDSK::fillMSXDirEntry(
 
 		// Fill in hostName / msx filename.
 		assert(!StringOp::endsWith(hostPath, '/'));
-		mapDirs[dirIndex].hostName = hostPath;
+		setHostName(dirIndex, hostPath);
 		memset(&msxDir(dirIndex), 0, sizeof(MSXDirEntry)); // clear entry
 		memcpy(msxDir(dirIndex).filename, msxFilename.data(), 8 + 3);
 		return dirIndex;
@@ -1153,7 +1221,7 @@ void DirAsDSK::exportToHost(DirIndex dirIndex, DirIndex dirDirIndex)
 			hostSubDir += '/';
 		}
 		hostName = hostSubDir + msxToHostName(msxName);
-		mapDirs[dirIndex].hostName = hostName;
+		setHostName(dirIndex, hostName);
 	} else {
 		// Hostname is already known.
 		hostName = it->second.hostName;
@@ -1183,6 +1251,9 @@ void DirAsDSK::exportToHostDir(DirIndex dirIndex, const string& hostName)
 		// Create the host directory.
 		string fullHostName = hostDir + hostName;
 		FileOperations::mkdirp(fullHostName);
+		// The incremental sync doesn't rescan directories that are
+		// already mapped, so host changes in it must be watched.
+		watcher.addDir(hostName + '/');
 
 		// Export all the components in this directory.
 		do {
@@ -4,8 +4,11 @@
 #include "SectorBasedDisk.hh"
 #include "DiskImageUtils.hh"
 #include "FileOperations.hh"
+#include "HostDirWatcher.hh"
 #include "EmuTime.hh"
 #include <map>
+#include <set>
+#include <unordered_map>
 
 namespace openmsx {
 
@@ -28,6 +31,7 @@ public:
 	virtual void writeSectorImpl(size_t sector, const SectorBuffer& buf);
 	virtual bool isWriteProtectedImpl() const;
 	virtual void checkCaches();
+	virtual bool supportsOverlay() const;
 
 private:
 	struct DirIndex {
@@ -62,13 +66,15 @@ private:
 	void writeDIREntry(DirIndex dirIndex, DirIndex dirDirIndex,
 	                   const MSXDirEntry& newEntry);
 	void syncWithHost();
-	void checkDeletedHostFiles();
+	void checkHostFiles(const std::set<std::string>* names);
 	void deleteMSXFile(DirIndex dirIndex);
 	void deleteMSXFilesInDir(unsigned msxDirSector);
 	void freeFATChain(unsigned cluster);
-	void addNewHostFiles(const std::string& hostSubDir, unsigned msxDirSector);
+	void addNewHostFiles(const std::string& hostSubDir, unsigned msxDirSector,
+	                     bool scanSubDirs);
 	void addNewDirectory(const std::string& hostSubDir, const std::string& hostName,
-                             unsigned msxDirSector, FileOperations::Stat& fst);
+                             unsigned msxDirSector, FileOperations::Stat& fst,
+                             bool scanSubDirs);
 	void addNewHostFile(const std::string& hostSubDir, const std::string& hostName,
 	                    unsigned msxDirSector, FileOperations::Stat& fst);
 	DirIndex fillMSXDirEntry(
@@ -76,11 +82,11 @@ private:
 		unsigned msxDirSector);
 	DirIndex getFreeDirEntry(unsigned msxDirSector);
 	DirIndex findHostFileInDSK(const std::string& hostName);
+	void setHostName(DirIndex dirIndex, const std::string& hostName);
 	bool checkFileUsedInDSK(const std::string& hostName);
 	unsigned nextMsxDirSector(unsigned sector);
 	bool checkMSXFileExists(const std::string& msxfilename,
 	                        unsigned msxDirSector);
-	void checkModifiedHostFiles();
 	void setMSXTimeStamp(DirIndex dirIndex, FileOperations::Stat& fst);
 	void importHostFile(DirIndex dirIndex, FileOperations::Stat& fst);
 	void exportToHost(DirIndex dirIndex, DirIndex dirDirIndex);
@@ -126,6 +132,16 @@ private:
 	// host file/dir.
 	typedef std::map<DirIndex, MapDir> MapDirs;
 	MapDirs mapDirs;
+	// Reverse index: host name -> directory entry. Entries can be stale
+	// (they're not removed together with the mapDirs entry), so they must
+	// be checked against mapDirs. See findHostFileInDSK().
+	std::unordered_map<std::string, DirIndex> hostNameIndex;
+
+	// Tells which host files changed since the previous sync.
+	HostDirWatcher watcher;
+	// Adding a host file failed (e.g. disk full), so on the next sync
+	// (after some change) retry adding all files.
+	bool addFailed;
 
 	// format parameters which depend on single/double sided
 	// varying root parameters
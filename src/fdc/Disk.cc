@@ -92,6 +92,13 @@ void Disk::detectGeometryFallback() // if all else fails, use statistics
 	nbSides = (getNbSectors() == 720) ? 1 : 2;
 }
 
+bool Disk::supportsOverlay() const
+{
+	// In general writeTrackImpl() doesn't go via writeSector() (e.g. DMK
+	// images store the raw track).
+	return false;
+}
+
 void Disk::detectGeometry()
 {
 	// From the MSX Red Book (p265):
@@ -31,6 +31,7 @@ protected:
 
 	virtual void detectGeometry();
 	virtual void detectGeometryFallback();
+	virtual bool supportsOverlay() const;
 
 	void setSectorsPerTrack(unsigned num);
 	unsigned getSectorsPerTrack();
@@ -3,6 +3,7 @@
 #include "DummyDisk.hh"
 #include "RamDSKDiskImage.hh"
 #include "DirAsDSK.hh"
+#include "DiskOverlay.hh"
 #include "CommandController.hh"
 #include "RecordedCommand.hh"
 #include "StateChangeDistributor.hh"
@@ -11,6 +12,8 @@
 #include "File.hh"
 #include "MSXMotherBoard.hh"
 #include "Reactor.hh"
+#include "GlobalSettings.hh"
+#include "BooleanSetting.hh"
 #include "DiskManipulator.hh"
 #include "FileContext.hh"
 #include "FileOperations.hh"
@@ -41,6 +44,8 @@ public:
 	virtual void tabCompletion(vector<string>& tokens) const;
 	virtual bool needRecord(const vector<string>& tokens) const;
 private:
+	void overlay(const vector<TclObject>& tokens, TclObject& result);
+
 	DiskChanger& diskChanger;
 };
 
@@ -52,6 +57,7 @@ DiskChanger::DiskChanger(MSXMotherBoard& board,
 	, stateChangeDistributor(&board.getStateChangeDistributor())
 	, scheduler(&board.getScheduler())
 	, filePool(&board.getReactor().getFilePool())
+	, powerSetting(&board.getReactor().getGlobalSettings().getPowerSetting())
 	, diskFactory(board.getReactor().getDiskFactory())
 	, manipulator(board.getReactor().getDiskManipulator())
 	, driveName(driveName_)
@@ -69,6 +75,7 @@ DiskChanger::DiskChanger(const string& driveName_,
 	, stateChangeDistributor(nullptr)
 	, scheduler(nullptr)
 	, filePool(nullptr)
+	, powerSetting(nullptr)
 	, diskFactory(diskFactory_)
 	, manipulator(manipulator_)
 	, driveName(driveName_)
@@ -244,10 +251,15 @@ void DiskCommand::execute(const vector<TclObject>& tokens, TclObject& result)
 		if (diskChanger.disk->isWriteProtected()) {
 			options.addListElement("readonly");
 		}
+		if (diskChanger.disk->hasOverlay()) {
+			options.addListElement("overlay");
+		}
 		if (options.getListLength() != 0) {
 			result.addListElement(options);
 		}
 
+	} else if (tokens[1].getString() == "overlay") {
+		overlay(tokens, result);
 	} else if (tokens[1].getString() == "ramdsk") {
 		diskChanger.sendChangeDiskEvent({
 			diskChanger.getDriveName(), tokens[1].getString().str()});
@@ -295,21 +307,83 @@ void DiskCommand::execute(const vector<TclObject>& tokens, TclObject& result)
 	}
 }
 
+void DiskCommand::overlay(const vector<TclObject>& tokens, TclObject& result)
+{
+	Disk& disk = *diskChanger.disk;
+	if (tokens.size() == 2) {
+		// number of modified sectors and the delta file (if any)
+		if (auto* overlay = disk.getOverlay()) {
+			result.addListElement(int(overlay->getNbSectors()));
+			result.addListElement(overlay->getDeltaFile());
+		}
+		return;
+	}
+	string_ref cmd = tokens[2].getString();
+	// Attaching a delta file to an in-memory overlay (e.g. one restored
+	// from a savestate) doesn't change the content of the disk.
+	bool attach = (cmd == "enable") && (tokens.size() == 4) &&
+	              disk.getOverlay() && disk.getOverlay()->getDeltaFile().empty();
+	if ((cmd != "commit") && !attach &&
+	    diskChanger.powerSetting && diskChanger.powerSetting->getBoolean()) {
+		// Enabling (with an existing delta file) or discarding changes
+		// the content of the disk. These commands are not recorded
+		// (they manage host files), so a replay would diverge.
+		throw CommandException(
+			"Can only enable or discard the overlay when MSX is "
+			"powered down.");
+	}
+	try {
+		if ((cmd == "enable") && (tokens.size() <= 4)) {
+			string deltaFile = (tokens.size() == 4)
+				? UserFileContext().resolveCreate(tokens[3].getString())
+				: "";
+			disk.enableOverlay(deltaFile);
+			// sectors from the delta file may change the content
+			// (attaching one to an existing overlay doesn't)
+			if (!attach && disk.getOverlay()->getNbSectors()) {
+				diskChanger.forceDiskChange();
+			}
+		} else if ((cmd == "commit") && (tokens.size() == 3)) {
+			disk.commitOverlay();
+		} else if ((cmd == "discard") && (tokens.size() == 3)) {
+			bool changed = disk.getOverlay() &&
+			               disk.getOverlay()->getNbSectors();
+			disk.discardOverlay();
+			if (changed) diskChanger.forceDiskChange();
+		} else {
+			throw CommandException("Too many or wrong arguments.");
+		}
+	} catch (CommandException&) {
+		throw;
+	} catch (MSXException& e) {
+		throw CommandException(e.getMessage());
+	}
+}
+
 string DiskCommand::help(const vector<string>& /*tokens*/) const
 {
 	const string& name = diskChanger.getDriveName();
-	return name + " eject             : remove disk from virtual drive\n" +
-	       name + " ramdsk            : create a virtual disk in RAM\n" +
-	       name + " insert <filename> : change the disk file\n" +
-	       name + " <filename>        : change the disk file\n" +
-	       name + "                   : show which disk image is in drive";
+	return name + " eject                   : remove disk from virtual drive\n" +
+	       name + " ramdsk                  : create a virtual disk in RAM\n" +
+	       name + " insert <filename>       : change the disk file\n" +
+	       name + " <filename>              : change the disk file\n" +
+	       name + " overlay enable [<file>] : send all further writes to an overlay (in memory or in the given delta file), the disk image itself is not modified; with an overlay that has no delta file (e.g. after loading a savestate) it starts storing that overlay in the given file\n" +
+	       name + " overlay commit          : write the overlay to the disk image and remove the overlay\n" +
+	       name + " overlay discard         : forget the overlay (and delete its delta file)\n" +
+	       name + " overlay                 : show the number of sectors in the overlay and its delta file\n" +
+	       name + "                         : show which disk image is in drive";
 }
 
 void DiskCommand::tabCompletion(vector<string>& tokens) const
 {
-	if (tokens.size() >= 2) {
+	if ((tokens.size() == 3) && (tokens[1] == "overlay")) {
+		static const char* const cmds[] = {
+			"enable", "commit", "discard",
+		};
+		completeString(tokens, cmds);
+	} else if (tokens.size() >= 2) {
 		static const char* const extra[] = {
-			"eject", "ramdsk", "insert",
+			"eject", "ramdsk", "insert", "overlay",
 		};
 		completeFileName(tokens, UserFileContext(), extra);
 	}
@@ -317,7 +391,10 @@ void DiskCommand::tabCompletion(vector<string>& tokens) const
 
 bool DiskCommand::needRecord(const vector<string>& tokens) const
 {
-	return tokens.size() > 1;
+	// The overlay manages (host) files, it shouldn't be repeated on replay.
+	// That's why the subcommands that change the content of the disk
+	// require the MSX to be powered down.
+	return (tokens.size() > 1) && (tokens[1] != "overlay");
 }
 
 static string calcSha1(SectorAccessibleDisk* disk)
@@ -327,6 +404,7 @@ static string calcSha1(SectorAccessibleDisk* disk)
 
 // version 1:  initial version
 // version 2:  replaced Filename with DiskName
+// version 3:  added overlay
 template<typename Archive>
 void DiskChanger::serialize(Archive& ar, unsigned version)
 {
@@ -391,7 +469,24 @@ void DiskChanger::serialize(Archive& ar, unsigned version)
 				//   without diskimage. Is this better?
 			}
 		}
+	}
 
+	// must be restored before the checksum (that one includes the overlay)
+	if (ar.versionAtLeast(version, 3)) {
+		if (auto* sad = getSectorAccessibleDisk()) {
+			sad->serializeOverlay(ar);
+		} else {
+			bool overlay = false;
+			ar.serialize("overlay", overlay);
+			if (overlay) {
+				throw MSXException(
+					"Couldn't restore overlay in drive " +
+					getDriveName() + ": no disk inserted");
+			}
+		}
+	}
+
+	if (ar.isLoader()) {
 		string newChecksum = calcSha1(getSectorAccessibleDisk());
 		if (oldChecksum != newChecksum) {
 			controller.getCliComm().printWarning(
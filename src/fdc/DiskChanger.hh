@@ -15,6 +15,7 @@ class CommandController;
 class StateChangeDistributor;
 class Scheduler;
 class FilePool;
+class BooleanSetting;
 class MSXMotherBoard;
 class DiskFactory;
 class DiskManipulator;
@@ -76,6 +77,7 @@ private:
 	StateChangeDistributor* stateChangeDistributor;
 	Scheduler* scheduler;
 	FilePool* filePool;
+	const BooleanSetting* powerSetting;
 	DiskFactory& diskFactory;
 	DiskManipulator& manipulator;
 
@@ -88,7 +90,7 @@ private:
 
 	bool diskChangedFlag;
 };
-SERIALIZE_CLASS_VERSION(DiskChanger, 2);
+SERIALIZE_CLASS_VERSION(DiskChanger, 3);
 
 } // namespace openmsx
 
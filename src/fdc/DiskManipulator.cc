@@ -13,6 +13,9 @@
 #include "FileException.hh"
 #include "FileOperations.hh"
 #include "SectorBasedDisk.hh"
+#include "SectorCache.hh"
+#include "InfoTopic.hh"
+#include "TclObject.hh"
 #include "StringOp.hh"
 #include "memory.hh"
 #include "xrange.hh"
@@ -31,10 +34,27 @@ namespace openmsx {
 const unsigned DiskManipulator::MAX_PARTITIONS;
 #endif
 
+class DiskCacheInfo : public InfoTopic
+{
+public:
+	DiskCacheInfo(InfoCommand& openMSXInfoCommand,
+	              DiskManipulator& manipulator);
+	virtual void execute(const vector<TclObject>& tokens,
+	                     TclObject& result) const;
+	virtual string help(const vector<string>& tokens) const;
+	virtual void tabCompletion(vector<string>& tokens) const;
+private:
+	vector<string> getDriveNames() const;
+	DiskManipulator& manipulator;
+};
+
+
 DiskManipulator::DiskManipulator(CommandController& commandController,
                                  Reactor& reactor_)
 	: Command(commandController, "diskmanipulator")
 	, reactor(reactor_)
+	, cacheInfo(make_unique<DiskCacheInfo>(
+		reactor.getOpenMSXInfoCommand(), *this))
 {
 }
 
@@ -545,4 +565,81 @@ void DiskManipulator::exprt(DriveSettings& driveData, const string& dirname,
 	}
 }
 
+
+// class DiskCacheInfo
+
+DiskCacheInfo::DiskCacheInfo(InfoCommand& openMSXInfoCommand,
+                             DiskManipulator& manipulator_)
+	: InfoTopic(openMSXInfoCommand, "disk_cache")
+	, manipulator(manipulator_)
+{
+}
+
+vector<string> DiskCacheInfo::getDriveNames() const
+{
+	vector<string> result;
+	for (auto& d : manipulator.drives) {
+		auto* disk = d.drive->getSectorAccessibleDisk();
+		if (disk && disk->getSectorCache()) {
+			result.push_back(d.driveName);
+		}
+	}
+	return result;
+}
+
+void DiskCacheInfo::execute(const vector<TclObject>& tokens,
+                            TclObject& result) const
+{
+	switch (tokens.size()) {
+	case 2:
+		result.addListElements(getDriveNames());
+		break;
+	case 3: {
+		string_ref name = tokens[2].getString();
+		auto it = manipulator.findDriveSettings(name);
+		if (it == manipulator.drives.end()) {
+			it = manipulator.findDriveSettings(
+				manipulator.getMachinePrefix() + name);
+		}
+		if (it == manipulator.drives.end()) {
+			throw CommandException("Unknown drive: " + name);
+		}
+		auto* disk = it->drive->getSectorAccessibleDisk();
+		auto* cache = disk ? disk->getSectorCache() : nullptr;
+		if (!cache) {
+			throw CommandException("No cache for drive: " + name);
+		}
+		auto& stats = cache->getStats();
+		result.addListElement("hits");
+		result.addListElement(StringOp::toString(stats.hits));
+		result.addListElement("misses");
+		result.addListElement(StringOp::toString(stats.misses));
+		result.addListElement("readahead");
+		result.addListElement(StringOp::toString(stats.readAhead));
+		result.addListElement("mapped");
+		result.addListElement(stats.mapped ? 1 : 0);
+		break;
+	}
+	default:
+		throw CommandException("Too many parameters");
+	}
+}
+
+string DiskCacheInfo::help(const vector<string>& /*tokens*/) const
+{
+	return "Without argument: show the drives that have a sector cache.\n"
+	       "With a drive name as argument: show the statistics of the "
+	       "cache of that drive: number of sectors read from the cache "
+	       "(hits) and from the image file (misses), the number of "
+	       "blocks that were read in advance, and whether the image "
+	       "file is memory mapped.\n";
+}
+
+void DiskCacheInfo::tabCompletion(vector<string>& tokens) const
+{
+	if (tokens.size() == 3) {
+		completeString(tokens, getDriveNames());
+	}
+}
+
 } // namespace openmsx
@@ -14,6 +14,7 @@ class SectorAccessibleDisk;
 class DiskPartition;
 class MSXtar;
 class Reactor;
+class DiskCacheInfo;
 
 class DiskManipulator : public Command
 {
@@ -65,6 +66,8 @@ private:
 	           const std::vector<std::string>& lists);
 
 	Reactor& reactor;
+	friend class DiskCacheInfo;
+	const std::unique_ptr<DiskCacheInfo> cacheInfo;
 };
 
 } // namespace openmsx
@@ -0,0 +1,212 @@
+#include "DiskOverlay.hh"
+#include "File.hh"
+#include "FileException.hh"
+#include "FileOperations.hh"
+#include "MSXException.hh"
+#include "serialize.hh"
+#include "serialize_stl.hh"
+#include "endian.hh"
+#include "memory.hh"
+#include <cstring>
+#include <cassert>
+
+using std::string;
+using std::vector;
+
+namespace openmsx {
+
+static const char MAGIC[8] = { 'o','M','S','X','d','e','l','t' };
+static const unsigned VERSION = 1;
+static const size_t HEADER_SIZE = 8 + 4 + 4 + 8;
+static const size_t RECORD_SIZE = 8 + sizeof(SectorBuffer);
+
+DiskOverlay::DiskOverlay(size_t nbSectors_, const string& deltaFile)
+	: deltaName(deltaFile)
+	, nbSectors(nbSectors_)
+{
+	if (!deltaName.empty()) {
+		try {
+			loadDeltaFile();
+		} catch (FileException& e) {
+			throw MSXException("Couldn't open overlay delta file: " +
+			                   e.getMessage());
+		}
+	}
+}
+
+DiskOverlay::~DiskOverlay()
+{
+}
+
+// Opens (or creates) the delta file and checks its header. Returns its size,
+// zero for a new file.
+size_t DiskOverlay::openDeltaFile()
+{
+	file = make_unique<File>(deltaName, File::CREATE);
+	if (file->isReadOnly()) {
+		throw FileException("file is read-only");
+	}
+	size_t size = file->getSize();
+	if (size == 0) return 0;
+
+	byte header[HEADER_SIZE];
+	if (size >= HEADER_SIZE) {
+		file->read(header, sizeof(header));
+	}
+	if ((size < HEADER_SIZE) ||
+	    (memcmp(header, MAGIC, sizeof(MAGIC)) != 0) ||
+	    (Endian::read_UA_L32(header +  8) != VERSION) ||
+	    (Endian::read_UA_L32(header + 12) != sizeof(SectorBuffer))) {
+		throw FileException("not an overlay delta file");
+	}
+	if (Endian::read_UA_L64(header + 16) != nbSectors) {
+		throw FileException("it belongs to a disk image of a different size");
+	}
+	return size;
+}
+
+void DiskOverlay::loadDeltaFile()
+{
+	size_t size = openDeltaFile();
+	if (size == 0) {
+		// new delta file
+		writeHeader();
+		return;
+	}
+
+	size_t num = (size - HEADER_SIZE) / RECORD_SIZE;
+	data.resize(num);
+	for (size_t slot = 0; slot < num; ++slot) {
+		byte num8[8];
+		file->read(num8, sizeof(num8));
+		file->read(&data[slot], sizeof(SectorBuffer));
+		uint64_t sector = Endian::read_UA_L64(num8);
+		if (sector >= nbSectors) {
+			throw FileException("corrupt delta file");
+		}
+		index[size_t(sector)] = slot;
+	}
+	if ((HEADER_SIZE + num * RECORD_SIZE) != size) {
+		// drop an incomplete record at the end (openMSX was killed while
+		// writing it), new records must start at a record boundary
+		file->truncate(HEADER_SIZE + num * RECORD_SIZE);
+	}
+}
+
+void DiskOverlay::writeHeader()
+{
+	byte header[HEADER_SIZE];
+	memcpy(header, MAGIC, sizeof(MAGIC));
+	Endian::write_UA_L32(header +  8, VERSION);
+	Endian::write_UA_L32(header + 12, unsigned(sizeof(SectorBuffer)));
+	Endian::write_UA_L64(header + 16, nbSectors);
+	file->write(header, sizeof(header));
+}
+
+void DiskOverlay::writeRecord(size_t slot, size_t sector,
+                              const SectorBuffer& buf)
+{
+	byte num8[8];
+	Endian::write_UA_L64(num8, sector);
+	file->seek(HEADER_SIZE + slot * RECORD_SIZE);
+	file->write(num8, sizeof(num8));
+	file->write(&buf, sizeof(buf));
+}
+
+void DiskOverlay::attachDeltaFile(const string& deltaFile)
+{
+	assert(deltaName.empty() && !file);
+	deltaName = deltaFile;
+	try {
+		openDeltaFile();
+		file->truncate(0);
+		file->seek(0);
+		writeHeader();
+		for (auto& p : index) {
+			writeRecord(p.second, p.first, data[p.second]);
+		}
+	} catch (FileException& e) {
+		file.reset();
+		deltaName.clear();
+		throw MSXException("Couldn't open overlay delta file: " +
+		                   e.getMessage());
+	}
+}
+
+bool DiskOverlay::readSector(size_t sector, SectorBuffer& buf) const
+{
+	auto it = index.find(sector);
+	if (it == index.end()) return false;
+	buf = data[it->second];
+	return true;
+}
+
+void DiskOverlay::writeSector(size_t sector, const SectorBuffer& buf)
+{
+	auto it = index.find(sector);
+	size_t slot;
+	if (it != index.end()) {
+		slot = it->second;
+	} else {
+		slot = data.size();
+	}
+	if (file) {
+		writeRecord(slot, sector, buf);
+	}
+	// only update the in-memory copy when the delta file write succeeded
+	if (slot == data.size()) {
+		data.push_back(buf);
+		index[sector] = slot;
+	} else {
+		data[slot] = buf;
+	}
+}
+
+vector<size_t> DiskOverlay::getSectors() const
+{
+	vector<size_t> result;
+	result.reserve(index.size());
+	for (auto& p : index) {
+		result.push_back(p.first);
+	}
+	return result;
+}
+
+void DiskOverlay::removeDeltaFile()
+{
+	if (!file) return;
+	file.reset();
+	FileOperations::unlink(deltaName);
+}
+
+template<typename Archive>
+void DiskOverlay::serialize(Archive& ar, unsigned /*version*/)
+{
+	// sector number of each slot in 'data'
+	vector<size_t> sectors(data.size());
+	if (!ar.isLoader()) {
+		for (auto& p : index) {
+			sectors[p.second] = p.first;
+		}
+	}
+	// Not the name of the delta file: after loading, this overlay is in
+	// memory only (see attachDeltaFile()).
+	ar.serialize("sectors", sectors);
+	if (ar.isLoader()) {
+		assert(data.empty() && !file);
+		data.resize(sectors.size());
+		for (size_t slot = 0; slot < sectors.size(); ++slot) {
+			if (sectors[slot] >= nbSectors) {
+				throw MSXException("Corrupt disk overlay in savestate");
+			}
+			index[sectors[slot]] = slot;
+		}
+	}
+	if (!data.empty()) {
+		ar.serialize_blob("data", data.data(),
+		                  data.size() * sizeof(SectorBuffer));
+	}
+}
+INSTANTIATE_SERIALIZE_METHODS(DiskOverlay);
+
+} // namespace openmsx
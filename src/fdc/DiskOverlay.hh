@@ -0,0 +1,86 @@
+#ifndef DISKOVERLAY_HH
+#define DISKOVERLAY_HH
+
+#include "DiskImageUtils.hh"
+#include "noncopyable.hh"
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace openmsx {
+
+class File;
+
+/** Copy-on-write layer on top of a disk image.
+  *
+  * Written sectors are kept in this overlay instead of in the image, so the
+  * image itself is only read and it can be shared (e.g. by several openMSX
+  * instances running the same test). The modified sectors are kept in
+  * memory and, optionally, also in a delta file. A delta file survives the
+  * session: enabling the overlay again with the same delta file continues
+  * where the previous session stopped.
+  *
+  * Delta file layout (little endian): 8 byte magic, L32 version, L32 sector
+  * size, L64 number of sectors of the image, followed by records of an L64
+  * sector number plus the sector data. A sector that's written again
+  * overwrites its own record.
+  *
+  * The modified sectors are also part of savestates (and thus of reverse),
+  * the image itself and the name of the delta file are not. So after
+  * loading a state the overlay is in memory only, until a delta file is
+  * attached again.
+  */
+class DiskOverlay : private noncopyable
+{
+public:
+	/** @param nbSectors Size of the underlying image.
+	  * @param deltaFile Name of the delta file, empty for an in-memory
+	  *                  only overlay.
+	  * @throw MSXException when the delta file can't be opened or
+	  *                     belongs to an image with a different size.
+	  */
+	DiskOverlay(size_t nbSectors, const std::string& deltaFile);
+	~DiskOverlay();
+
+	/** Returns false (and leaves 'buf' untouched) when the sector was
+	  * not (yet) written. */
+	bool readSector(size_t sector, SectorBuffer& buf) const;
+	/** @throw FileException */
+	void writeSector(size_t sector, const SectorBuffer& buf);
+
+	/** Sorted list of all modified sectors. */
+	std::vector<size_t> getSectors() const;
+	size_t getNbSectors() const { return index.size(); }
+	const std::string& getDeltaFile() const { return deltaName; }
+
+	/** Start storing this (in-memory only) overlay in the given delta
+	  * file. The file must not exist yet, or be a delta file for an image
+	  * of the same size. Its content is replaced by that of this overlay.
+	  * @throw MSXException when the file can't be used.
+	  */
+	void attachDeltaFile(const std::string& deltaFile);
+
+	/** Close and delete the delta file (if any). Used after the overlay
+	  * has been committed or discarded. */
+	void removeDeltaFile();
+
+	template<typename Archive>
+	void serialize(Archive& ar, unsigned version);
+
+private:
+	void loadDeltaFile();
+	size_t openDeltaFile();
+	void writeHeader();
+	void writeRecord(size_t slot, size_t sector, const SectorBuffer& buf);
+
+	std::map<size_t, size_t> index; // sector number -> slot in 'data'
+	std::vector<SectorBuffer> data;
+	std::unique_ptr<File> file;
+	std::string deltaName;
+	const size_t nbSectors;
+};
+
+} // namespace openmsx
+
+#endif
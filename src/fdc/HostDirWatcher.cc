@@ -0,0 +1,133 @@
+#include "HostDirWatcher.hh"
+#include "FileOperations.hh"
+#include "systemfuncs.hh"
+#if HAVE_INOTIFY_INIT1
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+using std::string;
+
+namespace openmsx {
+
+#if HAVE_INOTIFY_INIT1
+static const uint32_t WATCH_MASK =
+	IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB |
+	IN_MOVED_FROM | IN_MOVED_TO | IN_MOVE_SELF | IN_ONLYDIR;
+#endif
+
+HostDirWatcher::HostDirWatcher(const string& hostDir_)
+	: hostDir(hostDir_)
+	, fd(-1)
+	, needFullScan(true)
+{
+#if HAVE_INOTIFY_INIT1
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+HostDirWatcher::~HostDirWatcher()
+{
+#if HAVE_INOTIFY_INIT1
+	if (fd != -1) close(fd);
+#endif
+}
+
+void HostDirWatcher::addDir(const string& hostSubDir)
+{
+#if HAVE_INOTIFY_INIT1
+	if (fd == -1) return;
+	string path = FileOperations::getNativePath(hostDir + hostSubDir);
+	int wd = inotify_add_watch(fd, path.c_str(), WATCH_MASK);
+	if (wd == -1) {
+		if ((errno == ENOSPC) || (errno == ENOMEM)) {
+			// The limit on the number of watches is reached, from
+			// now on always check all files.
+			removeAllWatches();
+			close(fd);
+			fd = -1;
+		}
+		// Otherwise the directory can't be read (or is already
+		// removed again), the changes in its parent still get
+		// reported.
+		return;
+	}
+	// (re-)adding the same directory gives the same descriptor
+	watches[wd] = hostSubDir;
+#else
+	(void)hostSubDir;
+#endif
+}
+
+bool HostDirWatcher::getChanges(std::set<string>& names,
+                                std::set<string>& dirs)
+{
+#if HAVE_INOTIFY_INIT1
+	if (fd == -1) return false;
+	bool known = !needFullScan;
+	// buffer must be suitably aligned for inotify_event
+	union {
+		inotify_event event;
+		char raw[4096];
+	} buf;
+	while (true) {
+		ssize_t len = read(fd, buf.raw, sizeof(buf.raw));
+		if (len <= 0) break; // EAGAIN: no more events
+		for (char* p = buf.raw; p < (buf.raw + len); ) {
+			auto& ev = *reinterpret_cast<inotify_event*>(p);
+			p += sizeof(inotify_event) + ev.len;
+
+			if (ev.mask & IN_Q_OVERFLOW) {
+				known = false;
+				continue;
+			}
+			auto it = watches.find(ev.wd);
+			if (it == watches.end()) continue;
+			if (ev.mask & IN_IGNORED) {
+				// directory was removed
+				watches.erase(it);
+				continue;
+			}
+			if (ev.mask & IN_MOVE_SELF) {
+				// The names of the watches below this directory
+				// are no longer correct, start over.
+				known = false;
+				continue;
+			}
+			if (ev.len == 0) continue; // about the directory itself
+			names.insert(it->second + ev.name);
+			if (ev.mask & (IN_CREATE | IN_MOVED_TO)) {
+				dirs.insert(it->second);
+			}
+		}
+	}
+	if (!known) {
+		// the watches are re-added during the full scan
+		removeAllWatches();
+		needFullScan = true;
+	}
+	return known;
+#else
+	(void)names;
+	(void)dirs;
+	return false;
+#endif
+}
+
+void HostDirWatcher::fullScanDone()
+{
+	needFullScan = false;
+}
+
+void HostDirWatcher::removeAllWatches()
+{
+#if HAVE_INOTIFY_INIT1
+	for (auto& w : watches) {
+		inotify_rm_watch(fd, w.first);
+	}
+#endif
+	watches.clear();
+}
+
+} // namespace openmsx
@@ -0,0 +1,57 @@
+#ifndef HOSTDIRWATCHER_HH
+#define HOSTDIRWATCHER_HH
+
+#include "noncopyable.hh"
+#include <map>
+#include <set>
+#include <string>
+
+namespace openmsx {
+
+/** Reports which entries in a host directory (tree) changed, so that
+  * DirAsDSK doesn't have to stat all host files on every sync.
+  *
+  * This uses inotify (Linux only). When the changes are not (exactly) known,
+  * e.g. on other platforms, after an event queue overflow or when a
+  * directory was moved, getChanges() returns false and the caller has to
+  * check all host files (and report that with fullScanDone()).
+  */
+class HostDirWatcher : private noncopyable
+{
+public:
+	/** @param hostDir Must end in '/'. */
+	explicit HostDirWatcher(const std::string& hostDir);
+	~HostDirWatcher();
+
+	/** Also watch this subdirectory, relative to the host directory,
+	  * either empty or ending in '/'. This should be done before reading
+	  * the directory, so that no changes are missed. */
+	void addDir(const std::string& hostSubDir);
+
+	/** Collect the changes since the previous call.
+	  * @param names Names (relative to the host directory) of the files
+	  *              and directories that were created, removed, modified
+	  *              or renamed.
+	  * @param dirs Directories (relative, empty or ending in '/') in
+	  *             which files or directories were created.
+	  * @result false when the changes are not known, then the caller
+	  *         must check all host files.
+	  */
+	bool getChanges(std::set<std::string>& names,
+	                std::set<std::string>& dirs);
+
+	/** All host files were checked (after getChanges() returned false). */
+	void fullScanDone();
+
+private:
+	void removeAllWatches();
+
+	const std::string hostDir;
+	std::map<int, std::string> watches; // watch descriptor -> subdir
+	int fd;
+	bool needFullScan;
+};
+
+} // namespace openmsx
+
+#endif
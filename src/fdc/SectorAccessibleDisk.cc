@@ -1,9 +1,11 @@
 #include "SectorAccessibleDisk.hh"
 #include "EmptyDiskPatch.hh"
+#include "DiskOverlay.hh"
 #include "IPSPatch.hh"
 #include "DiskExceptions.hh"
 #include "sha1.hh"
 #include "xrange.hh"
+#include "serialize.hh"
 #include "memory.hh"
 
 namespace openmsx {
@@ -37,6 +39,9 @@ void SectorAccessibleDisk::readSector(size_t sector, SectorBuffer& buf)
 		throw NoSuchSectorException("No such sector");
 	}
 	try {
+		// modified sectors in the overlay take precedence over both the
+		// image and the patches
+		if (overlay && overlay->readSector(sector, buf)) return;
 		// in the end this calls readSectorImpl()
 		patch->copyBlock(sector * sizeof(buf), buf.raw, sizeof(buf));
 	} catch (MSXException& e) {
@@ -53,7 +58,12 @@ void SectorAccessibleDisk::writeSector(size_t sector, const SectorBuffer& buf)
 		throw NoSuchSectorException("No such sector");
 	}
 	try {
-		writeSectorImpl(sector, buf);
+		if (overlay) {
+			overlay->writeSector(sector, buf);
+			overlayChanged(sector);
+		} else {
+			writeSectorImpl(sector, buf);
+		}
 	} catch (MSXException& e) {
 		throw DiskIOErrorException("Disk I/O error: " + e.getMessage());
 	}
@@ -80,6 +90,87 @@ bool SectorAccessibleDisk::hasPatches() const
 	return !patch->isEmptyPatch();
 }
 
+void SectorAccessibleDisk::enableOverlay(const std::string& deltaFile)
+{
+	if (overlay) {
+		if (!deltaFile.empty() && overlay->getDeltaFile().empty()) {
+			// e.g. restored from a savestate
+			overlay->attachDeltaFile(deltaFile);
+			return;
+		}
+		throw MSXException("There already is an overlay.");
+	}
+	if (isDummyDisk() || !supportsOverlay()) {
+		throw MSXException("This type of disk image doesn't support "
+		                   "an overlay.");
+	}
+	overlay = make_unique<DiskOverlay>(getNbSectors(), deltaFile);
+	overlayChanged(size_t(-1));
+	flushCaches();
+}
+
+void SectorAccessibleDisk::commitOverlay()
+{
+	if (!overlay) {
+		throw MSXException("There is no overlay.");
+	}
+	if (forcedWriteProtect || isWriteProtectedImpl()) {
+		throw WriteProtectedException(
+			"Can't commit the overlay, the disk image is read-only.");
+	}
+	for (auto sector : overlay->getSectors()) {
+		SectorBuffer buf;
+		overlay->readSector(sector, buf);
+		try {
+			writeSectorImpl(sector, buf);
+		} catch (MSXException& e) {
+			// keep the overlay (complete), so a retry is possible
+			throw DiskIOErrorException(
+				"Disk I/O error while committing the overlay: " +
+				e.getMessage());
+		}
+	}
+	overlay->removeDeltaFile();
+	overlay.reset();
+	overlayChanged(size_t(-1));
+	flushCaches();
+}
+
+void SectorAccessibleDisk::discardOverlay()
+{
+	if (!overlay) {
+		throw MSXException("There is no overlay.");
+	}
+	overlay->removeDeltaFile();
+	overlay.reset();
+	overlayChanged(size_t(-1));
+	flushCaches();
+}
+
+template<typename Archive>
+void SectorAccessibleDisk::serializeOverlay(Archive& ar)
+{
+	bool active = overlay.get() != nullptr;
+	ar.serialize("overlay", active);
+	if (ar.isLoader()) {
+		overlay.reset();
+		if (active) {
+			overlay = make_unique<DiskOverlay>(getNbSectors(), "");
+		}
+	}
+	if (active) {
+		ar.serialize("overlayContent", *overlay);
+	}
+	if (ar.isLoader()) {
+		overlayChanged(size_t(-1));
+		flushCaches();
+	}
+}
+template void SectorAccessibleDisk::serializeOverlay(MemInputArchive&);
+template void SectorAccessibleDisk::serializeOverlay(MemOutputArchive&);
+template void SectorAccessibleDisk::serializeOverlay(XmlInputArchive&);
+template void SectorAccessibleDisk::serializeOverlay(XmlOutputArchive&);
+
 Sha1Sum SectorAccessibleDisk::getSha1Sum()
 {
 	checkCaches();
@@ -130,7 +221,8 @@ int SectorAccessibleDisk::writeSectors(
 
 bool SectorAccessibleDisk::isWriteProtected() const
 {
-	return forcedWriteProtect || isWriteProtectedImpl();
+	// with an overlay the image itself is never written
+	return forcedWriteProtect || (!overlay && isWriteProtectedImpl());
 }
 
 void SectorAccessibleDisk::forceWriteProtect()
@@ -144,6 +236,11 @@ bool SectorAccessibleDisk::isDummyDisk() const
 	return false;
 }
 
+const SectorCache* SectorAccessibleDisk::getSectorCache() const
+{
+	return nullptr;
+}
+
 void SectorAccessibleDisk::checkCaches()
 {
 	// nothing
@@ -154,4 +251,14 @@ void SectorAccessibleDisk::flushCaches()
 	sha1cache.clear();
 }
 
+bool SectorAccessibleDisk::supportsOverlay() const
+{
+	return true;
+}
+
+void SectorAccessibleDisk::overlayChanged(size_t /*sector*/)
+{
+	// nothing
+}
+
 } // namespace openmsx
@@ -10,6 +10,8 @@
 namespace openmsx {
 
 class PatchInterface;
+class DiskOverlay;
+class SectorCache;
 
 class SectorAccessibleDisk
 {
@@ -29,11 +31,37 @@ public:
 
 	virtual bool isDummyDisk() const;
 
+	/** The cache of the image file (for its statistics), or nullptr
+	  * when this disk doesn't have one. */
+	virtual const SectorCache* getSectorCache() const;
+
 	// patch stuff
 	void applyPatch(const Filename& patchFile);
 	std::vector<Filename> getPatches() const;
 	bool hasPatches() const;
 
+	// overlay stuff
+	/** Send all further writes to a copy-on-write overlay (see DiskOverlay)
+	  * instead of to the image. This also allows writes when the image
+	  * itself is read-only.
+	  * @param deltaFile Store the overlay in this file, empty for an
+	  *                  in-memory only overlay.
+	  * @throw MSXException
+	  */
+	void enableOverlay(const std::string& deltaFile);
+	/** Write the modified sectors to the image and remove the overlay.
+	  * @throw MSXException
+	  */
+	void commitOverlay();
+	/** Forget all modified sectors and remove the overlay. */
+	void discardOverlay();
+	bool hasOverlay() const { return overlay.get() != nullptr; }
+	const DiskOverlay* getOverlay() const { return overlay.get(); }
+	/** Store or restore the overlay (if any) in a savestate. Writes done
+	  * after a loadstate or reverse must again go to the overlay. */
+	template<typename Archive>
+	void serializeOverlay(Archive& ar);
+
 	/** Calculate SHA1 of the content of this disk.
 	 * This value is cached (and flushed on writes).
 	 */
@@ -60,6 +88,14 @@ protected:
 	virtual void checkCaches();
 	virtual void flushCaches();
 
+	/** Disks that don't (only) store their data via writeSectorImpl()
+	  * can't be used with an overlay. */
+	virtual bool supportsOverlay() const;
+	/** Called after a write went to the overlay (instead of to
+	  * writeSectorImpl()). Also called with sector == size_t(-1) when
+	  * the overlay is enabled or removed. */
+	virtual void overlayChanged(size_t sector);
+
 private:
 	virtual void readSectorImpl (size_t sector,       SectorBuffer& buf) = 0;
 	virtual void writeSectorImpl(size_t sector, const SectorBuffer& buf) = 0;
@@ -67,6 +103,7 @@ private:
 	virtual bool isWriteProtectedImpl() const = 0;
 
 	std::unique_ptr<const PatchInterface> patch;
+	std::unique_ptr<DiskOverlay> overlay;
 	Sha1Sum sha1cache;
 	bool forcedWriteProtect;
 	bool peekMode;
@@ -144,6 +144,13 @@ void SectorBasedDisk::flushCaches()
 	cachedTrackNum = -1;
 }
 
+bool SectorBasedDisk::supportsOverlay() const
+{
+	// writeTrackImpl() goes via writeSector(), so all writes end up in
+	// the overlay
+	return true;
+}
+
 size_t SectorBasedDisk::getNbSectorsImpl() const
 {
 	assert(nbSectors != size_t(-1)); // must have been initialized
@@ -18,6 +18,7 @@ protected:
 	virtual ~SectorBasedDisk();
 	virtual void detectGeometry();
 	virtual void flushCaches();
+	virtual bool supportsOverlay() const;
 
 	void setNbSectors(size_t num);
 
@@ -0,0 +1,151 @@
+#include "SectorCache.hh"
+#include "File.hh"
+#include "FileException.hh"
+#include <algorithm>
+#include <cstring>
+
+namespace openmsx {
+
+static const size_t SECTORS_PER_BLOCK = 8; // 4kB, typically one page
+static const size_t BLOCK_SIZE = SECTORS_PER_BLOCK * sizeof(SectorBuffer);
+static const size_t NUM_BLOCKS = 512;      // 2MB
+static const unsigned MAX_READ_AHEAD = 16; // blocks, so 64kB
+// Note: stay below the threshold above which CompressedFileAdapter streams
+// the data, mapping such a file would decompress all of it.
+static const size_t MMAP_LIMIT = 16 * 1024 * 1024;
+
+SectorCache::SectorCache(File& file_)
+	: file(file_)
+	, mmapData(nullptr)
+	, fileSize(file.getSize())
+	, useCounter(0)
+	, nextSequential(size_t(-1))
+	, readAheadSize(1)
+{
+	stats.hits = 0;
+	stats.misses = 0;
+	stats.readAhead = 0;
+	stats.mapped = false;
+
+	// A read-only file is never written (also not via an overlay, see
+	// SectorAccessibleDisk), so it can be used directly.
+	if (file.isReadOnly() && (fileSize <= MMAP_LIMIT)) {
+		try {
+			mmapData = file.mmap(fileSize);
+			stats.mapped = mmapData != nullptr;
+		} catch (FileException&) {
+			// use the block cache instead
+		}
+	}
+	if (!mmapData) {
+		size_t num = std::min(NUM_BLOCKS,
+		                      (fileSize + BLOCK_SIZE - 1) / BLOCK_SIZE);
+		blocks.resize(std::max<size_t>(num, 1));
+		for (auto& b : blocks) {
+			b.number = size_t(-1);
+			b.size = 0;
+			b.lastUse = 0;
+		}
+		data.resize(blocks.size() * BLOCK_SIZE);
+	}
+}
+
+void SectorCache::read(size_t sector, SectorBuffer& buf)
+{
+	size_t offset = sector * sizeof(SectorBuffer);
+	if ((offset >= fileSize) || ((fileSize - offset) < sizeof(buf))) {
+		throw FileException("Read beyond end of file");
+	}
+	if (mmapData) {
+		memcpy(&buf, mmapData + offset, sizeof(buf));
+		++stats.hits;
+		return;
+	}
+
+	size_t block = offset / BLOCK_SIZE;
+	unsigned slot;
+	auto it = index.find(block);
+	if (it != index.end()) {
+		slot = it->second;
+		++stats.hits;
+	} else {
+		slot = fetch(block);
+		++stats.misses;
+	}
+	blocks[slot].lastUse = ++useCounter;
+	memcpy(&buf, &data[slot * BLOCK_SIZE + offset % BLOCK_SIZE], sizeof(buf));
+}
+
+unsigned SectorCache::fetch(size_t block)
+{
+	if (block == nextSequential) {
+		readAheadSize = std::min(2 * readAheadSize, MAX_READ_AHEAD);
+	} else {
+		readAheadSize = 1;
+	}
+	size_t endBlock = (fileSize + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	size_t maxBlocks = std::min<size_t>(readAheadSize, blocks.size());
+	size_t num = 1;
+	while ((num < maxBlocks) && ((block + num) < endBlock) &&
+	       (index.find(block + num) == index.end())) {
+		++num;
+	}
+
+	// one file access for all blocks
+	size_t offset = block * BLOCK_SIZE;
+	size_t total = std::min(num * BLOCK_SIZE, fileSize - offset);
+	std::vector<byte> tmp(total);
+	file.seek(offset);
+	file.read(tmp.data(), total);
+	stats.readAhead += num - 1;
+	nextSequential = block + num;
+
+	unsigned result = 0;
+	for (size_t i = 0; i < num; ++i) {
+		unsigned slot = getFreeSlot();
+		auto& b = blocks[slot];
+		b.number = block + i;
+		b.size = std::min(BLOCK_SIZE, total - i * BLOCK_SIZE);
+		b.lastUse = ++useCounter;
+		memcpy(&data[slot * BLOCK_SIZE], &tmp[i * BLOCK_SIZE], b.size);
+		index[b.number] = slot;
+		if (i == 0) result = slot;
+	}
+	return result;
+}
+
+unsigned SectorCache::getFreeSlot()
+{
+	unsigned best = 0;
+	for (unsigned i = 0; i < blocks.size(); ++i) {
+		if (blocks[i].number == size_t(-1)) return i;
+		if (blocks[i].lastUse < blocks[best].lastUse) best = i;
+	}
+	index.erase(blocks[best].number);
+	blocks[best].number = size_t(-1);
+	return best;
+}
+
+void SectorCache::write(size_t sector, const SectorBuffer& buf)
+{
+	size_t offset = sector * sizeof(SectorBuffer);
+	file.seek(offset);
+	file.write(&buf, sizeof(buf));
+
+	auto it = index.find(offset / BLOCK_SIZE);
+	if (it != index.end()) {
+		auto& b = blocks[it->second];
+		size_t inBlock = offset % BLOCK_SIZE;
+		if ((inBlock + sizeof(buf)) <= b.size) {
+			memcpy(&data[it->second * BLOCK_SIZE + inBlock],
+			       &buf, sizeof(buf));
+		} else {
+			// the file has grown, simply drop this (last) block
+			b.number = size_t(-1);
+			index.erase(it);
+		}
+	}
+	fileSize = std::max(fileSize, offset + sizeof(buf));
+}
+
+} // namespace openmsx
@@ -0,0 +1,74 @@
+#ifndef SECTORCACHE_HH
+#define SECTORCACHE_HH
+
+#include "DiskImageUtils.hh"
+#include "MemBuffer.hh"
+#include "noncopyable.hh"
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+namespace openmsx {
+
+class File;
+
+/** Caches the sectors of a disk image file, so that not every sector read
+  * results in a seek plus a (small) read on the host file.
+  *
+  * Read-only images (that are not too big) are simply memory mapped.
+  * Otherwise the file is cached in blocks of a few sectors, the least
+  * recently used block is evicted when the cache is full. A miss in the
+  * block right after the previous miss is treated as a sequential read: the
+  * following blocks are then read in the same file access (read-ahead). The
+  * read-ahead size doubles on each sequential miss.
+  *
+  * All writes to the file must go via this cache (write-through), changes
+  * made by others (e.g. on the host) are not noticed.
+  */
+class SectorCache : private noncopyable
+{
+public:
+	struct Stats {
+		uint64_t hits;      // sectors read from the cache (or mmap)
+		uint64_t misses;    // sectors that needed a file access
+		uint64_t readAhead; // blocks read in advance
+		bool mapped;        // file is memory mapped
+	};
+
+	/** The file must remain valid for the lifetime of this cache. */
+	explicit SectorCache(File& file);
+
+	/** @throw FileException */
+	void read (size_t sector,       SectorBuffer& buf);
+	/** @throw FileException */
+	void write(size_t sector, const SectorBuffer& buf);
+
+	const Stats& getStats() const { return stats; }
+
+private:
+	struct Block {
+		size_t number;    // block number, size_t(-1) when unused
+		size_t size;      // valid bytes, less than BLOCK_SIZE at the end
+		uint64_t lastUse;
+	};
+
+	unsigned fetch(size_t block);
+	unsigned getFreeSlot();
+
+	File& file;
+	const byte* mmapData;
+	size_t fileSize;
+
+	std::vector<Block> blocks;
+	MemBuffer<byte> data; // contents of 'blocks'
+	std::unordered_map<size_t, unsigned> index; // block number -> slot
+	uint64_t useCounter;
+	size_t nextSequential; // block after the previous read from the file
+	unsigned readAheadSize;
+
+	Stats stats;
+};
+
+} // namespace openmsx
+
+#endif
@@ -1,13 +1,32 @@
 #include "CompressedFileAdapter.hh"
+#include "SeekableInflate.hh"
 #include "FileException.hh"
+#include "FileOperations.hh"
 #include "StringMap.hh"
+#include "sha1.hh"
+#include "memory.hh"
+#include <algorithm>
 #include <cstring>
+#include <mutex>
 
 using std::string;
 
 namespace openmsx {
 
 static StringMap<std::shared_ptr<CompressedFileAdapter::Decompressed>> decompressCache;
+// Files can also be opened from the FilePool indexer threads.
+static std::mutex decompressCacheMutex;
+
+// Files that decompress to at least this size (e.g. harddisk images) are not
+// decompressed as a whole, only the parts that are actually read.
+static const size_t STREAM_THRESHOLD = 16 * 1024 * 1024;
+
+static string getIndexName(const string& url)
+{
+	return FileOperations::getUserDataDir() + "/inflateindex/" +
+	       SHA1::calc(reinterpret_cast<const uint8_t*>(url.data()),
+	                  url.size()).toString();
+}
 
 
 CompressedFileAdapter::CompressedFileAdapter(std::unique_ptr<FileBase> file_)
@@ -17,6 +36,7 @@ CompressedFileAdapter::CompressedFileAdapter(std::unique_ptr<FileBase> file_)
 
 CompressedFileAdapter::~CompressedFileAdapter()
 {
+	std::lock_guard<std::mutex> lock(decompressCacheMutex);
 	auto it = decompressCache.find(getURL());
 	decompressed.reset();
 	if (it != decompressCache.end() && it->second.unique()) {
@@ -27,20 +47,56 @@ CompressedFileAdapter::~CompressedFileAdapter()
 
 void CompressedFileAdapter::decompress()
 {
-	if (decompressed) return;
+	if (decompressed || stream) return;
 
 	string url = getURL();
-	auto it = decompressCache.find(url);
-	if (it != decompressCache.end()) {
-		decompressed = it->second;
-	} else {
-		decompressed = std::make_shared<Decompressed>();
-		decompress(*file, *decompressed);
-		decompressed->cachedModificationDate = getModificationDate();
-		decompressed->cachedURL = url;
-		decompressCache[url] = decompressed;
+	{
+		std::lock_guard<std::mutex> lock(decompressCacheMutex);
+		auto it = decompressCache.find(url);
+		if (it != decompressCache.end()) {
+			decompressed = it->second;
+			// close original file, no longer needed
+			file.reset();
+			return;
+		}
 	}
 
+	StreamInfo info;
+	size_t size;
+	const byte* data = file->mmap(size);
+	// (the size in 'info' can be too small, see getStreamInfo())
+	if (getStreamInfo(*file, info) &&
+	    (std::max(info.size, size) >= STREAM_THRESHOLD)) {
+		try {
+			// keep the original file open (and mapped)
+			stream = make_unique<SeekableInflate>(
+				data, size, info.start, info.size,
+				getIndexName(url), file->getModificationDate());
+			streamOriginalName = info.originalName;
+			return;
+		} catch (FileException&) {
+			// size not as expected (or corrupt data, then this
+			// fails again below with a proper error message)
+		}
+	}
+	decompressAll(url);
+}
+
+void CompressedFileAdapter::decompressAll(const string& url)
+{
+	stream.reset();
+
+	// decompress without holding the lock
+	auto d = std::make_shared<Decompressed>();
+	decompress(*file, *d);
+	d->cachedModificationDate = getModificationDate();
+	d->cachedURL = url;
+	{
+		std::lock_guard<std::mutex> lock(decompressCacheMutex);
+		decompressCache[url] = d;
+	}
+	decompressed = d;
+
 	// close original file after succesful decompress
 	file.reset();
 }
@@ -48,6 +104,18 @@ void CompressedFileAdapter::decompress()
 void CompressedFileAdapter::read(void* buffer, size_t num)
 {
 	decompress();
+	if (stream) {
+		if (stream->getSize() < (pos + num)) {
+			throw FileException("Read beyond end of file");
+		}
+		if (stream->read(pos, static_cast<byte*>(buffer), num)) {
+			pos += num;
+			return;
+		}
+		// The size in the header was wrong, fall back to decompressing
+		// the whole file.
+		decompressAll(getURL());
+	}
 	const MemBuffer<byte>& buf = decompressed->buf;
 	if (buf.size() < (pos + num)) {
 		throw FileException("Read beyond end of file");
@@ -64,6 +132,10 @@ void CompressedFileAdapter::write(const void* /*buffer*/, size_t /*num*/)
 const byte* CompressedFileAdapter::mmap(size_t& size)
 {
 	decompress();
+	if (stream) {
+		// the whole file is needed after all
+		decompressAll(getURL());
+	}
 	size = decompressed->buf.size();
 	return reinterpret_cast<const byte*>(decompressed->buf.data());
 }
@@ -76,7 +148,7 @@ void CompressedFileAdapter::munmap()
 size_t CompressedFileAdapter::getSize()
 {
 	decompress();
-	return decompressed->buf.size();
+	return stream ? stream->getSize() : decompressed->buf.size();
 }
 
 void CompressedFileAdapter::seek(size_t newpos)
@@ -107,7 +179,7 @@ const string CompressedFileAdapter::getURL() const
 const string CompressedFileAdapter::getOriginalName()
 {
 	decompress();
-	return decompressed->originalName;
+	return stream ? streamOriginalName : decompressed->originalName;
 }
 
 bool CompressedFileAdapter::isReadOnly() const
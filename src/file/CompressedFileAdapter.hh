@@ -7,6 +7,8 @@
 
 namespace openmsx {
 
+class SeekableInflate;
+
 class CompressedFileAdapter : public FileBase
 {
 public:
@@ -32,15 +34,31 @@ public:
 	virtual time_t getModificationDate();
 
 protected:
+	/** Location of the deflate stream within the compressed file. */
+	struct StreamInfo {
+		std::string originalName;
+		size_t start; // offset of the (raw) deflate stream
+		size_t size;  // decompressed size (possibly modulo 4GB)
+	};
+
 	explicit CompressedFileAdapter(std::unique_ptr<FileBase> file);
 	virtual ~CompressedFileAdapter();
 	virtual void decompress(FileBase& file, Decompressed& decompressed) = 0;
+	/** Used to decompress big files on demand instead of all at once.
+	  * Returns false when that's not possible for this file (e.g. when
+	  * the decompressed size is not known upfront). The size is verified
+	  * by SeekableInflate before it's used.
+	  */
+	virtual bool getStreamInfo(FileBase& file, StreamInfo& info) = 0;
 
 private:
 	void decompress();
+	void decompressAll(const std::string& url);
 
 	std::unique_ptr<FileBase> file;
 	std::shared_ptr<Decompressed> decompressed;
+	std::unique_ptr<SeekableInflate> stream; // must be destroyed before 'file'
+	std::string streamOriginalName;
 	size_t pos;
 };
 
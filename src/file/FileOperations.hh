@@ -50,6 +50,12 @@ namespace FileOperations {
 	 */
 	int unlink(const std::string& path);
 
+	/**
+	 * Call rename() in a platform-independent manner. An existing file
+	 * with the new name is replaced (also on windows).
+	 */
+	int rename(const std::string& oldPath, const std::string& newPath);
+
 	/**
 	 * Call rmdir() in a platform-independent manner
 	 */
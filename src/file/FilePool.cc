@@ -13,10 +13,18 @@
 #include "CliComm.hh"
 #include "Timer.hh"
 #include "StringOp.hh"
+#include "ScopedAssign.hh"
+#include "endian.hh"
 #include "memory.hh"
 #include "sha1.hh"
 #include "stl.hh"
+#include "Thread.hh"
+#include <algorithm>
+#include <condition_variable>
+#include <chrono>
 #include <fstream>
+#include <mutex>
+#include <thread>
 #include <cassert>
 
 using std::ifstream;
@@ -30,7 +38,123 @@ using std::unique_ptr;
 
 namespace openmsx {
 
-const char* const FILE_CACHE = "/.filecache";
+const char* const FILE_CACHE = "/.filecache"; // text format, only read
+const char* const FILE_CACHE_BIN = "/.filecache.bin";
+const char* const FILE_CACHE_JOURNAL = "/.filecache.journal";
+const char* const DIR_CACHE = "/.filecache-dirs";
+
+// Journal record types.
+static const byte JOURNAL_PUT    = 'P';
+static const byte JOURNAL_REMOVE = 'R';
+
+// On exit the journal is merged into the binary cache when it has more
+// records than this (or more than 1/16th of the number of cache entries).
+static const unsigned MIN_JOURNAL_RECORDS = 1000;
+
+// Maximum number of threads used to calculate sha1sums while indexing.
+static const unsigned MAX_HASH_THREADS = 8;
+
+/** A file that needs to be (re)hashed while indexing a directory. */
+struct HashJob
+{
+	HashJob(std::string filename_, time_t time_)
+		: filename(std::move(filename_)), time(time_)
+		, done(false), ok(false) {}
+
+	std::string filename;
+	time_t time;
+	Sha1Sum sum; // only valid when 'ok'
+	bool done;   // locked by ParallelHasher::mutex
+	bool ok;
+};
+
+/** Calculates the sha1sums for a list of files on several threads. The
+  * results become available (roughly) in order, so that the caller can
+  * already process them while the remaining files are being hashed.
+  */
+class ParallelHasher : private Runnable
+{
+public:
+	explicit ParallelHasher(vector<HashJob>& jobs);
+	~ParallelHasher();
+
+	/** Wait (at most 'timeout' milliseconds) till job 'i' is done.
+	  * Returns true iff that job is done.
+	  */
+	bool waitFor(unsigned i, unsigned timeout);
+
+private:
+	// Runnable
+	virtual void run();
+
+	vector<HashJob>& jobs;
+	vector<unique_ptr<Thread>> threads;
+	std::mutex mutex;
+	std::condition_variable jobDone;
+	unsigned next;  // locked by mutex
+	bool cancelled; // idem
+};
+
+ParallelHasher::ParallelHasher(vector<HashJob>& jobs_)
+	: jobs(jobs_), next(0), cancelled(false)
+{
+	unsigned num = std::min<unsigned>(
+		std::min(std::max(std::thread::hardware_concurrency(), 1u),
+		         MAX_HASH_THREADS),
+		unsigned(jobs.size()));
+	for (unsigned i = 0; i < num; ++i) {
+		threads.push_back(make_unique<Thread>(
+			static_cast<Runnable*>(this)));
+		threads.back()->start();
+	}
+}
+
+ParallelHasher::~ParallelHasher()
+{
+	{
+		// stop handing out new jobs, jobs in progress are finished
+		std::lock_guard<std::mutex> lock(mutex);
+		cancelled = true;
+	}
+	for (auto& t : threads) {
+		t->join();
+	}
+}
+
+bool ParallelHasher::waitFor(unsigned i, unsigned timeout)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	return jobDone.wait_for(lock, std::chrono::milliseconds(timeout),
+	                        [&] { return jobs[i].done; });
+}
+
+void ParallelHasher::run()
+{
+	while (true) {
+		unsigned i;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (cancelled || (next == jobs.size())) return;
+			i = next++;
+		}
+		auto& job = jobs[i];
+		try {
+			File file(job.filename);
+			size_t size;
+			const byte* data = file.mmap(size);
+			job.sum = SHA1::calc(data, size);
+			job.ok = true;
+		} catch (FileException&) {
+			job.ok = false;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job.done = true;
+		}
+		jobDone.notify_all();
+	}
+}
+
 
 static string initialFilePoolSettingValue()
 {
@@ -62,19 +186,29 @@ FilePool::FilePool(CommandController& controller, EventDistributor& distributor_
 		initialFilePoolSettingValue()))
 	, distributor(distributor_)
 	, cliComm(controller.getCliComm())
+	, journalRecords(0)
+	, cacheIndexBuilt(false)
+	, dirIndexLoaded(false)
+	, dirIndexChanged(false)
+	, needCompact(false)
+	, replaying(false)
 	, quit(false)
 {
 	filePoolSetting->attach(*this);
 	distributor.registerEventListener(OPENMSX_QUIT_EVENT, *this);
 	readSha1sums();
-	needWrite = false;
 }
 
 FilePool::~FilePool()
 {
-	if (needWrite) {
+	journal.reset();
+	if (needCompact ||
+	    (journalRecords > std::max(MIN_JOURNAL_RECORDS, cache.size() / 16))) {
 		writeSha1sums();
 	}
+	if (dirIndexChanged) {
+		writeDirIndex();
+	}
 	distributor.unregisterEventListener(OPENMSX_QUIT_EVENT, *this);
 	filePoolSetting->detach(*this);
 }
@@ -84,13 +218,15 @@ void FilePool::insert(const Sha1Sum& sum, time_t time, const string& filename)
 	auto it = upper_bound(pool.begin(), pool.end(), sum,
 	                      LessTupleElement<0>());
 	pool.insert(it, make_tuple(sum, time, filename));
-	needWrite = true;
+	filenameIndex[filename] = sum;
+	writeJournal(JOURNAL_PUT, sum, time, filename);
 }
 
 void FilePool::remove(Pool::iterator it)
 {
+	writeJournal(JOURNAL_REMOVE, get<0>(*it), get<1>(*it), get<2>(*it));
+	filenameIndex.erase(get<2>(*it));
 	pool.erase(it);
-	needWrite = true;
 }
 
 // Change the sha1sum of the element pointed to by 'it' into 'newSum'.
@@ -100,10 +236,11 @@ void FilePool::remove(Pool::iterator it)
 // Returns true  if the new position is after          the old position.
 bool FilePool::adjust(Pool::iterator it, const Sha1Sum& newSum)
 {
-	needWrite = true;
+	writeJournal(JOURNAL_PUT, newSum, get<1>(*it), get<2>(*it));
 	auto newIt = upper_bound(pool.begin(), pool.end(), newSum,
 	                         LessTupleElement<0>());
 	get<0>(*it) = newSum; // update sum
+	filenameIndex[get<2>(*it)] = newSum;
 	if (newIt > it) {
 		// move to back
 		rotate(it, it + 1, newIt);
@@ -121,6 +258,52 @@ bool FilePool::adjust(Pool::iterator it, const Sha1Sum& newSum)
 	}
 }
 
+// Move an entry from the (read-only) binary cache to the pool, so that it
+// can be modified. This doesn't change the content of the database, so it
+// doesn't need to be journaled.
+FilePool::Pool::iterator FilePool::moveToPool(unsigned cacheIdx)
+{
+	assert(!removedFromCache[cacheIdx]);
+	removedFromCache[cacheIdx] = true;
+	auto sum = cache.getSum(cacheIdx);
+	auto filename = cache.getFilename(cacheIdx).str();
+	auto it = upper_bound(pool.begin(), pool.end(), sum,
+	                      LessTupleElement<0>());
+	filenameIndex[filename] = sum;
+	return pool.insert(it, make_tuple(sum, cache.getTime(cacheIdx), filename));
+}
+
+static size_t hashFilename(string_ref filename)
+{
+	// FNV-1a
+	size_t h = 2166136261u;
+	for (char c : filename) {
+		h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+	}
+	return h;
+}
+
+int FilePool::findInCache(string_ref filename)
+{
+	if (!cacheIndexBuilt) {
+		// Only build this index when it's actually needed. Often
+		// all lookups are on sha1sum.
+		cacheIndex.reserve(cache.size());
+		for (unsigned i = 0; i < cache.size(); ++i) {
+			cacheIndex.emplace(hashFilename(cache.getFilename(i)), i);
+		}
+		cacheIndexBuilt = true;
+	}
+	auto range = cacheIndex.equal_range(hashFilename(filename));
+	for (auto it = range.first; it != range.second; ++it) {
+		unsigned i = it->second;
+		if (!removedFromCache[i] && (cache.getFilename(i) == filename)) {
+			return i;
+		}
+	}
+	return -1;
+}
+
 static bool parse(const string& line, Sha1Sum& sha1, time_t& time, string& filename)
 {
 	if (line.size() <= 68) return false;
@@ -142,7 +325,21 @@ void FilePool::readSha1sums()
 {
 	assert(pool.empty());
 
-	string cacheFile = FileOperations::getUserDataDir() + FILE_CACHE;
+	string dir = FileOperations::getUserDataDir();
+	if (cache.open(dir + FILE_CACHE_BIN)) {
+		removedFromCache.assign(cache.size(), false);
+	} else {
+		// No (valid) binary cache yet, import the text file that was
+		// used by older openMSX versions. It's converted to the
+		// binary format on exit.
+		readTextSha1sums(dir + FILE_CACHE);
+		needCompact = !pool.empty();
+	}
+	readJournal(dir + FILE_CACHE_JOURNAL);
+}
+
+void FilePool::readTextSha1sums(const string& cacheFile)
+{
 	ifstream file(cacheFile.c_str());
 	string line;
 	Sha1Sum sum;
@@ -162,21 +359,187 @@ void FilePool::readSha1sums()
 		// safety mechanism.
 		sort(pool.begin(), pool.end(), LessTupleElement<0>());
 	}
+
+	filenameIndex.reserve(pool.size());
+	for (auto& p : pool) {
+		filenameIndex[get<2>(p)] = get<0>(p);
+	}
+}
+
+// Journal record: 1 byte type, 20 bytes sha1sum, 2 x L32 time (low, high
+// part), L32 length of the filename, followed by the filename.
+static const unsigned JOURNAL_HEADER_SIZE = 1 + 20 + 4 + 4 + 4;
+
+void FilePool::readJournal(const string& journalFile)
+{
+	if (!FileOperations::exists(journalFile)) return;
+	try {
+		File file(journalFile);
+		size_t size;
+		const byte* data = file.mmap(size);
+		const byte* end = data + size;
+
+		ScopedAssign<bool> sa(replaying, true);
+		while (size_t(end - data) >= JOURNAL_HEADER_SIZE) {
+			byte type = data[0];
+			Sha1Sum sum;
+			sum.fromBinary(data + 1);
+			auto time = time_t(
+				(uint64_t(Endian::read_UA_L32(data + 25)) << 32) |
+				Endian::read_UA_L32(data + 21));
+			size_t length = Endian::read_UA_L32(data + 29);
+			data += JOURNAL_HEADER_SIZE;
+			if (length > size_t(end - data)) break; // truncated
+			string filename(reinterpret_cast<const char*>(data), length);
+			data += length;
+			++journalRecords;
+
+			auto it = findInDatabase(filename);
+			if (type == JOURNAL_PUT) {
+				if (it == pool.end()) {
+					insert(sum, time, filename);
+				} else {
+					get<1>(*it) = time;
+					adjust(it, sum);
+				}
+			} else if (type == JOURNAL_REMOVE) {
+				if (it != pool.end()) remove(it);
+			} else {
+				break; // corrupt
+			}
+		}
+	} catch (FileException&) {
+		// ignore, the cache is only an optimization
+	}
+}
+
+void FilePool::writeJournal(byte type, const Sha1Sum& sum, time_t time,
+                            const string& filename)
+{
+	if (replaying) return;
+	try {
+		if (!journal) {
+			journal = make_unique<File>(
+				FileOperations::getUserDataDir() + FILE_CACHE_JOURNAL,
+				"ab");
+		}
+		byte header[JOURNAL_HEADER_SIZE];
+		header[0] = type;
+		sum.toBinary(header + 1);
+		Endian::write_UA_L32(header + 21, unsigned(uint64_t(time)));
+		Endian::write_UA_L32(header + 25, unsigned(uint64_t(time) >> 32));
+		Endian::write_UA_L32(header + 29, unsigned(filename.size()));
+		journal->write(header, sizeof(header));
+		journal->write(filename.data(), filename.size());
+		journal->flush();
+		++journalRecords;
+	} catch (FileException&) {
+		// ignore, the cache is only an optimization
+	}
 }
 
 void FilePool::writeSha1sums()
 {
-	string cacheFile = FileOperations::getUserDataDir() + FILE_CACHE;
+	// Merge the remaining entries of the binary cache with the pool.
+	vector<FilePoolCache::Entry> entries;
+	entries.reserve(cache.size() + pool.size());
+	auto it = pool.begin();
+	auto addFromPool = [&]() {
+		entries.push_back(FilePoolCache::Entry{
+			get<0>(*it), get<1>(*it), get<2>(*it)});
+		++it;
+	};
+	for (unsigned i = 0; i < cache.size(); ++i) {
+		if (removedFromCache[i]) continue;
+		auto sum = cache.getSum(i);
+		while ((it != pool.end()) && (get<0>(*it) < sum)) {
+			addFromPool();
+		}
+		entries.push_back(FilePoolCache::Entry{
+			sum, cache.getTime(i), cache.getFilename(i)});
+	}
+	while (it != pool.end()) {
+		addFromPool();
+	}
+
+	string dir = FileOperations::getUserDataDir();
+	try {
+		cache.write(dir + FILE_CACHE_BIN, entries);
+		FileOperations::unlink(dir + FILE_CACHE_JOURNAL);
+	} catch (FileException&) {
+		// ignore, journal is still valid
+	}
+}
+
+// First line of the directory index, older (or other) files are ignored.
+static const char* const DIR_CACHE_HEADER =
+	"# openMSX file pool directory index, version 2";
+
+void FilePool::readDirIndex()
+{
+	assert(dirIndex.empty());
+	dirIndexLoaded = true;
+
+	// For each directory a line with its modification time and its name,
+	// followed by a line per entry: "f <name>" for a file, "d <name>" for
+	// a subdirectory. A (fake) time of 0 means the directory exists, but
+	// was not completely indexed.
+	string cacheFile = FileOperations::getUserDataDir() + DIR_CACHE;
+	ifstream file(cacheFile.c_str());
+	string line;
+	getline(file, line);
+	if (line != DIR_CACHE_HEADER) return;
+	DirInfo* info = nullptr;
+	while (file.good()) {
+		getline(file, line);
+		if ((line.size() > 2) && (line[1] == ' ') &&
+		    ((line[0] == 'f') || (line[0] == 'd'))) {
+			if (!info) continue;
+			auto& list = (line[0] == 'f') ? info->files : info->subdirs;
+			list.push_back(line.substr(2));
+			continue;
+		}
+		info = nullptr;
+		if (line.size() <= 26) continue;
+		time_t time = Date::fromString(line.data());
+		if (time == time_t(-1)) continue;
+		info = &dirIndex[line.substr(26)];
+		info->time = time;
+	}
+}
+
+void FilePool::writeDirIndex()
+{
+	string cacheFile = FileOperations::getUserDataDir() + DIR_CACHE;
 	ofstream file;
 	FileOperations::openofstream(file, cacheFile);
 	if (!file.is_open()) {
 		return;
 	}
-	for (auto& p : pool) {
-		file << get<0>(p).toString()      << "  " // sum
-		     << Date::toString(get<1>(p)) << "  " // date
-		     << get<2>(p)                         // filename
-		     << '\n';
+	// A name with a newline can't be stored. Such a directory is skipped,
+	// a directory with such an entry is stored as not completely indexed.
+	auto hasNewline = [](const string& name) {
+		return name.find('\n') != string::npos;
+	};
+	file << DIR_CACHE_HEADER << '\n';
+	for (auto& d : dirIndex) {
+		if (hasNewline(d.first)) continue;
+		bool complete = d.second.time &&
+			std::none_of(d.second.files.begin(), d.second.files.end(),
+			             hasNewline) &&
+			std::none_of(d.second.subdirs.begin(), d.second.subdirs.end(),
+			             hasNewline);
+		// Not completely indexed directories are written with a
+		// time that never matches (Date::toString(0) doesn't parse
+		// back to a valid time in all timezones).
+		file << Date::toString(complete ? d.second.time : 1)
+		     << "  " << d.first << '\n';
+		for (auto& f : d.second.files) {
+			if (!hasNewline(f)) file << "f " << f << '\n';
+		}
+		for (auto& f : d.second.subdirs) {
+			if (!hasNewline(f)) file << "d " << f << '\n';
+		}
 	}
 }
 
@@ -256,6 +619,7 @@ unique_ptr<File> FilePool::getFile(FileType fileType, const Sha1Sum& sha1sum)
 	if (result) return result;
 
 	// not found in cache, need to scan directories
+	if (!dirIndexLoaded) readDirIndex();
 	ScanProgress progress;
 	progress.lastTime = Timer::getTime();
 	progress.amountScanned = 0;
@@ -287,6 +651,12 @@ static Sha1Sum calcSha1sum(File& file, CliComm& cliComm, EventDistributor& distr
 
 unique_ptr<File> FilePool::getFromPool(const Sha1Sum& sha1sum)
 {
+	// first move matching entries from the binary cache to the pool
+	auto range = cache.equalRange(sha1sum);
+	for (auto j = range.first; j != range.second; ++j) {
+		if (!removedFromCache[j]) moveToPool(j);
+	}
+
 	auto bound = equal_range(pool.begin(), pool.end(), sha1sum,
 	                         LessTupleElement<0>());
 	// use indices instead of iterators
@@ -306,11 +676,11 @@ unique_ptr<File> FilePool::getFromPool(const Sha1Sum& sha1sum)
 				return file;
 			}
 			time = newTime; // update timestamp
-			needWrite = true;
 			auto newSum = calcSha1sum(*file, cliComm, distributor);
 			if (newSum == sha1sum) {
 				// Modification time was changed, but
 				// (recalculated) sha1sum is still the same.
+				writeJournal(JOURNAL_PUT, sha1sum, time, filename);
 				return file;
 			}
 			// Sha1sum has changed: update sha1sum, move entry to
@@ -336,37 +706,151 @@ unique_ptr<File> FilePool::scanDirectory(
 	const Sha1Sum& sha1sum, const string& directory, const string& poolPath,
 	ScanProgress& progress)
 {
-	ReadDir dir(directory);
-	while (dirent* d = dir.getEntry()) {
-		if (quit) {
-			// Scanning can take a long time. Allow to exit
-			// openmsx when it takes too long. Stop scanning
-			// by pretending we didn't find the file.
-			return nullptr;
-		}
-		string file = d->d_name;
-		string path = directory + '/' + file;
-		FileOperations::Stat st;
-		if (FileOperations::getStat(path, st)) {
-			unique_ptr<File> result;
-			if (FileOperations::isRegularFile(st)) {
-				result = scanFile(sha1sum, path, st, poolPath, progress);
-			} else if (FileOperations::isDirectory(st)) {
+	// deliverEvents() is relatively cheap when there are no events to
+	// deliver, so it's ok to call on each directory.
+	distributor.deliverEvents();
+	if (quit) {
+		// Scanning can take a long time. Allow to exit openmsx when it
+		// takes too long. Stop scanning by pretending we didn't find
+		// the file.
+		return nullptr;
+	}
+	FileOperations::Stat st;
+	if (!FileOperations::getStat(directory, st)) return nullptr;
+	auto dirTime = FileOperations::getModificationDate(st);
+
+	// Note: references to elements of an unordered_map remain valid when
+	// other elements are inserted (in the recursive calls below).
+	auto& info = dirIndex[directory];
+	if (info.time != dirTime) {
+		// new or changed directory: (re)read the list of entries
+		info.time = 0;
+		info.files.clear();
+		info.subdirs.clear();
+		dirIndexChanged = true;
+		ReadDir dir(directory);
+		while (dirent* d = dir.getEntry()) {
+			string file = d->d_name;
+			string path = directory + '/' + file;
+			FileOperations::Stat st2;
+			if (!FileOperations::getStat(path, st2)) continue;
+			if (FileOperations::isRegularFile(st2)) {
+				info.files.push_back(file);
+			} else if (FileOperations::isDirectory(st2)) {
 				if ((file != ".") && (file != "..")) {
-					result = scanDirectory(sha1sum, path, poolPath, progress);
+					info.subdirs.push_back(file);
 				}
 			}
-			if (result) return result;
 		}
 	}
+
+	// Files that are not yet in the pool (or that were modified since)
+	// are hashed in parallel.
+	vector<HashJob> jobs;
+	for (auto& file : info.files) {
+		string path = directory + '/' + file;
+		FileOperations::Stat st2;
+		if (!FileOperations::getStat(path, st2)) continue;
+		auto time = FileOperations::getModificationDate(st2);
+		Sha1Sum dbSum;
+		time_t dbTime;
+		if (!lookup(path, dbSum, dbTime) || (dbTime != time)) {
+			jobs.emplace_back(path, time);
+		} else if (dbSum == sha1sum) {
+			// db is still up to date
+			try {
+				return make_unique<File>(path);
+			} catch (FileException&) {
+				// error reading file, remove from db
+				auto it = findInDatabase(path);
+				if (it != pool.end()) remove(it);
+			}
+		} else {
+			++progress.amountScanned;
+			reportProgress(sha1sum, path, poolPath, progress);
+		}
+	}
+	auto result = hashFiles(sha1sum, jobs, poolPath, progress);
+	if (quit) return nullptr;
+
+	// All files in this directory are now in the pool. Only trust the
+	// directory timestamp when it's not too recent, otherwise a file
+	// that is added in the same second would go unnoticed.
+	if (dirTime < (time(nullptr) - 1)) {
+		info.time = dirTime;
+	}
+	if (result) return result;
+
+	for (auto& subdir : info.subdirs) {
+		result = scanDirectory(sha1sum, directory + '/' + subdir,
+		                       poolPath, progress);
+		if (result) return result;
+	}
 	return nullptr; // not found
 }
 
-unique_ptr<File> FilePool::scanFile(const Sha1Sum& sha1sum, const string& filename,
-                                    const FileOperations::Stat& st, const string& poolPath,
-                                    ScanProgress& progress)
+unique_ptr<File> FilePool::hashFiles(
+	const Sha1Sum& sha1sum, vector<HashJob>& jobs, const string& poolPath,
+	ScanProgress& progress)
+{
+	unique_ptr<File> result;
+	auto process = [&](HashJob& job) {
+		++progress.amountScanned;
+		auto it = findInDatabase(job.filename);
+		if (!job.ok) {
+			// error reading file, remove from db
+			if (it != pool.end()) remove(it);
+			return;
+		}
+		if (it == pool.end()) {
+			insert(job.sum, job.time, job.filename);
+		} else {
+			get<1>(*it) = job.time;
+			adjust(it, job.sum);
+		}
+		if (!result && (job.sum == sha1sum)) {
+			try {
+				result = make_unique<File>(job.filename);
+			} catch (FileException&) {
+				// ignore
+			}
+		}
+	};
+
+	if (jobs.size() == 1) {
+		// Not worth starting threads. This also gives more detailed
+		// progress messages for (big) single files.
+		auto& job = jobs.front();
+		reportProgress(sha1sum, job.filename, poolPath, progress);
+		try {
+			File file(job.filename);
+			job.sum = calcSha1sum(file, cliComm, distributor);
+			job.ok = true;
+		} catch (FileException&) {
+			job.ok = false;
+		}
+		process(job);
+	} else if (!jobs.empty()) {
+		// Even when the file was found, continue till the end of the
+		// list, this also indexes the other files in this directory.
+		ParallelHasher hasher(jobs);
+		for (unsigned i = 0; i < jobs.size(); /**/) {
+			bool done = hasher.waitFor(i, 100);
+			reportProgress(sha1sum, jobs[i].filename, poolPath, progress);
+			// deliverEvents() is relatively cheap when there are
+			// no events to deliver.
+			distributor.deliverEvents();
+			if (quit) return nullptr; // destructor cancels the jobs
+			if (done) process(jobs[i++]);
+		}
+	}
+	return result;
+}
+
+void FilePool::reportProgress(
+	const Sha1Sum& sha1sum, const string& filename, const string& poolPath,
+	ScanProgress& progress)
 {
-	++progress.amountScanned;
 	// Periodically send a progress message with the current filename
 	auto now = Timer::getTime();
 	if (now > (progress.lastTime + 250000)) { // 4Hz
@@ -376,67 +860,51 @@ unique_ptr<File> FilePool::scanFile(const Sha1Sum& sha1sum, const string& filena
 			": [" + StringOp::toString(progress.amountScanned) + "]: " +
 			filename.substr(poolPath.size()));
 	}
+}
 
-	// deliverEvents() is relatively cheap when there are no events to
-	// deliver, so it's ok to call on each file.
-	distributor.deliverEvents();
+FilePool::Pool::iterator FilePool::findInPool(const string& filename)
+{
+	// Lookup the sha1sum of this file, and then search for the file among
+	// the (usually very few) entries in the pool with that sha1sum.
+	auto idx = filenameIndex.find(filename);
+	if (idx == filenameIndex.end()) return pool.end(); // not found
 
-	auto it = findInDatabase(filename);
-	if (it == pool.end()) {
-		// not in pool
-		try {
-			auto file = make_unique<File>(filename);
-			auto sum = calcSha1sum(*file, cliComm, distributor);
-			auto time = FileOperations::getModificationDate(st);
-			insert(sum, time, filename);
-			if (sum == sha1sum) {
-				return file;
-			}
-		} catch (FileException&) {
-			// ignore
-		}
-	} else {
-		// already in pool
-		assert(filename == get<2>(*it));
-		try {
-			auto time = FileOperations::getModificationDate(st);
-			if (time == get<1>(*it)) {
-				// db is still up to date
-				if (get<0>(*it) == sha1sum) {
-					return make_unique<File>(filename);
-				}
-			} else {
-				// db outdated
-				auto file = make_unique<File>(filename);
-				auto sum = calcSha1sum(*file, cliComm, distributor);
-				get<1>(*it) = time;
-				adjust(it, sum);
-				if (sum == sha1sum) {
-					return file;
-				}
-			}
-		} catch (FileException&) {
-			// error reading file, remove from db
-			remove(it);
+	auto bound = equal_range(pool.begin(), pool.end(), idx->second,
+	                         LessTupleElement<0>());
+	for (auto it = bound.first; it != bound.second; ++it) {
+		if (get<2>(*it) == filename) {
+			return it;
 		}
 	}
-	return nullptr; // not found
+	return pool.end(); // not found
 }
 
 FilePool::Pool::iterator FilePool::findInDatabase(const string& filename)
 {
-	// Linear search in pool for filename.
-	// Search from back to front because often, soon after this search, we
-	// will insert/remove an element from the vector. This requires
-	// shifting all elements in the vector starting from a certain
-	// position. Starting the search from the back increases the likelihood
-	// that the to-be-shifted elements are already in the memory cache.
-	for (auto it = pool.rbegin(); it != pool.rend(); ++it) {
-		if (get<2>(*it) == filename) {
-			return it.base() - 1;
-		}
+	auto it = findInPool(filename);
+	if (it != pool.end()) return it;
+
+	// Not in the pool, maybe it's in the binary cache. If so move it to
+	// the pool, because the caller may want to modify it.
+	int i = findInCache(filename);
+	return (i == -1) ? pool.end() : moveToPool(i);
+}
+
+bool FilePool::lookup(const string& filename, Sha1Sum& sum, time_t& time)
+{
+	// Like findInDatabase(), but for read-only access: entries are not
+	// moved out of the binary cache.
+	auto it = findInPool(filename);
+	if (it != pool.end()) {
+		sum  = get<0>(*it);
+		time = get<1>(*it);
+		return true;
 	}
-	return pool.end(); // not found
+	int i = findInCache(filename);
+	if (i == -1) return false;
+	sum  = cache.getSum(i);
+	time = cache.getTime(i);
+	return true;
 }
 
 Sha1Sum FilePool::getSha1Sum(File& file)
@@ -444,15 +912,17 @@ Sha1Sum FilePool::getSha1Sum(File& file)
 	auto time = file.getModificationDate();
 	const auto& filename = file.getURL();
 
-	auto it = findInDatabase(filename);
-	if ((it != pool.end()) && (get<1>(*it) == time)) {
+	Sha1Sum sum;
+	time_t dbTime;
+	if (lookup(filename, sum, dbTime) && (dbTime == time)) {
 		// in database and modification time matches,
 		// assume sha1sum also matches
-		return get<0>(*it);
+		return sum;
 	}
 
 	// not in database or timestamp mismatch
-	auto sum = calcSha1sum(file, cliComm, distributor);
+	auto it = findInDatabase(filename);
+	sum = calcSha1sum(file, cliComm, distributor);
 	if (it == pool.end()) {
 		// was not yet in database, insert new entry
 		insert(sum, time, filename);
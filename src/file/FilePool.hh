@@ -2,6 +2,7 @@
 #define FILEPOOL_HH
 
 #include "FileOperations.hh"
+#include "FilePoolCache.hh"
 #include "Observer.hh"
 #include "EventListener.hh"
 #include "sha1.hh"
@@ -9,6 +10,7 @@
 #include <memory>
 #include <string>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
 #include <ctime>
 #include <cstdint>
@@ -21,6 +23,7 @@ class File;
 class Setting;
 class StringSetting;
 class CliComm;
+struct HashJob;
 
 class FilePool : private Observer<Setting>, private EventListener,
                  private noncopyable
@@ -63,26 +66,57 @@ private:
 	typedef std::vector<Entry> Directories;
 
 	// <sha1sum, timestamp, filename>, sorted on sha1sum
+	// These are the entries that were added or modified since the binary
+	// cache was written (or that were moved from the binary cache to be
+	// able to modify them).
 	typedef std::vector<std::tuple<Sha1Sum, time_t, std::string>> Pool;
 
+	// filename -> sha1sum, to quickly locate a file in 'pool'
+	typedef std::unordered_map<std::string, Sha1Sum> FilenameIndex;
+
+	// Directories in the filepool that were scanned before. As long as
+	// the modification time of a directory doesn't change, the set of
+	// files (and subdirectories) in it doesn't change either, so it
+	// doesn't need to be read again. (The files themselves are still
+	// checked against their own modification time.)
+	struct DirInfo {
+		DirInfo() : time(0) {}
+		time_t time; // 0 -> not (completely) indexed yet
+		std::vector<std::string> files;
+		std::vector<std::string> subdirs;
+	};
+	typedef std::unordered_map<std::string, DirInfo> DirIndex;
+
 	void insert(const Sha1Sum& sum, time_t time, const std::string& filename);
 	void remove(Pool::iterator it);
 	bool adjust(Pool::iterator it, const Sha1Sum& newSum);
 
+	Pool::iterator moveToPool(unsigned cacheIdx);
+	int findInCache(string_ref filename);
+
 	void readSha1sums();
+	void readTextSha1sums(const std::string& cacheFile);
 	void writeSha1sums();
+	void readJournal(const std::string& journalFile);
+	void writeJournal(byte type, const Sha1Sum& sum, time_t time,
+	                  const std::string& filename);
+	void readDirIndex();
+	void writeDirIndex();
 
 	std::unique_ptr<File> getFromPool(const Sha1Sum& sha1sum);
 	std::unique_ptr<File> scanDirectory(const Sha1Sum& sha1sum,
 	                                    const std::string& directory,
 	                                    const std::string& poolPath,
 	                                    ScanProgress& progress);
-	std::unique_ptr<File> scanFile(const Sha1Sum& sha1sum,
-	                               const std::string& filename,
-	                               const FileOperations::Stat& st,
-	                               const std::string& poolPath,
-	                               ScanProgress& progress);
+	std::unique_ptr<File> hashFiles(const Sha1Sum& sha1sum,
+	                                std::vector<HashJob>& jobs,
+	                                const std::string& poolPath,
+	                                ScanProgress& progress);
+	void reportProgress(const Sha1Sum& sha1sum, const std::string& filename,
+	                    const std::string& poolPath, ScanProgress& progress);
+	Pool::iterator findInPool(const std::string& filename);
 	Pool::iterator findInDatabase(const std::string& filename);
+	bool lookup(const std::string& filename, Sha1Sum& sum, time_t& time);
 
 	Directories getDirectories() const;
 
@@ -97,9 +131,24 @@ private:
 	EventDistributor& distributor;
 	CliComm& cliComm;
 
+	// The bulk of the sha1sum database is a read-only memory mapped
+	// file. Changes are appended to a journal (and made in 'pool'), and
+	// only occasionally the journal is merged back into the binary file.
+	FilePoolCache cache;
+	std::vector<bool> removedFromCache; // moved to pool or removed
+	std::unordered_multimap<size_t, unsigned> cacheIndex; // filename hash
+	std::unique_ptr<File> journal;
+	unsigned journalRecords;
+	bool cacheIndexBuilt;
+
 	Pool pool;
+	FilenameIndex filenameIndex;
+	DirIndex dirIndex;
+	bool dirIndexLoaded;
+	bool dirIndexChanged;
+	bool needCompact;
+	bool replaying;
 	bool quit;
-	bool needWrite;
 };
 
 } // namespace openmsx
@@ -0,0 +1,177 @@
+#include "FilePoolCache.hh"
+#include "File.hh"
+#include "FileException.hh"
+#include "FileOperations.hh"
+#include "endian.hh"
+#include "memory.hh"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+using std::string;
+using std::vector;
+
+namespace openmsx {
+
+static const char MAGIC[8] = { 'o','M','S','X','p','o','o','l' };
+static const unsigned VERSION = 1;
+
+struct FileHeader {
+	char magic[8];
+	Endian::L32 version;
+	Endian::L32 count;
+};
+
+struct FilePoolCache::FileEntry {
+	uint8_t sum[20];
+	Endian::L32 nameOffset;
+	Endian::L32 nameLength;
+	Endian::L32 timeLow;
+	Endian::L32 timeHigh;
+};
+static_assert(sizeof(FileHeader) == 16, "unexpected padding");
+
+
+FilePoolCache::FilePoolCache()
+	: entries(nullptr), strings(nullptr), stringsSize(0), count(0)
+{
+}
+
+FilePoolCache::~FilePoolCache()
+{
+	close();
+}
+
+bool FilePoolCache::open(const string& filename)
+{
+	close();
+	try {
+		file = make_unique<File>(filename);
+		size_t size;
+		const byte* data = file->mmap(size);
+		if (size < sizeof(FileHeader)) {
+			close();
+			return false;
+		}
+		auto& header = *reinterpret_cast<const FileHeader*>(data);
+		size_t entriesSize = size_t(header.count) * sizeof(FileEntry);
+		if ((memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) ||
+		    (header.version != VERSION) ||
+		    ((size - sizeof(FileHeader)) < entriesSize)) {
+			close();
+			return false;
+		}
+		count = header.count;
+		entries = data + sizeof(FileHeader);
+		strings = reinterpret_cast<const char*>(entries + entriesSize);
+		stringsSize = size - sizeof(FileHeader) - entriesSize;
+		return true;
+	} catch (FileException&) {
+		close();
+		return false;
+	}
+}
+
+void FilePoolCache::close()
+{
+	file.reset(); // also unmaps
+	entries = nullptr;
+	strings = nullptr;
+	stringsSize = 0;
+	count = 0;
+}
+
+const FilePoolCache::FileEntry& FilePoolCache::getEntry(unsigned i) const
+{
+	assert(i < count);
+	return reinterpret_cast<const FileEntry*>(entries)[i];
+}
+
+Sha1Sum FilePoolCache::getSum(unsigned i) const
+{
+	Sha1Sum result;
+	result.fromBinary(getEntry(i).sum);
+	return result;
+}
+
+time_t FilePoolCache::getTime(unsigned i) const
+{
+	auto& e = getEntry(i);
+	return time_t((uint64_t(e.timeHigh) << 32) | e.timeLow);
+}
+
+string_ref FilePoolCache::getFilename(unsigned i) const
+{
+	// The file is not validated on load (that would defeat the purpose
+	// of mapping it), so check the string bounds on access. A corrupt
+	// entry results in an empty filename, which can't be opened and
+	// is removed from the pool later.
+	auto& e = getEntry(i);
+	size_t offset = e.nameOffset;
+	size_t length = e.nameLength;
+	if ((offset > stringsSize) || (length > (stringsSize - offset))) {
+		return string_ref();
+	}
+	return string_ref(strings + offset, length);
+}
+
+struct FilePoolCache::CompareSum {
+	bool operator()(const FileEntry& e, const uint8_t* k) const {
+		return memcmp(e.sum, k, 20) < 0;
+	}
+	bool operator()(const uint8_t* k, const FileEntry& e) const {
+		return memcmp(k, e.sum, 20) < 0;
+	}
+};
+
+std::pair<unsigned, unsigned> FilePoolCache::equalRange(const Sha1Sum& sum) const
+{
+	uint8_t key[20];
+	sum.toBinary(key);
+	auto* first = reinterpret_cast<const FileEntry*>(entries);
+	auto* last  = first + count;
+	auto range = std::equal_range(first, last, key, CompareSum());
+	return std::make_pair(unsigned(range.first  - first),
+	                      unsigned(range.second - first));
+}
+
+void FilePoolCache::write(const string& filename, const vector<Entry>& list)
+{
+	vector<byte> buf(sizeof(FileHeader) + list.size() * sizeof(FileEntry));
+	auto& header = *reinterpret_cast<FileHeader*>(buf.data());
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.count = unsigned(list.size());
+
+	size_t offset = 0;
+	auto* out = reinterpret_cast<FileEntry*>(buf.data() + sizeof(FileHeader));
+	for (auto& e : list) {
+		e.sum.toBinary(out->sum);
+		out->nameOffset = unsigned(offset);
+		out->nameLength = unsigned(e.filename.size());
+		auto time = uint64_t(e.time);
+		out->timeLow  = unsigned(time);
+		out->timeHigh = unsigned(time >> 32);
+		offset += e.filename.size();
+		++out;
+	}
+	for (auto& e : list) {
+		buf.insert(buf.end(), e.filename.begin(), e.filename.end());
+	}
+
+	close();
+
+	// Write to a temporary file first, so that there's always a valid
+	// cache file, even when openMSX is killed while writing.
+	string tmpName = filename + ".tmp";
+	{
+		File file(tmpName, File::TRUNCATE);
+		file.write(buf.data(), buf.size());
+	}
+	if (FileOperations::rename(tmpName, filename) != 0) {
+		FileOperations::unlink(tmpName);
+		throw FileException("Couldn't replace " + filename);
+	}
+}
+
+} // namespace openmsx
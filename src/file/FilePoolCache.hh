@@ -0,0 +1,81 @@
+#ifndef FILEPOOLCACHE_HH
+#define FILEPOOLCACHE_HH
+
+#include "sha1.hh"
+#include "string_ref.hh"
+#include "noncopyable.hh"
+#include "openmsx.hh"
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <ctime>
+
+namespace openmsx {
+
+class File;
+
+/** The bulk of the filepool sha1 cache: a read-only, memory mapped, binary
+  * file that is queried in place (so it doesn't need to be parsed on
+  * startup).
+  *
+  * File layout (all numbers are little endian):
+  *  - header: 8 byte magic, L32 version, L32 number of entries
+  *  - entries, sorted on sha1sum, each 36 bytes:
+  *     - 20 bytes sha1sum (see Sha1Sum::toBinary())
+  *     - L32 offset of the filename in the string table
+  *     - L32 length of the filename
+  *     - 2 x L32 modification time (low, high part)
+  *  - string table (filenames are not zero-terminated)
+  */
+class FilePoolCache : private noncopyable
+{
+public:
+	struct Entry {
+		Sha1Sum sum;
+		time_t time;
+		string_ref filename;
+	};
+
+	FilePoolCache();
+	~FilePoolCache();
+
+	/** Memory map the given cache file. Returns false (and leaves the
+	  * cache empty) when the file doesn't exist or is not valid.
+	  */
+	bool open(const std::string& filename);
+	void close();
+
+	unsigned size() const { return count; }
+	Sha1Sum getSum(unsigned i) const;
+	time_t getTime(unsigned i) const;
+	string_ref getFilename(unsigned i) const;
+
+	/** Returns the range [first, last) of the entries with the given
+	  * sha1sum.
+	  */
+	std::pair<unsigned, unsigned> equalRange(const Sha1Sum& sum) const;
+
+	/** Write a new cache file, the entries must be sorted on sha1sum.
+	  * The entries may point into this cache, it's closed before the file
+	  * is replaced (a mapped file can't be replaced on all platforms).
+	  * @throw FileException
+	  */
+	void write(const std::string& filename,
+	           const std::vector<Entry>& list);
+
+private:
+	struct FileEntry;
+	struct CompareSum;
+	const FileEntry& getEntry(unsigned i) const;
+
+	std::unique_ptr<File> file;
+	const byte* entries;
+	const char* strings;
+	size_t stringsSize;
+	unsigned count;
+};
+
+} // namespace openmsx
+
+#endif
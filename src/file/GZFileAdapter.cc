@@ -1,6 +1,7 @@
 #include "GZFileAdapter.hh"
 #include "ZlibInflate.hh"
 #include "FileException.hh"
+#include "endian.hh"
 
 namespace openmsx {
 
@@ -64,4 +65,23 @@ void GZFileAdapter::decompress(FileBase& file, Decompressed& decompressed)
 	zlib.inflate(decompressed.buf);
 }
 
+bool GZFileAdapter::getStreamInfo(FileBase& file, StreamInfo& info)
+{
+	size_t size;
+	const byte* data = file.mmap(size);
+	ZlibInflate zlib(data, size);
+	if (!skipHeader(zlib, info.originalName)) {
+		return false;
+	}
+	info.start = zlib.getPosition() - data;
+	if ((size - info.start) < 8) {
+		return false;
+	}
+	// The trailer contains the decompressed size, but only modulo 4GB
+	// (and only of the last member in case of a multi-member file).
+	// SeekableInflate checks it on its first pass over the whole stream.
+	info.size = Endian::read_UA_L32(data + size - 4);
+	return true;
+}
+
 } // namespace openmsx
@@ -12,6 +12,7 @@ public:
 
 private:
 	virtual void decompress(FileBase& file, Decompressed& decompressed);
+	virtual bool getStreamInfo(FileBase& file, StreamInfo& info);
 };
 
 } // namespace openmsx
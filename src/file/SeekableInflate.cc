@@ -0,0 +1,288 @@
+#include "SeekableInflate.hh"
+#include "File.hh"
+#include "FileException.hh"
+#include "FileOperations.hh"
+#include "StringOp.hh"
+#include "endian.hh"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+using std::string;
+using std::vector;
+
+namespace openmsx {
+
+static const size_t WINSIZE = 32768;       // deflate history size
+static const size_t SPAN = 1024 * 1024;    // distance between access points
+static const size_t MAX_IN = 1 << 30;      // avail_in is only 32 bit
+
+static const char MAGIC[8] = { 'o','M','S','X','z','i','d','x' };
+static const unsigned VERSION = 2; // 2: size is verified, all points present
+
+// Cache file layout (all numbers little endian, unaligned):
+//  - header: 8 byte magic, 32-bit version, 32-bit number of access points,
+//            64-bit compressed size, modification time, (verified)
+//            decompressed size
+//  - per access point: 64-bit 'out', 64-bit 'in', 32-bit 'bits',
+//            32-bit window size, followed by the (compressed) window
+static const size_t HEADER_SIZE = 8 + 4 + 4 + 3 * 8;
+static const size_t POINT_SIZE = 8 + 8 + 4 + 4;
+
+
+SeekableInflate::SeekableInflate(
+		const byte* data_, size_t dataSize_, size_t start,
+		size_t size_, string cacheName_, time_t time_)
+	: data(data_), dataSize(dataSize_), size(0)
+	, cacheName(std::move(cacheName_)), time(time_)
+	, window(WINSIZE), curOut(0), active(false), pointsChanged(false)
+{
+	memset(&strm, 0, sizeof(strm));
+	if (!cacheName.empty()) loadCache(size_);
+	if (points.empty() || (points.front().in != start)) {
+		points.clear();
+		points.push_back(AccessPoint{0, start, 0, vector<byte>()});
+		scan(size_);
+	}
+}
+
+SeekableInflate::~SeekableInflate()
+{
+	if (active) inflateEnd(&strm);
+	if (pointsChanged && !cacheName.empty()) {
+		try {
+			saveCache();
+		} catch (FileException&) {
+			// ignore, it's only a cache
+		}
+	}
+}
+
+bool SeekableInflate::read(size_t pos, byte* buffer, size_t num)
+{
+	assert(num <= size);
+	assert(pos <= (size - num));
+	if (num == 0) return true;
+
+	// Continue from the current position, unless there's an access point
+	// that's closer to (but not past) the requested position.
+	auto it = std::upper_bound(points.begin(), points.end(), pos,
+		[](size_t p, const AccessPoint& a) { return p < a.out; });
+	assert(it != points.begin());
+	--it;
+	if (!active || (curOut > pos) || (it->out > curOut)) {
+		startAt(*it);
+	}
+	return inflateTo(uint64_t(pos) + num, pos, buffer);
+}
+
+// Decompress up to position 'end' and copy the part from 'pos' onwards to
+// 'buffer' (if not null). Returns false when the stream ends before 'end'.
+bool SeekableInflate::inflateTo(uint64_t end, size_t pos, byte* buffer)
+{
+	while (curOut < end) {
+		size_t wpos = size_t(curOut % WINSIZE);
+		size_t avail = size_t(std::min<uint64_t>(WINSIZE - wpos, end - curOut));
+		if (strm.avail_in == 0) {
+			size_t in = strm.next_in - data;
+			strm.avail_in = uInt(std::min(dataSize - in, MAX_IN));
+		}
+		strm.next_out = &window[wpos];
+		strm.avail_out = uInt(avail);
+		int err = inflate(&strm, Z_BLOCK);
+		size_t got = avail - strm.avail_out;
+
+		// copy the part that overlaps with the requested range
+		uint64_t from = std::max<uint64_t>(curOut, pos);
+		uint64_t to = curOut + got;
+		if (buffer && (from < to)) {
+			memcpy(buffer + (from - pos),
+			       &window[wpos + size_t(from - curOut)],
+			       size_t(to - from));
+		}
+		curOut += got;
+
+		if (err == Z_STREAM_END) {
+			// Stream ended before the end of the requested range.
+			inflateEnd(&strm);
+			active = false;
+			return curOut >= end;
+		}
+		if ((err == Z_BUF_ERROR) && (got == 0) &&
+		    (strm.next_in == (data + dataSize))) {
+			inflateEnd(&strm);
+			active = false;
+			throw FileException(
+				"Error while decompressing: unexpected end of file.");
+		}
+		if ((err != Z_OK) && (err != Z_BUF_ERROR)) {
+			inflateEnd(&strm);
+			active = false;
+			throw FileException(StringOp::Builder() <<
+				"Error while decompressing: " << err);
+		}
+		// At the end of a deflate block (but not the last one) the
+		// decompression state is fully described by the position plus
+		// the history window.
+		if ((strm.data_type & 128) && !(strm.data_type & 64) &&
+		    ((points.back().out + SPAN) <= curOut)) {
+			addAccessPoint();
+		}
+	}
+	return true;
+}
+
+void SeekableInflate::scan(size_t expectedSize)
+{
+	// Decompress the whole stream once: to get the actual size and to
+	// create all access points.
+	startAt(points.front());
+	inflateTo(uint64_t(-1), 0, nullptr);
+	uint64_t total = curOut;
+	if ((total != uint64_t(size_t(total))) ||
+	    ((total & 0xFFFFFFFF) != (uint64_t(expectedSize) & 0xFFFFFFFF))) {
+		// e.g. a multi-member gzip file
+		throw FileException("Decompressed size doesn't match header");
+	}
+	size = size_t(total);
+	pointsChanged = true;
+}
+
+void SeekableInflate::startAt(const AccessPoint& point)
+{
+	if (active) {
+		inflateReset(&strm);
+	} else {
+		if (inflateInit2(&strm, -MAX_WBITS) != Z_OK) {
+			throw FileException("Error initializing inflate struct.");
+		}
+		active = true;
+	}
+	curOut = point.out;
+	strm.next_in = const_cast<byte*>(data + point.in);
+	strm.avail_in = 0;
+	if (point.bits) {
+		byte b = data[point.in - 1];
+		inflatePrime(&strm, point.bits, b >> (8 - point.bits));
+	}
+	if (!point.window.empty()) {
+		// restore the history, both in the inflate state and in our
+		// own (circular) window, new access points are taken from it
+		vector<byte> dict(WINSIZE);
+		uLongf dictLen = WINSIZE;
+		size_t len = size_t(std::min<uint64_t>(point.out, WINSIZE));
+		if ((uncompress(dict.data(), &dictLen, point.window.data(),
+		                uLong(point.window.size())) != Z_OK) ||
+		    (dictLen != len)) {
+			inflateEnd(&strm);
+			active = false;
+			throw FileException("Corrupt decompression index");
+		}
+		inflateSetDictionary(&strm, dict.data(), uInt(len));
+		for (size_t i = 0; i < len; ++i) {
+			window[size_t((point.out - len + i) % WINSIZE)] = dict[i];
+		}
+	}
+}
+
+void SeekableInflate::addAccessPoint()
+{
+	// linearize the circular window
+	size_t len = size_t(std::min<uint64_t>(curOut, WINSIZE));
+	vector<byte> dict(len);
+	for (size_t i = 0; i < len; ++i) {
+		dict[i] = window[size_t((curOut - len + i) % WINSIZE)];
+	}
+	// The history is often quite compressible, store it compressed to
+	// keep the index small (both in memory and on disk).
+	uLongf compLen = compressBound(uLong(len));
+	vector<byte> comp(compLen);
+	if (compress2(comp.data(), &compLen, dict.data(), uLong(len),
+	              Z_BEST_SPEED) != Z_OK) {
+		return; // not fatal, just no access point here
+	}
+	comp.resize(compLen);
+
+	size_t in = strm.next_in - data;
+	points.push_back(AccessPoint{
+		curOut, in, unsigned(strm.data_type & 7), std::move(comp)});
+	pointsChanged = true;
+}
+
+void SeekableInflate::loadCache(size_t expectedSize)
+{
+	try {
+		File file(cacheName);
+		size_t fileSize;
+		const byte* buf = file.mmap(fileSize);
+		if ((fileSize < HEADER_SIZE) ||
+		    (memcmp(buf, MAGIC, sizeof(MAGIC)) != 0) ||
+		    (Endian::read_UA_L32(buf +  8) != VERSION) ||
+		    (Endian::read_UA_L64(buf + 16) != dataSize) ||
+		    (Endian::read_UA_L64(buf + 24) != uint64_t(time)) ||
+		    ((Endian::read_UA_L64(buf + 32) & 0xFFFFFFFF) !=
+		     (uint64_t(expectedSize) & 0xFFFFFFFF))) {
+			return; // not for this file (anymore)
+		}
+		uint64_t cachedSize = Endian::read_UA_L64(buf + 32);
+		if (cachedSize != size_t(cachedSize)) return; // 32-bit host
+		unsigned count = Endian::read_UA_L32(buf + 12);
+		vector<AccessPoint> result;
+		size_t offset = HEADER_SIZE;
+		for (unsigned i = 0; i < count; ++i) {
+			if ((fileSize - offset) < POINT_SIZE) return;
+			const byte* p = buf + offset;
+			uint64_t out     = Endian::read_UA_L64(p +  0);
+			uint64_t in      = Endian::read_UA_L64(p +  8);
+			unsigned bits    = Endian::read_UA_L32(p + 16);
+			size_t   winSize = Endian::read_UA_L32(p + 20);
+			offset += POINT_SIZE;
+			if (((fileSize - offset) < winSize) ||
+			    (in > dataSize) || (out > cachedSize) || (bits > 7) ||
+			    (bits && (in == 0)) || (out && (winSize == 0)) ||
+			    (!result.empty() && (out <= result.back().out))) {
+				return;
+			}
+			result.push_back(AccessPoint{
+				out, in, bits,
+				vector<byte>(buf + offset, buf + offset + winSize)});
+			offset += winSize;
+		}
+		points.swap(result);
+		size = size_t(cachedSize);
+	} catch (FileException&) {
+		// no (valid) cache file
+	}
+}
+
+void SeekableInflate::saveCache()
+{
+	vector<byte> buf(HEADER_SIZE);
+	memcpy(buf.data(), MAGIC, sizeof(MAGIC));
+	Endian::write_UA_L32(&buf[ 8], VERSION);
+	Endian::write_UA_L32(&buf[12], unsigned(points.size()));
+	Endian::write_UA_L64(&buf[16], dataSize);
+	Endian::write_UA_L64(&buf[24], uint64_t(time));
+	Endian::write_UA_L64(&buf[32], size);
+	for (auto& point : points) {
+		byte p[POINT_SIZE];
+		Endian::write_UA_L64(p +  0, point.out);
+		Endian::write_UA_L64(p +  8, point.in);
+		Endian::write_UA_L32(p + 16, point.bits);
+		Endian::write_UA_L32(p + 20, unsigned(point.window.size()));
+		buf.insert(buf.end(), p, p + POINT_SIZE);
+		buf.insert(buf.end(), point.window.begin(), point.window.end());
+	}
+
+	FileOperations::mkdirp(FileOperations::getBaseName(cacheName));
+	string tmpName = cacheName + ".tmp";
+	{
+		File file(tmpName, File::TRUNCATE);
+		file.write(buf.data(), buf.size());
+	}
+	if (FileOperations::rename(tmpName, cacheName) != 0) {
+		FileOperations::unlink(tmpName);
+	}
+}
+
+} // namespace openmsx
@@ -0,0 +1,91 @@
+#ifndef SEEKABLEINFLATE_HH
+#define SEEKABLEINFLATE_HH
+
+#include "openmsx.hh"
+#include "noncopyable.hh"
+#include <string>
+#include <vector>
+#include <ctime>
+#include <cstdint>
+#include <zlib.h>
+
+namespace openmsx {
+
+/** Random access into a (raw) deflate stream, based on the 'zran' example
+  * from zlib.
+  *
+  * While the stream is decompressed, access points are recorded every
+  * SPAN bytes of output: the position in the compressed and decompressed
+  * stream plus the 32kB of history that inflate needs to resume at that
+  * point. A read at some position then only has to decompress starting
+  * from the nearest access point before it. Sequential reads continue
+  * where the previous read stopped.
+  *
+  * The size in the header of the compressed file can't be trusted (e.g. gzip
+  * only stores it modulo 4GB), so the first time a file is opened the whole
+  * stream is decompressed once to verify it. This pass also creates all
+  * access points. They are stored in a cache file together with the
+  * verified size, so that in a later session this pass isn't needed.
+  */
+class SeekableInflate : private noncopyable
+{
+public:
+	/** @param data The compressed file (must remain valid).
+	  * @param dataSize Size of the compressed file.
+	  * @param start Offset of the deflate stream in 'data'.
+	  * @param size Size of the decompressed data according to the header,
+	  *             only the lower 32 bits are used.
+	  * @param cacheName File to load/store the access points, can be
+	  *                  empty.
+	  * @param time Modification time of the compressed file, used to
+	  *             validate the cache file.
+	  * @throw FileException on corrupt data or when the actual size
+	  *        doesn't match the header, the caller should then fall back
+	  *        to decompressing the whole file.
+	  */
+	SeekableInflate(const byte* data, size_t dataSize, size_t start,
+	                size_t size, std::string cacheName, time_t time);
+	~SeekableInflate();
+
+	size_t getSize() const { return size; }
+
+	/** Read 'num' bytes starting at position 'pos'.
+	  * Returns false when the deflate stream ends before the expected
+	  * size (e.g. the size in the header was wrong), the caller should
+	  * then fall back to decompressing the whole file.
+	  * @throw FileException on corrupt data.
+	  */
+	bool read(size_t pos, byte* buffer, size_t num);
+
+private:
+	struct AccessPoint {
+		uint64_t out;  // position in decompressed data
+		uint64_t in;   // position in compressed data (in 'data')
+		unsigned bits; // number of bits of the byte before 'in'
+		std::vector<byte> window; // history, compressed (empty at start)
+	};
+
+	void startAt(const AccessPoint& point);
+	bool inflateTo(uint64_t end, size_t pos, byte* buffer);
+	void addAccessPoint();
+	void scan(size_t expectedSize);
+	void loadCache(size_t expectedSize);
+	void saveCache();
+
+	const byte* data;
+	const size_t dataSize;
+	size_t size;
+	const std::string cacheName;
+	const time_t time;
+
+	std::vector<AccessPoint> points; // sorted on 'out'
+	std::vector<byte> window; // last 32kB of output (circular)
+	z_stream strm;
+	uint64_t curOut; // position of 'strm' in the decompressed data
+	bool active;     // is 'strm' initialized
+	bool pointsChanged;
+};
+
+} // namespace openmsx
+
+#endif
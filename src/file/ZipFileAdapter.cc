@@ -9,18 +9,17 @@ ZipFileAdapter::ZipFileAdapter(std::unique_ptr<FileBase> file_)
 {
 }
 
-void ZipFileAdapter::decompress(FileBase& file, Decompressed& decompressed)
+// Parses the local file header, returns the "general purpose bit flag".
+static unsigned parseHeader(ZlibInflate& zlib, std::string& originalName,
+                            unsigned& origSize)
 {
-	size_t size;
-	const byte* data = file.mmap(size);
-	ZlibInflate zlib(data, size);
-
 	if (zlib.get32LE() != 0x04034B50) {
 		throw FileException("Invalid ZIP file");
 	}
 
-	// skip "version needed to extract" and "general purpose bit flag"
-	zlib.skip(2 + 2);
+	// skip "version needed to extract"
+	zlib.skip(2);
+	unsigned flags = zlib.get16LE();
 
 	// compression method
 	if (zlib.get16LE() != 0x0008) {
@@ -31,13 +30,39 @@ void ZipFileAdapter::decompress(FileBase& file, Decompressed& decompressed)
 	//      "crc32",              "compressed size"
 	zlib.skip(2 + 2 + 4 + 4);
 
-	unsigned origSize = zlib.get32LE(); // uncompressed size
+	origSize = zlib.get32LE(); // uncompressed size
 	unsigned filenameLen = zlib.get16LE(); // filename length
 	unsigned extraFieldLen = zlib.get16LE(); // extra field length
-	decompressed.originalName = zlib.getString(filenameLen); // original filename
+	originalName = zlib.getString(filenameLen); // original filename
 	zlib.skip(extraFieldLen); // skip "extra field"
+	return flags;
+}
 
+void ZipFileAdapter::decompress(FileBase& file, Decompressed& decompressed)
+{
+	size_t size;
+	const byte* data = file.mmap(size);
+	ZlibInflate zlib(data, size);
+	unsigned origSize;
+	parseHeader(zlib, decompressed.originalName, origSize);
 	zlib.inflate(decompressed.buf, origSize);
 }
 
+bool ZipFileAdapter::getStreamInfo(FileBase& file, StreamInfo& info)
+{
+	size_t size;
+	const byte* data = file.mmap(size);
+	ZlibInflate zlib(data, size);
+	unsigned origSize;
+	unsigned flags = parseHeader(zlib, info.originalName, origSize);
+	if ((flags & 0x0008) || (origSize == 0xFFFFFFFF)) {
+		// sizes are stored in a data descriptor after the data, or
+		// in a zip64 extra field
+		return false;
+	}
+	info.start = zlib.getPosition() - data;
+	info.size = origSize;
+	return true;
+}
+
 } // namespace openmsx
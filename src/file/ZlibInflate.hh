@@ -20,6 +20,9 @@ public:
 	unsigned get32LE();
 	std::string getString(size_t len);
 	std::string getCString();
+	/** Current position in the input buffer (e.g. the start of the
+	  * deflate stream after the header was parsed). */
+	const byte* getPosition() const { return s.next_in; }
 
 	void inflate(MemBuffer<byte>& output, size_t sizeHint = 65536);
 
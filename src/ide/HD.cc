@@ -1,5 +1,6 @@
 #include "HD.hh"
 #include "File.hh"
+#include "SectorCache.hh"
 #include "FileContext.hh"
 #include "FileException.hh"
 #include "DeviceConfig.hh"
@@ -55,6 +56,7 @@ HD::HD(const DeviceConfig& config)
 		file = make_unique<File>(filename);
 		filesize = file->getSize();
 		file->setFilePool(motherBoard.getReactor().getFilePool());
+		cache = make_unique<SectorCache>(*file);
 		tigerTree = make_unique<TigerTree>(*this, filesize,
 		                                   filename.getResolved());
 	} catch (FileException&) {
@@ -77,6 +79,8 @@ HD::HD(const DeviceConfig& config)
 
 HD::~HD()
 {
+	updateTigerTreeTime();
+
 	auto& info = motherBoard.getSharedStuff("hdInUse");
 	assert(info.counter);
 	assert(info.stuff);
@@ -118,6 +122,7 @@ void HD::openImage()
 		file = make_unique<File>(filename, File::CREATE);
 		file->truncate(filesize);
 		file->setFilePool(motherBoard.getReactor().getFilePool());
+		cache = make_unique<SectorCache>(*file);
 		tigerTree = make_unique<TigerTree>(*this, filesize,
 		                                   filename.getResolved());
 	} catch (FileException& e) {
@@ -127,12 +132,33 @@ void HD::openImage()
 	}
 }
 
+void HD::updateTigerTreeTime()
+{
+	// The (persistent) tiger tree cache is only valid for the modification
+	// time of the image after all our writes are done.
+	if (!file || !tigerTree) return;
+	try {
+		file->flush();
+		tigerTree->notifyChange(0, 0, file->getModificationDate());
+	} catch (FileException&) {
+		// ignore
+	}
+}
+
 void HD::switchImage(const Filename& name)
 {
-	file = make_unique<File>(name);
+	if (hasOverlay()) {
+		throw MSXException("Can't change the hard disk image while it "
+		                   "has an overlay, first commit or discard it.");
+	}
+	updateTigerTreeTime();
+	auto newFile = make_unique<File>(name);
+	cache.reset(); // refers to the old file
+	file = std::move(newFile);
 	filename = name;
 	filesize = file->getSize();
 	file->setFilePool(motherBoard.getReactor().getFilePool());
+	cache = make_unique<SectorCache>(*file);
 	tigerTree = make_unique<TigerTree>(*this, filesize,
 	                                   filename.getResolved());
 	motherBoard.getMSXCliComm().update(CliComm::MEDIA, getName(),
@@ -148,15 +174,13 @@ size_t HD::getNbSectorsImpl() const
 void HD::readSectorImpl(size_t sector, SectorBuffer& buf)
 {
 	openImage();
-	file->seek(sector * sizeof(buf));
-	file->read(&buf, sizeof(buf));
+	cache->read(sector, buf);
 }
 
 void HD::writeSectorImpl(size_t sector, const SectorBuffer& buf)
 {
 	openImage();
-	file->seek(sector * sizeof(buf));
-	file->write(&buf, sizeof(buf));
+	cache->write(sector, buf);
 	tigerTree->notifyChange(sector * sizeof(buf), sizeof(buf),
 	                        file->getModificationDate());
 }
@@ -170,16 +194,41 @@ bool HD::isWriteProtectedImpl() const
 Sha1Sum HD::getSha1Sum()
 {
 	openImage();
-	if (hasPatches()) {
+	if (hasPatches() || hasOverlay()) {
 		return SectorAccessibleDisk::getSha1Sum();
 	}
 	return file->getSha1Sum();
 }
 
+const SectorCache* HD::getSectorCache() const
+{
+	return cache.get();
+}
+
 std::string HD::getTigerTreeHash()
 {
 	openImage();
-	return tigerTree->calcHash().toString(); // calls HD::getData()
+	auto& tree = overlayTree ? *overlayTree : *tigerTree;
+	return tree.calcHash().toString(); // calls HD::getData()
+}
+
+void HD::overlayChanged(size_t sector)
+{
+	// Writes to the overlay don't change the image, so they must not end
+	// up in the (persistent) tree of the image. Instead use a separate,
+	// non-persistent, tree for the content as seen via the overlay.
+	if (sector == size_t(-1)) {
+		overlayTree.reset();
+		if (hasOverlay()) {
+			overlayTree = make_unique<TigerTree>(
+				*this, filesize,
+				filename.getResolved() + "#overlay", false);
+		}
+	} else {
+		assert(overlayTree);
+		overlayTree->notifyChange(sector * sizeof(SectorBuffer),
+		                          sizeof(SectorBuffer), 0);
+	}
 }
 
 uint8_t* HD::getData(size_t offset, size_t size)
@@ -205,6 +254,11 @@ uint8_t* HD::getData(size_t offset, size_t size)
 
 bool HD::isCacheStillValid(time_t& cacheTime)
 {
+	if (hasOverlay()) {
+		// the overlay tree is recalculated for each new overlay
+		cacheTime = 0;
+		return false;
+	}
 	time_t fileTime = file->getModificationDate();
 	bool result = fileTime == cacheTime;
 	cacheTime = fileTime;
@@ -238,6 +292,7 @@ int HD::insertDisk(const std::string& filename)
 
 // version 1: initial version
 // version 2: replaced 'checksum'(=sha1) with 'tthsum`
+// version 3: added overlay
 template<typename Archive>
 void HD::serialize(Archive& ar, unsigned version)
 {
@@ -261,6 +316,7 @@ void HD::serialize(Archive& ar, unsigned version)
 			//  - So to get in the same state as the initial
 			//    savestate we again close the file. Otherwise the
 			//    checksum-check code below goes wrong.
+			cache.reset();
 			file.reset();
 		} else {
 			tmp.updateAfterLoadState();
@@ -269,6 +325,11 @@ void HD::serialize(Archive& ar, unsigned version)
 		}
 	}
 
+	// must be restored before the checksum (that one includes the overlay)
+	if (file && ar.versionAtLeast(version, 3)) {
+		serializeOverlay(ar);
+	}
+
 	// store/check checksum
 	if (file) {
 		bool mismatch = false;
@@ -14,6 +14,7 @@ namespace openmsx {
 class MSXMotherBoard;
 class HDCommand;
 class File;
+class SectorCache;
 class DeviceConfig;
 
 class HD : public SectorAccessibleDisk, public DiskContainer
@@ -41,6 +42,8 @@ private:
 	virtual size_t getNbSectorsImpl() const;
 	virtual bool isWriteProtectedImpl() const;
 	virtual Sha1Sum getSha1Sum();
+	virtual void overlayChanged(size_t sector);
+	virtual const SectorCache* getSectorCache() const;
 
 	// Diskcontainer:
 	virtual SectorAccessibleDisk* getSectorAccessibleDisk();
@@ -53,20 +56,23 @@ private:
 	virtual bool isCacheStillValid(time_t& time);
 
 	void openImage();
+	void updateTigerTreeTime();
 
 	MSXMotherBoard& motherBoard;
 	std::string name;
 	std::unique_ptr<HDCommand> hdCommand;
 	std::unique_ptr<TigerTree> tigerTree;
+	std::unique_ptr<TigerTree> overlayTree; // content as seen via overlay
 
 	std::unique_ptr<File> file;
+	std::unique_ptr<SectorCache> cache; // must come after 'file'
 	Filename filename;
 	size_t filesize;
 	bool alreadyTried;
 };
 
 REGISTER_BASE_CLASS(HD, "HD");
-SERIALIZE_CLASS_VERSION(HD, 2);
+SERIALIZE_CLASS_VERSION(HD, 3);
 
 } // namespace openmsx
 
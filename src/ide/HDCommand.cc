@@ -1,5 +1,6 @@
 #include "HDCommand.hh"
 #include "HD.hh"
+#include "DiskOverlay.hh"
 #include "FileContext.hh"
 #include "FileException.hh"
 #include "CommandException.hh"
@@ -35,9 +36,14 @@ void HDCommand::execute(const std::vector<TclObject>& tokens, TclObject& result,
 		if (hd.isWriteProtected()) {
 			options.addListElement("readonly");
 		}
+		if (hd.hasOverlay()) {
+			options.addListElement("overlay");
+		}
 		if (options.getListLength() != 0) {
 			result.addListElement(options);
 		}
+	} else if (tokens[1].getString() == "overlay") {
+		overlay(tokens, result);
 	} else if ((tokens.size() == 2) ||
 	           ((tokens.size() == 3) && tokens[1].getString() == "insert")) {
 		if (powerSetting.getBoolean()) {
@@ -61,7 +67,7 @@ void HDCommand::execute(const std::vector<TclObject>& tokens, TclObject& result,
 			// Note: the diskX command doesn't do this either,
 			// so this has not been converted to TclObject style here
 			// return filename;
-		} catch (FileException& e) {
+		} catch (MSXException& e) {
 			throw CommandException("Can't change hard disk image: " +
 			                       e.getMessage());
 		}
@@ -70,23 +76,78 @@ void HDCommand::execute(const std::vector<TclObject>& tokens, TclObject& result,
 	}
 }
 
+void HDCommand::overlay(const vector<TclObject>& tokens, TclObject& result)
+{
+	if (tokens.size() == 2) {
+		// number of modified sectors and the delta file (if any)
+		if (auto* overlay = hd.getOverlay()) {
+			result.addListElement(int(overlay->getNbSectors()));
+			result.addListElement(overlay->getDeltaFile());
+		}
+		return;
+	}
+	string_ref cmd = tokens[2].getString();
+	// attaching a delta file to an in-memory overlay (e.g. one restored
+	// from a savestate) doesn't change the content of the disk
+	bool attach = (cmd == "enable") && (tokens.size() == 4) &&
+	              hd.getOverlay() && hd.getOverlay()->getDeltaFile().empty();
+	if ((cmd != "commit") && !attach && powerSetting.getBoolean()) {
+		// enabling (with an existing delta file) or discarding
+		// changes the content of the disk
+		throw CommandException(
+			"Can only enable or discard the overlay when MSX is "
+			"powered down.");
+	}
+	try {
+		if ((cmd == "enable") && (tokens.size() <= 4)) {
+			string deltaFile = (tokens.size() == 4)
+				? UserFileContext().resolveCreate(tokens[3].getString())
+				: "";
+			hd.enableOverlay(deltaFile);
+		} else if ((cmd == "commit") && (tokens.size() == 3)) {
+			hd.commitOverlay();
+		} else if ((cmd == "discard") && (tokens.size() == 3)) {
+			hd.discardOverlay();
+		} else {
+			throw CommandException("Too many or wrong arguments.");
+		}
+	} catch (CommandException&) {
+		throw;
+	} catch (MSXException& e) {
+		throw CommandException(e.getMessage());
+	}
+}
+
 string HDCommand::help(const vector<string>& /*tokens*/) const
 {
-	return hd.getName() + ": change the hard disk image for this hard disk drive\n";
+	const string& name = hd.getName();
+	return name + " insert <filename>        : change the hard disk image for this hard disk drive\n" +
+	       name + " overlay enable [<file>] : send all further writes to an overlay (in memory or in the given delta file), the image itself is not modified; with an overlay that has no delta file (e.g. after loading a savestate) it starts storing that overlay in the given file\n" +
+	       name + " overlay commit          : write the overlay to the image and remove the overlay\n" +
+	       name + " overlay discard         : forget the overlay (and delete its delta file)\n" +
+	       name + " overlay                 : show the number of sectors in the overlay and its delta file\n" +
+	       name + "                         : show which image is used for this hard disk drive\n";
 }
 
 void HDCommand::tabCompletion(vector<string>& tokens) const
 {
 	vector<const char*> extra;
 	if (tokens.size() < 3) {
-		extra = { "insert" };
+		extra = { "insert", "overlay" };
+	} else if ((tokens.size() == 3) && (tokens[1] == "overlay")) {
+		static const char* const cmds[] = {
+			"enable", "commit", "discard",
+		};
+		completeString(tokens, cmds);
+		return;
 	}
 	completeFileName(tokens, UserFileContext(), extra);
 }
 
 bool HDCommand::needRecord(const vector<string>& tokens) const
 {
-	return tokens.size() > 1;
+	// The overlay manages (host) files, it shouldn't be repeated on replay.
+	return (tokens.size() > 1) && (tokens[1] != "overlay");
 }
 
 } // namespace openmsx
@@ -26,6 +26,8 @@ public:
 	virtual void tabCompletion(std::vector<std::string>& tokens) const;
 	virtual bool needRecord(const std::vector<std::string>& tokens) const;
 private:
+	void overlay(const std::vector<TclObject>& tokens, TclObject& result);
+
 	HD& hd;
 	const BooleanSetting& powerSetting;
 };
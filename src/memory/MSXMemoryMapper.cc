@@ -67,6 +67,11 @@ byte MSXMemoryMapper::readMem(word address, EmuTime::param /*time*/)
 	return checkedRam->read(calcAddress(address));
 }
 
+int MSXMemoryMapper::getSegment(word address) const
+{
+	return calcAddress(address) >> 14;
+}
+
 void MSXMemoryMapper::writeMem(word address, byte value, EmuTime::param /*time*/)
 {
 	checkedRam->write(calcAddress(address), value);
@@ -22,6 +22,7 @@ public:
 	virtual const byte* getReadCacheLine(word start) const;
 	virtual byte* getWriteCacheLine(word start) const;
 	virtual byte peekMem(word address, EmuTime::param time) const;
+	virtual int getSegment(word address) const;
 
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
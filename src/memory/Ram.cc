@@ -8,6 +8,7 @@
 #include "serialize.hh"
 #include "memory.hh"
 #include <algorithm>
+#include <cassert>
 #include <cstring>
 #include <zlib.h>
 
@@ -22,6 +23,8 @@ public:
 	              const string& description, Ram& ram);
 	virtual byte read(unsigned address);
 	virtual void write(unsigned address, byte value);
+	virtual void readBlock(unsigned start, byte* output, unsigned num);
+	virtual void writeBlock(unsigned start, const byte* input, unsigned num);
 private:
 	Ram& ram;
 };
@@ -111,6 +114,18 @@ void RamDebuggable::write(unsigned address, byte value)
 	ram[address] = value;
 }
 
+void RamDebuggable::readBlock(unsigned start, byte* output, unsigned num)
+{
+	assert((start + num) <= ram.getSize());
+	if (num) memcpy(output, &ram[start], num);
+}
+
+void RamDebuggable::writeBlock(unsigned start, const byte* input, unsigned num)
+{
+	assert((start + num) <= ram.getSize());
+	if (num) memcpy(&ram[start], input, num);
+}
+
 
 template<typename Archive>
 void Ram::serialize(Archive& ar, unsigned /*version*/)
@@ -14,12 +14,16 @@
 #include "Debuggable.hh"
 #include "CliComm.hh"
 #include "FilePool.hh"
+#include "ConfigCache.hh"
+#include "RomStore.hh"
 #include "ConfigException.hh"
 #include "EmptyPatch.hh"
 #include "IPSPatch.hh"
 #include "StringOp.hh"
 #include "sha1.hh"
+#include "Timer.hh"
 #include "memory.hh"
+#include <algorithm>
 #include <limits>
 #include <cstring>
 
@@ -78,6 +82,22 @@ Rom::Rom(const string& name_, const string& description_,
 	}
 }
 
+// Everything that determines which file is found for a <rom> tag (that
+// doesn't have a resolvedFilename or resolvedSha1 tag).
+static string romCacheKey(const FileContext& context,
+                          const std::vector<const XMLElement*>& filenames,
+                          const std::vector<const XMLElement*>& sums)
+{
+	StringOp::Builder key;
+	key << (context.isUserContext() ? "user" : "system");
+	for (auto& p : context.getPaths()) key << '\n' << p;
+	key << "\nfilenames:";
+	for (auto& f : filenames) key << '\n' << f->getData();
+	key << "\nsha1:";
+	for (auto& s : sums) key << '\n' << s->getData();
+	return key;
+}
+
 void Rom::init(MSXMotherBoard& motherBoard, const XMLElement& config,
                const FileContext& context)
 {
@@ -113,8 +133,17 @@ void Rom::init(MSXMotherBoard& motherBoard, const XMLElement& config,
 	} else if (resolvedFilenameElem || resolvedSha1Elem ||
 	           !sums.empty() || !filenames.empty()) {
 		auto& filepool = motherBoard.getReactor().getFilePool();
+		auto& configCache = motherBoard.getReactor().getConfigCache();
+		auto start = Timer::getTime();
+		// When this ROM was found before (e.g. when the same machine
+		// is created again), use that file and its sha1sum again.
+		string cacheKey;
+		if (!resolvedFilenameElem && !resolvedSha1Elem) {
+			cacheKey = romCacheKey(context, filenames, sums);
+			file = configCache.findRom(cacheKey, originalSha1);
+		}
 		// first try already resolved filename ..
-		if (resolvedFilenameElem) {
+		if (!file && resolvedFilenameElem) {
 			try {
 				file = make_unique<File>(
 					resolvedFilenameElem->getData());
@@ -181,24 +210,32 @@ void Rom::init(MSXMotherBoard& motherBoard, const XMLElement& config,
 				"supported.");
 		}
 		try {
-			size_t size2;
-			rom = file->mmap(size2);
+			// For file-based roms, calc sha1 via File::getSha1Sum().
+			// It can possibly use the FilePool cache to avoid the
+			// calculation.
+			if (originalSha1.empty()) {
+				file->setFilePool(filepool);
+				originalSha1 = file->getSha1Sum();
+			}
+			// Share the content with other Roms with the same
+			// sha1sum (possibly in other motherboards).
+			content = RomStore::get(originalSha1, file->getURL());
+			file->munmap(); // possibly mapped for the sha1 calculation
+			size_t size2 = content->getSize();
 			if (size2 > std::numeric_limits<decltype(size)>::max()) {
 				throw MSXException("Rom file too big: " +
 				                   file->getURL());
 			}
+			rom = content->getData();
 			size = unsigned(size2);
 		} catch (FileException&) {
 			throw MSXException("Error reading ROM image: " +
 					   file->getURL());
 		}
-
-		// For file-based roms, calc sha1 via File::getSha1Sum(). It can
-		// possibly use the FilePool cache to avoid the calculation.
-		if (originalSha1.empty()) {
-			file->setFilePool(filepool);
-			originalSha1 = file->getSha1Sum();
+		if (!cacheKey.empty()) {
+			configCache.storeRom(cacheKey, *file, originalSha1);
 		}
+		configCache.addTime(ConfigCache::ROMS, Timer::getTime() - start);
 
 		// verify SHA1
 		if (!checkSHA1(config)) {
@@ -239,15 +276,15 @@ void Rom::init(MSXMotherBoard& motherBoard, const XMLElement& config,
 				patch = make_unique<IPSPatch>(
 					filename, std::move(patch));
 			}
-			auto patchSize = unsigned(patch->getSize());
-			if (patchSize <= size) {
-				patch->copyBlock(0, const_cast<byte*>(rom), size);
-			} else {
-				size = patchSize;
-				extendedRom.resize(size);
-				patch->copyBlock(0, extendedRom.data(), size);
-				rom = extendedRom.data();
-			}
+			// The original content is possibly shared with other
+			// Roms (see RomStore), so always patch a copy.
+			size = std::max(size, unsigned(patch->getSize()));
+			MemBuffer<byte> patched(size);
+			patch->copyBlock(0, patched.data(), size);
+			patch.reset();
+			extendedRom = std::move(patched);
+			rom = extendedRom.data();
+			content.reset();
 
 			// calculated because it's different from original
 			patchedSha1 = SHA1::calc(rom, size);
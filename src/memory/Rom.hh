@@ -17,6 +17,7 @@ class DeviceConfig;
 class File;
 class FileContext;
 class RomDebuggable;
+namespace RomStore { class Content; }
 
 class Rom : private noncopyable
 {
@@ -44,6 +45,7 @@ private:
 
 	const byte* rom;
 	MemBuffer<byte> extendedRom;
+	std::shared_ptr<const RomStore::Content> content;
 
 	std::unique_ptr<File> file;
 
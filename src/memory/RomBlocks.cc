@@ -58,6 +58,12 @@ const byte* RomBlocks<BANK_SIZE>::getReadCacheLine(word address) const
 	return &bank[address / BANK_SIZE][address & BANK_MASK];
 }
 
+template <unsigned BANK_SIZE>
+int RomBlocks<BANK_SIZE>::getSegment(word address) const
+{
+	return blockNr[address / BANK_SIZE];
+}
+
 template <unsigned BANK_SIZE>
 void RomBlocks<BANK_SIZE>::setBank(byte region, const byte* adr, int block)
 {
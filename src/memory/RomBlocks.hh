@@ -19,6 +19,7 @@ public:
 
 	virtual byte readMem(word address, EmuTime::param time);
 	virtual const byte* getReadCacheLine(word start) const;
+	virtual int getSegment(word address) const;
 
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
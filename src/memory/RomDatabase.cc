@@ -4,15 +4,20 @@
 #include "TclObject.hh"
 #include "FileContext.hh"
 #include "File.hh"
+#include "FileException.hh"
 #include "FileOperations.hh"
 #include "GlobalCommandController.hh"
 #include "CliComm.hh"
 #include "StringOp.hh"
 #include "StringMap.hh"
+#include "Version.hh"
 #include "rapidsax.hh"
+#include "endian.hh"
 #include "unreachable.hh"
 #include "memory.hh"
 #include "stl.hh"
+#include <unordered_map>
+#include <cstring>
 
 using std::string;
 using std::vector;
@@ -47,6 +52,7 @@ public:
 		, state(BEGIN)
 		, unknownLevel(0)
 		, initialSize(db.size())
+		, duplicates(false)
 	{
 	}
 
@@ -58,6 +64,7 @@ public:
 	void doctype(string_ref text);
 
 	string_ref getSystemID() const { return systemID; }
+	bool hadDuplicates() const { return duplicates; }
 
 private:
 	void addEntries();
@@ -111,6 +118,7 @@ private:
 	State state;
 	unsigned unknownLevel;
 	size_t initialSize;
+	bool duplicates;
 };
 
 void DBParser::start(string_ref tag)
@@ -414,6 +422,7 @@ void DBParser::addAllEntries()
 			cliComm.printWarning(
 				"duplicate softwaredb entry SHA1: " +
 				it2->first.toString());
+			duplicates = true;
 		} else {
 			++it1;
 			*it1 = std::move(*it2);
@@ -548,7 +557,8 @@ void DBParser::doctype(string_ref text)
 	systemID = t.substr(0, pos2);
 }
 
-static void parseDB(CliComm& cliComm, const string& filename,
+// Returns true iff there were duplicate entries (and so warnings).
+static bool parseDB(CliComm& cliComm, const string& filename,
                     MemBuffer<char>& buf, RomDatabase::RomDB& db,
                     UnknownTypes& unknownTypes)
 {
@@ -567,24 +577,221 @@ static void parseDB(CliComm& cliComm, const string& filename,
 			"You're probably using an old incompatible file format.",
 			nullptr);
 	}
+	return handler.hadDuplicates();
+}
+
+
+// The precompiled database is a binary file that is memory mapped and
+// queried in place. Layout (all numbers are little endian):
+//  - header: 8 byte magic, L32 version, L32 number of entries,
+//            L32 length of the key, the key (padded to a multiple of 4)
+//  - entries, sorted on sha1sum (see CacheEntry)
+//  - string pool (strings are not zero-terminated)
+// The key identifies the openMSX version and the size and modification
+// time of all softwaredb.xml files. When it doesn't match the key that is
+// calculated on startup, the xml files are parsed again and the cache is
+// rewritten.
+static const char CACHE_MAGIC[8] = { 'o','M','S','X','s','w','d','b' };
+static const unsigned CACHE_VERSION = 1;
+static const char* const CACHE_FILE = "/.softwaredb.cache";
+
+enum { TITLE_STR, YEAR_STR, COMPANY_STR, COUNTRY_STR, ORIGTYPE_STR,
+       REMARK_STR, NUM_STRINGS };
+
+struct CacheHeader {
+	char magic[8];
+	Endian::L32 version;
+	Endian::L32 count;
+	Endian::L32 keyLength;
+};
+
+struct CacheEntry {
+	uint8_t sha1[20];
+	Endian::L32 strings[NUM_STRINGS][2]; // offset, length
+	Endian::L32 romType;
+	Endian::L32 genMSXid;
+	Endian::L32 original;
+};
+
+static size_t alignKey(size_t length)
+{
+	return (length + 3) & ~3;
+}
+
+static string calcCacheKey(const vector<string>& filenames)
+{
+	StringOp::Builder key;
+	key << Version::full() << '\n';
+	for (auto& f : filenames) {
+		key << f << '\n';
+		FileOperations::Stat st;
+		if (FileOperations::getStat(f, st)) {
+			key << st.st_size << ' '
+			    << FileOperations::getModificationDate(st) << '\n';
+		} else {
+			key << "-\n";
+		}
+	}
+	return key;
+}
+
+bool RomDatabase::openCache(const string& filename, const string& key)
+{
+	try {
+		cacheFile = make_unique<File>(filename);
+		size_t size;
+		const byte* data = cacheFile->mmap(size);
+		if (size < sizeof(CacheHeader)) {
+			cacheFile.reset();
+			return false;
+		}
+		auto& header = *reinterpret_cast<const CacheHeader*>(data);
+		size_t keySize = alignKey(header.keyLength);
+		size_t entriesSize = size_t(header.count) * sizeof(CacheEntry);
+		if ((memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0) ||
+		    (header.version != CACHE_VERSION) ||
+		    (header.keyLength != key.size()) ||
+		    ((size - sizeof(CacheHeader)) < (keySize + entriesSize)) ||
+		    (memcmp(data + sizeof(CacheHeader), key.data(), key.size()) != 0)) {
+			cacheFile.reset();
+			return false;
+		}
+		cacheCount = header.count;
+		cacheEntries = data + sizeof(CacheHeader) + keySize;
+		cacheStrings = reinterpret_cast<const char*>(cacheEntries + entriesSize);
+		cacheStringsSize = size - sizeof(CacheHeader) - keySize - entriesSize;
+		return true;
+	} catch (FileException&) {
+		cacheFile.reset();
+		return false;
+	}
+}
+
+void RomDatabase::writeCache(const string& filename, const string& key)
+{
+	size_t keySize = alignKey(key.size());
+	vector<byte> buf(sizeof(CacheHeader) + keySize +
+	                 db.size() * sizeof(CacheEntry));
+	auto& header = *reinterpret_cast<CacheHeader*>(buf.data());
+	memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.version = CACHE_VERSION;
+	header.count = unsigned(db.size());
+	header.keyLength = unsigned(key.size());
+	memcpy(buf.data() + sizeof(CacheHeader), key.data(), key.size());
+
+	// Many strings (company, country, year, ...) occur often, store them
+	// only once.
+	string pool;
+	std::unordered_map<string, unsigned> offsets;
+	auto addString = [&](Endian::L32* out, string_ref str) {
+		auto result = offsets.emplace(str.str(), unsigned(pool.size()));
+		if (result.second) pool.append(str.data(), str.size());
+		out[0] = result.first->second;
+		out[1] = unsigned(str.size());
+	};
+	auto* out = reinterpret_cast<CacheEntry*>(
+		buf.data() + sizeof(CacheHeader) + keySize);
+	for (auto& p : db) {
+		auto& info = p.second;
+		p.first.toBinary(out->sha1);
+		addString(out->strings[TITLE_STR],    info.getTitle());
+		addString(out->strings[YEAR_STR],     info.getYear());
+		addString(out->strings[COMPANY_STR],  info.getCompany());
+		addString(out->strings[COUNTRY_STR],  info.getCountry());
+		addString(out->strings[ORIGTYPE_STR], info.getOrigType());
+		addString(out->strings[REMARK_STR],   info.getRemark());
+		out->romType  = unsigned(info.getRomType());
+		out->genMSXid = unsigned(info.getGenMSXid());
+		out->original = info.getOriginal() ? 1 : 0;
+		++out;
+	}
+	buf.insert(buf.end(), pool.begin(), pool.end());
+
+	// Write to a temporary file first, so that a concurrently starting
+	// openMSX never sees a half written file.
+	FileOperations::mkdirp(FileOperations::getUserDataDir());
+	string tmpName = filename + ".tmp";
+	{
+		File file(tmpName, File::TRUNCATE);
+		file.write(buf.data(), buf.size());
+	}
+	if (FileOperations::rename(tmpName, filename) != 0) {
+		FileOperations::unlink(tmpName);
+		throw FileException("Couldn't replace " + filename);
+	}
+}
+
+struct CompareCacheEntry {
+	bool operator()(const CacheEntry& e, const uint8_t* k) const {
+		return memcmp(e.sha1, k, 20) < 0;
+	}
+	bool operator()(const uint8_t* k, const CacheEntry& e) const {
+		return memcmp(k, e.sha1, 20) < 0;
+	}
+};
+
+const RomInfo* RomDatabase::fetchFromCache(const Sha1Sum& sha1sum) const
+{
+	auto it = cacheFetched.find(sha1sum);
+	if (it != cacheFetched.end()) return &it->second;
+
+	uint8_t key[20];
+	sha1sum.toBinary(key);
+	auto* first = reinterpret_cast<const CacheEntry*>(cacheEntries);
+	auto* last  = first + cacheCount;
+	auto* e = std::lower_bound(first, last, key, CompareCacheEntry());
+	if ((e == last) || (memcmp(e->sha1, key, 20) != 0)) return nullptr;
+
+	auto getString = [&](int i) {
+		// the file is not validated on load, so check the bounds here
+		size_t offset = e->strings[i][0];
+		size_t length = e->strings[i][1];
+		if ((offset > cacheStringsSize) ||
+		    (length > (cacheStringsSize - offset))) {
+			return string_ref();
+		}
+		return string_ref(cacheStrings + offset, length);
+	};
+	auto result = cacheFetched.emplace(sha1sum, RomInfo(
+		getString(TITLE_STR), getString(YEAR_STR),
+		getString(COMPANY_STR), getString(COUNTRY_STR),
+		e->original != 0, getString(ORIGTYPE_STR),
+		getString(REMARK_STR), RomType(unsigned(e->romType)),
+		int(unsigned(e->genMSXid))));
+	return &result.first->second;
 }
 
 RomDatabase::RomDatabase(GlobalCommandController& commandController, CliComm& cliComm)
-	: softwareInfoTopic(make_unique<SoftwareInfoTopic>(
+	: cacheEntries(nullptr)
+	, cacheStrings(nullptr)
+	, cacheStringsSize(0)
+	, cacheCount(0)
+	, softwareInfoTopic(make_unique<SoftwareInfoTopic>(
 		commandController.getOpenMSXInfoCommand(), *this))
 {
+	// first user- then system-directory
+	vector<string> filenames;
+	for (auto& p : SystemFileContext().getPaths()) {
+		filenames.push_back(FileOperations::join(p, "softwaredb.xml"));
+	}
+
+	// Try the precompiled database first, it only needs to be mapped.
+	string cacheName = FileOperations::getUserDataDir() + CACHE_FILE;
+	string cacheKey = calcCacheKey(filenames);
+	if (openCache(cacheName, cacheKey)) return;
+
 	db.reserve(3500);
 	UnknownTypes unknownTypes;
-	// first user- then system-directory
-	vector<string> paths = SystemFileContext().getPaths();
-	for (auto& p : paths) {
-		string filename = FileOperations::join(p, "softwaredb.xml");
+	bool warnings = false;
+	for (auto& filename : filenames) {
 		try {
 			buffers.emplace_back();
-			parseDB(cliComm, filename, buffers.back(), db, unknownTypes);
+			warnings |= parseDB(cliComm, filename, buffers.back(),
+			                    db, unknownTypes);
 		} catch (rapidsax::ParseError& e) {
 			cliComm.printWarning(StringOp::Builder() <<
 				"Rom database parsing failed: " << e.what());
+			warnings = true;
 		} catch (MSXException& /*e*/) {
 			// Ignore. It's not unusual the DB in the user
 			// directory is not found. In case there's an error
@@ -604,6 +811,21 @@ RomDatabase::RomDatabase(GlobalCommandController& commandController, CliComm& cl
 			output << p.first() << " (" << p.second << "x); ";
 		}
 		cliComm.printWarning(output);
+		warnings = true;
+	}
+
+	// Only precompile a database without problems, otherwise the
+	// warnings would no longer be shown on the next startup.
+	if (db.empty() || warnings) return;
+	try {
+		writeCache(cacheName, cacheKey);
+	} catch (MSXException&) {
+		return; // ignore, keep using the parsed database
+	}
+	// switch to the precompiled version, uses less memory
+	if (openCache(cacheName, cacheKey)) {
+		RomDB().swap(db);
+		vector<MemBuffer<char>>().swap(buffers);
 	}
 }
 
@@ -613,6 +835,8 @@ RomDatabase::~RomDatabase()
 
 const RomInfo* RomDatabase::fetchRomInfo(const Sha1Sum& sha1sum) const
 {
+	if (cacheFile) return fetchFromCache(sha1sum);
+
 	auto it = lower_bound(db.begin(), db.end(), sha1sum,
 	                      LessTupleElement<0>());
 	return ((it != db.end()) && (it->first == sha1sum))
@@ -5,6 +5,9 @@
 #include "MemBuffer.hh"
 #include "sha1.hh"
 #include "noncopyable.hh"
+#include "openmsx.hh"
+#include <map>
+#include <string>
 #include <utility>
 #include <vector>
 #include <memory>
@@ -12,6 +15,7 @@
 namespace openmsx {
 
 class CliComm;
+class File;
 class SoftwareInfoTopic;
 class GlobalCommandController;
 
@@ -29,8 +33,23 @@ public:
 	const RomInfo* fetchRomInfo(const Sha1Sum& sha1sum) const;
 
 private:
+	bool openCache(const std::string& filename, const std::string& key);
+	void writeCache(const std::string& filename, const std::string& key);
+	const RomInfo* fetchFromCache(const Sha1Sum& sha1sum) const;
+
 	RomDB db;
 	std::vector<MemBuffer<char>> buffers;
+
+	// Precompiled (binary) version of the database, memory mapped. When
+	// this is used, 'db' and 'buffers' are empty.
+	std::unique_ptr<File> cacheFile;
+	const byte* cacheEntries;
+	const char* cacheStrings;
+	size_t cacheStringsSize;
+	unsigned cacheCount;
+	// RomInfo objects for the entries that were looked up in the cache
+	mutable std::map<Sha1Sum, RomInfo> cacheFetched;
+
 	std::unique_ptr<SoftwareInfoTopic> softwareInfoTopic;
 };
 
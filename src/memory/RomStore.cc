@@ -0,0 +1,45 @@
+#include "RomStore.hh"
+#include "File.hh"
+#include "memory.hh"
+#include <map>
+
+using std::string;
+using std::shared_ptr;
+using std::weak_ptr;
+
+namespace openmsx {
+namespace RomStore {
+
+// An entry is removed by the destructor of its Content.
+static std::map<Sha1Sum, weak_ptr<const Content>> store;
+
+Content::Content(const Sha1Sum& sha1_, const string& url)
+	: sha1(sha1_)
+	, file(make_unique<File>(url))
+{
+	data = file->mmap(size);
+}
+
+Content::~Content()
+{
+	auto it = store.find(sha1);
+	if ((it != store.end()) && it->second.expired()) {
+		store.erase(it);
+	}
+}
+
+shared_ptr<const Content> get(const Sha1Sum& sha1, const string& url)
+{
+	auto it = store.find(sha1);
+	if (it != store.end()) {
+		if (auto content = it->second.lock()) {
+			return content;
+		}
+	}
+	auto content = std::make_shared<const Content>(sha1, url);
+	store[sha1] = content;
+	return content;
+}
+
+} // namespace RomStore
+} // namespace openmsx
@@ -0,0 +1,54 @@
+#ifndef ROMSTORE_HH
+#define ROMSTORE_HH
+
+#include "sha1.hh"
+#include "openmsx.hh"
+#include "noncopyable.hh"
+#include <memory>
+#include <string>
+
+namespace openmsx {
+
+class File;
+
+/** Process-wide store of ROM images, keyed on their sha1sum.
+  *
+  * Roms with the same content (e.g. the system ROMs of several instances of
+  * the same machine, or of the motherboards that are created during a reverse
+  * replay) share one immutable buffer instead of each having their own
+  * mapping (or decompressed copy). The content is released when the last user
+  * is gone.
+  *
+  * Only used from the main thread.
+  */
+namespace RomStore {
+
+	class Content : private noncopyable
+	{
+	public:
+		/** @throw FileException */
+		Content(const Sha1Sum& sha1, const std::string& url);
+		~Content();
+
+		const byte* getData() const { return data; }
+		size_t getSize() const { return size; }
+
+	private:
+		const Sha1Sum sha1;
+		std::unique_ptr<File> file; // keeps the mapping alive
+		const byte* data;
+		size_t size;
+	};
+
+	/** Get the content with the given sha1sum. If it's not yet in the
+	  * store, the file with the given url is loaded (it must have that
+	  * sha1sum).
+	  * @throw FileException
+	  */
+	std::shared_ptr<const Content> get(const Sha1Sum& sha1,
+	                                   const std::string& url);
+
+} // namespace RomStore
+} // namespace openmsx
+
+#endif
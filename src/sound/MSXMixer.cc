@@ -11,9 +11,9 @@
 #include "BooleanSetting.hh"
 #include "CommandException.hh"
 #include "AviRecorder.hh"
+#include "SoundChipLogCommand.hh"
 #include "Filename.hh"
 #include "CliComm.hh"
-#include "Math.hh"
 #include "StringOp.hh"
 #include "vla.hh"
 #include "unreachable.hh"
@@ -104,7 +104,11 @@ MSXMixer::MSXMixer(Mixer& mixer_, Scheduler& scheduler,
 	, prevTime(getCurrentTime(), 44100)
 	, soundDeviceInfo(make_unique<SoundDeviceInfoTopic>(
 		msxCommandController_.getMachineInfoCommand(), *this))
+	, soundChipLogCommand(make_unique<SoundChipLogCommand>(
+		msxCommandController_, scheduler))
 	, recorder(nullptr)
+	, offlineListener(nullptr)
+	, offlineSavedRate(0)
 	, synchronousCounter(0)
 {
 	hostSampleRate = 44100;
@@ -234,293 +238,52 @@ void MSXMixer::updateStream(EmuTime::param time)
 	if (recorder) {
 		recorder->addWave(count, mixBuffer);
 	}
+	if (offlineListener) {
+		offlineListener->mixerOutput(mixBuffer, count);
+	}
 
 	prevTime += count;
 }
 
 void MSXMixer::generate(short* output, EmuTime::param time, unsigned samples)
 {
-	// The code below is specialized for a lot of cases (before this
-	// routine was _much_ shorter). This is done because this routine
-	// ends up relatively high (top 5) in a profile run.
-	// After these specialization this routine runs about two times
-	// faster for the common cases (mono output or no sound at all).
-	// In total emulation time this gave a speedup of about 2%.
-
-	VLA(int, stereoBuf, 2 * samples + 3);
-	VLA(int, monoBuf, samples + 3);
-	VLA_SSE_ALIGNED(int, tmpBuf, 2 * samples + 3);
-
-	static const unsigned HAS_MONO_FLAG = 1;
-	static const unsigned HAS_STEREO_FLAG = 2;
-	unsigned usedBuffers = 0;
+	// This routine ends up relatively high in a profile run. All devices
+	// are mixed in a (float) stereo accumulator, see MixKernels for the
+	// vectorized inner loops.
+	const unsigned padded = samples + MixKernels::PADDING;
+	VLA_SSE_ALIGNED(int, tmpBuf, 2 * padded);
+	VLA_SSE_ALIGNED(float, accBuf, 2 * padded);
+	bool hasInput = false;
 
-	// FIXME: The Infos should be ordered such that all the mono
-	// devices are handled first
 	for (auto& info : infos) {
 		// When samples==0, call updateBuffer() but skip mixing
 		SoundDevice& device = *info.device;
 		if (device.updateBuffer(samples, tmpBuf, time) &&
 		    (samples > 0)) {
+			if (!hasInput) {
+				hasInput = true;
+				memset(accBuf, 0, 2 * padded * sizeof(float));
+			}
 			if (!device.isStereo()) {
-				int l1 = info.left1;
-				int r1 = info.right1;
-				if (l1 == r1) {
-					if (!(usedBuffers & HAS_MONO_FLAG)) {
-						usedBuffers |= HAS_MONO_FLAG;
-#ifdef __arm__
-						unsigned dummy1, dummy2, dummy3;
-						asm volatile (
-						"0:\n\t"
-							"ldmia	%[in]!,{r3-r6}\n\t"
-							"mul	r3,%[f],r3\n\t"
-							"mul	r4,%[f],r4\n\t"
-							"mul	r5,%[f],r5\n\t"
-							"mul	r6,%[f],r6\n\t"
-							"stmia	%[out]!,{r3-r6}\n\t"
-							"subs	%[n],%[n],#4\n\t"
-							"bgt	0b\n\t"
-							: [in]  "=r"    (dummy1)
-							, [out] "=r"    (dummy2)
-							, [n]   "=r"    (dummy3)
-							:       "[in]"  (tmpBuf)
-							,       "[out]" (monoBuf)
-							,       "[n]"   (samples)
-							, [f]   "r"     (l1)
-							: "memory", "r3","r4","r5","r6"
-						);
-#else
-						for (unsigned i = 0; i < samples; ++i) {
-							int tmp = l1 * tmpBuf[i];
-							monoBuf[i] = tmp;
-						}
-#endif
-					} else {
-#ifdef __arm__
-						unsigned dummy1, dummy2, dummy3;
-						asm volatile (
-						"0:\n\t"
-							"ldmia	%[in]!,{r3,r4,r5,r6}\n\t"
-							"ldmia	%[out],{r8,r9,r10,r12}\n\t"
-							"mla	r3,%[f],r3,r8\n\t"
-							"mla	r4,%[f],r4,r9\n\t"
-							"mla	r5,%[f],r5,r10\n\t"
-							"mla	r6,%[f],r6,r12\n\t"
-							"stmia	%[out]!,{r3,r4,r5,r6}\n\t"
-							"subs	%[n],%[n],#4\n\t"
-							"bgt	0b\n\t"
-							: [in]  "=r"    (dummy1)
-							, [out] "=r"    (dummy2)
-							, [n]   "=r"    (dummy3)
-							:       "[in]"  (tmpBuf)
-							,       "[out]" (monoBuf)
-							,       "[n]"   (samples)
-							, [f]   "r"     (l1)
-							: "memory"
-							, "r3","r4","r5","r6"
-							, "r8","r9","r10","r12"
-						);
-#else
-						for (unsigned i = 0; i < samples; ++i) {
-							int tmp = l1 * tmpBuf[i];
-							monoBuf[i] += tmp;
-						}
-#endif
-					}
-				} else {
-					if (!(usedBuffers & HAS_STEREO_FLAG)) {
-						usedBuffers |= HAS_STEREO_FLAG;
-						for (unsigned i = 0; i < samples; ++i) {
-							int l = l1 * tmpBuf[i];
-							int r = r1 * tmpBuf[i];
-							stereoBuf[2 * i + 0] = l;
-							stereoBuf[2 * i + 1] = r;
-						}
-					} else {
-						for (unsigned i = 0; i < samples; ++i) {
-							int l = l1 * tmpBuf[i];
-							int r = r1 * tmpBuf[i];
-							stereoBuf[2 * i + 0] += l;
-							stereoBuf[2 * i + 1] += r;
-						}
-					}
-				}
+				MixKernels::addMono(accBuf, tmpBuf, samples,
+				                    info.left1, info.right1);
 			} else {
-				int l1 = info.left1;
-				int r1 = info.right1;
-				int l2 = info.left2;
-				int r2 = info.right2;
-				if (!(usedBuffers & HAS_STEREO_FLAG)) {
-					usedBuffers |= HAS_STEREO_FLAG;
-					for (unsigned i = 0; i < samples; ++i) {
-						int in1 = tmpBuf[2 * i + 0];
-						int in2 = tmpBuf[2 * i + 1];
-						int l = l1 * in1 + l2 * in2;
-						int r = r1 * in1 + r2 * in2;
-						stereoBuf[2 * i + 0] = l;
-						stereoBuf[2 * i + 1] = r;
-					}
-				} else {
-					for (unsigned i = 0; i < samples; ++i) {
-						int in1 = tmpBuf[2 * i + 0];
-						int in2 = tmpBuf[2 * i + 1];
-						int l = l1 * in1 + l2 * in2;
-						int r = r1 * in1 + r2 * in2;
-						stereoBuf[2 * i + 0] += l;
-						stereoBuf[2 * i + 1] += r;
-					}
-				}
+				MixKernels::addStereo(accBuf, tmpBuf, samples,
+				                      info.left1, info.right1,
+				                      info.left2, info.right2);
 			}
 		}
 	}
+	if (samples == 0) return;
 
-	// DC removal filter
-	//   y(n) = x(n) - x(n-1) + R * y(n-1)
-	//   R = 1 - (pi*2 * cut-off-frequency / samplerate)
-	// take R = 511/512
-	//   44100Hz --> cutt-off freq = 14Hz
-	//   22050Hz                     7Hz
-	// Note: we divide by 512 iso shift-right by 9 because we want
-	//       to round towards zero.
-	switch (usedBuffers) {
-	case 0:
-		// no new input
-		if (samples == 0) break;
-		if ((outLeft == outRight) && (prevLeft == prevRight)) {
-			if ((outLeft == 0) && (prevLeft == 0)) {
-				// output was already zero, after DC-filter
-				// it will still be zero
-				memset(output, 0, 2 * samples * sizeof(short));
-			} else {
-				// output was not zero, but it was the same
-				// left and right
-				assert(samples > 0);
-				outLeft  = -prevLeft + ((511 * outLeft) / 512);
-				prevLeft = 0;
-				short out = Math::clipIntToShort(outLeft);
-				output[0] = out;
-				output[1] = out;
-				for (unsigned j = 1; j < samples; ++j) {
-					outLeft = ((511 * outLeft) / 512);
-					out = Math::clipIntToShort(outLeft);
-					output[2 * j + 0] = out;
-					output[2 * j + 1] = out;
-				}
-			}
-			outRight = outLeft;
-			prevRight = prevLeft;
-		} else {
-			assert(samples > 0);
-			outLeft   = -prevLeft  + ((511 * outLeft ) / 512);
-			outRight  = -prevRight + ((511 * outRight) / 512);
-			prevLeft  = 0;
-			prevRight = 0;
-			output[0] = Math::clipIntToShort(outLeft);
-			output[1] = Math::clipIntToShort(outRight);
-			for (unsigned j = 1; j < samples; ++j) {
-				outLeft   = ((511 *  outLeft) / 512);
-				outRight  = ((511 * outRight) / 512);
-				output[2 * j + 0] = Math::clipIntToShort(outLeft);
-				output[2 * j + 1] = Math::clipIntToShort(outRight);
-			}
-		}
-		break;
-
-	case HAS_MONO_FLAG:
-		// only mono
-		if ((outLeft == outRight) && (prevLeft == prevRight)) {
-			// previous output was also mono
-#ifdef __arm__
-			// Note: there are two functional differences in the
-			//       asm and c++ code below:
-			//  - divide by 512 is replaced by ASR #9
-			//    (different for negative numbers)
-			//  - the outLeft variable is set to the clipped value
-			// Though this difference is very small, and we need
-			// the extra speed.
-			unsigned dummy1, dummy2, dummy3, dummy4;
-			asm volatile (
-			"0:\n\t"
-				"rsb	%[o],%[o],%[o],LSL #9\n\t"
-				"rsb	%[o],%[p],%[o],ASR #9\n\t"
-				"ldr	%[p],[%[in]],#4\n\t"
-				"asrs	%[p],%[p],#8\n\t"
-				"add	%[o],%[o],%[p]\n\t"
-				"lsls	%[t],%[o],#16\n\t"
-				"cmp	%[o],%[t],ASR #16\n\t"
-				"it ne\n\t"
-				"subne	%[o],%[m],%[o],ASR #31\n\t"
-				"strh	%[o],[%[out]],#2\n\t"
-				"strh	%[o],[%[out]],#2\n\t"
-				"subs	%[n],%[n],#1\n\t"
-				"bne	0b\n\t"
-				: [o]   "=r"    (outLeft)
-				, [p]   "=r"    (prevLeft)
-				, [in]  "=r"    (dummy1)
-				, [out] "=r"    (dummy2)
-				, [n]   "=r"    (dummy3)
-				, [t]   "=&r"   (dummy4)
-				:       "[o]"   (outLeft)
-				,       "[p]"   (prevLeft)
-				,       "[in]"  (monoBuf)
-				,       "[out]" (output)
-				,       "[n]"   (samples)
-				, [m]   "r"     (0x7FFF)
-				: "memory"
-			);
-#else
-			for (unsigned j = 0; j < samples; ++j) {
-				int mono = monoBuf[j] >> 8;
-				outLeft   = mono -  prevLeft + ((511 *  outLeft) / 512);
-				prevLeft  = mono;
-				short out = Math::clipIntToShort(outLeft);
-				output[2 * j + 0] = out;
-				output[2 * j + 1] = out;
-			}
-#endif
-			outRight = outLeft;
-			prevRight = prevLeft;
-		} else {
-			for (unsigned j = 0; j < samples; ++j) {
-				int mono = monoBuf[j] >> 8;
-				outLeft   = mono -  prevLeft + ((511 *  outLeft) / 512);
-				prevLeft  = mono;
-				outRight  = mono - prevRight + ((511 * outRight) / 512);
-				prevRight = mono;
-				output[2 * j + 0] = Math::clipIntToShort(outLeft);
-				output[2 * j + 1] = Math::clipIntToShort(outRight);
-			}
-		}
-		break;
-
-	case HAS_STEREO_FLAG:
-		// only stereo
-		for (unsigned j = 0; j < samples; ++j) {
-			int left  = stereoBuf[2 * j + 0] >> 8;
-			int right = stereoBuf[2 * j + 1] >> 8;
-			outLeft   =  left -  prevLeft + ((511 *  outLeft) / 512);
-			prevLeft  =  left;
-			outRight  = right - prevRight + ((511 * outRight) / 512);
-			prevRight = right;
-			output[2 * j + 0] = Math::clipIntToShort(outLeft);
-			output[2 * j + 1] = Math::clipIntToShort(outRight);
-		}
-		break;
-
-	default:
-		// mono + stereo
-		for (unsigned j = 0; j < samples; ++j) {
-			int mono = monoBuf[j] >> 8;
-			int left  = (stereoBuf[2 * j + 0] >> 8) + mono;
-			int right = (stereoBuf[2 * j + 1] >> 8) + mono;
-			outLeft   =  left -  prevLeft + ((511 *  outLeft) / 512);
-			prevLeft  =  left;
-			outRight  = right - prevRight + ((511 * outRight) / 512);
-			prevRight = right;
-			output[2 * j + 0] = Math::clipIntToShort(outLeft);
-			output[2 * j + 1] = Math::clipIntToShort(outRight);
-		}
+	if (!hasInput && dcFilter.isSilent()) {
+		// output was already zero, after DC-filter it will still be
+		// zero
+		memset(output, 0, 2 * samples * sizeof(short));
+		return;
 	}
+	MixKernels::dcFilter(dcFilter, hasInput ? accBuf : nullptr,
+	                     output, samples);
 }
 
 bool MSXMixer::needStereoRecording() const
@@ -543,8 +306,7 @@ void MSXMixer::unmute()
 {
 	--muteCount;
 	if (muteCount == 0) {
-		prevLeft = outLeft = 0;
-		prevRight = outRight = 0;
+		dcFilter.reset();
 		mixer.registerMixer(*this);
 	}
 }
@@ -593,6 +355,40 @@ void MSXMixer::setRecorder(AviRecorder* newRecorder)
 	recorder = newRecorder;
 }
 
+void MSXMixer::startOfflineRendering(OutputListener& listener,
+                                     unsigned sampleRate)
+{
+	assert(!offlineListener);
+	offlineListener = &listener;
+	offlineSavedRate = hostSampleRate;
+	mute();
+	++synchronousCounter;
+	setMixerParams(fragmentSize, sampleRate);
+}
+
+void MSXMixer::stopOfflineRendering()
+{
+	assert(offlineListener);
+	assert(synchronousCounter > 0);
+	--synchronousCounter;
+	setMixerParams(fragmentSize, offlineSavedRate);
+	unmute();
+	offlineListener = nullptr;
+}
+
+bool MSXMixer::isCapturingRegisters() const
+{
+	return soundChipLogCommand->isCapturing();
+}
+
+void MSXMixer::logRegisterWrite(
+	const SoundDevice& device, const char* suffix,
+	unsigned address, byte value, EmuTime::param time)
+{
+	soundChipLogCommand->logWrite(
+		device.getName() + suffix, address, value, time);
+}
+
 unsigned MSXMixer::getSampleRate() const
 {
 	return hostSampleRate;
@@ -697,11 +493,11 @@ void MSXMixer::updateVolumeParams(SoundDeviceInfo& info)
 		r1 = volume * sqrt(std::max(0.0,       b));
 		l2 = r2 = 0.0; // dummy
 	}
-	int amp = 256 * info.device->getAmplificationFactor();
-	info.left1  = int(l1 * amp);
-	info.right1 = int(r1 * amp);
-	info.left2  = int(l2 * amp);
-	info.right2 = int(r2 * amp);
+	double amp = info.device->getAmplificationFactor();
+	info.left1  = float(l1 * amp);
+	info.right1 = float(r1 * amp);
+	info.left2  = float(l2 * amp);
+	info.right2 = float(r2 * amp);
 }
 
 void MSXMixer::updateMasterVolume()
@@ -728,6 +524,15 @@ SoundDevice* MSXMixer::findDevice(string_ref name) const
 	return (it != infos.end()) ? it->device : nullptr;
 }
 
+vector<SoundDevice*> MSXMixer::getDevices() const
+{
+	vector<SoundDevice*> result;
+	for (auto& info : infos) {
+		result.push_back(info.device);
+	}
+	return result;
+}
+
 SoundDeviceInfoTopic::SoundDeviceInfoTopic(
 		InfoCommand& machineInfoCommand, MSXMixer& mixer_)
 	: InfoTopic(machineInfoCommand, "sounddevice")
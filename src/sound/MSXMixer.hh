@@ -4,7 +4,9 @@
 #include "Schedulable.hh"
 #include "Observer.hh"
 #include "EmuTime.hh"
+#include "MixKernels.hh"
 #include "DynamicClock.hh"
+#include "openmsx.hh"
 #include <vector>
 #include <memory>
 
@@ -22,12 +24,23 @@ class StringSetting;
 class BooleanSetting;
 class Setting;
 class SoundDeviceInfoTopic;
+class SoundChipLogCommand;
 class AviRecorder;
 
 class MSXMixer : private Schedulable, private Observer<Setting>
                , private Observer<ThrottleManager>
 {
 public:
+	/** Receives a copy of every block of (stereo) samples generated by
+	  * this mixer, see startOfflineRendering().
+	  */
+	class OutputListener {
+	public:
+		virtual void mixerOutput(const short* buffer, unsigned samples) = 0;
+	protected:
+		~OutputListener() {}
+	};
+
 	MSXMixer(Mixer& mixer, Scheduler& scheduler,
 	         MSXCommandController& msxCommandController,
 	         GlobalSettings& globalSettings);
@@ -98,10 +111,24 @@ public:
 	bool needStereoRecording() const;
 	void setRecorder(AviRecorder* recorder);
 
+	/** Disconnect from the host sound driver and generate sound at the
+	  * given sample rate (at 100% emutime speed). Sound is only produced
+	  * when the caller explicitly calls updateStream(), so this can run
+	  * much faster than realtime. All output goes to the given listener.
+	  */
+	void startOfflineRendering(OutputListener& listener, unsigned sampleRate);
+	void stopOfflineRendering();
+
+	// Called by SoundDevice, see SoundDevice::logRegisterWrite()
+	bool isCapturingRegisters() const;
+	void logRegisterWrite(const SoundDevice& device, const char* suffix,
+	                      unsigned address, byte value, EmuTime::param time);
+
 	// Returns the nominal host sample rate (not adjusted for speed setting)
 	unsigned getSampleRate() const;
 
 	SoundDevice* findDevice(string_ref name) const;
+	std::vector<SoundDevice*> getDevices() const;
 
 	void reInit();
 
@@ -125,7 +152,7 @@ private:
 			std::unique_ptr<BooleanSetting> muteSetting;
 		};
 		std::vector<ChannelSettings> channelSettings;
-		int left1, right1, left2, right2;
+		float left1, right1, left2, right2;
 	};
 
 	void updateVolumeParams(SoundDeviceInfo& info);
@@ -162,13 +189,15 @@ private:
 
 	friend class SoundDeviceInfoTopic;
 	const std::unique_ptr<SoundDeviceInfoTopic> soundDeviceInfo;
+	const std::unique_ptr<SoundChipLogCommand> soundChipLogCommand;
 
 	AviRecorder* recorder;
+	OutputListener* offlineListener;
+	unsigned offlineSavedRate;
 	unsigned synchronousCounter;
 
 	unsigned muteCount;
-	int prevLeft, prevRight;
-	int outLeft, outRight;
+	MixKernels::DCFilter dcFilter;
 };
 
 } // namespace openmsx
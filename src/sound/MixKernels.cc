@@ -0,0 +1,169 @@
+#include "MixKernels.hh"
+#include "Math.hh"
+#include <cmath>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+namespace openmsx {
+namespace MixKernels {
+
+void addMono(float* acc, const int* in, unsigned num, float left, float right)
+{
+#if defined(__AVX__)
+	__m256 g = _mm256_setr_ps(left, right, left, right,
+	                          left, right, left, right);
+	for (unsigned i = 0; i < num; i += 8) {
+		__m256 x = _mm256_cvtepi32_ps(_mm256_loadu_si256(
+			reinterpret_cast<const __m256i*>(in + i)));
+		__m256 lo = _mm256_unpacklo_ps(x, x); // a a b b | e e f f
+		__m256 hi = _mm256_unpackhi_ps(x, x); // c c d d | g g h h
+		__m256 x0 = _mm256_permute2f128_ps(lo, hi, 0x20);
+		__m256 x1 = _mm256_permute2f128_ps(lo, hi, 0x31);
+		float* a = acc + 2 * i;
+		_mm256_storeu_ps(a + 0, _mm256_add_ps(
+			_mm256_loadu_ps(a + 0), _mm256_mul_ps(x0, g)));
+		_mm256_storeu_ps(a + 8, _mm256_add_ps(
+			_mm256_loadu_ps(a + 8), _mm256_mul_ps(x1, g)));
+	}
+#elif defined(__SSE2__)
+	__m128 g = _mm_setr_ps(left, right, left, right);
+	for (unsigned i = 0; i < num; i += 4) {
+		__m128 x = _mm_cvtepi32_ps(_mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(in + i)));
+		__m128 x0 = _mm_unpacklo_ps(x, x); // a a b b
+		__m128 x1 = _mm_unpackhi_ps(x, x); // c c d d
+		float* a = acc + 2 * i;
+		_mm_storeu_ps(a + 0, _mm_add_ps(
+			_mm_loadu_ps(a + 0), _mm_mul_ps(x0, g)));
+		_mm_storeu_ps(a + 4, _mm_add_ps(
+			_mm_loadu_ps(a + 4), _mm_mul_ps(x1, g)));
+	}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	float32x4_t g = {left, right, left, right};
+	for (unsigned i = 0; i < num; i += 4) {
+		float32x4_t x = vcvtq_f32_s32(vld1q_s32(in + i));
+		float32x4x2_t z = vzipq_f32(x, x); // a a b b, c c d d
+		float* a = acc + 2 * i;
+		vst1q_f32(a + 0, vmlaq_f32(vld1q_f32(a + 0), z.val[0], g));
+		vst1q_f32(a + 4, vmlaq_f32(vld1q_f32(a + 4), z.val[1], g));
+	}
+#else
+	for (unsigned i = 0; i < num; ++i) {
+		float x = float(in[i]);
+		acc[2 * i + 0] += left  * x;
+		acc[2 * i + 1] += right * x;
+	}
+#endif
+}
+
+void addStereo(float* acc, const int* in, unsigned num,
+               float l1, float r1, float l2, float r2)
+{
+	// Per frame (L,R): out = (L,R) * (l1,r2) + (R,L) * (l2,r1)
+#if defined(__AVX__)
+	__m256 g1 = _mm256_setr_ps(l1, r2, l1, r2, l1, r2, l1, r2);
+	__m256 g2 = _mm256_setr_ps(l2, r1, l2, r1, l2, r1, l2, r1);
+	for (unsigned i = 0; i < num; i += 4) {
+		__m256 x = _mm256_cvtepi32_ps(_mm256_loadu_si256(
+			reinterpret_cast<const __m256i*>(in + 2 * i)));
+		__m256 s = _mm256_permute_ps(x, 0xB1); // swap L/R
+		float* a = acc + 2 * i;
+		__m256 t = _mm256_add_ps(_mm256_loadu_ps(a), _mm256_mul_ps(x, g1));
+		_mm256_storeu_ps(a, _mm256_add_ps(t, _mm256_mul_ps(s, g2)));
+	}
+#elif defined(__SSE2__)
+	__m128 g1 = _mm_setr_ps(l1, r2, l1, r2);
+	__m128 g2 = _mm_setr_ps(l2, r1, l2, r1);
+	for (unsigned i = 0; i < num; i += 2) {
+		__m128 x = _mm_cvtepi32_ps(_mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(in + 2 * i)));
+		__m128 s = _mm_shuffle_ps(x, x, 0xB1); // swap L/R
+		float* a = acc + 2 * i;
+		__m128 t = _mm_add_ps(_mm_loadu_ps(a), _mm_mul_ps(x, g1));
+		_mm_storeu_ps(a, _mm_add_ps(t, _mm_mul_ps(s, g2)));
+	}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	float32x4_t g1 = {l1, r2, l1, r2};
+	float32x4_t g2 = {l2, r1, l2, r1};
+	for (unsigned i = 0; i < num; i += 2) {
+		float32x4_t x = vcvtq_f32_s32(vld1q_s32(in + 2 * i));
+		float32x4_t s = vrev64q_f32(x); // swap L/R
+		float* a = acc + 2 * i;
+		vst1q_f32(a, vmlaq_f32(vmlaq_f32(vld1q_f32(a), x, g1), s, g2));
+	}
+#else
+	for (unsigned i = 0; i < num; ++i) {
+		float inL = float(in[2 * i + 0]);
+		float inR = float(in[2 * i + 1]);
+		acc[2 * i + 0] += l1 * inL;
+		acc[2 * i + 1] += r2 * inR;
+		acc[2 * i + 0] += l2 * inR;
+		acc[2 * i + 1] += r1 * inL;
+	}
+#endif
+}
+
+void dcFilter(DCFilter& filter, const float* acc, short* out, unsigned num)
+{
+	// The filter is recursive, so it can't be vectorized over time. On
+	// x86 we still process the left and right channel in parallel and
+	// let packssdw do the clipping.
+	const float R = 511.0f / 512.0f;
+#ifdef __SSE2__
+	const __m128 r = _mm_set1_ps(R);
+	const __m128 zero = _mm_setzero_ps();
+	__m128 p = _mm_setr_ps(filter.prevLeft, filter.prevRight, 0.0f, 0.0f);
+	__m128 y = _mm_setr_ps(filter.outLeft,  filter.outRight,  0.0f, 0.0f);
+	for (unsigned i = 0; i < num; ++i) {
+		__m128 x = acc
+			? _mm_castpd_ps(_mm_load_sd(
+				reinterpret_cast<const double*>(acc + 2 * i)))
+			: zero;
+		y = _mm_add_ps(_mm_sub_ps(x, p), _mm_mul_ps(r, y));
+		p = x;
+		__m128i s = _mm_packs_epi32(_mm_cvtps_epi32(y), _mm_setzero_si128());
+		int lr = _mm_cvtsi128_si32(s);
+		memcpy(out + 2 * i, &lr, sizeof(lr));
+	}
+	float tmp[4];
+	_mm_storeu_ps(tmp, p);
+	filter.prevLeft = tmp[0]; filter.prevRight = tmp[1];
+	_mm_storeu_ps(tmp, y);
+	filter.outLeft  = tmp[0]; filter.outRight  = tmp[1];
+#else
+	float pL = filter.prevLeft, pR = filter.prevRight;
+	float yL = filter.outLeft,  yR = filter.outRight;
+	for (unsigned i = 0; i < num; ++i) {
+		float xL = acc ? acc[2 * i + 0] : 0.0f;
+		float xR = acc ? acc[2 * i + 1] : 0.0f;
+		yL = xL - pL + R * yL;
+		yR = xR - pR + R * yR;
+		pL = xL;
+		pR = xR;
+		out[2 * i + 0] = Math::clipIntToShort(int(lrintf(yL)));
+		out[2 * i + 1] = Math::clipIntToShort(int(lrintf(yR)));
+	}
+	filter.prevLeft = pL; filter.prevRight = pR;
+	filter.outLeft  = yL; filter.outRight  = yR;
+#endif
+
+	if (!acc && (std::abs(filter.outLeft)  < 0.5f) &&
+	            (std::abs(filter.outRight) < 0.5f)) {
+		// The output has decayed to (rounded) zero. Unlike the
+		// integer version of this filter, the float state never
+		// reaches zero by itself, so snap it. This lets the mixer
+		// take the fast path for silence.
+		filter.reset();
+	}
+}
+
+} // namespace MixKernels
+} // namespace openmsx
@@ -0,0 +1,61 @@
+#ifndef MIXKERNELS_HH
+#define MIXKERNELS_HH
+
+namespace openmsx {
+
+/** The inner loops of MSXMixer::generate(). All sound devices are mixed
+  * into a single (interleaved) stereo float accumulator, in one pass per
+  * device, with a per-device gain vector. Afterwards one fused pass
+  * applies the DC removal filter, clips and converts to 16-bit.
+  *
+  * There are SSE2, AVX and NEON versions (selected at compile time) and a
+  * plain c++ fallback. To avoid tail loops the SIMD versions may process
+  * up to PADDING frames more than requested, so both the input buffer and
+  * the accumulator must have room for 'num + PADDING' frames. No special
+  * alignment is required.
+  */
+namespace MixKernels {
+
+	static const unsigned PADDING = 8;
+
+	/** acc[2*i + 0] += left  * in[i]
+	  * acc[2*i + 1] += right * in[i]
+	  */
+	void addMono(float* acc, const int* in, unsigned num,
+	             float left, float right);
+
+	/** acc[2*i + 0] += l1 * in[2*i + 0] + l2 * in[2*i + 1]
+	  * acc[2*i + 1] += r1 * in[2*i + 0] + r2 * in[2*i + 1]
+	  */
+	void addStereo(float* acc, const int* in, unsigned num,
+	               float l1, float r1, float l2, float r2);
+
+	/** State of the DC removal filter:
+	  *   y(n) = x(n) - x(n-1) + R * y(n-1)
+	  *   R = 1 - (pi*2 * cut-off-frequency / samplerate)
+	  * take R = 511/512
+	  *   44100Hz --> cutt-off freq = 14Hz
+	  *   22050Hz                     7Hz
+	  */
+	struct DCFilter {
+		DCFilter() { reset(); }
+		void reset() { prevLeft = prevRight = outLeft = outRight = 0.0f; }
+		bool isSilent() const {
+			return (prevLeft == 0.0f) && (prevRight == 0.0f) &&
+			       (outLeft  == 0.0f) && (outRight  == 0.0f);
+		}
+		float prevLeft, prevRight;
+		float outLeft, outRight;
+	};
+
+	/** Run the DC filter over the (stereo) accumulator and write the
+	  * clipped and rounded result to 'out'. When 'acc' is null the input
+	  * is silence (only the filter state decays).
+	  */
+	void dcFilter(DCFilter& filter, const float* acc, short* out,
+	              unsigned num);
+
+} // namespace MixKernels
+} // namespace openmsx
+
+#endif
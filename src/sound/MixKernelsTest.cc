@@ -0,0 +1,105 @@
+// Micro-benchmark (and sanity check) for the MSXMixer inner loops.
+// Not part of the regular build, compile it manually, e.g. (one command):
+//   g++ -O3 -std=c++11 [-mavx] -Isrc -Isrc/sound -Isrc/utils
+//       -Iderived/<platform>-<flavour>/config
+//       src/sound/MixKernelsTest.cc src/sound/MixKernels.cc
+
+#include "MixKernels.hh"
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+using namespace openmsx;
+
+
+static const unsigned SAMPLES = 1024; // typical fragment size
+static const unsigned REPEAT = 2000;
+
+struct Device
+{
+	bool stereo;
+	float l1, r1, l2, r2;
+	vector<int> buf;
+};
+
+static vector<Device> createDevices(unsigned num)
+{
+	vector<Device> devices(num);
+	for (unsigned d = 0; d < num; ++d) {
+		auto& dev = devices[d];
+		dev.stereo = (d % 3) == 2; // mostly mono, like most machines
+		dev.l1 = 0.1f * (d + 1); dev.r1 = 0.05f * (d + 2);
+		dev.l2 = 0.02f * (d + 1); dev.r2 = 0.1f * (d + 3);
+		unsigned len = (dev.stereo ? 2 : 1) * (SAMPLES + MixKernels::PADDING);
+		dev.buf.resize(len);
+		for (auto& s : dev.buf) s = (rand() % 20001) - 10000;
+	}
+	return devices;
+}
+
+static void mix(const vector<Device>& devices, vector<float>& acc)
+{
+	fill(acc.begin(), acc.end(), 0.0f);
+	for (auto& dev : devices) {
+		if (dev.stereo) {
+			MixKernels::addStereo(acc.data(), dev.buf.data(), SAMPLES,
+			                      dev.l1, dev.r1, dev.l2, dev.r2);
+		} else {
+			MixKernels::addMono(acc.data(), dev.buf.data(), SAMPLES,
+			                    dev.l1, dev.r1);
+		}
+	}
+}
+
+static bool check(const vector<Device>& devices, const vector<float>& acc)
+{
+	for (unsigned i = 0; i < SAMPLES; ++i) {
+		double l = 0.0, r = 0.0;
+		for (auto& dev : devices) {
+			if (dev.stereo) {
+				double inL = dev.buf[2 * i + 0];
+				double inR = dev.buf[2 * i + 1];
+				l += dev.l1 * inL + dev.l2 * inR;
+				r += dev.r1 * inL + dev.r2 * inR;
+			} else {
+				l += dev.l1 * double(dev.buf[i]);
+				r += dev.r1 * double(dev.buf[i]);
+			}
+		}
+		if ((fabs(acc[2 * i + 0] - l) > 0.5) ||
+		    (fabs(acc[2 * i + 1] - r) > 0.5)) {
+			cout << "Mismatch at sample " << i << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+int main()
+{
+	vector<float> acc(2 * (SAMPLES + MixKernels::PADDING));
+	vector<short> out(2 * SAMPLES);
+	MixKernels::DCFilter filter;
+	bool ok = true;
+
+	cout << "devices  ns/sample (mix + dc-filter)" << endl;
+	for (unsigned num = 1; num <= 12; ++num) {
+		auto devices = createDevices(num);
+		mix(devices, acc);
+		ok &= check(devices, acc);
+
+		auto start = chrono::high_resolution_clock::now();
+		for (unsigned r = 0; r < REPEAT; ++r) {
+			mix(devices, acc);
+			MixKernels::dcFilter(filter, acc.data(), out.data(), SAMPLES);
+		}
+		auto stop = chrono::high_resolution_clock::now();
+		double ns = chrono::duration<double, nano>(stop - start).count();
+		cout << "   " << (num < 10 ? " " : "") << num << "    "
+		     << ns / (double(REPEAT) * SAMPLES) << endl;
+	}
+	return ok ? 0 : 1;
+}
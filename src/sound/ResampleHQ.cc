@@ -26,6 +26,12 @@
 #ifdef __SSE2__
 #include <emmintrin.h>
 #endif
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
 
 namespace openmsx {
 
@@ -40,6 +46,18 @@ static const int INDEX_INC = 128;
 static const int COEFF_LEN = countof(coeffs);
 static const int COEFF_HALF_LEN = COEFF_LEN - 1;
 static const unsigned TAB_LEN = 4096;
+#ifdef __AVX__
+// the AVX routines process 8 coefficients at a time
+static const unsigned FILTER_ALIGN = 8;
+static const unsigned TABLE_ALIGN = 32;
+#else
+static const unsigned FILTER_ALIGN = 4;
+static const unsigned TABLE_ALIGN = 16;
+#endif
+// Tables that are no longer used are kept around for a while, typically
+// they're needed again soon (e.g. when the sample rate or the resampler
+// setting is changed back, or when a similar machine is created).
+static const unsigned MAX_UNUSED_TABLES = 4;
 
 class ResampleCoeffs : private noncopyable
 {
@@ -63,16 +81,21 @@ private:
 		unsigned filterLen;
 		unsigned count;
 	};
-	std::vector<Element> cache; // typically 1-4 entries -> unsorted vector
+	std::vector<Element> cache; // typically 1-8 entries -> unsorted vector
+	unsigned unused; // number of entries with count == 0
 };
 
 ResampleCoeffs::ResampleCoeffs()
+	: unused(0)
 {
 }
 
 ResampleCoeffs::~ResampleCoeffs()
 {
-	assert(cache.empty());
+	for (auto& e : cache) {
+		assert(e.count == 0);
+		MemoryOps::freeAligned(e.table);
+	}
 }
 
 ResampleCoeffs& ResampleCoeffs::instance()
@@ -89,7 +112,7 @@ void ResampleCoeffs::getCoeffs(
 	if (it != cache.end()) {
 		table     = it->table;
 		filterLen = it->filterLen;
-		it->count++;
+		if (it->count++ == 0) --unused;
 		return;
 	}
 	calcTable(ratio, table, filterLen);
@@ -102,10 +125,18 @@ void ResampleCoeffs::releaseCoeffs(double ratio)
 		[=](const Element& e) { return e.ratio == ratio; });
 	assert(it != cache.end());
 	it->count--;
-	if (it->count == 0) {
-		MemoryOps::freeAligned(it->table);
-		*it = cache.back(); // move last element here
+	if (it->count != 0) return;
+
+	if (++unused > MAX_UNUSED_TABLES) {
+		// drop an arbitrary unused table (not the one just released)
+		auto it2 = find_if(cache.begin(), cache.end(),
+			[=](const Element& e) {
+				return (e.count == 0) && (e.ratio != ratio); });
+		assert(it2 != cache.end());
+		MemoryOps::freeAligned(it2->table);
+		*it2 = cache.back(); // move last element here
 		cache.pop_back();   // and erase last
+		--unused;
 	}
 }
 
@@ -128,10 +159,11 @@ void ResampleCoeffs::calcTable(
 	int min_idx = -maxFilterIndex.divAsInt(increment);
 	int max_idx = 1 + (maxFilterIndex - (increment - FilterIndex(floatIncr))).divAsInt(increment);
 	int idx_cnt = max_idx - min_idx + 1;
-	filterLen = (idx_cnt + 3) & ~3; // round up to multiple of 4
+	// round up to multiple of FILTER_ALIGN
+	filterLen = (idx_cnt + FILTER_ALIGN - 1) & ~(FILTER_ALIGN - 1);
 	min_idx -= (filterLen - idx_cnt);
 	table = static_cast<float*>(MemoryOps::mallocAligned(
-		16, TAB_LEN * filterLen * sizeof(float)));
+		TABLE_ALIGN, TAB_LEN * filterLen * sizeof(float)));
 	memset(table, 0, TAB_LEN * filterLen * sizeof(float));
 
 	for (unsigned t = 0; t < TAB_LEN; ++t) {
@@ -296,6 +328,110 @@ static inline void calcSseStereo(const float* buf_, const float* tab_, long len,
 }
 #endif
 
+#ifdef __AVX__
+static inline void calcAvxMono(const float* buf, const float* tab, long len, int* out)
+{
+	assert((len % 8) == 0);
+	assert((uintptr_t(tab) % 32) == 0);
+
+	__m256 a0 = _mm256_setzero_ps();
+	__m256 a1 = _mm256_setzero_ps();
+	long i = 0;
+	for (/**/; i < (len & ~15); i += 16) {
+		__m256 b0 = _mm256_loadu_ps(buf + i + 0);
+		__m256 b1 = _mm256_loadu_ps(buf + i + 8);
+		__m256 t0 = _mm256_load_ps (tab + i + 0);
+		__m256 t1 = _mm256_load_ps (tab + i + 8);
+		a0 = _mm256_add_ps(a0, _mm256_mul_ps(b0, t0));
+		a1 = _mm256_add_ps(a1, _mm256_mul_ps(b1, t1));
+	}
+	if (len & 8) {
+		__m256 b0 = _mm256_loadu_ps(buf + i);
+		__m256 t0 = _mm256_load_ps (tab + i);
+		a0 = _mm256_add_ps(a0, _mm256_mul_ps(b0, t0));
+	}
+
+	__m256 a = _mm256_add_ps(a0, a1);
+	__m128 h = _mm_add_ps(_mm256_castps256_ps128(a),
+	                      _mm256_extractf128_ps(a, 1));
+	__m128 t = _mm_add_ps(h, _mm_movehl_ps(h, h));
+	__m128 s = _mm_add_ss(t, _mm_shuffle_ps(t, t, 1));
+	*out = _mm_cvtss_si32(s);
+}
+
+// duplicate 4 coefficients (t0 t1 t2 t3) to (t0 t0 t1 t1 t2 t2 t3 t3)
+static inline __m256 dupTaps(const float* tab)
+{
+	__m128 t = _mm_load_ps(tab);
+	__m128 lo = _mm_unpacklo_ps(t, t);
+	__m128 hi = _mm_unpackhi_ps(t, t);
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+}
+static inline void calcAvxStereo(const float* buf, const float* tab, long len, int* out)
+{
+	assert((len % 8) == 0);
+	assert((uintptr_t(tab) % 32) == 0);
+
+	__m256 a0 = _mm256_setzero_ps();
+	__m256 a1 = _mm256_setzero_ps();
+	for (long i = 0; i < len; i += 8) {
+		__m256 b0 = _mm256_loadu_ps(buf + 2 * i + 0);
+		__m256 b1 = _mm256_loadu_ps(buf + 2 * i + 8);
+		__m256 t0 = dupTaps(tab + i + 0);
+		__m256 t1 = dupTaps(tab + i + 4);
+		a0 = _mm256_add_ps(a0, _mm256_mul_ps(b0, t0));
+		a1 = _mm256_add_ps(a1, _mm256_mul_ps(b1, t1));
+	}
+
+	__m256 a = _mm256_add_ps(a0, a1);
+	__m128 h = _mm_add_ps(_mm256_castps256_ps128(a),
+	                      _mm256_extractf128_ps(a, 1));
+	__m128 s = _mm_add_ps(h, _mm_movehl_ps(h, h));
+	__m128i si = _mm_cvtps_epi32(s);
+	out[0] = _mm_cvtsi128_si32(si);
+	out[1] = _mm_cvtsi128_si32(_mm_shuffle_epi32(si, 0x55));
+}
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+static inline float hsum(float32x4_t a)
+{
+	float32x2_t s = vadd_f32(vget_low_f32(a), vget_high_f32(a));
+	return vget_lane_f32(vpadd_f32(s, s), 0);
+}
+static inline void calcNeonMono(const float* buf, const float* tab, long len, int* out)
+{
+	assert((len % 4) == 0);
+
+	float32x4_t a0 = vdupq_n_f32(0.0f);
+	float32x4_t a1 = vdupq_n_f32(0.0f);
+	long i = 0;
+	for (/**/; i < (len & ~7); i += 8) {
+		a0 = vmlaq_f32(a0, vld1q_f32(buf + i + 0), vld1q_f32(tab + i + 0));
+		a1 = vmlaq_f32(a1, vld1q_f32(buf + i + 4), vld1q_f32(tab + i + 4));
+	}
+	if (len & 4) {
+		a0 = vmlaq_f32(a0, vld1q_f32(buf + i), vld1q_f32(tab + i));
+	}
+	*out = lrint(hsum(vaddq_f32(a0, a1)));
+}
+static inline void calcNeonStereo(const float* buf, const float* tab, long len, int* out)
+{
+	assert((len % 4) == 0);
+
+	float32x4_t l = vdupq_n_f32(0.0f);
+	float32x4_t r = vdupq_n_f32(0.0f);
+	for (long i = 0; i < len; i += 4) {
+		float32x4x2_t b = vld2q_f32(buf + 2 * i); // deinterleave L/R
+		float32x4_t t = vld1q_f32(tab + i);
+		l = vmlaq_f32(l, b.val[0], t);
+		r = vmlaq_f32(r, b.val[1], t);
+	}
+	out[0] = lrint(hsum(l));
+	out[1] = lrint(hsum(r));
+}
+#endif
+
 template <unsigned CHANNELS>
 void ResampleHQ<CHANNELS>::calcOutput(
 	float pos, int* __restrict output)
@@ -310,13 +446,27 @@ void ResampleHQ<CHANNELS>::calcOutput(
 	bufIdx *= CHANNELS;
 	const float* buf = &buffer[bufIdx];
 
-#ifdef __SSE2__
+#if defined(__AVX__)
+	if (CHANNELS == 1) {
+		calcAvxMono  (buf, tab, filterLen, output);
+	} else {
+		calcAvxStereo(buf, tab, filterLen, output);
+	}
+	return;
+#elif defined(__SSE2__)
 	if (CHANNELS == 1) {
 		calcSseMono  (buf, tab, filterLen, output);
 	} else {
 		calcSseStereo(buf, tab, filterLen, output);
 	}
 	return;
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	if (CHANNELS == 1) {
+		calcNeonMono  (buf, tab, filterLen, output);
+	} else {
+		calcNeonStereo(buf, tab, filterLen, output);
+	}
+	return;
 #endif
 
 	// c++ version, both mono and stereo
@@ -7,6 +7,8 @@
 #include "Reactor.hh"
 #include "GlobalSettings.hh"
 #include "EnumSetting.hh"
+#include "Timer.hh"
+#include "likely.hh"
 #include "unreachable.hh"
 #include "memory.hh"
 #include <cassert>
@@ -19,6 +21,9 @@ ResampledSoundDevice::ResampledSoundDevice(
 		bool stereo)
 	: SoundDevice(motherBoard.getMSXMixer(), name, description, channels, stereo)
 	, resampleSetting(motherBoard.getReactor().getGlobalSettings().getResampleSetting())
+	, generateTime(0)
+	, totalTime(0)
+	, profiling(false)
 {
 	resampleSetting.attach(*this);
 }
@@ -37,12 +42,33 @@ void ResampledSoundDevice::setOutputRate(unsigned /*sampleRate*/)
 bool ResampledSoundDevice::updateBuffer(unsigned length, int* buffer,
                                         EmuTime::param time)
 {
-	return algo->generateOutput(buffer, length, time);
+	if (likely(!profiling)) {
+		return algo->generateOutput(buffer, length, time);
+	}
+	uint64_t start = Timer::getTime();
+	bool result = algo->generateOutput(buffer, length, time);
+	totalTime += Timer::getTime() - start;
+	return result;
 }
 
 bool ResampledSoundDevice::generateInput(int* buffer, unsigned num)
 {
-	return mixChannels(buffer, num);
+	if (likely(!profiling)) {
+		return mixChannels(buffer, num);
+	}
+	uint64_t start = Timer::getTime();
+	bool result = mixChannels(buffer, num);
+	generateTime += Timer::getTime() - start;
+	return result;
+}
+
+void ResampledSoundDevice::setProfiling(bool enabled)
+{
+	profiling = enabled;
+	if (enabled) {
+		generateTime = 0;
+		totalTime = 0;
+	}
 }
 
 
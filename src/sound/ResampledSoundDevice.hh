@@ -4,6 +4,7 @@
 #include "SoundDevice.hh"
 #include "Observer.hh"
 #include <memory>
+#include <cstdint>
 
 namespace openmsx {
 
@@ -23,6 +24,16 @@ public:
 	  */
 	bool generateInput(int* buffer, unsigned num);
 
+	/** Enable (and reset) or disable measuring the (real) time spent in
+	  * this device. Used by 'soundchip_replay -profile'.
+	  */
+	void setProfiling(bool enabled);
+	/** Time (in us) spent generating samples at the native rate. */
+	uint64_t getGenerateTime() const { return generateTime; }
+	/** Time (in us) spent resampling to the host rate (excludes the
+	  * generate time). */
+	uint64_t getResampleTime() const { return totalTime - generateTime; }
+
 protected:
 	ResampledSoundDevice(MSXMotherBoard& motherBoard, string_ref name,
 	                     string_ref description, unsigned channels,
@@ -42,6 +53,9 @@ protected:
 private:
 	EnumSetting<ResampleType>& resampleSetting;
 	std::unique_ptr<ResampleAlgo> algo;
+	uint64_t generateTime;
+	uint64_t totalTime;
+	bool profiling;
 };
 
 } // namespace openmsx
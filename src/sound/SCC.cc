@@ -132,6 +132,7 @@ SCC::SCC(const string& name, const DeviceConfig& config,
 		config.getMotherBoard(), *this))
 	, deformTimer(time)
 	, currentChipMode(mode)
+	, loggedMode(-1)
 {
 	// Make valgrind happy
 	for (int i = 0; i < 5; ++i) {
@@ -205,6 +206,23 @@ void SCC::setChipMode(ChipMode newMode)
 	currentChipMode = newMode;
 }
 
+void SCC::startRegisterLog()
+{
+	loggedMode = -1;
+}
+
+void SCC::logWrite(unsigned address, byte value, EmuTime::param time)
+{
+	// The chip mode changes without a time, it only matters for the
+	// following writes, so log it just before the next write. In the
+	// debuggable it's the (otherwise unused) address 0xE0.
+	if (unlikely(loggedMode != currentChipMode)) {
+		loggedMode = currentChipMode;
+		logRegisterWrite(" SCC", 0xE0, currentChipMode, time);
+	}
+	logRegisterWrite(" SCC", address, value, time);
+}
+
 byte SCC::readMem(byte addr, EmuTime::param time)
 {
 	// Deform-register locations:
@@ -310,7 +328,7 @@ void SCC::writeMem(byte address, byte value, EmuTime::param time)
 	case SCC_Real:
 		if (address < 0x80) {
 			// 0x00..0x7F : write wave form 1..4
-			writeWave(address >> 5, address, value);
+			writeWave(address >> 5, address, value, time);
 		} else if (address < 0xA0) {
 			// 0x80..0x9F : freq volume block
 			setFreqVol(address, value, time);
@@ -324,7 +342,7 @@ void SCC::writeMem(byte address, byte value, EmuTime::param time)
 	case SCC_Compatible:
 		if (address < 0x80) {
 			// 0x00..0x7F : write wave form 1..4
-			writeWave(address >> 5, address, value);
+			writeWave(address >> 5, address, value, time);
 		} else if (address < 0xA0) {
 			// 0x80..0x9F : freq volume block
 			setFreqVol(address, value, time);
@@ -340,7 +358,7 @@ void SCC::writeMem(byte address, byte value, EmuTime::param time)
 	case SCC_plusmode:
 		if (address < 0xA0) {
 			// 0x00..0x9F : write wave form 1..5
-			writeWave(address >> 5, address, value);
+			writeWave(address >> 5, address, value, time);
 		} else if (address < 0xC0) {
 			// 0xA0..0xBF : freq volume block
 			setFreqVol(address, value, time);
@@ -366,11 +384,13 @@ inline int SCC::adjust(signed char wav, byte vol)
 	return (int(wav) * vol) >> 4;
 }
 
-void SCC::writeWave(unsigned channel, unsigned address, byte value)
+void SCC::writeWave(unsigned channel, unsigned address, byte value,
+                    EmuTime::param time)
 {
 	// write to channel 5 only possible in SCC+ mode
 	assert(channel < 5);
 	assert((channel != 4) || (currentChipMode == SCC_plusmode));
+	logWrite((channel << 5) | (address & 0x1F), value, time);
 
 	if (!readOnly[channel]) {
 		unsigned pos = address & 0x1F;
@@ -387,6 +407,7 @@ void SCC::writeWave(unsigned channel, unsigned address, byte value)
 void SCC::setFreqVol(unsigned address, byte value, EmuTime::param time)
 {
 	address &= 0x0F; // region is visible twice
+	logWrite(0xA0 | address, value, time);
 	if (address < 0x0A) {
 		// change frequency
 		unsigned channel = address / 2;
@@ -429,6 +450,7 @@ void SCC::setFreqVol(unsigned address, byte value, EmuTime::param time)
 
 void SCC::setDeformReg(byte value, EmuTime::param time)
 {
+	logWrite(0xC0, value, time);
 	if (value == deformValue) {
 		return;
 	}
@@ -485,67 +507,44 @@ void SCC::generateChannels(int** bufs, unsigned num)
 	unsigned enable = ch_enable;
 	for (unsigned i = 0; i < 5; ++i, enable >>= 1) {
 		if ((enable & 1) && (volume[i] || out[i])) {
-#ifdef __arm__
-			unsigned dummy;
+			// Instead of stepping sample by sample, calculate the
+			// number of samples till the next waveform position
+			// and fill that (constant) run in one go.
 			int* buf = bufs[i];
-			asm volatile (
-			"0:\n\t"
-				"ldr	%[T],[%[B]]\n\t"
-				"add	%[T],%[T],%[O]\n\t"
-				"add	%[C],%[C],%[I]\n\t"
-				"str	%[T],[%[B]],#4\n\t"
-				"subs	%[T],%[C],%[PE]\n\t"
-				"bpl	2f\n"
-			"1:\n\t"
-				"cmp	%[B],%[E]\n\t"
-				"bne	0b\n\t"
-				"b	3f\n"
-			"2:\n\t"
-				"adds	%[PO],%[PO],#1\n\t"
-				"subs	%[T],%[T],%[PE]\n\t"
-				"bpl	2b\n\t"
-				"and	%[PO],%[PO],#31\n\t"
-				"add	%[C],%[T],%[PE]\n\t"
-				"ldr	%[O],[%[V],%[PO],LSL #2]\n\t"
-				"b	1b\n"
-			"3:\n\t"
-
-				: [T]  "=&r"  (dummy)
-				, [B]  "=r"   (buf)
-				, [O]  "=r"   (out[i])
-				, [C]  "=r"   (count[i])
-				, [PO] "=r"   (pos[i])
-				:      "[B]"  (buf)
-				,      "[O]"  (out[i])
-				,      "[C]"  (count[i])
-				, [I]  "r"    (incr[i])
-				, [PE] "r"    (period[i] + 1)
-				, [E]  "r"    (&buf[num])
-				,      "[PO]" (pos[i])
-				, [V]  "r"    (volAdjustedWave[i])
-				: "memory", "cc"
-			);
-#else
 			int out2 = out[i];
 			unsigned count2 = count[i];
 			unsigned pos2 = pos[i];
 			unsigned incr2 = incr[i];
 			unsigned period2 = period[i] + 1;
-			for (unsigned j = 0; j < num; ++j) {
-				bufs[i][j] += out2;
-				count2 += incr2;
+			unsigned remaining = num;
+			while (remaining) {
+				// The sample in which the counter reaches the
+				// period still uses the old output. (The counter
+				// can already be beyond the period, e.g. after
+				// loading a savestate.) With incr == 0 (very
+				// small period) the output is frozen.
+				unsigned next = (count2 >= period2) ? 1
+				              : incr2 ? (period2 - count2 + incr2 - 1) / incr2
+				              : remaining + 1;
+				if (next > remaining) {
+					addFill(buf, out2, remaining);
+					count2 += remaining * incr2;
+					break;
+				}
+				addFill(buf, out2, next);
+				remaining -= next;
+				count2 += next * incr2;
 				// Note: only for very small periods
 				//       this will take more than 1 iteration
-				while (unlikely(count2 >= period2)) {
+				do {
 					count2 -= period2;
 					pos2 = (pos2 + 1) % 32;
-					out2 = volAdjustedWave[i][pos2];
-				}
+				} while (unlikely(count2 >= period2));
+				out2 = volAdjustedWave[i][pos2];
 			}
 			out[i] = out2;
 			count[i] = count2;
 			pos[i] = pos2;
-#endif
 		} else {
 			bufs[i] = nullptr; // channel muted
 			// Update phase counter.
@@ -579,6 +578,9 @@ byte SCCDebuggable::read(unsigned address, EmuTime::param time)
 	} else if (address < 0xE0) {
 		// peek deformation register
 		return scc.deformValue;
+	} else if (address == 0xE0) {
+		// chip mode (not a real register, see SCC::logWrite())
+		return scc.currentChipMode;
 	} else {
 		return 0xFF;
 	}
@@ -587,14 +589,24 @@ byte SCCDebuggable::read(unsigned address, EmuTime::param time)
 void SCCDebuggable::write(unsigned address, byte value, EmuTime::param time)
 {
 	if (address < 0xA0) {
-		// read wave form 1..5
-		scc.writeWave(address >> 5, address, value);
+		// write wave form 1..5 (wave form 5 only in SCC+ mode)
+		if ((address < 0x80) ||
+		    (scc.currentChipMode == SCC::SCC_plusmode)) {
+			scc.writeWave(address >> 5, address, value, time);
+		}
 	} else if (address < 0xC0) {
 		// freq volume block
 		scc.setFreqVol(address, value, time);
 	} else if (address < 0xE0) {
 		// deformation register
 		scc.setDeformReg(value, time);
+	} else if (address == 0xE0) {
+		// chip mode, can't switch between a real SCC and an SCC+
+		if ((value <= SCC::SCC_plusmode) &&
+		    ((scc.currentChipMode == SCC::SCC_Real) ==
+		     (value == SCC::SCC_Real))) {
+			scc.setChipMode(SCC::ChipMode(value));
+		}
 	} else {
 		// ignore
 	}
@@ -34,14 +34,17 @@ private:
 	// SoundDevice
 	virtual int getAmplificationFactor() const;
 	virtual void generateChannels(int** bufs, unsigned num);
+	virtual void startRegisterLog();
 
 	inline int adjust(signed char wav, byte vol);
 	byte readWave(unsigned channel, unsigned address, EmuTime::param time) const;
-	void writeWave(unsigned channel, unsigned offset, byte value);
+	void writeWave(unsigned channel, unsigned offset, byte value,
+	               EmuTime::param time);
 	void setDeformReg(byte value, EmuTime::param time);
 	void setDeformRegHelper(byte value);
 	void setFreqVol(unsigned address, byte value, EmuTime::param time);
 	byte getFreqVol(unsigned address) const;
+	void logWrite(unsigned address, byte value, EmuTime::param time);
 
 	static const int CLOCK_FREQ = 3579545;
 
@@ -50,6 +53,7 @@ private:
 
 	Clock<CLOCK_FREQ> deformTimer;
 	ChipMode currentChipMode;
+	int loggedMode; // chip mode as last logged, -1 if not yet logged
 
 	signed char wave[5][32];
 	int volAdjustedWave[5][32];
@@ -4,23 +4,58 @@
 #include "RealTime.hh"
 #include "GlobalSettings.hh"
 #include "ThrottleManager.hh"
+#include "InfoTopic.hh"
+#include "TclObject.hh"
 #include "MSXException.hh"
 #include "Math.hh"
 #include "StringOp.hh"
 #include "Timer.hh"
+#include "vla.hh"
+#include "memory.hh"
 #include "build-info.hh"
 #include <SDL.h>
 #include <algorithm>
 #include <cassert>
 #include <cstring>
 
+using std::string;
+using std::vector;
+
 namespace openmsx {
 
+// Maximum deviation from the nominal rate used to compensate for the drift
+// between the emulation and the audio clock. 0.5% is not audible.
+static const double MAX_RATIO_ADJUST = 0.005;
+// How strongly the rate reacts to the fill level (relative to buffer size).
+static const double RATIO_GAIN = 0.01;
+
+class SoundBufferInfo : public InfoTopic
+{
+public:
+	SoundBufferInfo(InfoCommand& openMSXInfoCommand, SDLSoundDriver& driver);
+	virtual void execute(const vector<TclObject>& tokens,
+	                     TclObject& result) const;
+	virtual string help(const vector<string>& tokens) const;
+private:
+	SDLSoundDriver& driver;
+};
+
+
 SDLSoundDriver::SDLSoundDriver(Reactor& reactor_,
                                unsigned wantedFreq, unsigned wantedSamples)
 	: reactor(reactor_)
+	, readIdx(0)
+	, writeIdx(0)
+	, resamplePos(0.0)
+	, ratio(1.0)
+	, prevLeft(0), prevRight(0)
+	, underruns(0)
+	, bufferInfo(make_unique<SoundBufferInfo>(
+		reactor.getOpenMSXInfoCommand(), *this))
 	, muted(true)
 {
+	for (auto& h : histogram) h = 0;
+
 	SDL_AudioSpec desired;
 	desired.freq     = wantedFreq;
 	desired.samples  = Math::powerOfTwo(wantedSamples);
@@ -57,10 +92,14 @@ SDLSoundDriver::~SDLSoundDriver()
 
 void SDLSoundDriver::reInit()
 {
+	// only called while the audio callback is paused
 	SDL_LockAudio();
 	readIdx  = 0;
 	writeIdx = 0;
 	SDL_UnlockAudio();
+	resamplePos = 0.0;
+	ratio = 1.0;
+	prevLeft = prevRight = 0;
 }
 
 void SDLSoundDriver::mute()
@@ -97,21 +136,21 @@ void SDLSoundDriver::audioCallbackHelper(void* userdata, byte* strm, int len)
 		audioCallback(reinterpret_cast<short*>(strm), len / sizeof(short));
 }
 
-unsigned SDLSoundDriver::getBufferFilled() const
+unsigned SDLSoundDriver::getBufferFilled(unsigned read, unsigned write) const
 {
-	int result = writeIdx - readIdx;
+	int result = write - read;
 	if (result < 0) result += unsigned(mixBuffer.size());
 	assert((0 <= result) && (unsigned(result) < mixBuffer.size()));
 	return result;
 }
 
-unsigned SDLSoundDriver::getBufferFree() const
+unsigned SDLSoundDriver::getBufferFree(unsigned read, unsigned write) const
 {
 	// we can't distinguish completely filled from completely empty
 	// (in both cases readIx would be equal to writeIdx), so instead
 	// we define full as '(writeIdx + 2) == readIdx' (note that index
 	// increases in steps of 2 (stereo)).
-	int result = unsigned(mixBuffer.size()) - 2 - getBufferFilled();
+	int result = unsigned(mixBuffer.size()) - 2 - getBufferFilled(read, write);
 	assert((0 <= result) && (unsigned(result) < mixBuffer.size()));
 	return result;
 }
@@ -119,42 +158,99 @@ unsigned SDLSoundDriver::getBufferFree() const
 void SDLSoundDriver::audioCallback(short* stream, unsigned len)
 {
 	assert((len & 1) == 0); // stereo
-	unsigned available = getBufferFilled();
-	//PRT_DEBUG("DEBUG callback: " << available);
+	unsigned read = readIdx.load(std::memory_order_relaxed);
+	unsigned write = writeIdx.load(std::memory_order_acquire);
+	unsigned available = getBufferFilled(read, write);
+	unsigned size = unsigned(mixBuffer.size());
+	histogram[std::min(available * HISTOGRAM_BINS / size,
+	                   HISTOGRAM_BINS - 1)].fetch_add(
+		1, std::memory_order_relaxed);
+
 	unsigned num = std::min(len, available);
-	if ((readIdx + num) < mixBuffer.size()) {
-		memcpy(stream, &mixBuffer[readIdx], num * sizeof(short));
-		readIdx += num;
+	if ((read + num) < size) {
+		memcpy(stream, &mixBuffer[read], num * sizeof(short));
+		read += num;
 	} else {
-		unsigned len1 = unsigned(mixBuffer.size()) - readIdx;
-		memcpy(stream, &mixBuffer[readIdx], len1 * sizeof(short));
+		unsigned len1 = size - read;
+		memcpy(stream, &mixBuffer[read], len1 * sizeof(short));
 		unsigned len2 = num - len1;
 		memcpy(&stream[len1], &mixBuffer[0], len2 * sizeof(short));
-		readIdx = len2;
+		read = len2;
 	}
+	readIdx.store(read, std::memory_order_release);
+
 	int missing = len - available;
 	if (missing > 0) {
 		// buffer underrun
-		//PRT_DEBUG("DEBUG underrun: " << missing);
+		underruns.fetch_add(1, std::memory_order_relaxed);
 		memset(&stream[available], 0, missing * sizeof(short));
 	}
 }
 
+unsigned SDLSoundDriver::resample(const short* in, unsigned len, short* out)
+{
+	// Linear interpolation between consecutive (stereo) input samples.
+	// Input sample -1 is the last sample of the previous call. The
+	// fractional position is carried over to the next call.
+	unsigned num = 0;
+	double pos = resamplePos - 1.0;
+	double end = double(len) - 1.0;
+	while (pos < end) {
+		int i = int(pos + 1.0) - 1; // floor, also for pos in [-1, 0)
+		double frac = pos - i;
+		int l0 = (i < 0) ? prevLeft  : in[2 * i + 0];
+		int r0 = (i < 0) ? prevRight : in[2 * i + 1];
+		int l1 = in[2 * (i + 1) + 0];
+		int r1 = in[2 * (i + 1) + 1];
+		out[2 * num + 0] = short(l0 + int(frac * (l1 - l0)));
+		out[2 * num + 1] = short(r0 + int(frac * (r1 - r0)));
+		++num;
+		pos += ratio;
+	}
+	resamplePos = pos - end;
+	prevLeft  = in[2 * (len - 1) + 0];
+	prevRight = in[2 * (len - 1) + 1];
+	return num;
+}
+
 void SDLSoundDriver::uploadBuffer(short* buffer, unsigned len)
 {
-	SDL_LockAudio();
-	len *= 2; // stereo
-	unsigned free = getBufferFree();
+	if (len == 0) return;
+
+	// Fine-tune the rate at which we consume the emulated samples, so
+	// that the fill level of the ring buffer stays around its middle.
+	// This compensates the (small) drift between the emulation clock
+	// and the audio hardware clock, so that a small buffer (low
+	// latency) doesn't underrun or overflow in the long run.
+	unsigned size = unsigned(mixBuffer.size());
+	unsigned filled = getBufferFilled(
+		readIdx.load(std::memory_order_acquire),
+		writeIdx.load(std::memory_order_relaxed));
+	double error = (double(filled) - double(size / 2)) / size;
+	ratio = 1.0 + std::max(-MAX_RATIO_ADJUST,
+	                       std::min(MAX_RATIO_ADJUST, error * RATIO_GAIN));
+
+	VLA(short, resampled, 2 * (len + len / 64 + 2));
+	unsigned num = resample(buffer, len, resampled);
+	write(resampled, 2 * num); // stereo
+}
+
+void SDLSoundDriver::write(const short* buffer, unsigned len)
+{
+	unsigned size = unsigned(mixBuffer.size());
+	unsigned write = writeIdx.load(std::memory_order_relaxed);
+	unsigned free = getBufferFree(
+		readIdx.load(std::memory_order_acquire), write);
 	if (len > free) {
 		if (reactor.getGlobalSettings().getThrottleManager().isThrottled()) {
 			do {
-				SDL_UnlockAudio();
-				Timer::sleep(5000); // 5ms
-				SDL_LockAudio();
+				Timer::sleep(1000); // 1ms
 				if (MSXMotherBoard* board = reactor.getMotherBoard()) {
 					board->getRealTime().resync();
 				}
-				free = getBufferFree();
+				free = getBufferFree(
+					readIdx.load(std::memory_order_acquire),
+					write);
 			} while (len > free);
 		} else {
 			// drop excess samples
@@ -162,18 +258,57 @@ void SDLSoundDriver::uploadBuffer(short* buffer, unsigned len)
 		}
 	}
 	assert(len <= free);
-	if ((writeIdx + len) < mixBuffer.size()) {
-		memcpy(&mixBuffer[writeIdx], buffer, len * sizeof(short));
-		writeIdx += len;
+	if ((write + len) < size) {
+		memcpy(&mixBuffer[write], buffer, len * sizeof(short));
+		write += len;
 	} else {
-		unsigned len1 = unsigned(mixBuffer.size()) - writeIdx;
-		memcpy(&mixBuffer[writeIdx], buffer, len1 * sizeof(short));
+		unsigned len1 = size - write;
+		memcpy(&mixBuffer[write], buffer, len1 * sizeof(short));
 		unsigned len2 = len - len1;
 		memcpy(&mixBuffer[0], &buffer[len1], len2 * sizeof(short));
-		writeIdx = len2;
+		write = len2;
 	}
+	writeIdx.store(write, std::memory_order_release);
+}
 
-	SDL_UnlockAudio();
+
+// class SoundBufferInfo
+
+SoundBufferInfo::SoundBufferInfo(InfoCommand& openMSXInfoCommand,
+                                 SDLSoundDriver& driver_)
+	: InfoTopic(openMSXInfoCommand, "sound_buffer")
+	, driver(driver_)
+{
+}
+
+void SoundBufferInfo::execute(const vector<TclObject>& /*tokens*/,
+                              TclObject& result) const
+{
+	unsigned size = unsigned(driver.mixBuffer.size()) / 2; // stereo
+	result.addListElement("size");
+	result.addListElement(int(size));
+	result.addListElement("latency");
+	result.addListElement(double(size) / driver.frequency);
+	result.addListElement("ratio");
+	result.addListElement(driver.ratio);
+	result.addListElement("underruns");
+	result.addListElement(int(driver.underruns.load()));
+	TclObject histogram;
+	for (auto& h : driver.histogram) {
+		histogram.addListElement(int(h.load()));
+	}
+	result.addListElement("histogram");
+	result.addListElement(histogram);
+}
+
+string SoundBufferInfo::help(const vector<string>& /*tokens*/) const
+{
+	return "Returns statistics about the buffer between the emulation "
+	       "and the sound driver: the buffer size (in samples), the "
+	       "corresponding latency (in seconds), the current rate "
+	       "correction ratio, the number of buffer underruns and a "
+	       "histogram of the buffer fill level (in 10 bins from empty "
+	       "to full) sampled at each request of the sound driver.";
 }
 
 } // namespace openmsx
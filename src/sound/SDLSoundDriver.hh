@@ -5,10 +5,13 @@
 #include "MemBuffer.hh"
 #include "openmsx.hh"
 #include "noncopyable.hh"
+#include <atomic>
+#include <memory>
 
 namespace openmsx {
 
 class Reactor;
+class SoundBufferInfo;
 
 class SDLSoundDriver : public SoundDriver, private noncopyable
 {
@@ -27,16 +30,38 @@ public:
 
 private:
 	void reInit();
-	unsigned getBufferFilled() const;
-	unsigned getBufferFree() const;
+	unsigned getBufferFilled(unsigned read, unsigned write) const;
+	unsigned getBufferFree(unsigned read, unsigned write) const;
+	unsigned resample(const short* in, unsigned len, short* out);
+	void write(const short* buffer, unsigned len);
 	static void audioCallbackHelper(void* userdata, byte* strm, int len);
 	void audioCallback(short* stream, unsigned len);
 
+	static const unsigned HISTOGRAM_BINS = 10;
+
 	Reactor& reactor;
 	MemBuffer<short> mixBuffer;
 	unsigned frequency;
 	unsigned fragmentSize;
-	unsigned readIdx, writeIdx;
+
+	// Single-producer (emulation thread) single-consumer (audio callback)
+	// ring buffer. The producer only writes 'writeIdx', the consumer
+	// only writes 'readIdx', so no locking is needed.
+	std::atomic<unsigned> readIdx;
+	std::atomic<unsigned> writeIdx;
+
+	// Drift compensation, only used by the producer.
+	double resamplePos;
+	double ratio;
+	short prevLeft, prevRight;
+
+	// Statistics, updated by the consumer.
+	std::atomic<unsigned> histogram[HISTOGRAM_BINS];
+	std::atomic<unsigned> underruns;
+
+	friend class SoundBufferInfo;
+	const std::unique_ptr<SoundBufferInfo> bufferInfo;
+
 	bool muted;
 };
 
@@ -0,0 +1,187 @@
+#include "SoundChipLog.hh"
+#include "File.hh"
+#include "MSXException.hh"
+#include "memory.hh"
+#include <algorithm>
+#include <cstring>
+#include <cassert>
+
+using std::string;
+
+namespace openmsx {
+
+static const char MAGIC[4] = { 'O', 'S', 'C', 'L' };
+static const byte VERSION = 1;
+
+static void putVarInt(std::vector<byte>& buf, uint64_t value)
+{
+	while (value >= 0x80) {
+		buf.push_back(byte(value & 0x7f) | 0x80);
+		value >>= 7;
+	}
+	buf.push_back(byte(value));
+}
+
+static uint64_t getVarInt(const byte*& p, const byte* end)
+{
+	uint64_t result = 0;
+	for (unsigned shift = 0; shift < 64; shift += 7) {
+		if (p == end) {
+			throw MSXException("Unexpected end of sound chip log.");
+		}
+		byte b = *p++;
+		result |= uint64_t(b & 0x7f) << shift;
+		if (!(b & 0x80)) return result;
+	}
+	throw MSXException("Corrupt sound chip log.");
+}
+
+
+SoundChipLog::SoundChipLog()
+	: duration(0)
+{
+}
+
+void SoundChipLog::load(string_ref filename)
+{
+	machine.clear();
+	devices.clear();
+	writes.clear();
+	duration = 0;
+
+	File file(filename);
+	size_t size;
+	const byte* p = file.mmap(size);
+	const byte* end = p + size;
+	if ((size < sizeof(MAGIC) + 1) ||
+	    (memcmp(p, MAGIC, sizeof(MAGIC)) != 0)) {
+		throw MSXException("Not a sound chip log: " + filename);
+	}
+	p += sizeof(MAGIC);
+	if (*p++ != VERSION) {
+		throw MSXException("Unsupported sound chip log version.");
+	}
+
+	uint64_t time = 0;
+	while (p != end) {
+		switch (byte tag = *p++) {
+		case 'M':
+		case 'D': {
+			uint64_t len = getVarInt(p, end);
+			if (len > uint64_t(end - p)) {
+				throw MSXException(
+					"Unexpected end of sound chip log.");
+			}
+			string name(reinterpret_cast<const char*>(p), size_t(len));
+			if (tag == 'M') {
+				machine = name;
+			} else {
+				devices.push_back(name);
+			}
+			p += len;
+			break;
+		}
+		case 'T':
+			time += getVarInt(p, end);
+			break;
+		case 'W': {
+			Write w;
+			w.time = time;
+			w.device  = unsigned(getVarInt(p, end));
+			w.address = unsigned(getVarInt(p, end));
+			if (p == end) {
+				throw MSXException(
+					"Unexpected end of sound chip log.");
+			}
+			w.value = *p++;
+			if (w.device >= devices.size()) {
+				throw MSXException(
+					"Sound chip log refers to undefined device.");
+			}
+			writes.push_back(w);
+			break;
+		}
+		case 'E':
+			duration = time + getVarInt(p, end);
+			return;
+		default:
+			throw MSXException("Corrupt sound chip log.");
+		}
+	}
+	// no end marker (e.g. capture was interrupted), use last write
+	duration = time;
+}
+
+
+// class SoundChipLogWriter
+
+SoundChipLogWriter::SoundChipLogWriter(string_ref filename, string_ref machine)
+	: file(make_unique<File>(filename, File::TRUNCATE))
+	, buf(MAGIC, MAGIC + sizeof(MAGIC))
+	, time(0)
+{
+	buf.push_back(VERSION);
+	if (!machine.empty()) {
+		putString('M', machine);
+	}
+}
+
+SoundChipLogWriter::~SoundChipLogWriter()
+{
+	try {
+		flush();
+	} catch (MSXException&) {
+		// ignore, can't throw from destructor
+	}
+}
+
+unsigned SoundChipLogWriter::getDevice(string_ref name)
+{
+	auto it = std::find(devices.begin(), devices.end(), name);
+	if (it != devices.end()) {
+		return unsigned(it - devices.begin());
+	}
+	putString('D', name);
+	devices.push_back(name.str());
+	return unsigned(devices.size() - 1);
+}
+
+void SoundChipLogWriter::write(uint64_t time_, unsigned device,
+                               unsigned address, byte value)
+{
+	assert(time_ >= time);
+	assert(device < devices.size());
+	if (time_ != time) {
+		buf.push_back('T');
+		putVarInt(buf, time_ - time);
+		time = time_;
+	}
+	buf.push_back('W');
+	putVarInt(buf, device);
+	putVarInt(buf, address);
+	buf.push_back(value);
+	if (buf.size() >= 0x10000) flush();
+}
+
+void SoundChipLogWriter::close(uint64_t duration)
+{
+	buf.push_back('E');
+	putVarInt(buf, std::max(duration, time) - time);
+	flush();
+}
+
+void SoundChipLogWriter::putString(byte tag, string_ref str)
+{
+	buf.push_back(tag);
+	putVarInt(buf, str.size());
+	buf.insert(buf.end(), str.begin(), str.end());
+}
+
+void SoundChipLogWriter::flush()
+{
+	if (buf.empty()) return;
+	file->write(buf.data(), buf.size());
+	buf.clear();
+}
+
+} // namespace openmsx
@@ -0,0 +1,90 @@
+#ifndef SOUNDCHIPLOG_HH
+#define SOUNDCHIPLOG_HH
+
+#include "openmsx.hh"
+#include "string_ref.hh"
+#include "noncopyable.hh"
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+namespace openmsx {
+
+class File;
+
+/** A time-stamped log of register writes to sound chips.
+  *
+  * Chips are identified by the name of their register debuggable (e.g.
+  * "PSG regs" or "MSX Music regs"), so a log can be replayed on any
+  * machine that contains chips with the same names, without knowing
+  * anything about the chip-specific write entry points.
+  *
+  * On disk the log is a small header ("OSCL" followed by a version byte)
+  * and a sequence of records. Each record starts with a tag byte:
+  *   'M' <len> <name>        : machine config the log was captured on
+  *   'D' <len> <name>        : define the next device index
+  *   'T' <ticks>             : advance time by this many EmuTime ticks
+  *   'W' <dev> <addr> <val>  : write byte 'val' to 'addr' of device 'dev'
+  *   'E' <ticks>             : end of log, after this many more ticks
+  * All numbers except <val> (a single byte) are encoded as LEB128
+  * variable length integers. Time is relative to the start of the log.
+  */
+class SoundChipLog
+{
+public:
+	struct Write {
+		uint64_t time; // in EmuTime ticks since start of the log
+		unsigned device;
+		unsigned address;
+		byte value;
+	};
+
+	SoundChipLog();
+
+	/** Parse a log file. Throws MSXException on error. */
+	void load(string_ref filename);
+
+	const std::string& getMachine() const { return machine; }
+	const std::vector<std::string>& getDevices() const { return devices; }
+	const std::vector<Write>& getWrites() const { return writes; }
+	uint64_t getDuration() const { return duration; }
+
+private:
+	std::string machine;
+	std::vector<std::string> devices;
+	std::vector<Write> writes;
+	uint64_t duration;
+};
+
+/** Writes a SoundChipLog file incrementally, so that long captures don't
+  * have to be kept in memory. Devices are defined on first use.
+  */
+class SoundChipLogWriter : private noncopyable
+{
+public:
+	/** Throws MSXException on error. */
+	SoundChipLogWriter(string_ref filename, string_ref machine);
+	~SoundChipLogWriter();
+
+	unsigned getDevice(string_ref name);
+	/** Time must be non-decreasing between calls. */
+	void write(uint64_t time, unsigned device, unsigned address,
+	           byte value);
+	/** Write the end marker and flush. The writer can't be used anymore
+	  * after this call. */
+	void close(uint64_t duration);
+
+private:
+	void putString(byte tag, string_ref str);
+	void flush();
+
+	const std::unique_ptr<File> file;
+	std::vector<byte> buf;
+	std::vector<std::string> devices;
+	uint64_t time;
+};
+
+} // namespace openmsx
+
+#endif
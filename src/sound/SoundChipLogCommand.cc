@@ -0,0 +1,163 @@
+#include "SoundChipLogCommand.hh"
+#include "SoundChipLog.hh"
+#include "MSXCommandController.hh"
+#include "MSXMotherBoard.hh"
+#include "MSXMixer.hh"
+#include "SoundDevice.hh"
+#include "Scheduler.hh"
+#include "FileOperations.hh"
+#include "CommandException.hh"
+#include "MSXException.hh"
+#include "TclObject.hh"
+#include "StringOp.hh"
+#include "memory.hh"
+#include <algorithm>
+#include <cassert>
+
+using std::string;
+using std::vector;
+
+namespace openmsx {
+
+SoundChipLogCommand::SoundChipLogCommand(
+		MSXCommandController& msxCommandController_,
+		Scheduler& scheduler_)
+	: Command(msxCommandController_, "soundchip_log")
+	, msxCommandController(msxCommandController_)
+	, scheduler(scheduler_)
+	, startTime(EmuTime::zero)
+	, lastTime(0)
+	, numWrites(0)
+{
+}
+
+SoundChipLogCommand::~SoundChipLogCommand()
+{
+	if (writer) {
+		try {
+			stop();
+		} catch (MSXException&) {
+			// ignore, can't throw from destructor
+		}
+	}
+}
+
+void SoundChipLogCommand::logWrite(
+	string_ref debuggable, unsigned address, byte value,
+	EmuTime::param time)
+{
+	assert(writer);
+	// Time can jump backwards (e.g. when reverse is used), keep the log
+	// monotonic by clamping.
+	uint64_t t = (time > startTime) ? (time - startTime).length() : 0;
+	lastTime = std::max(lastTime, t);
+	unsigned device = writer->getDevice(debuggable);
+	writer->write(lastTime, device, address, value);
+	++numWrites;
+}
+
+void SoundChipLogCommand::execute(
+	const vector<TclObject>& tokens, TclObject& result)
+{
+	if (tokens.size() < 2) {
+		throw CommandException("Missing argument");
+	}
+	string_ref subcommand = tokens[1].getString();
+	if (subcommand == "start") {
+		start(tokens, result);
+	} else if (subcommand == "stop") {
+		if (tokens.size() != 2) throw SyntaxError();
+		if (!writer) {
+			throw CommandException("Not capturing.");
+		}
+		unsigned num = numWrites;
+		stop();
+		result.setString(StringOp::Builder() << "Captured " << num
+		                 << " register writes to " << filename);
+	} else if (subcommand == "status") {
+		if (tokens.size() != 2) throw SyntaxError();
+		result.addListElement("status");
+		result.addListElement(writer ? "capturing" : "idle");
+		if (writer) {
+			result.addListElement("filename");
+			result.addListElement(filename);
+			result.addListElement("writes");
+			result.addListElement(int(numWrites));
+		}
+	} else {
+		throw SyntaxError();
+	}
+}
+
+void SoundChipLogCommand::start(
+	const vector<TclObject>& tokens, TclObject& result)
+{
+	string prefix = "openmsx";
+	string name;
+	for (unsigned i = 2; i < tokens.size(); ++i) {
+		string_ref token = tokens[i].getString();
+		if (token == "-prefix") {
+			if (++i == tokens.size()) {
+				throw CommandException("Missing argument");
+			}
+			prefix = tokens[i].getString().str();
+		} else if (name.empty()) {
+			name = token.str();
+		} else {
+			throw SyntaxError();
+		}
+	}
+	if (writer) {
+		throw CommandException("Already capturing.");
+	}
+	filename = FileOperations::parseCommandFileArgument(
+		name, "soundlogs", prefix, ".oscl");
+	writer = make_unique<SoundChipLogWriter>(
+		filename,
+		msxCommandController.getMSXMotherBoard().getMachineName());
+	startTime = scheduler.getCurrentTime();
+	lastTime = 0;
+	numWrites = 0;
+	auto& mixer = msxCommandController.getMSXMotherBoard().getMSXMixer();
+	for (auto* device : mixer.getDevices()) {
+		device->startRegisterLog();
+	}
+	result.setString("Capturing sound chip registers to " + filename);
+}
+
+void SoundChipLogCommand::stop()
+{
+	assert(writer);
+	EmuTime::param now = scheduler.getCurrentTime();
+	uint64_t duration = (now > startTime) ? (now - startTime).length() : 0;
+	auto w = std::move(writer); // also clears 'writer' if close() throws
+	w->close(duration);
+}
+
+string SoundChipLogCommand::help(const vector<string>& /*tokens*/) const
+{
+	return "Captures all sound chip register writes to a compact log file, "
+	       "which can be rendered to audio (much faster than realtime "
+	       "and at any sample rate) with 'soundchip_replay'.\n"
+	       "soundchip_log start              Capture to file 'openmsxNNNN.oscl'\n"
+	       "soundchip_log start <filename>   Capture to given file\n"
+	       "soundchip_log start -prefix foo  Capture to file 'fooNNNN.oscl'\n"
+	       "soundchip_log stop               Stop capturing\n"
+	       "soundchip_log status             Query capturing state\n"
+	       "\n"
+	       "Note that the log only contains the register writes made "
+	       "during the capture: start the capture before the music "
+	       "initializes the sound chips (e.g. before uploading samples).";
+}
+
+void SoundChipLogCommand::tabCompletion(vector<string>& tokens) const
+{
+	if (tokens.size() == 2) {
+		static const char* const subcommands[] = {
+			"start", "stop", "status"
+		};
+		completeString(tokens, subcommands);
+	}
+}
+
+} // namespace openmsx
@@ -0,0 +1,49 @@
+#ifndef SOUNDCHIPLOGCOMMAND_HH
+#define SOUNDCHIPLOGCOMMAND_HH
+
+#include "Command.hh"
+#include "EmuTime.hh"
+#include "openmsx.hh"
+#include <memory>
+
+namespace openmsx {
+
+class MSXCommandController;
+class Scheduler;
+class SoundChipLogWriter;
+
+/** Captures all sound chip register writes of a machine to a
+  * SoundChipLog file (see also SoundChipReplayCommand).
+  */
+class SoundChipLogCommand : public Command
+{
+public:
+	SoundChipLogCommand(MSXCommandController& commandController,
+	                    Scheduler& scheduler);
+	~SoundChipLogCommand();
+
+	bool isCapturing() const { return writer != nullptr; }
+	void logWrite(string_ref debuggable, unsigned address, byte value,
+	              EmuTime::param time);
+
+	virtual void execute(const std::vector<TclObject>& tokens,
+	                     TclObject& result);
+	virtual std::string help(const std::vector<std::string>& tokens) const;
+	virtual void tabCompletion(std::vector<std::string>& tokens) const;
+
+private:
+	void start(const std::vector<TclObject>& tokens, TclObject& result);
+	void stop();
+
+	MSXCommandController& msxCommandController;
+	Scheduler& scheduler;
+	std::unique_ptr<SoundChipLogWriter> writer;
+	std::string filename;
+	EmuTime startTime;
+	uint64_t lastTime;
+	unsigned numWrites;
+};
+
+} // namespace openmsx
+
+#endif
@@ -0,0 +1,291 @@
+#include "SoundChipReplayCommand.hh"
+#include "SoundChipLog.hh"
+#include "Reactor.hh"
+#include "MSXMotherBoard.hh"
+#include "MSXMixer.hh"
+#include "ResampledSoundDevice.hh"
+#include "Debugger.hh"
+#include "SimpleDebuggable.hh"
+#include "EnumSetting.hh"
+#include "WavWriter.hh"
+#include "Filename.hh"
+#include "File.hh"
+#include "FileContext.hh"
+#include "FileOperations.hh"
+#include "FileException.hh"
+#include "CommandException.hh"
+#include "TclObject.hh"
+#include "Timer.hh"
+#include "sha1.hh"
+#include "StringOp.hh"
+#include "endian.hh"
+#include "vla.hh"
+#include "memory.hh"
+
+using std::string;
+using std::vector;
+
+namespace openmsx {
+
+class ReplayOutput : public MSXMixer::OutputListener
+{
+public:
+	ReplayOutput(const string& wavFilename, unsigned sampleRate)
+		: samples(0)
+	{
+		if (!wavFilename.empty()) {
+			wav = make_unique<Wav16Writer>(
+				Filename(wavFilename), 2, sampleRate);
+		}
+	}
+
+	virtual void mixerOutput(const short* buffer, unsigned num)
+	{
+		// Hash a fixed (little endian) representation. Still the
+		// samples themselves are not bit-exact between hosts: the
+		// resampler and the mixer calculate in float, with SIMD
+		// kernels that depend on the instruction set (and compiler).
+		// So a golden file is only valid for the build it was created
+		// with.
+		VLA(uint8_t, le, 4 * num);
+		for (unsigned i = 0; i < 2 * num; ++i) {
+			Endian::write_UA_L16(&le[2 * i], buffer[i]);
+		}
+		sha1.update(le, 4 * num);
+		if (wav) wav->write(buffer, 2, num);
+		samples += num;
+	}
+
+	SHA1 sha1;
+	std::unique_ptr<Wav16Writer> wav;
+	uint64_t samples;
+};
+
+
+SoundChipReplayCommand::SoundChipReplayCommand(
+		CommandController& commandController, Reactor& reactor_)
+	: Command(commandController, "soundchip_replay")
+	, reactor(reactor_)
+{
+}
+
+void SoundChipReplayCommand::execute(
+	const vector<TclObject>& tokens, TclObject& result)
+{
+	string logFilename;
+	string machine;
+	vector<string> extensions;
+	unsigned sampleRate = 44100;
+	string goldenFilename;
+	string wavFilename;
+	bool profile = false;
+	for (unsigned i = 1; i < tokens.size(); ++i) {
+		string_ref token = tokens[i].getString();
+		if (token == "-profile") {
+			profile = true;
+		} else if (token.starts_with("-")) {
+			if (++i == tokens.size()) {
+				throw CommandException("Missing argument");
+			}
+			string arg = tokens[i].getString().str();
+			if (token == "-machine") {
+				machine = arg;
+			} else if (token == "-ext") {
+				extensions.push_back(arg);
+			} else if (token == "-rate") {
+				sampleRate = StringOp::stringToInt(arg);
+				if ((sampleRate < 8000) || (sampleRate > 192000)) {
+					throw CommandException(
+						"Sample rate must be in range "
+						"8000..192000.");
+				}
+			} else if (token == "-golden") {
+				goldenFilename = UserFileContext().resolveCreate(arg);
+			} else if (token == "-wav") {
+				wavFilename = FileOperations::parseCommandFileArgument(
+					arg, "soundlogs", "openmsx", ".wav");
+			} else {
+				throw CommandException("Invalid option: " + token);
+			}
+		} else {
+			if (!logFilename.empty()) throw SyntaxError();
+			logFilename = UserFileContext().resolve(token.str());
+		}
+	}
+	if (logFilename.empty()) throw SyntaxError();
+
+	SoundChipLog log;
+	log.load(logFilename);
+	if (machine.empty()) {
+		machine = log.getMachine();
+	}
+	if (machine.empty()) {
+		machine = reactor.getMachineSetting().getString();
+	}
+
+	// A machine that is loaded but never powered up: the CPU, VDP, ...
+	// never run, we only drive the sound chips through their register
+	// debuggables and step the mixer ourselves.
+	MSXMotherBoard motherBoard(reactor);
+	motherBoard.loadMachine(machine);
+	for (auto& ext : extensions) {
+		motherBoard.loadExtension(ext, "any");
+	}
+	auto& debugger = motherBoard.getDebugger();
+	vector<SimpleDebuggable*> devices;
+	for (auto& name : log.getDevices()) {
+		auto* device = dynamic_cast<SimpleDebuggable*>(
+			debugger.findDebuggable(name));
+		if (!device) {
+			throw CommandException(
+				"Sound chip log uses '" + name + "', but this "
+				"machine has no such debuggable.");
+		}
+		devices.push_back(device);
+	}
+
+	auto& msxMixer = motherBoard.getMSXMixer();
+	vector<ResampledSoundDevice*> profiled;
+	if (profile) {
+		for (auto* device : msxMixer.getDevices()) {
+			if (auto* r = dynamic_cast<ResampledSoundDevice*>(device)) {
+				profiled.push_back(r);
+			}
+		}
+	}
+	ReplayOutput output(wavFilename, sampleRate);
+	// Step in small chunks so that MSXMixer::updateStream() never has
+	// to generate more than its maximum number of samples at once.
+	const uint64_t step = EmuDuration::msec(20).length();
+	const EmuTime start = motherBoard.getCurrentTime();
+	uint64_t current = 0;
+	auto advance = [&](uint64_t target) {
+		while ((target - current) > step) {
+			current += step;
+			msxMixer.updateStream(start + EmuDuration(current));
+		}
+		current = target;
+	};
+
+	uint64_t startTime = Timer::getTime();
+	msxMixer.startOfflineRendering(output, sampleRate);
+	for (auto* device : profiled) device->setProfiling(true);
+	try {
+		for (auto& w : log.getWrites()) {
+			advance(w.time);
+			devices[w.device]->write(
+				w.address, w.value,
+				start + EmuDuration(w.time));
+		}
+		advance(std::max(log.getDuration(), current));
+		msxMixer.updateStream(start + EmuDuration(current));
+	} catch (...) {
+		for (auto* device : profiled) device->setProfiling(false);
+		msxMixer.stopOfflineRendering();
+		throw;
+	}
+	for (auto* device : profiled) device->setProfiling(false);
+	msxMixer.stopOfflineRendering();
+	uint64_t duration = Timer::getTime() - startTime;
+
+	double emulated = double(output.samples) / sampleRate;
+	double real = std::max<uint64_t>(duration, 1) / 1000000.0;
+	string sha1 = output.sha1.digest().toString();
+
+	result.addListElement("samples");
+	result.addListElement(int(output.samples));
+	result.addListElement("emutime");
+	result.addListElement(emulated);
+	result.addListElement("realtime");
+	result.addListElement(real);
+	result.addListElement("samples_per_second");
+	result.addListElement(output.samples / real);
+	result.addListElement("speed");
+	result.addListElement(emulated / real);
+	result.addListElement("sha1");
+	result.addListElement(sha1);
+	if (profile) {
+		// per device: time (in seconds) spent generating samples at
+		// the chip's native rate and resampling to the output rate
+		TclObject devs;
+		for (auto* device : profiled) {
+			TclObject dev;
+			dev.addListElement("generate");
+			dev.addListElement(device->getGenerateTime() / 1000000.0);
+			dev.addListElement("resample");
+			dev.addListElement(device->getResampleTime() / 1000000.0);
+			devs.addListElement(device->getName());
+			devs.addListElement(dev);
+		}
+		result.addListElement("profile");
+		result.addListElement(devs);
+	}
+
+	if (!goldenFilename.empty()) {
+		result.addListElement("golden");
+		if (FileOperations::exists(goldenFilename)) {
+			File file(goldenFilename);
+			vector<char> buf(file.getSize());
+			file.read(buf.data(), buf.size());
+			string expected(buf.begin(), buf.end());
+			StringOp::trimRight(expected, " \t\r\n");
+			if (expected != sha1) {
+				throw CommandException(
+					"Output differs from golden file " +
+					goldenFilename + ": expected " + expected +
+					", got " + sha1);
+			}
+			result.addListElement("match");
+		} else {
+			File file(goldenFilename, File::TRUNCATE);
+			string line = sha1 + '\n';
+			file.write(line.data(), line.size());
+			result.addListElement("created");
+		}
+	}
+}
+
+string SoundChipReplayCommand::help(const vector<string>& /*tokens*/) const
+{
+	return "soundchip_replay <log> [-machine <name>] [-ext <name>]... "
+	       "[-rate <samplerate>] [-golden <file>] [-wav <file>] [-profile]\n"
+	       "Replays a sound chip register log (e.g. captured with "
+	       "'soundchip_log') on a temporary machine, without running the "
+	       "CPU or the VDP, and renders the audio as fast as possible "
+	       "(default 44100Hz). By default the machine the log was "
+	       "captured on is used, or else the default_machine. Extensions "
+	       "that contain the logged chips can be added with -ext.\n"
+	       "Returns the number of samples, the emulated and real time, "
+	       "the rendering speed and the sha1sum of the output.\n"
+	       "With -golden the sha1sum is compared against the given "
+	       "file (an error is raised on mismatch), or the file is "
+	       "created if it doesn't exist yet. The output is not bit-exact "
+	       "between hosts (CPU type and compiler), so a golden file is "
+	       "only valid for the openMSX build that created it. With -wav "
+	       "the output is "
+	       "also written to a .wav file. With -profile the time spent "
+	       "in each sound device is reported, split in generating "
+	       "samples (at the native rate of the chip) and resampling.\n"
+	       "Note that the output also depends on the resampler and "
+	       "master_volume settings.";
+}
+
+void SoundChipReplayCommand::tabCompletion(vector<string>& tokens) const
+{
+	static const char* const options[] = {
+		"-machine", "-ext", "-rate", "-golden", "-wav", "-profile"
+	};
+	if (tokens.size() >= 3) {
+		string_ref prev = tokens[tokens.size() - 2];
+		if (prev == "-machine") {
+			completeString(tokens, Reactor::getHwConfigs("machines"));
+			return;
+		} else if (prev == "-ext") {
+			completeString(tokens, Reactor::getHwConfigs("extensions"));
+			return;
+		}
+	}
+	completeFileName(tokens, UserFileContext(), options);
+}
+
+} // namespace openmsx
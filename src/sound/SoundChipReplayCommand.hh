@@ -0,0 +1,32 @@
+#ifndef SOUNDCHIPREPLAYCOMMAND_HH
+#define SOUNDCHIPREPLAYCOMMAND_HH
+
+#include "Command.hh"
+
+namespace openmsx {
+
+class Reactor;
+
+/** Replays a SoundChipLog on a temporary (never powered) machine and
+  * renders the resulting audio as fast as possible. Reports the rendering
+  * speed and a hash of the output, optionally compared against a golden
+  * file. Useful to benchmark and regression-test the sound chip cores.
+  */
+class SoundChipReplayCommand : public Command
+{
+public:
+	SoundChipReplayCommand(CommandController& commandController,
+	                       Reactor& reactor);
+
+	virtual void execute(const std::vector<TclObject>& tokens,
+	                     TclObject& result);
+	virtual std::string help(const std::vector<std::string>& tokens) const;
+	virtual void tabCompletion(std::vector<std::string>& tokens) const;
+
+private:
+	Reactor& reactor;
+};
+
+} // namespace openmsx
+
+#endif
@@ -12,6 +12,12 @@
 #include "vla.hh"
 #include "memory.hh"
 #include <cassert>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
 
 using std::string;
 
@@ -88,6 +94,10 @@ int SoundDevice::getAmplificationFactor() const
 	return 1;
 }
 
+void SoundDevice::startRegisterLog()
+{
+}
+
 void SoundDevice::registerSound(const DeviceConfig& config)
 {
 	const XMLElement& soundConfig = config.getChild("sound");
@@ -179,6 +189,27 @@ void SoundDevice::muteChannel(unsigned channel, bool muted)
 	channelMuted[channel] = muted;
 }
 
+void SoundDevice::addFill(int*& buf, int val, unsigned num)
+{
+	assert(num > 0);
+	int* end = buf + num;
+#if defined(__SSE2__)
+	__m128i v = _mm_set1_epi32(val);
+	for (/**/; (end - buf) >= 4; buf += 4) {
+		auto* p = reinterpret_cast<__m128i*>(buf);
+		_mm_storeu_si128(p, _mm_add_epi32(_mm_loadu_si128(p), v));
+	}
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	int32x4_t v = vdupq_n_s32(val);
+	for (/**/; (end - buf) >= 4; buf += 4) {
+		vst1q_s32(buf, vaddq_s32(vld1q_s32(buf), v));
+	}
+#endif
+	for (/**/; buf != end; ++buf) {
+		*buf += val;
+	}
+}
+
 bool SoundDevice::mixChannels(int* dataOut, unsigned samples)
 {
 #ifdef __SSE2__
@@ -326,6 +357,13 @@ bool SoundDevice::mixChannels(int* dataOut, unsigned samples)
 	return true;
 }
 
+void SoundDevice::logRegisterWrite(const char* suffix, unsigned address,
+                                   byte value, EmuTime::param time)
+{
+	if (likely(!mixer.isCapturingRegisters())) return;
+	mixer.logRegisterWrite(*this, suffix, address, value, time);
+}
+
 const DynamicClock& SoundDevice::getHostSampleClock() const
 {
 	return mixer.getHostSampleClock();
@@ -2,6 +2,7 @@
 #define SOUNDDEVICE_HH
 
 #include "EmuTime.hh"
+#include "openmsx.hh"
 #include "noncopyable.hh"
 #include "string_ref.hh"
 #include <memory>
@@ -44,6 +45,12 @@ public:
 	  */
 	virtual int getAmplificationFactor() const;
 
+	/** Called when a 'soundchip_log' capture starts. Devices with state
+	  * that isn't set through register writes (e.g. the SCC chip mode)
+	  * must log that state (again) before their next register write.
+	  */
+	virtual void startRegisterLog();
+
 	void recordChannel(unsigned channel, const Filename& filename);
 	void muteChannel  (unsigned channel, bool muted);
 
@@ -138,6 +145,22 @@ protected:
 	  */
 	bool mixChannels(int* dataOut, unsigned num);
 
+	/** Add 'val' to the next 'num' samples in 'buf', and advance 'buf'.
+	  * Used by generators that compute the time till the next change of
+	  * their output and then fill a constant run in one go.
+	  * Unlike the whole buffer, this never touches more than 'num'
+	  * samples (it can be called in the middle of a buffer).
+	  */
+	static void addFill(int*& buf, int val, unsigned num);
+
+	/** Report a register write to a running 'soundchip_log' capture.
+	  * The address must be in the address space of the debuggable named
+	  * getName() + suffix, so that the write can later be replayed
+	  * through that debuggable.
+	  */
+	void logRegisterWrite(const char* suffix, unsigned address, byte value,
+	                      EmuTime::param time);
+
 	/** See MSXMixer::getHostSampleClock(). */
 	const DynamicClock& getHostSampleClock() const;
 	double getEffectiveSpeed() const;
@@ -77,6 +77,7 @@ chirp 12-..: vokume   0   : silent
 #include "VLM5030.hh"
 #include "ResampledSoundDevice.hh"
 #include "Rom.hh"
+#include "SimpleDebuggable.hh"
 #include "DeviceConfig.hh"
 #include "XMLElement.hh"
 #include "FileOperations.hh"
@@ -87,10 +88,21 @@ chirp 12-..: vokume   0   : silent
 
 namespace openmsx {
 
+class VLM5030Debuggable : public SimpleDebuggable
+{
+public:
+	VLM5030Debuggable(MSXMotherBoard& motherBoard, VLM5030& vlm5030,
+	                  const std::string& name);
+	virtual byte read(unsigned address);
+	virtual void write(unsigned address, byte value, EmuTime::param time);
+private:
+	VLM5030& vlm5030;
+};
+
 class VLM5030::Impl : public ResampledSoundDevice
 {
 public:
-	Impl(const std::string& name, const std::string& desc,
+	Impl(VLM5030& self, const std::string& name, const std::string& desc,
 	     const std::string& romFilename, const DeviceConfig& config);
 	~Impl();
 
@@ -98,6 +110,8 @@ public:
 	void writeData(byte data);
 	void writeControl(byte data, EmuTime::param time);
 	bool getBSY(EmuTime::param time);
+	byte peekData() const;
+	byte peekControl() const;
 
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
@@ -114,6 +128,7 @@ private:
 	int getBits(unsigned sbit, unsigned bits);
 	int parseFrame();
 
+	const std::unique_ptr<VLM5030Debuggable> debuggable;
 	std::unique_ptr<Rom> rom;
 	int address_mask;
 
@@ -498,8 +513,24 @@ void VLM5030::Impl::writeData(byte data)
 	latch_data = data;
 }
 
+byte VLM5030::Impl::peekData() const
+{
+	return latch_data;
+}
+
+// same bit layout as writeControl(), plus BSY in bit 3
+byte VLM5030::Impl::peekControl() const
+{
+	return (pin_RST ? 0x01 : 0) | (pin_ST  ? 0x02 : 0) |
+	       (pin_VCU ? 0x04 : 0) | (pin_BSY ? 0x08 : 0);
+}
+
 void VLM5030::Impl::writeControl(byte data, EmuTime::param time)
 {
+	// writeData() has no timestamp, but the latch is only used from
+	// here, so log its current value together with the control pins
+	logRegisterWrite(" regs", 0, latch_data, time);
+	logRegisterWrite(" regs", 1, data, time);
 	updateStream(time);
 	setRST((data & 0x01) != 0);
 	setVCU((data & 0x04) != 0);
@@ -573,9 +604,12 @@ void VLM5030::Impl::setST(bool pin)
 	}
 }
 
-VLM5030::Impl::Impl(const std::string& name, const std::string& desc,
-                    const std::string& romFilename, const DeviceConfig& config)
+VLM5030::Impl::Impl(VLM5030& self, const std::string& name,
+                    const std::string& desc, const std::string& romFilename,
+                    const DeviceConfig& config)
 	: ResampledSoundDevice(config.getMotherBoard(), name, desc, 1)
+	, debuggable(make_unique<VLM5030Debuggable>(
+		config.getMotherBoard(), self, getName()))
 {
 	XMLElement voiceROMconfig(name);
 	voiceROMconfig.addAttribute("id", "name");
@@ -645,11 +679,37 @@ void VLM5030::Impl::serialize(Archive& ar, unsigned /*version*/)
 }
 
 
+// class VLM5030Debuggable
+
+VLM5030Debuggable::VLM5030Debuggable(
+		MSXMotherBoard& motherBoard, VLM5030& vlm5030_,
+		const std::string& name)
+	: SimpleDebuggable(motherBoard, name + " regs",
+	                   "VLM5030 data latch (0) and control pins (1)", 2)
+	, vlm5030(vlm5030_)
+{
+}
+
+byte VLM5030Debuggable::read(unsigned address)
+{
+	return (address == 0) ? vlm5030.peekData() : vlm5030.peekControl();
+}
+
+void VLM5030Debuggable::write(unsigned address, byte value, EmuTime::param time)
+{
+	if (address == 0) {
+		vlm5030.writeData(value);
+	} else {
+		vlm5030.writeControl(value, time);
+	}
+}
+
+
 // class VLM5030
 
 VLM5030::VLM5030(const std::string& name, const std::string& desc,
                  const std::string& romFilename, const DeviceConfig& config)
-	: pimpl(make_unique<Impl>(name, desc, romFilename, config))
+	: pimpl(make_unique<Impl>(*this, name, desc, romFilename, config))
 {
 }
 
@@ -677,6 +737,16 @@ bool VLM5030::getBSY(EmuTime::param time)
 	return pimpl->getBSY(time);
 }
 
+byte VLM5030::peekData() const
+{
+	return pimpl->peekData();
+}
+
+byte VLM5030::peekControl() const
+{
+	return pimpl->peekControl();
+}
+
 template<typename Archive>
 void VLM5030::serialize(Archive& ar, unsigned version)
 {
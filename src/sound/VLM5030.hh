@@ -27,6 +27,10 @@ public:
 	/** get BSY pin level */
 	bool getBSY(EmuTime::param time);
 
+	/** read back latched data / control pins without side effects */
+	byte peekData() const;
+	byte peekControl() const;
+
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
 
@@ -1,21 +1,265 @@
 #include "WavWriter.hh"
 #include "File.hh"
+#include "Filename.hh"
+#include "Thread.hh"
 #include "MSXException.hh"
 #include "Math.hh"
-#include "vla.hh"
 #include "endian.hh"
 #include "memory.hh"
+#include <condition_variable>
+#include <mutex>
+#include <deque>
 #include <cstring>
-#include <vector>
+#include <zlib.h>
 
 namespace openmsx {
 
+// Data is handed to the background thread in blocks of this size.
+static const unsigned BUFFER_SIZE = 256 * 1024;
+
+/** Background thread that performs the file I/O (and compression) for all
+  * WavWriter objects. It only exists while there are WavWriters.
+  */
+class WavWriterThread : private Runnable
+{
+public:
+	static void acquire();
+	static void release();
+	static WavWriterThread& get() { assert(instance); return *instance; }
+
+	void enqueue(WavWriter& writer, std::vector<byte>&& data);
+	void enqueueHeader(WavWriter& writer, unsigned dataBytes);
+	/** Wait till all queued jobs of the given writer are done. */
+	void sync(WavWriter& writer);
+	std::mutex& getMutex() { return mutex; }
+
+private:
+	WavWriterThread();
+	~WavWriterThread();
+
+	// Runnable
+	virtual void run();
+
+	struct Job {
+		WavWriter* writer;
+		std::vector<byte> data;
+		unsigned headerBytes; // only used when data is empty
+		bool header;
+	};
+	void push(Job&& job);
+
+	Thread thread;
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::condition_variable jobDone;
+	std::deque<Job> jobs; // locked by mutex
+	bool exitLoop;        // idem
+
+	static WavWriterThread* instance;
+	static unsigned users;
+};
+
+WavWriterThread* WavWriterThread::instance = nullptr;
+unsigned WavWriterThread::users = 0;
+
+void WavWriterThread::acquire()
+{
+	// WavWriters are only created/destroyed from the main thread
+	if (users++ == 0) {
+		instance = new WavWriterThread();
+	}
+}
+
+void WavWriterThread::release()
+{
+	assert(users > 0);
+	if (--users == 0) {
+		delete instance;
+		instance = nullptr;
+	}
+}
+
+WavWriterThread::WavWriterThread()
+	: thread(this)
+	, exitLoop(false)
+{
+	thread.start();
+}
+
+WavWriterThread::~WavWriterThread()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		assert(jobs.empty());
+		exitLoop = true;
+	}
+	jobAvailable.notify_one();
+	thread.join();
+}
+
+void WavWriterThread::push(Job&& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		++job.writer->pending;
+		jobs.push_back(std::move(job));
+	}
+	jobAvailable.notify_one();
+}
+
+void WavWriterThread::enqueue(WavWriter& writer, std::vector<byte>&& data)
+{
+	push(Job{&writer, std::move(data), 0, false});
+}
+
+void WavWriterThread::enqueueHeader(WavWriter& writer, unsigned dataBytes)
+{
+	push(Job{&writer, std::vector<byte>(), dataBytes, true});
+}
+
+void WavWriterThread::sync(WavWriter& writer)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	jobDone.wait(lock, [&] { return writer.pending == 0; });
+}
+
+void WavWriterThread::run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		jobAvailable.wait(lock, [&] { return exitLoop || !jobs.empty(); });
+		if (jobs.empty()) break; // exitLoop
+
+		Job job = std::move(jobs.front());
+		jobs.pop_front();
+		WavWriter& writer = *job.writer;
+		bool skip = !writer.error.empty(); // don't continue after error
+		lock.unlock();
+
+		std::string error;
+		if (!skip) {
+			try {
+				if (job.header) {
+					writer.writeHeader(job.headerBytes);
+				} else {
+					writer.writeData(job.data);
+				}
+			} catch (MSXException& e) {
+				error = e.getMessage();
+			}
+		}
+
+		lock.lock();
+		if (!error.empty()) writer.error = error;
+		--writer.pending;
+		jobDone.notify_all();
+	}
+}
+
+
 WavWriter::WavWriter(const Filename& filename,
-                     unsigned channels, unsigned bits, unsigned frequency)
+                     unsigned channels_, unsigned bits_, unsigned frequency_)
 	: file(make_unique<File>(filename, "wb"))
+	, channels(channels_)
+	, bits(bits_)
+	, frequency(frequency_)
 	, bytes(0)
+	, pending(0)
+{
+	if (string_ref(filename.getResolved()).ends_with(".gz")) {
+		zstream = make_unique<z_stream>();
+		memset(zstream.get(), 0, sizeof(z_stream));
+		// windowBits + 16: gzip instead of zlib wrapper
+		if (deflateInit2(zstream.get(), 6, Z_DEFLATED, 15 + 16, 8,
+		                 Z_DEFAULT_STRATEGY) != Z_OK) {
+			throw MSXException("Error initializing compression");
+		}
+	}
+	// write (preliminary) header, this is done synchronously, before
+	// there are any jobs for the background thread
+	try {
+		writeHeader(0);
+	} catch (...) {
+		if (zstream) deflateEnd(zstream.get());
+		throw;
+	}
+	buffer.reserve(BUFFER_SIZE);
+	WavWriterThread::acquire();
+}
+
+WavWriter::~WavWriter()
+{
+	try {
+		// data chunk must have an even number of bytes
+		if (bytes & 1) {
+			*allocate(1) = 0;
+			--bytes; // padding is not part of the data
+		}
+
+		flush(); // write header
+	} catch (MSXException&) {
+		// ignore, can't throw from destructor
+	}
+	sync(); // also in case of error, background thread uses 'file'
+	WavWriterThread::release();
+	if (zstream) deflateEnd(zstream.get());
+}
+
+bool WavWriter::isEmpty() const
+{
+	return bytes == 0;
+}
+
+byte* WavWriter::allocate(unsigned size)
+{
+	if ((buffer.size() + size) > BUFFER_SIZE) {
+		submit();
+	}
+	auto oldSize = buffer.size();
+	buffer.resize(oldSize + size);
+	bytes += size;
+	return &buffer[oldSize];
+}
+
+void WavWriter::submit()
+{
+	checkError();
+	if (buffer.empty()) return;
+	std::vector<byte> data;
+	data.reserve(BUFFER_SIZE);
+	data.swap(buffer);
+	WavWriterThread::get().enqueue(*this, std::move(data));
+}
+
+void WavWriter::flush()
+{
+	submit();
+	auto& thread = WavWriterThread::get();
+	thread.enqueueHeader(*this, bytes);
+	thread.sync(*this);
+	checkError();
+}
+
+void WavWriter::sync()
+{
+	WavWriterThread::get().sync(*this);
+}
+
+void WavWriter::checkError()
+{
+	std::string err;
+	{
+		std::lock_guard<std::mutex> lock(
+			WavWriterThread::get().getMutex());
+		err = error;
+	}
+	if (!err.empty()) {
+		throw MSXException("Error while writing WAV file: " + err);
+	}
+}
+
+std::vector<byte> WavWriter::createHeader(unsigned dataBytes) const
 {
-	// write wav header
 	struct WavHeader {
 		char        chunkID[4];     // + 0 'RIFF'
 		Endian::L32 chunkSize;      // + 4 total size
@@ -33,7 +277,7 @@ WavWriter::WavWriter(const Filename& filename,
 	} header;
 
 	memcpy(header.chunkID,     "RIFF", sizeof(header.chunkID));
-	header.chunkSize     = 0; // actual value filled in later
+	header.chunkSize     = (dataBytes + 44 - 8 + 1) & ~1; // round up to even number
 	memcpy(header.format,      "WAVE", sizeof(header.format));
 	memcpy(header.subChunk1ID, "fmt ", sizeof(header.subChunk1ID));
 	header.subChunk1Size = 16;
@@ -44,95 +288,102 @@ WavWriter::WavWriter(const Filename& filename,
 	header.blockAlign    = (channels * bits) / 8;
 	header.bitsPerSample = bits;
 	memcpy(header.subChunk2ID, "data", sizeof(header.subChunk2ID));
-	header.subChunk2Size = 0; // actaul value filled in later
-
-	file->write(&header, sizeof(header));
-}
+	header.subChunk2Size = dataBytes;
 
-WavWriter::~WavWriter()
-{
-	try {
-		// data chunk must have an even number of bytes
-		if (bytes & 1) {
-			unsigned char pad = 0;
-			file->write(&pad, 1);
+	auto* p = reinterpret_cast<const byte*>(&header);
+	std::vector<byte> result(p, p + sizeof(header));
+	if (zstream) {
+		// Store the header as a separate gzip member without
+		// compression, so it always has the same size.
+		z_stream z;
+		memset(&z, 0, sizeof(z));
+		if (deflateInit2(&z, 0, Z_DEFLATED, 15 + 16, 8,
+		                 Z_DEFAULT_STRATEGY) != Z_OK) {
+			throw MSXException("Error initializing compression");
 		}
-
-		flush(); // write header
-	} catch (MSXException&) {
-		// ignore, can't throw from destructor
+		std::vector<byte> out(deflateBound(&z, uLong(result.size())));
+		z.next_in   = result.data();
+		z.avail_in  = uInt(result.size());
+		z.next_out  = out.data();
+		z.avail_out = uInt(out.size());
+		int err = deflate(&z, Z_FINISH);
+		out.resize(out.size() - z.avail_out);
+		deflateEnd(&z);
+		if (err != Z_STREAM_END) {
+			throw MSXException("Error compressing WAV header");
+		}
+		result.swap(out);
 	}
+	return result;
 }
 
-bool WavWriter::isEmpty() const
+void WavWriter::writeHeader(unsigned dataBytes)
 {
-	return bytes == 0;
+	std::vector<byte> header = createHeader(dataBytes);
+	if (file->getSize() == 0) {
+		file->write(header.data(), header.size());
+		return;
+	}
+	file->seek(0);
+	file->write(header.data(), header.size());
+	file->seek(file->getSize()); // SEEK_END
+	file->flush();
 }
 
-void WavWriter::flush()
+void WavWriter::writeData(const std::vector<byte>& data)
 {
-	// TODO For now (before C++11) this needs separate definition and
-	//      initialization. See comments in Endian::EndianT for details.
-	Endian::L32 totalSize, wavSize;
-	totalSize = (bytes + 44 - 8 + 1) & ~1; // round up to even number
-	wavSize   = bytes;
-
-	file->seek(4);
-	file->write(&totalSize, 4);
-	file->seek(40);
-	file->write(&wavSize, 4);
-	file->seek(file->getSize()); // SEEK_END
-	file->flush();
+	if (!zstream) {
+		file->write(data.data(), data.size());
+		return;
+	}
+	// Each block becomes a separate gzip member, so that the file is a
+	// valid .gz file after every block.
+	byte out[64 * 1024];
+	zstream->next_in  = const_cast<byte*>(data.data());
+	zstream->avail_in = uInt(data.size());
+	int err;
+	do {
+		zstream->next_out  = out;
+		zstream->avail_out = sizeof(out);
+		err = deflate(zstream.get(), Z_FINISH);
+		if ((err != Z_OK) && (err != Z_STREAM_END)) {
+			throw MSXException("Error compressing WAV data");
+		}
+		file->write(out, sizeof(out) - zstream->avail_out);
+	} while (err != Z_STREAM_END);
+	deflateReset(zstream.get());
 }
 
+
 void Wav8Writer::write(const unsigned char* buffer, unsigned samples)
 {
-	file->write(buffer, samples);
-	bytes += samples;
+	memcpy(allocate(samples), buffer, samples);
 }
 
 void Wav16Writer::write(const short* buffer, unsigned samples)
 {
-	unsigned size = sizeof(short) * samples;
+	byte* out = allocate(sizeof(short) * samples);
 	if (OPENMSX_BIGENDIAN) {
-		// Variable length arrays (VLA) are part of c99 but not of c++
-		// (not even c++11). Some compilers (like gcc) do support VLA
-		// in c++ mode, others (like VC++) don't. Still other compilers
-		// (like clang) only support VLA for POD types.
-		// To side-step this issue we simply use a std::vector, this
-		// code is anyway not performance critical.
-		//VLA(Endian::L16, buf, samples); // doesn't work in clang
-		//std::vector<Endian::L16> buf(buffer, buffer + samples); // this needs c++11
-		std::vector<Endian::L16> buf(samples);
 		for (unsigned i = 0; i < samples; ++i) {
-			buf[i] = buffer[i];
+			Endian::write_UA_L16(out + 2 * i, buffer[i]);
 		}
-		file->write(buf.data(), size);
 	} else {
-		file->write(buffer, size);
+		memcpy(out, buffer, sizeof(short) * samples);
 	}
-	bytes += size;
 }
 
 void Wav16Writer::write(const int* buffer, unsigned samples, int amp)
 {
-	//VLA(Endian::L16, buf, samples); // doesn't work in clang
-	std::vector<Endian::L16> buf(samples);
+	byte* out = allocate(sizeof(short) * samples);
 	for (unsigned i = 0; i < samples; ++i) {
-		buf[i] = Math::clipIntToShort(buffer[i] * amp);
+		Endian::write_UA_L16(out + 2 * i,
+		                     Math::clipIntToShort(buffer[i] * amp));
 	}
-	unsigned size = sizeof(short) * samples;
-	file->write(buf.data(), size);
-	bytes += size;
 }
 
 void Wav16Writer::writeSilence(unsigned samples)
 {
-	VLA(short, buf, samples);
-	unsigned size = sizeof(short) * samples;
-	memset(buf, 0, size);
-	file->write(buf, size);
-	bytes += size;
+	memset(allocate(sizeof(short) * samples), 0, sizeof(short) * samples);
 }
 
 } // namespace openmsx
@@ -1,9 +1,14 @@
 #ifndef WAVWRITER_HH
 #define WAVWRITER_HH
 
+#include "openmsx.hh"
 #include "noncopyable.hh"
-#include <cassert>
+#include <vector>
+#include <string>
 #include <memory>
+#include <cassert>
+
+struct z_stream_s;
 
 namespace openmsx {
 
@@ -11,6 +16,16 @@ class File;
 class Filename;
 
 /** Base class for writing WAV files.
+  *
+  * The actual file I/O happens asynchronously: data is collected in large
+  * buffers which are handed over to a background thread (shared by all
+  * writers). So recording many channels at once doesn't stall emulation
+  * on disk I/O.
+  *
+  * When the filename ends in '.gz' the file is gzip compressed (also in the
+  * background thread). The result is a regular .wav.gz file: the WAV header
+  * is stored (uncompressed) in a separate gzip member, so that it can still
+  * be updated in-place when more data is written.
   */
 class WavWriter : private noncopyable
 {
@@ -21,6 +36,7 @@ public:
 
 	/** Flush data to file and update header. Try to make (possibly)
 	  * incomplete file already usable for external programs.
+	  * This waits until the background writes are done.
 	  */
 	void flush();
 
@@ -29,8 +45,30 @@ protected:
 	          unsigned channels, unsigned bits, unsigned frequency);
 	~WavWriter();
 
+	/** Reserve space for 'size' bytes of sample data in the write
+	  * buffer, the caller must fill it in. */
+	byte* allocate(unsigned size);
+
+private:
+	void submit();
+	void sync();
+	void checkError();
+	// called from the background thread
+	void writeData(const std::vector<byte>& data);
+	void writeHeader(unsigned dataBytes);
+	std::vector<byte> createHeader(unsigned dataBytes) const;
+
 	const std::unique_ptr<File> file;
+	std::unique_ptr<z_stream_s> zstream; // only for compressed files
+	std::vector<byte> buffer;
+	const unsigned channels;
+	const unsigned bits;
+	const unsigned frequency;
 	unsigned bytes;
+	unsigned pending; // number of queued jobs, locked by thread mutex
+	std::string error; // error from background thread, idem
+
+	friend class WavWriterThread;
 };
 
 /** Writes 8-bit WAV files.
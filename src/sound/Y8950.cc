@@ -969,6 +969,27 @@ void Y8950::Impl::generateChannels(int** bufs, unsigned num)
 		return;
 	}
 
+	// A slot that is not active stays inactive until the next register
+	// write, so those channels are silent for the whole buffer. Don't
+	// touch their output buffers, so that the mixer can skip them.
+	int m = rythm_mode ? 6 : 9;
+	for (int i = 0; i < 9; ++i) {
+		if ((i >= m) || !ch[i].slot[CAR].isActive()) {
+			bufs[i] = nullptr;
+		}
+	}
+	if (rythm_mode) {
+		if (!ch[6].slot[CAR].isActive()) bufs[ 9] = nullptr;
+		if (!ch[7].slot[CAR].isActive()) bufs[10] = nullptr;
+		if (!ch[8].slot[CAR].isActive()) bufs[11] = nullptr;
+		if (!ch[7].slot[MOD].isActive()) bufs[12] = nullptr;
+		if (!ch[8].slot[MOD].isActive()) bufs[13] = nullptr;
+	} else {
+		for (int i = 9; i < 9 + 5; ++i) {
+			bufs[i] = nullptr;
+		}
+	}
+
 	for (unsigned sample = 0; sample < num; ++sample) {
 		// Amplitude modulation: 27 output levels (triangle waveform);
 		// 1 level takes one of: 192, 256 or 448 samples
@@ -999,7 +1020,6 @@ void Y8950::Impl::generateChannels(int** bufs, unsigned num)
 		noiseB_phase &= (0x10 << 11) - 1;
 		int noiseB = noiseB_phase & (0x0A << 11) ? DB_POS(6) : DB_NEG(6);
 
-		int m = rythm_mode ? 6 : 9;
 		for (int i = 0; i < m; ++i) {
 			if (ch[i].slot[CAR].isActive()) {
 				bufs[i][sample] += ch[i].alg
@@ -1007,41 +1027,29 @@ void Y8950::Impl::generateChannels(int** bufs, unsigned num)
 					       ch[i].slot[MOD].calc_slot_mod(lfo_pm, lfo_am)
 					: ch[i].slot[CAR].calc_slot_car(lfo_pm, lfo_am,
 					       ch[i].slot[MOD].calc_slot_mod(lfo_pm, lfo_am));
-			} else {
-				//bufs[i][sample] += 0;
 			}
 		}
 		if (rythm_mode) {
-			//bufs[6][sample] += 0;
-			//bufs[7][sample] += 0;
-			//bufs[8][sample] += 0;
-
 			// TODO wasn't in original source either
 			ch[7].slot[MOD].calc_phase(lfo_pm);
 			ch[8].slot[CAR].calc_phase(lfo_pm);
 
-			bufs[ 9][sample] += (ch[6].slot[CAR].isActive())
-				? 2 * ch[6].slot[CAR].calc_slot_car(lfo_pm, lfo_am,
-						    ch[6].slot[MOD].calc_slot_mod(lfo_pm, lfo_am))
-				: 0;
-			bufs[10][sample] += (ch[7].slot[CAR].isActive())
-				? 2 * ch[7].slot[CAR].calc_slot_snare(lfo_pm, lfo_am, whitenoise)
-				: 0;
-			bufs[11][sample] += (ch[8].slot[CAR].isActive())
-				? 2 * ch[8].slot[CAR].calc_slot_cym(lfo_am, noiseA, noiseB)
-				: 0;
-			bufs[12][sample] += (ch[7].slot[MOD].isActive())
-				? 2 * ch[7].slot[MOD].calc_slot_hat(lfo_am, noiseA, noiseB, whitenoise)
-				: 0;
-			bufs[13][sample] += (ch[8].slot[MOD].isActive())
-				? 2 * ch[8].slot[MOD].calc_slot_tom(lfo_pm, lfo_am)
-				: 0;
-		} else {
-			//bufs[ 9] += 0;
-			//bufs[10] += 0;
-			//bufs[11] += 0;
-			//bufs[12] += 0;
-			//bufs[13] += 0;
+			if (ch[6].slot[CAR].isActive()) {
+				bufs[ 9][sample] += 2 * ch[6].slot[CAR].calc_slot_car(lfo_pm, lfo_am,
+				                            ch[6].slot[MOD].calc_slot_mod(lfo_pm, lfo_am));
+			}
+			if (ch[7].slot[CAR].isActive()) {
+				bufs[10][sample] += 2 * ch[7].slot[CAR].calc_slot_snare(lfo_pm, lfo_am, whitenoise);
+			}
+			if (ch[8].slot[CAR].isActive()) {
+				bufs[11][sample] += 2 * ch[8].slot[CAR].calc_slot_cym(lfo_am, noiseA, noiseB);
+			}
+			if (ch[7].slot[MOD].isActive()) {
+				bufs[12][sample] += 2 * ch[7].slot[MOD].calc_slot_hat(lfo_am, noiseA, noiseB, whitenoise);
+			}
+			if (ch[8].slot[MOD].isActive()) {
+				bufs[13][sample] += 2 * ch[8].slot[MOD].calc_slot_tom(lfo_pm, lfo_am);
+			}
 		}
 
 		bufs[14][sample] += adpcm->calcSample();
@@ -1061,6 +1069,8 @@ void Y8950::Impl::writeReg(byte rg, byte data, EmuTime::param time)
 		-1, -1, -1, -1, -1, -1, -1, -1
 	};
 
+	logRegisterWrite(" regs", rg, data, time);
+
 	// TODO only for registers that influence sound
 	// TODO also ADPCM
 	//if (rg >= 0x20) {
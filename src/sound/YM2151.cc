@@ -8,6 +8,7 @@
 #include "ResampledSoundDevice.hh"
 #include "EmuTimer.hh"
 #include "IRQHelper.hh"
+#include "SimpleDebuggable.hh"
 #include "DeviceConfig.hh"
 #include "serialize.hh"
 #include "memory.hh"
@@ -16,14 +17,26 @@
 
 namespace openmsx {
 
+class YM2151Debuggable : public SimpleDebuggable
+{
+public:
+	YM2151Debuggable(MSXMotherBoard& motherBoard, YM2151& ym2151,
+	                 const std::string& name);
+	virtual byte read(unsigned address);
+	virtual void write(unsigned address, byte value, EmuTime::param time);
+private:
+	YM2151& ym2151;
+};
+
 class YM2151::Impl : public ResampledSoundDevice, private EmuTimerCallback
 {
 public:
-	Impl(const std::string& name, const std::string& desc,
+	Impl(YM2151& self, const std::string& name, const std::string& desc,
 	     const DeviceConfig& config, EmuTime::param time);
 	~Impl();
 	void reset(EmuTime::param time);
 	void writeReg(byte r, byte v, EmuTime::param time);
+	byte peekReg(byte r) const;
 	byte readStatus() const;
 
 	template<typename Archive>
@@ -110,12 +123,15 @@ private:
 	// general chip mehods
 	void chanCalc(unsigned chan);
 	void chan7Calc();
+	bool isChannelSilent(unsigned chan) const;
 
 	void advanceEG();
 	void advance();
 
 	bool checkMuteHelper();
 
+	const std::unique_ptr<YM2151Debuggable> debuggable;
+
 	IRQHelper irq;
 
 	// Timers (see EmuTimer class for details about timing)
@@ -796,8 +812,14 @@ void YM2151::Impl::refreshEG(YM2151Operator* op)
 	op->eg_sel_rr  = eg_rate_select[op->rr  + v];
 }
 
+byte YM2151::Impl::peekReg(byte r) const
+{
+	return regs[r];
+}
+
 void YM2151::Impl::writeReg(byte r, byte v, EmuTime::param time)
 {
+	logRegisterWrite(" regs", r, v, time);
 	updateStream(time);
 
 	YM2151Operator* op = &oper[(r & 0x07) * 4 + ((r & 0x18) >> 3)];
@@ -1012,9 +1034,12 @@ void YM2151::Impl::writeReg(byte r, byte v, EmuTime::param time)
 	}
 }
 
-YM2151::Impl::Impl(const std::string& name, const std::string& desc,
-                   const DeviceConfig& config, EmuTime::param time)
+YM2151::Impl::Impl(YM2151& self, const std::string& name,
+                   const std::string& desc, const DeviceConfig& config,
+                   EmuTime::param time)
 	: ResampledSoundDevice(config.getMotherBoard(), name, desc, 8, true)
+	, debuggable(make_unique<YM2151Debuggable>(
+		config.getMotherBoard(), self, getName()))
 	, irq(config.getMotherBoard(), getName() + ".IRQ")
 	, timer1(EmuTimer::createOPM_1(config.getScheduler(), *this))
 	, timer2(EmuTimer::createOPM_2(config.getScheduler(), *this))
@@ -1051,6 +1076,27 @@ bool YM2151::Impl::checkMuteHelper()
 	return true;
 }
 
+// A channel with all operators in the EG_OFF state and attenuated enough to
+// not produce any output (see chanCalc()/chan7Calc()) remains silent until the
+// next register write or CSM key-on. When in addition the feedback and MEM
+// values are zero, calculating this channel doesn't change any state.
+bool YM2151::Impl::isChannelSilent(unsigned chan) const
+{
+	const YM2151Operator* op = &oper[chan * 4];
+	if (op->fb_out_curr || op->fb_out_prev || op->mem_value) {
+		return false;
+	}
+	for (int i = 0; i < 4; ++i) {
+		unsigned quiet = ((chan == 7) && (i == 3) && (noise & 0x80))
+		               ? 0x3ff : ENV_QUIET;
+		if ((op[i].state != EG_OFF) ||
+		    ((op[i].tl + unsigned(op[i].volume)) < quiet)) {
+			return false;
+		}
+	}
+	return true;
+}
+
 void YM2151::Impl::reset(EmuTime::param time)
 {
 	// initialize hardware registers
@@ -1650,22 +1696,34 @@ void YM2151::Impl::generateChannels(int** bufs, unsigned num)
 		return;
 	}
 
+	// Skip channels that remain silent for the whole buffer. A pending CSM
+	// request can key-on all operators halfway, so then calculate all.
+	bool active[8];
+	for (int j = 0; j < 8; ++j) {
+		active[j] = csm_req || !isChannelSilent(j);
+	}
+
 	for (unsigned i = 0; i < num; ++i) {
 		advanceEG();
 
 		for (int j = 0; j < 8-1; ++j) {
 			chanout[j] = 0;
-			chanCalc(j);
+			if (active[j]) chanCalc(j);
 		}
 		chanout[7] = 0;
-		chan7Calc(); // special case for channel 7
+		if (active[7]) chan7Calc(); // special case for channel 7
 
 		for (int j = 0; j < 8; ++j) {
+			if (!active[j]) continue;
 			bufs[j][2 * i + 0] += chanout[j] & pan[2 * j + 0];
 			bufs[j][2 * i + 1] += chanout[j] & pan[2 * j + 1];
 		}
 		advance();
 	}
+
+	for (int j = 0; j < 8; ++j) {
+		if (!active[j]) bufs[j] = nullptr;
+	}
 }
 
 void YM2151::Impl::callback(byte flag)
@@ -1794,11 +1852,32 @@ void YM2151::Impl::serialize(Archive& ar, unsigned /*version*/)
 }
 
 
+// YM2151Debuggable
+
+YM2151Debuggable::YM2151Debuggable(
+		MSXMotherBoard& motherBoard, YM2151& ym2151_,
+		const std::string& name)
+	: SimpleDebuggable(motherBoard, name + " regs", "YM2151 registers", 0x100)
+	, ym2151(ym2151_)
+{
+}
+
+byte YM2151Debuggable::read(unsigned address)
+{
+	return ym2151.peekReg(address);
+}
+
+void YM2151Debuggable::write(unsigned address, byte value, EmuTime::param time)
+{
+	ym2151.writeReg(address, value, time);
+}
+
+
 // YM2151
 
 YM2151::YM2151(const std::string& name, const std::string& desc,
                const DeviceConfig& config, EmuTime::param time)
-	: pimpl(make_unique<Impl>(name, desc, config, time))
+	: pimpl(make_unique<Impl>(*this, name, desc, config, time))
 {
 }
 
@@ -1816,6 +1895,11 @@ void YM2151::writeReg(byte r, byte v, EmuTime::param time)
 	pimpl->writeReg(r, v, time);
 }
 
+byte YM2151::peekReg(byte r) const
+{
+	return pimpl->peekReg(r);
+}
+
 byte YM2151::readStatus() const
 {
 	return pimpl->readStatus();
@@ -50,6 +50,7 @@ public:
 
 	void reset(EmuTime::param time);
 	void writeReg(byte r, byte v, EmuTime::param time);
+	byte peekReg(byte r) const;
 	byte readStatus() const;
 
 	template<typename Archive>
@@ -76,6 +76,7 @@ void YM2413::reset(EmuTime::param time)
 
 void YM2413::writeReg(byte reg, byte value, EmuTime::param time)
 {
+	logRegisterWrite(" regs", reg, value, time);
 	updateStream(time);
 	core->writeReg(reg, value);
 }
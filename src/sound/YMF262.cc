@@ -87,6 +87,7 @@ class YMF262Slot
 public:
 	YMF262Slot();
 	inline int op_calc(unsigned phase, unsigned lfo_am) const;
+	inline bool isSilent() const;
 	inline void FM_KEYON(byte key_set);
 	inline void FM_KEYOFF(byte key_clr);
 	inline void advanceEnvelopeGenerator(unsigned eg_cnt);
@@ -154,6 +155,7 @@ public:
 	YMF262Channel();
 	void chan_calc(unsigned lfo_am);
 	void chan_calc_ext(unsigned lfo_am);
+	inline bool isSilent() const;
 
 	template<typename Archive>
 	void serialize(Archive& ar, unsigned version);
@@ -787,6 +789,22 @@ inline int YMF262Slot::op_calc(unsigned phase, unsigned lfo_am) const
 	return (p < TL_TAB_LEN) ? tl_tab[p] : 0;
 }
 
+// A slot in the EG_OFF state with an attenuation that's too big to produce
+// any output (see op_calc()) stays silent until the next register write (and
+// register writes never happen in the middle of generateChannels()). When
+// also the feedback history is zero, calculating this slot is a no-op.
+inline bool YMF262Slot::isSilent() const
+{
+	return (state == EG_OFF) &&
+	       (((TLL + volume) << 4) >= TL_TAB_LEN) &&
+	       (op1_out[0] == 0) && (op1_out[1] == 0);
+}
+
+inline bool YMF262Channel::isSilent() const
+{
+	return slot[MOD].isSilent() && slot[CAR].isSilent();
+}
+
 // calculate output of a standard 2 operator channel
 // (or 1st part of a 4-op channel)
 void YMF262Channel::chan_calc(unsigned lfo_am)
@@ -1272,6 +1290,7 @@ void YMF262::Impl::writeReg(unsigned r, byte v, EmuTime::param time)
 }
 void YMF262::Impl::writeReg512(unsigned r, byte v, EmuTime::param time)
 {
+	logRegisterWrite(" regs", r, v, time);
 	updateStream(time); // TODO optimize only for regs that directly influence sound
 	writeRegDirect(r, v, time);
 }
@@ -1736,7 +1755,6 @@ int YMF262::Impl::getAmplificationFactor() const
 
 void YMF262::Impl::generateChannels(int** bufs, unsigned num)
 {
-	// TODO implement per-channel mute (instead of all-or-nothing)
 	// TODO output rhythm on separate channels?
 	if (checkMuteHelper()) {
 		// TODO update internal state, even if muted
@@ -1748,6 +1766,27 @@ void YMF262::Impl::generateChannels(int** bufs, unsigned num)
 
 	bool rhythmEnabled = (rhythm & 0x20) != 0;
 
+	// Silent channels remain silent for the whole duration of this buffer
+	// (see YMF262Slot::isSilent()). Skip the operator calculations for
+	// those channels and don't touch their output buffers. Channels that
+	// are combined (4op mode or rhythm mode) must be skipped together.
+	bool active[18];
+	for (int i = 0; i < 18; ++i) {
+		active[i] = !channel[i].isSilent();
+	}
+	for (int k = 0; k <= 9; k += 9) {
+		for (int i = 0; i < 3; ++i) {
+			if (channel[k + i].extended) {
+				bool a = active[k + i] || active[k + i + 3];
+				active[k + i] = active[k + i + 3] = a;
+			}
+		}
+	}
+	if (rhythmEnabled) {
+		bool a = active[6] || active[7] || active[8];
+		active[6] = active[7] = active[8] = a;
+	}
+
 	for (unsigned j = 0; j < num; ++j) {
 		// Amplitude modulation: 27 output levels (triangle waveform);
 		// 1 level takes one of: 192, 256 or 448 samples
@@ -1770,33 +1809,38 @@ void YMF262::Impl::generateChannels(int** bufs, unsigned num)
 				YMF262Channel& ch0 = channel[k + i + 0];
 				YMF262Channel& ch3 = channel[k + i + 3];
 				// extended 4op ch#0 part 1 or 2op ch#0
-				ch0.chan_calc(lfo_am);
-				if (ch0.extended) {
-					// extended 4op ch#0 part 2
-					ch3.chan_calc_ext(lfo_am);
-				} else {
-					// standard 2op ch#3
-					ch3.chan_calc(lfo_am);
+				if (active[k + i + 0]) {
+					ch0.chan_calc(lfo_am);
+				}
+				if (active[k + i + 3]) {
+					if (ch0.extended) {
+						// extended 4op ch#0 part 2
+						ch3.chan_calc_ext(lfo_am);
+					} else {
+						// standard 2op ch#3
+						ch3.chan_calc(lfo_am);
+					}
 				}
 			}
 		}
 
 		// channels 6,7,8 rhythm or 2op mode
 		if (!rhythmEnabled) {
-			channel[6].chan_calc(lfo_am);
-			channel[7].chan_calc(lfo_am);
-			channel[8].chan_calc(lfo_am);
-		} else {
+			for (int i = 6; i <= 8; ++i) {
+				if (active[i]) channel[i].chan_calc(lfo_am);
+			}
+		} else if (active[6]) {
 			// Rhythm part
 			chan_calc_rhythm(lfo_am);
 		}
 
 		// channels 15,16,17 are fixed 2-operator channels only
-		channel[15].chan_calc(lfo_am);
-		channel[16].chan_calc(lfo_am);
-		channel[17].chan_calc(lfo_am);
+		for (int i = 15; i <= 17; ++i) {
+			if (active[i]) channel[i].chan_calc(lfo_am);
+		}
 
 		for (int i = 0; i < 18; ++i) {
+			if (!active[i]) continue;
 			bufs[i][2 * j + 0] += chanout[i] & pan[4 * i + 0];
 			bufs[i][2 * j + 1] += chanout[i] & pan[4 * i + 1];
 			// unused c        += chanout[i] & pan[4 * i + 2];
@@ -1805,6 +1849,10 @@ void YMF262::Impl::generateChannels(int** bufs, unsigned num)
 
 		advance();
 	}
+
+	for (int i = 0; i < 18; ++i) {
+		if (!active[i]) bufs[i] = nullptr;
+	}
 }
 
 
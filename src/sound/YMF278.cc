@@ -19,6 +19,7 @@
 #include "likely.hh"
 #include "memory.hh"
 #include <algorithm>
+#include <vector>
 #include <cmath>
 #include <cstring>
 
@@ -46,6 +47,18 @@ private:
 	YMF278& ymf278;
 };
 
+/** Decoded (16-bit) PCM data of one sample, identified by its start address
+  * and sample format. Decoding happens lazily, in small chunks, up to the
+  * highest position that was played so far. Writes to sample RAM truncate the
+  * decoded data from the first affected position onwards.
+  */
+struct DecodedSample
+{
+	unsigned startaddr;
+	byte bits;
+	std::vector<short> data;
+};
+
 class YMF278Slot
 {
 public:
@@ -69,6 +82,7 @@ public:
 	unsigned stepptr;    // fixed-point pointer into the sample
 	unsigned pos;
 	short sample1, sample2;
+	DecodedSample* decoded; // not serialized, looked up on demand
 
 	int env_vol;
 
@@ -124,7 +138,11 @@ private:
 
 	void writeRegDirect(byte reg, byte data, EmuTime::param time);
 	unsigned getRamAddress(unsigned addr) const;
-	short getSample(YMF278Slot& op);
+	short decodeSample(unsigned startaddr, byte bits, unsigned pos) const;
+	inline short getSample(YMF278Slot& op);
+	short getSampleSlow(YMF278Slot& op);
+	void invalidateSampleCache(unsigned address);
+	void clearSampleCache();
 	void advance();
 	bool anyActive();
 	void keyOnHelper(YMF278Slot& slot);
@@ -146,6 +164,9 @@ private:
 	const std::unique_ptr<Rom> rom;
 	MemBuffer<byte> ram;
 
+	/** Decoded samples, shared by all slots that play the same sample. */
+	std::vector<std::unique_ptr<DecodedSample>> sampleCache;
+
 	/** Precalculated attenuation values with some margin for
 	  * envelope and pan levels.
 	  */
@@ -336,6 +357,7 @@ void YMF278Slot::reset()
 
 	// not strictly needed, but avoid UMR on savestate
 	pos = sample1 = sample2 = 0;
+	decoded = nullptr;
 }
 
 int YMF278Slot::compute_rate(int val) const
@@ -533,22 +555,22 @@ void YMF278::Impl::advance()
 	}
 }
 
-short YMF278::Impl::getSample(YMF278Slot& op)
+short YMF278::Impl::decodeSample(unsigned startaddr, byte bits, unsigned pos) const
 {
 	// TODO How does this behave when R#2 bit 0 = 1?
 	//      As-if read returns 0xff? (Like for CPU memory reads.) Or is
 	//      sound generation blocked at some higher level?
 	short sample;
-	switch (op.bits) {
+	switch (bits) {
 	case 0: {
 		// 8 bit
-		sample = readMem(op.startaddr + op.pos) << 8;
+		sample = readMem(startaddr + pos) << 8;
 		break;
 	}
 	case 1: {
 		// 12 bit
-		unsigned addr = op.startaddr + ((op.pos / 2) * 3);
-		if (op.pos & 1) {
+		unsigned addr = startaddr + ((pos / 2) * 3);
+		if (pos & 1) {
 			sample = readMem(addr + 2) << 8 |
 				 ((readMem(addr + 1) << 4) & 0xF0);
 		} else {
@@ -559,7 +581,7 @@ short YMF278::Impl::getSample(YMF278Slot& op)
 	}
 	case 2: {
 		// 16 bit
-		unsigned addr = op.startaddr + (op.pos * 2);
+		unsigned addr = startaddr + (pos * 2);
 		sample = (readMem(addr + 0) << 8) |
 			 (readMem(addr + 1));
 		break;
@@ -571,6 +593,86 @@ short YMF278::Impl::getSample(YMF278Slot& op)
 	return sample;
 }
 
+short YMF278::Impl::getSample(YMF278Slot& op)
+{
+	if (likely(op.decoded && (op.pos < op.decoded->data.size()))) {
+		return op.decoded->data[op.pos];
+	}
+	return getSampleSlow(op);
+}
+
+short YMF278::Impl::getSampleSlow(YMF278Slot& op)
+{
+	if (!op.decoded) {
+		auto it = find_if(sampleCache.begin(), sampleCache.end(),
+			[&](const std::unique_ptr<DecodedSample>& d) {
+				return (d->startaddr == op.startaddr) &&
+				       (d->bits      == op.bits); });
+		if (it == sampleCache.end()) {
+			if (sampleCache.size() >= 64) {
+				// drop the samples that are not playing
+				sampleCache.erase(remove_if(
+					sampleCache.begin(), sampleCache.end(),
+					[&](const std::unique_ptr<DecodedSample>& d) {
+						return std::none_of(
+							std::begin(slots), std::end(slots),
+							[&](const YMF278Slot& s) {
+								return s.decoded == d.get(); }); }),
+					sampleCache.end());
+			}
+			auto d = make_unique<DecodedSample>();
+			d->startaddr = op.startaddr;
+			d->bits = op.bits;
+			sampleCache.push_back(std::move(d));
+			it = sampleCache.end() - 1;
+		}
+		op.decoded = it->get();
+	}
+	// Decode a small chunk at a time (not up to the end address): the
+	// decoded data gets truncated on each write to the sample memory, a
+	// program that streams into the sample while it's playing would
+	// otherwise cause the whole sample to be decoded again and again.
+	static const unsigned CHUNK = 256;
+	auto& data = op.decoded->data;
+	unsigned end = (op.pos + CHUNK) & ~(CHUNK - 1);
+	for (unsigned i = unsigned(data.size()); i < end; ++i) {
+		data.push_back(decodeSample(op.startaddr, op.bits, i));
+	}
+	return data[op.pos];
+}
+
+void YMF278::Impl::invalidateSampleCache(unsigned address)
+{
+	if ((regs[2] & 2) || (ram.size() == 640 * 1024)) {
+		// RAM is mirrored or remapped, the written byte may be
+		// visible at other addresses as well. Rare, so keep it simple.
+		clearSampleCache();
+		return;
+	}
+	for (auto& d : sampleCache) {
+		// (the address space wraps at 4MB)
+		unsigned offset = (address - d->startaddr) & 0x3FFFFF;
+		unsigned first; // first position that uses this byte
+		switch (d->bits) {
+		case 0:  first = offset;           break;
+		case 1:  first = (offset / 3) * 2; break;
+		case 2:  first = offset / 2;       break;
+		default: first = unsigned(-1);     break; // no memory used
+		}
+		if (first < d->data.size()) {
+			d->data.resize(first);
+		}
+	}
+}
+
+void YMF278::Impl::clearSampleCache()
+{
+	for (auto& slot : slots) {
+		slot.decoded = nullptr;
+	}
+	sampleCache.clear();
+}
+
 bool YMF278::Impl::anyActive()
 {
 	for (int i = 0; i < 24; ++i) {
@@ -649,6 +751,7 @@ void YMF278::Impl::keyOnHelper(YMF278Slot& slot)
 
 void YMF278::Impl::writeReg(byte reg, byte data, EmuTime::param time)
 {
+	logRegisterWrite(" regs", reg, data, time);
 	updateStream(time); // TODO optimize only for regs that directly influence sound
 	writeRegDirect(reg, data, time);
 }
@@ -675,6 +778,7 @@ void YMF278::Impl::writeRegDirect(byte reg, byte data, EmuTime::param time)
 			slot.bits = (buf[0] & 0xC0) >> 6;
 			slot.startaddr = buf[2] | (buf[1] << 8) |
 			                 ((buf[0] & 0x3F) << 16);
+			slot.decoded = nullptr;
 			slot.loopaddr = buf[4] + (buf[3] << 8);
 			slot.endaddr  = (((buf[6] + (buf[5] << 8)) ^ 0xFFFF) + 1);
 			for (int i = 7; i < 12; ++i) {
@@ -780,6 +884,10 @@ void YMF278::Impl::writeRegDirect(byte reg, byte data, EmuTime::param time)
 		case 0x02:
 			// wave-table-header / memory-type / memory-access-mode
 			// Simply store in regs[2]
+			if ((regs[2] ^ data) & 2) {
+				// memory access mode changed
+				clearSampleCache();
+			}
 			break;
 
 		case 0x03:
@@ -925,6 +1033,7 @@ YMF278::Impl::~Impl()
 void YMF278::Impl::clearRam()
 {
 	memset(ram.data(), 0, ram.size());
+	clearSampleCache();
 }
 
 void YMF278::Impl::reset(EmuTime::param time)
@@ -1062,7 +1171,10 @@ void YMF278::Impl::writeMem(unsigned address, byte value)
 	} else {
 		unsigned ramAddr = getRamAddress(address);
 		if (ramAddr < ram.size()) {
-			ram[ramAddr] = value;
+			if (ram[ramAddr] != value) {
+				ram[ramAddr] = value;
+				invalidateSampleCache(address);
+			}
 		} else {
 			// can't write to unmapped memory
 		}
@@ -1170,6 +1282,7 @@ void YMF278::Impl::serialize(Archive& ar, unsigned version)
 		0xf9,    // pcm_l, pcm_r
 	};
 	if (ar.isLoader()) {
+		clearSampleCache();
 		EmuTime::param time = motherBoard.getCurrentTime();
 		for (unsigned i = 0; i < sizeof(rewriteRegs); ++i) {
 			byte reg = rewriteRegs[i];
@@ -0,0 +1,118 @@
+// Throughput benchmark (and sanity check) for the SHA-1 and tiger(-tree)
+// hash implementations.
+// Not part of the regular build, compile it manually, e.g. (one command):
+//   g++ -O3 -std=c++11 -pthread -Isrc -Isrc/utils -Isrc/thread -Isrc/events
+//       -Iderived/<platform>-<flavour>/config
+//       src/utils/HashTest.cc src/utils/sha1.cc src/utils/tiger.cc
+//       src/utils/TigerTree.cc src/thread/Thread.cc src/utils/string_ref.cc
+//       src/utils/StringOp.cc src/MSXException.cc -lSDL
+//       -ffunction-sections -Wl,--gc-sections
+// (the last line drops SHA1::calcWithProgress(), it's not used here)
+
+#include "sha1.hh"
+#include "tiger.hh"
+#include "TigerTree.hh"
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+using namespace openmsx;
+
+
+static const size_t SIZE = 256 * 1024 * 1024; // a typical harddisk image
+
+class TestData : public TTData
+{
+public:
+	explicit TestData(vector<uint8_t>& buf_) : buf(buf_), time(1) {}
+	virtual uint8_t* getData(size_t offset, size_t /*size*/)
+	{
+		return &buf[offset + 1]; // buf[offset] is the spare byte
+	}
+	virtual bool isCacheStillValid(time_t& cacheTime)
+	{
+		bool result = cacheTime == time;
+		cacheTime = time;
+		return result;
+	}
+	vector<uint8_t>& buf;
+	time_t time;
+};
+
+// Straightforward (non-incremental, single threaded) tiger-tree-hash.
+static TigerHash refTTH(uint8_t* data, size_t size)
+{
+	TigerHash result;
+	if (size <= 1024) {
+		auto backup = data[-1];
+		data[-1] = 0;
+		tiger(data - 1, size + 1, result);
+		data[-1] = backup;
+	} else {
+		size_t left = 1024;
+		while ((2 * left) < size) left *= 2;
+		auto h0 = refTTH(data, left);
+		auto h1 = refTTH(data + left, size - left);
+		tiger_int(h0, h1, result);
+	}
+	return result;
+}
+
+template<typename F> static double measure(F f)
+{
+	auto start = chrono::high_resolution_clock::now();
+	f();
+	auto stop = chrono::high_resolution_clock::now();
+	return chrono::duration<double>(stop - start).count();
+}
+
+static void report(const char* name, size_t bytes, double seconds)
+{
+	cout << name << (bytes / (1024.0 * 1024.0)) / seconds << " MB/s" << endl;
+}
+
+int main()
+{
+	vector<uint8_t> buf(SIZE + 1);
+	for (auto& b : buf) b = rand();
+	uint8_t* data = &buf[1];
+	bool ok = true;
+
+	// "abc", from FIPS PUB 180-1
+	ok &= SHA1::calc(reinterpret_cast<const uint8_t*>("abc"), 3).toString()
+	      == "a9993e364706816aba3e25717850c26c9cd0d89d";
+	Sha1Sum sum;
+	report("sha1              ", SIZE,
+	       measure([&] { sum = SHA1::calc(data, SIZE); }));
+	SHA1 sha1; // same result when fed in odd-sized pieces
+	for (size_t pos = 0; pos < SIZE; pos += 1000) {
+		sha1.update(data + pos, min<size_t>(1000, SIZE - pos));
+	}
+	ok &= sha1.digest() == sum;
+
+	TigerHash hash;
+	report("tiger             ", SIZE,
+	       measure([&] { tiger(data, SIZE, hash); }));
+
+	TestData ttData(buf);
+	TigerTree tree(ttData, SIZE, "test");
+	report("tiger-tree (full) ", SIZE,
+	       measure([&] { hash = tree.calcHash(); }));
+	TigerHash ref = refTTH(data, SIZE);
+	ok &= hash.toString() == ref.toString();
+
+	// incremental update of a few sectors
+	for (int i = 0; i < 100; ++i) {
+		size_t pos = (size_t(rand()) * 512) % (SIZE - 512);
+		data[pos] ^= 1;
+		tree.notifyChange(pos, 512, ttData.time);
+	}
+	double t = measure([&] { hash = tree.calcHash(); });
+	cout << "tiger-tree (100 sectors changed) " << t * 1000.0 << " ms" << endl;
+	ok &= hash.toString() == refTTH(data, SIZE).toString();
+
+	cout << (ok ? "OK" : "MISMATCH") << endl;
+	return ok ? 0 : 1;
+}
@@ -5,6 +5,7 @@
 #include "likely.hh"
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 
 namespace openmsx {
 namespace Math {
@@ -201,6 +202,20 @@ inline unsigned countLeadingZeros(unsigned x)
 #endif
 }
 
+/** Count the number of 1-bits in the given word.
+  */
+inline unsigned countBits(uint64_t x)
+{
+#ifdef __GNUC__
+	return __builtin_popcountll(x);
+#else
+	x = x - ((x >> 1) & 0x5555555555555555ull);
+	x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+	x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+	return unsigned((x * 0x0101010101010101ull) >> 56);
+#endif
+}
+
 } // namespace Math
 } // namespace openmsx
 
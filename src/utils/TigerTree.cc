@@ -1,5 +1,20 @@
 #include "TigerTree.hh"
+#include "Thread.hh"
+#include "File.hh"
+#include "FileException.hh"
+#include "FileOperations.hh"
+#include "sha1.hh"
 #include "Math.hh"
+#include "endian.hh"
+#include "memory.hh"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <cstring>
 #include <cassert>
@@ -8,23 +23,41 @@ namespace openmsx {
 
 static const size_t BLOCK_SIZE = 1024;
 
+// Only when at least this many leaves need to be (re)calculated (e.g. the
+// first time for a big harddisk image), they're hashed on several threads.
+static const size_t PARALLEL_MIN_LEAVES = 4096;
+static const size_t BATCH_LEAVES = 256; // leaves per data buffer
+static const size_t CHUNK_LEAVES = 32;  // leaves per job for a thread
+static const unsigned MAX_THREADS = 8;
+
+// The nodes at this level and higher (each covering 64 blocks) are stored
+// in a cache file, so that the hash of a big harddisk image doesn't need to
+// be recalculated completely each time it's opened. That's only a small
+// fraction of all nodes (about 3MB for a 4GB image).
+static const size_t PERSIST_LEVEL = 64;
+static const char CACHE_MAGIC[8] = { 'o','M','S','X','t','t','h','c' };
+static const unsigned CACHE_VERSION = 1;
+static const size_t CACHE_HEADER_SIZE = 8 + 4 + 4 + 8 + 8;
+
 struct TTCacheEntry
 {
 	TTCacheEntry(const std::string& name_, size_t size_)
-		: name(name_), size(size_), time(-1) {}
+		: name(name_), size(size_), time(-1), changed(false) {}
 	// TODO use compiler generated versions once VS supports that
 	TTCacheEntry(TTCacheEntry&& other)
-		: hash (std::move(other.hash ))
-		, valid(std::move(other.valid))
-		, name (std::move(other.name ))
-		, size (std::move(other.size ))
-		, time (std::move(other.time )) {}
+		: hash   (std::move(other.hash   ))
+		, valid  (std::move(other.valid  ))
+		, name   (std::move(other.name   ))
+		, size   (std::move(other.size   ))
+		, time   (std::move(other.time   ))
+		, changed(std::move(other.changed)) {}
 	TTCacheEntry& operator=(TTCacheEntry&& other) {
-		hash  = std::move(other.hash );
-		valid = std::move(other.valid);
-		name  = std::move(other.name );
-		size  = std::move(other.size );
-		time  = std::move(other.time );
+		hash    = std::move(other.hash   );
+		valid   = std::move(other.valid  );
+		name    = std::move(other.name   );
+		size    = std::move(other.size   );
+		time    = std::move(other.time   );
+		changed = std::move(other.changed);
 		return *this;
 	}
 
@@ -33,9 +66,117 @@ struct TTCacheEntry
 	std::string name;
 	size_t size;
 	time_t time;
+	bool changed; // not yet stored in the cache file
 };
 // Typically contains 0 or 1 element, and only rarely 2 or more.
-static std::vector<TTCacheEntry> ttCache;
+// Must be a list: TigerTree objects keep a reference to their entry, so
+// adding an entry may not move the existing ones.
+static std::list<TTCacheEntry> ttCache;
+
+
+/** Hashes leaf blocks on several threads. TTData::getData() is not
+  * thread-safe, so the main thread fetches the data of the next batch of
+  * leaves while the threads hash the previous batch.
+  */
+class LeafHasher : private Runnable
+{
+public:
+	struct Batch {
+		Batch() : buf(BATCH_LEAVES * (BLOCK_SIZE + 1)), pending(0) {}
+		// each leaf is preceded by a spare byte, see tiger_leaf()
+		std::vector<uint8_t> buf;
+		std::vector<TigerHash*> results;
+		unsigned pending; // unfinished chunks, locked by mutex
+	};
+
+	explicit LeafHasher(unsigned numThreads);
+	~LeafHasher();
+
+	void submit(Batch& batch);
+	/** Wait till all leaves of the given batch are hashed. */
+	void wait(Batch& batch);
+
+private:
+	// Runnable
+	virtual void run();
+
+	struct Chunk {
+		Batch* batch;
+		size_t first, last;
+	};
+
+	std::vector<std::unique_ptr<Thread>> threads;
+	std::mutex mutex;
+	std::condition_variable chunkAvailable;
+	std::condition_variable chunkDone;
+	std::deque<Chunk> chunks; // locked by mutex
+	bool exitLoop;            // idem
+};
+
+LeafHasher::LeafHasher(unsigned numThreads)
+	: exitLoop(false)
+{
+	for (unsigned i = 0; i < numThreads; ++i) {
+		threads.push_back(make_unique<Thread>(
+			static_cast<Runnable*>(this)));
+		threads.back()->start();
+	}
+}
+
+LeafHasher::~LeafHasher()
+{
+	{
+		// normally there are no chunks left, except on error
+		std::lock_guard<std::mutex> lock(mutex);
+		exitLoop = true;
+	}
+	chunkAvailable.notify_all();
+	for (auto& t : threads) {
+		t->join();
+	}
+}
+
+void LeafHasher::submit(Batch& batch)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t i = 0; i < batch.results.size(); i += CHUNK_LEAVES) {
+			auto last = std::min(i + CHUNK_LEAVES, batch.results.size());
+			chunks.push_back(Chunk{&batch, i, last});
+			++batch.pending;
+		}
+	}
+	chunkAvailable.notify_all();
+}
+
+void LeafHasher::wait(Batch& batch)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	chunkDone.wait(lock, [&] { return batch.pending == 0; });
+}
+
+void LeafHasher::run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		chunkAvailable.wait(lock, [&] { return exitLoop || !chunks.empty(); });
+		if (exitLoop) return;
+
+		Chunk chunk = chunks.front();
+		chunks.pop_front();
+		lock.unlock();
+
+		auto& batch = *chunk.batch;
+		for (size_t i = chunk.first; i < chunk.last; ++i) {
+			tiger_leaf(&batch.buf[i * (BLOCK_SIZE + 1) + 1],
+			           *batch.results[i]);
+		}
+
+		lock.lock();
+		if (--batch.pending == 0) chunkDone.notify_all();
+	}
+}
+
 
 static size_t calcNumNodes(size_t dataSize)
 {
@@ -43,15 +184,99 @@ static size_t calcNumNodes(size_t dataSize)
 	return (numBlocks == 0) ? 1 : 2 * numBlocks - 1;
 }
 
+static bool isPersisted(size_t n)
+{
+	// the level of node 'n' is the lowest set bit of 'n + 1'
+	return ((n + 1) % PERSIST_LEVEL) == 0;
+}
+
+static std::string getCacheFileName(const std::string& name)
+{
+	return FileOperations::getUserDataDir() + "/tigertree/" +
+	       SHA1::calc(reinterpret_cast<const uint8_t*>(name.data()),
+	                  name.size()).toString();
+}
+
+// Cache file layout (little endian): 8 byte magic, L32 version, L32 length
+// of the name, L64 data size, L64 modification time, the name, and then for
+// all persisted nodes: one byte 'valid' flag plus the 24 byte hash.
+static void loadCacheFile(TTCacheEntry& entry)
+{
+	try {
+		File file(getCacheFileName(entry.name));
+		size_t fileSize;
+		const uint8_t* buf = file.mmap(fileSize);
+		if ((fileSize < CACHE_HEADER_SIZE) ||
+		    (memcmp(buf, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0) ||
+		    (Endian::read_UA_L32(buf +  8) != CACHE_VERSION) ||
+		    (Endian::read_UA_L32(buf + 12) != entry.name.size()) ||
+		    (Endian::read_UA_L64(buf + 16) != entry.size)) {
+			return;
+		}
+		size_t numNodes = calcNumNodes(entry.size);
+		size_t numPersisted = numNodes / PERSIST_LEVEL;
+		size_t expected = CACHE_HEADER_SIZE + entry.name.size() +
+		                  numPersisted * (1 + sizeof(TigerHash));
+		const uint8_t* p = buf + CACHE_HEADER_SIZE;
+		if ((fileSize != expected) ||
+		    (memcmp(p, entry.name.data(), entry.name.size()) != 0)) {
+			return;
+		}
+		p += entry.name.size();
+
+		entry.hash .resize(numNodes);
+		entry.valid.resize(numNodes);
+		memset(entry.valid.data(), 0, numNodes); // all invalid
+		for (size_t n = PERSIST_LEVEL - 1; n < numNodes; n += PERSIST_LEVEL) {
+			entry.valid[n] = *p++ != 0;
+			memcpy(entry.hash[n].h8, p, sizeof(TigerHash));
+			p += sizeof(TigerHash);
+		}
+		// validated against the actual file in getCacheEntry()
+		entry.time = time_t(Endian::read_UA_L64(buf + 24));
+	} catch (FileException&) {
+		// no (valid) cache file
+	}
+}
+
+static void saveCacheFile(const TTCacheEntry& entry)
+{
+	size_t numNodes = entry.valid.size();
+	std::vector<uint8_t> buf(CACHE_HEADER_SIZE);
+	memcpy(buf.data(), CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	Endian::write_UA_L32(&buf[ 8], CACHE_VERSION);
+	Endian::write_UA_L32(&buf[12], unsigned(entry.name.size()));
+	Endian::write_UA_L64(&buf[16], entry.size);
+	Endian::write_UA_L64(&buf[24], uint64_t(entry.time));
+	buf.insert(buf.end(), entry.name.begin(), entry.name.end());
+	for (size_t n = PERSIST_LEVEL - 1; n < numNodes; n += PERSIST_LEVEL) {
+		buf.push_back(entry.valid[n] ? 1 : 0);
+		buf.insert(buf.end(), entry.hash[n].h8,
+		           entry.hash[n].h8 + sizeof(TigerHash));
+	}
+
+	std::string filename = getCacheFileName(entry.name);
+	FileOperations::mkdirp(FileOperations::getBaseName(filename));
+	std::string tmpName = filename + ".tmp";
+	{
+		File file(tmpName, File::TRUNCATE);
+		file.write(buf.data(), buf.size());
+	}
+	if (FileOperations::rename(tmpName, filename) != 0) {
+		FileOperations::unlink(tmpName);
+	}
+}
+
 static TTCacheEntry& getCacheEntry(
-	TTData& data, size_t dataSize, const std::string& name)
+	TTData& data, size_t dataSize, const std::string& name, bool persistent)
 {
 	auto it = find_if(ttCache.begin(), ttCache.end(),
 		[&](const TTCacheEntry& e) {
 			return (e.size == dataSize) && (e.name == name); });
 	if (it == ttCache.end()) {
 		ttCache.emplace_back(name, dataSize);
-		it = ttCache.end() - 1;
+		it = std::prev(ttCache.end());
+		if (persistent) loadCacheFile(*it);
 	}
 
 	size_t numNodes = calcNumNodes(dataSize);
@@ -66,15 +291,29 @@ static TTCacheEntry& getCacheEntry(
 	return *it;
 }
 
-TigerTree::TigerTree(TTData& data_, size_t dataSize_, const std::string& name)
+TigerTree::TigerTree(TTData& data_, size_t dataSize_, const std::string& name,
+                     bool persistent_)
 	: data(data_)
 	, dataSize(dataSize_)
-	, entry(getCacheEntry(data, dataSize, name))
+	, entry(getCacheEntry(data, dataSize, name, persistent_))
+	, persistent(persistent_)
 {
 }
 
+TigerTree::~TigerTree()
+{
+	if (!persistent || !entry.changed) return;
+	entry.changed = false;
+	try {
+		saveCacheFile(entry);
+	} catch (FileException&) {
+		// ignore, it's only a cache
+	}
+}
+
 const TigerHash& TigerTree::calcHash()
 {
+	hashLeaves();
 	return calcHash(getTop());
 }
 
@@ -85,14 +324,19 @@ void TigerTree::notifyChange(size_t offset, size_t len, time_t time)
 	assert((offset + len) <= dataSize);
 	if (len == 0) return;
 
-	entry.valid[getTop().n] = false; // set sentinel
+	entry.changed = true;
+	auto top = getTop();
 	auto first = offset / BLOCK_SIZE;
 	auto last = (offset + len - 1) / BLOCK_SIZE;
 	assert(first <= last); // requires len != 0
 	do {
+		// Walk up till an invalid node (all its ancestors are invalid
+		// as well). Though after loading the cache file, nodes below
+		// PERSIST_LEVEL are invalid while their parents can be valid.
 		auto node = getLeaf(first);
-		while (entry.valid[node.n]) {
+		while (entry.valid[node.n] || (node.l < PERSIST_LEVEL)) {
 			entry.valid[node.n] = false;
+			if (node.n == top.n) break;
 			node = getParent(node);
 		}
 	} while (++first <= last);
@@ -109,6 +353,7 @@ const TigerHash& TigerTree::calcHash(Node node)
 			auto& h1 = calcHash(left);
 			auto& h2 = calcHash(right);
 			tiger_int(h1, h2, entry.hash[n]);
+			if (isPersisted(n)) entry.changed = true;
 		} else {
 			// leaf node
 			size_t b = n * (BLOCK_SIZE / 2);
@@ -131,6 +376,53 @@ const TigerHash& TigerTree::calcHash(Node node)
 	return entry.hash[n];
 }
 
+void TigerTree::collectLeaves(Node node, std::vector<size_t>& leaves) const
+{
+	// a valid node implies its whole subtree is valid
+	if (entry.valid[node.n]) return;
+	if (node.l == 1) {
+		// the (partial) last block is left for calcHash(Node)
+		if ((node.n * (BLOCK_SIZE / 2) + BLOCK_SIZE) <= dataSize) {
+			leaves.push_back(node.n);
+		}
+	} else {
+		collectLeaves(getLeftChild (node), leaves);
+		collectLeaves(getRightChild(node), leaves);
+	}
+}
+
+void TigerTree::hashLeaves()
+{
+	std::vector<size_t> leaves;
+	collectLeaves(getTop(), leaves);
+	if (leaves.size() < PARALLEL_MIN_LEAVES) return;
+	unsigned numThreads = std::min(std::thread::hardware_concurrency(),
+	                               MAX_THREADS);
+	if (numThreads < 2) return;
+
+	LeafHasher::Batch batches[2]; // must outlive 'hasher'
+	LeafHasher hasher(numThreads);
+	for (size_t i = 0, b = 0; i < leaves.size(); i += BATCH_LEAVES, b ^= 1) {
+		auto& batch = batches[b];
+		hasher.wait(batch); // buffer still in use by the threads?
+		batch.results.clear();
+		auto num = std::min(BATCH_LEAVES, leaves.size() - i);
+		for (size_t j = 0; j < num; ++j) {
+			auto n = leaves[i + j];
+			memcpy(&batch.buf[j * (BLOCK_SIZE + 1) + 1],
+			       data.getData(n * (BLOCK_SIZE / 2), BLOCK_SIZE),
+			       BLOCK_SIZE);
+			batch.results.push_back(&entry.hash[n]);
+		}
+		hasher.submit(batch);
+	}
+	hasher.wait(batches[0]);
+	hasher.wait(batches[1]);
+	for (auto n : leaves) {
+		entry.valid[n] = true;
+	}
+}
+
 
 // The TigerTree::nodes member variable stores a linearized binary tree. The
 // linearization is done like in this example:
@@ -31,6 +31,7 @@
 #include "tiger.hh"
 #include "MemBuffer.hh"
 #include <string>
+#include <vector>
 #include <cstdint>
 #include <ctime>
 
@@ -72,9 +73,16 @@ class TigerTree
 {
 public:
 	/** Create TigerTree calculator for the given (abstract) data block
-	 * of given size.
+	 * of given size. A non-persistent tree doesn't use the cache file
+	 * (e.g. for data that only exists in this session).
 	 */
-	TigerTree(TTData& data, size_t dataSize, const std::string& name);
+	TigerTree(TTData& data, size_t dataSize, const std::string& name,
+	          bool persistent = true);
+
+	/** Stores the upper levels of the tree in a cache file, so that a
+	 * next session (for the same, unmodified data) can reuse them.
+	 */
+	~TigerTree();
 
 	/** Calculate the hash value.
 	 */
@@ -84,6 +92,7 @@ public:
 	 * used to (not) skip re-calculations on future calcHash() calls. So
 	 * it's crucial this calculator is informed about  _all_ changes in
 	 * the input.
+	 * A call with len == 0 only updates the modification time.
 	 */
 	void notifyChange(size_t offset, size_t len, time_t time);
 
@@ -101,10 +110,13 @@ private:
 	Node getRightChild(Node node) const;
 
 	const TigerHash& calcHash(Node node);
+	void collectLeaves(Node node, std::vector<size_t>& leaves) const;
+	void hashLeaves();
 
 	TTData& data;
 	const size_t dataSize;
 	TTCacheEntry& entry;
+	const bool persistent;
 };
 
 } // namespace openmsx
@@ -27,6 +27,25 @@ A million repetitions of "a"
 #include <cassert>
 #include <cstring>
 
+// SHA-1 instructions: on x86 they are used when the CPU supports them (the
+// rest of the code is compiled for a generic CPU), on ARM only when the
+// compiler already targets a CPU with the crypto extensions.
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ >= 5)))
+#define SHA1_X86_SHA 1
+#define SHA1_TARGET __attribute__((target("sha,ssse3,sse4.1")))
+#include <immintrin.h>
+#include <cpuid.h>
+#elif (defined(_M_X64) || defined(_M_IX86)) && defined(_MSC_VER) && (_MSC_VER >= 1800)
+#define SHA1_X86_SHA 1
+#define SHA1_TARGET
+#include <immintrin.h>
+#include <intrin.h>
+#elif defined(__ARM_FEATURE_CRYPTO)
+#define SHA1_ARM_SHA 1
+#include <arm_neon.h>
+#endif
+
 using std::string;
 
 namespace openmsx {
@@ -143,6 +162,19 @@ std::string Sha1Sum::toString() const
 	return string(buf, 40);
 }
 
+void Sha1Sum::fromBinary(const uint8_t* data)
+{
+	for (int i = 0; i < 5; ++i) {
+		a[i] = Endian::read_UA_B32(data + 4 * i);
+	}
+}
+void Sha1Sum::toBinary(uint8_t* data) const
+{
+	for (int i = 0; i < 5; ++i) {
+		Endian::write_UA_B32(data + 4 * i, a[i]);
+	}
+}
+
 bool Sha1Sum::empty() const
 {
 	for (int i = 0; i < 5; ++i) {
@@ -193,52 +225,396 @@ SHA1::SHA1()
 	m_finalized = false;
 }
 
-void SHA1::transform(const uint8_t buffer[64])
+// Process 'num' 64-byte blocks.
+static void transformScalar(uint32_t state[5], const uint8_t* data, size_t num)
+{
+	for (/**/; num; --num, data += 64) {
+		WorkspaceBlock block(data);
+
+		// Copy state[] to working vars
+		uint32_t a = state[0];
+		uint32_t b = state[1];
+		uint32_t c = state[2];
+		uint32_t d = state[3];
+		uint32_t e = state[4];
+
+		// 4 rounds of 20 operations each. Loop unrolled
+		block.r0(a,b,c,d,e, 0); block.r0(e,a,b,c,d, 1); block.r0(d,e,a,b,c, 2);
+		block.r0(c,d,e,a,b, 3); block.r0(b,c,d,e,a, 4); block.r0(a,b,c,d,e, 5);
+		block.r0(e,a,b,c,d, 6); block.r0(d,e,a,b,c, 7); block.r0(c,d,e,a,b, 8);
+		block.r0(b,c,d,e,a, 9); block.r0(a,b,c,d,e,10); block.r0(e,a,b,c,d,11);
+		block.r0(d,e,a,b,c,12); block.r0(c,d,e,a,b,13); block.r0(b,c,d,e,a,14);
+		block.r0(a,b,c,d,e,15); block.r1(e,a,b,c,d,16); block.r1(d,e,a,b,c,17);
+		block.r1(c,d,e,a,b,18); block.r1(b,c,d,e,a,19); block.r2(a,b,c,d,e,20);
+		block.r2(e,a,b,c,d,21); block.r2(d,e,a,b,c,22); block.r2(c,d,e,a,b,23);
+		block.r2(b,c,d,e,a,24); block.r2(a,b,c,d,e,25); block.r2(e,a,b,c,d,26);
+		block.r2(d,e,a,b,c,27); block.r2(c,d,e,a,b,28); block.r2(b,c,d,e,a,29);
+		block.r2(a,b,c,d,e,30); block.r2(e,a,b,c,d,31); block.r2(d,e,a,b,c,32);
+		block.r2(c,d,e,a,b,33); block.r2(b,c,d,e,a,34); block.r2(a,b,c,d,e,35);
+		block.r2(e,a,b,c,d,36); block.r2(d,e,a,b,c,37); block.r2(c,d,e,a,b,38);
+		block.r2(b,c,d,e,a,39); block.r3(a,b,c,d,e,40); block.r3(e,a,b,c,d,41);
+		block.r3(d,e,a,b,c,42); block.r3(c,d,e,a,b,43); block.r3(b,c,d,e,a,44);
+		block.r3(a,b,c,d,e,45); block.r3(e,a,b,c,d,46); block.r3(d,e,a,b,c,47);
+		block.r3(c,d,e,a,b,48); block.r3(b,c,d,e,a,49); block.r3(a,b,c,d,e,50);
+		block.r3(e,a,b,c,d,51); block.r3(d,e,a,b,c,52); block.r3(c,d,e,a,b,53);
+		block.r3(b,c,d,e,a,54); block.r3(a,b,c,d,e,55); block.r3(e,a,b,c,d,56);
+		block.r3(d,e,a,b,c,57); block.r3(c,d,e,a,b,58); block.r3(b,c,d,e,a,59);
+		block.r4(a,b,c,d,e,60); block.r4(e,a,b,c,d,61); block.r4(d,e,a,b,c,62);
+		block.r4(c,d,e,a,b,63); block.r4(b,c,d,e,a,64); block.r4(a,b,c,d,e,65);
+		block.r4(e,a,b,c,d,66); block.r4(d,e,a,b,c,67); block.r4(c,d,e,a,b,68);
+		block.r4(b,c,d,e,a,69); block.r4(a,b,c,d,e,70); block.r4(e,a,b,c,d,71);
+		block.r4(d,e,a,b,c,72); block.r4(c,d,e,a,b,73); block.r4(b,c,d,e,a,74);
+		block.r4(a,b,c,d,e,75); block.r4(e,a,b,c,d,76); block.r4(d,e,a,b,c,77);
+		block.r4(c,d,e,a,b,78); block.r4(b,c,d,e,a,79);
+
+		// Add the working vars back into state[]
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+	}
+}
+
+#ifdef SHA1_X86_SHA
+SHA1_TARGET
+static void transformShaExt(uint32_t state[5], const uint8_t* data, size_t num)
 {
-	WorkspaceBlock block(buffer);
-
-	// Copy m_state[] to working vars
-	uint32_t a = m_state.a[0];
-	uint32_t b = m_state.a[1];
-	uint32_t c = m_state.a[2];
-	uint32_t d = m_state.a[3];
-	uint32_t e = m_state.a[4];
-
-	// 4 rounds of 20 operations each. Loop unrolled
-	block.r0(a,b,c,d,e, 0); block.r0(e,a,b,c,d, 1); block.r0(d,e,a,b,c, 2);
-	block.r0(c,d,e,a,b, 3); block.r0(b,c,d,e,a, 4); block.r0(a,b,c,d,e, 5);
-	block.r0(e,a,b,c,d, 6); block.r0(d,e,a,b,c, 7); block.r0(c,d,e,a,b, 8);
-	block.r0(b,c,d,e,a, 9); block.r0(a,b,c,d,e,10); block.r0(e,a,b,c,d,11);
-	block.r0(d,e,a,b,c,12); block.r0(c,d,e,a,b,13); block.r0(b,c,d,e,a,14);
-	block.r0(a,b,c,d,e,15); block.r1(e,a,b,c,d,16); block.r1(d,e,a,b,c,17);
-	block.r1(c,d,e,a,b,18); block.r1(b,c,d,e,a,19); block.r2(a,b,c,d,e,20);
-	block.r2(e,a,b,c,d,21); block.r2(d,e,a,b,c,22); block.r2(c,d,e,a,b,23);
-	block.r2(b,c,d,e,a,24); block.r2(a,b,c,d,e,25); block.r2(e,a,b,c,d,26);
-	block.r2(d,e,a,b,c,27); block.r2(c,d,e,a,b,28); block.r2(b,c,d,e,a,29);
-	block.r2(a,b,c,d,e,30); block.r2(e,a,b,c,d,31); block.r2(d,e,a,b,c,32);
-	block.r2(c,d,e,a,b,33); block.r2(b,c,d,e,a,34); block.r2(a,b,c,d,e,35);
-	block.r2(e,a,b,c,d,36); block.r2(d,e,a,b,c,37); block.r2(c,d,e,a,b,38);
-	block.r2(b,c,d,e,a,39); block.r3(a,b,c,d,e,40); block.r3(e,a,b,c,d,41);
-	block.r3(d,e,a,b,c,42); block.r3(c,d,e,a,b,43); block.r3(b,c,d,e,a,44);
-	block.r3(a,b,c,d,e,45); block.r3(e,a,b,c,d,46); block.r3(d,e,a,b,c,47);
-	block.r3(c,d,e,a,b,48); block.r3(b,c,d,e,a,49); block.r3(a,b,c,d,e,50);
-	block.r3(e,a,b,c,d,51); block.r3(d,e,a,b,c,52); block.r3(c,d,e,a,b,53);
-	block.r3(b,c,d,e,a,54); block.r3(a,b,c,d,e,55); block.r3(e,a,b,c,d,56);
-	block.r3(d,e,a,b,c,57); block.r3(c,d,e,a,b,58); block.r3(b,c,d,e,a,59);
-	block.r4(a,b,c,d,e,60); block.r4(e,a,b,c,d,61); block.r4(d,e,a,b,c,62);
-	block.r4(c,d,e,a,b,63); block.r4(b,c,d,e,a,64); block.r4(a,b,c,d,e,65);
-	block.r4(e,a,b,c,d,66); block.r4(d,e,a,b,c,67); block.r4(c,d,e,a,b,68);
-	block.r4(b,c,d,e,a,69); block.r4(a,b,c,d,e,70); block.r4(e,a,b,c,d,71);
-	block.r4(d,e,a,b,c,72); block.r4(c,d,e,a,b,73); block.r4(b,c,d,e,a,74);
-	block.r4(a,b,c,d,e,75); block.r4(e,a,b,c,d,76); block.r4(d,e,a,b,c,77);
-	block.r4(c,d,e,a,b,78); block.r4(b,c,d,e,a,79);
-
-	// Add the working vars back into m_state[]
-	m_state.a[0] += a;
-	m_state.a[1] += b;
-	m_state.a[2] += c;
-	m_state.a[3] += d;
-	m_state.a[4] += e;
+	const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL,
+	                                    0x08090a0b0c0d0e0fULL);
+	__m128i abcd = _mm_shuffle_epi32(
+		_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1B);
+	__m128i e0 = _mm_set_epi32(state[4], 0, 0, 0);
+
+	for (/**/; num; --num, data += 64) {
+		__m128i abcdSave = abcd;
+		__m128i e0Save = e0;
+		__m128i e1;
+		auto* p = reinterpret_cast<const __m128i*>(data);
+		__m128i msg0 = _mm_shuffle_epi8(_mm_loadu_si128(p + 0), mask);
+		__m128i msg1 = _mm_shuffle_epi8(_mm_loadu_si128(p + 1), mask);
+		__m128i msg2 = _mm_shuffle_epi8(_mm_loadu_si128(p + 2), mask);
+		__m128i msg3 = _mm_shuffle_epi8(_mm_loadu_si128(p + 3), mask);
+
+		// rounds 0-3
+		e0 = _mm_add_epi32(e0, msg0);
+		e1 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+		// rounds 4-7
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+		msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+		// rounds 8-11
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+		msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+		msg0 = _mm_xor_si128(msg0, msg2);
+		// rounds 12-15
+		e1 = _mm_sha1nexte_epu32(e1, msg3);
+		e0 = abcd;
+		msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+		msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+		msg1 = _mm_xor_si128(msg1, msg3);
+		// rounds 16-19
+		e0 = _mm_sha1nexte_epu32(e0, msg0);
+		e1 = abcd;
+		msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+		msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+		msg2 = _mm_xor_si128(msg2, msg0);
+		// rounds 20-23
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+		msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+		msg3 = _mm_xor_si128(msg3, msg1);
+		// rounds 24-27
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+		msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+		msg0 = _mm_xor_si128(msg0, msg2);
+		// rounds 28-31
+		e1 = _mm_sha1nexte_epu32(e1, msg3);
+		e0 = abcd;
+		msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+		msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+		msg1 = _mm_xor_si128(msg1, msg3);
+		// rounds 32-35
+		e0 = _mm_sha1nexte_epu32(e0, msg0);
+		e1 = abcd;
+		msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+		msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+		msg2 = _mm_xor_si128(msg2, msg0);
+		// rounds 36-39
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 1);
+		msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+		msg3 = _mm_xor_si128(msg3, msg1);
+		// rounds 40-43
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+		msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+		msg0 = _mm_xor_si128(msg0, msg2);
+		// rounds 44-47
+		e1 = _mm_sha1nexte_epu32(e1, msg3);
+		e0 = abcd;
+		msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+		msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+		msg1 = _mm_xor_si128(msg1, msg3);
+		// rounds 48-51
+		e0 = _mm_sha1nexte_epu32(e0, msg0);
+		e1 = abcd;
+		msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+		msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+		msg2 = _mm_xor_si128(msg2, msg0);
+		// rounds 52-55
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 2);
+		msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+		msg3 = _mm_xor_si128(msg3, msg1);
+		// rounds 56-59
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+		msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+		msg0 = _mm_xor_si128(msg0, msg2);
+		// rounds 60-63
+		e1 = _mm_sha1nexte_epu32(e1, msg3);
+		e0 = abcd;
+		msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+		msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+		msg1 = _mm_xor_si128(msg1, msg3);
+		// rounds 64-67
+		e0 = _mm_sha1nexte_epu32(e0, msg0);
+		e1 = abcd;
+		msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+		msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+		msg2 = _mm_xor_si128(msg2, msg0);
+		// rounds 68-71
+		e1 = _mm_sha1nexte_epu32(e1, msg1);
+		e0 = abcd;
+		msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+		msg3 = _mm_xor_si128(msg3, msg1);
+		// rounds 72-75
+		e0 = _mm_sha1nexte_epu32(e0, msg2);
+		e1 = abcd;
+		msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+		abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+		// rounds 76-79
+		e1 = _mm_sha1nexte_epu32(e1, msg3);
+		e0 = abcd;
+		abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+		e0 = _mm_sha1nexte_epu32(e0, e0Save);
+		abcd = _mm_add_epi32(abcd, abcdSave);
+	}
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(state),
+	                 _mm_shuffle_epi32(abcd, 0x1B));
+	state[4] = _mm_extract_epi32(e0, 3);
+}
+
+static bool hasShaExt()
+{
+#ifdef _MSC_VER
+	int regs[4];
+	__cpuid(regs, 0);
+	if (regs[0] < 7) return false;
+	__cpuid(regs, 1);
+	unsigned ecx1 = regs[2];
+	__cpuidex(regs, 7, 0);
+	unsigned ebx7 = regs[1];
+#else
+	if (__get_cpuid_max(0, nullptr) < 7) return false;
+	unsigned eax, ebx, ecx, edx, ecx1, ebx7;
+	__cpuid(1, eax, ebx, ecx1, edx);
+	__cpuid_count(7, 0, eax, ebx7, ecx, edx);
+#endif
+	bool ssse3  = (ecx1 & (1 <<  9)) != 0;
+	bool sse41  = (ecx1 & (1 << 19)) != 0;
+	bool sha    = (ebx7 & (1 << 29)) != 0;
+	return ssse3 && sse41 && sha;
+}
+#endif
+
+#ifdef SHA1_ARM_SHA
+static void transformShaExt(uint32_t state[5], const uint8_t* data, size_t num)
+{
+	const uint32x4_t k0 = vdupq_n_u32(0x5A827999);
+	const uint32x4_t k1 = vdupq_n_u32(0x6ED9EBA1);
+	const uint32x4_t k2 = vdupq_n_u32(0x8F1BBCDC);
+	const uint32x4_t k3 = vdupq_n_u32(0xCA62C1D6);
+
+	uint32x4_t abcd = vld1q_u32(&state[0]);
+	uint32_t e0 = state[4];
+
+	for (/**/; num; --num, data += 64) {
+		uint32x4_t abcdSave = abcd;
+		uint32_t e0Save = e0;
+		uint32_t e1;
+		uint32x4_t msg0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data +  0)));
+		uint32x4_t msg1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16)));
+		uint32x4_t msg2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 32)));
+		uint32x4_t msg3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 48)));
+		uint32x4_t tmp0 = vaddq_u32(msg0, k0);
+		uint32x4_t tmp1 = vaddq_u32(msg1, k0);
+
+		// rounds 0-3
+		e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1cq_u32(abcd, e0, tmp0);
+		tmp0 = vaddq_u32(msg2, k0);
+		msg0 = vsha1su0q_u32(msg0, msg1, msg2);
+		// rounds 4-7
+		e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1cq_u32(abcd, e1, tmp1);
+		tmp1 = vaddq_u32(msg3, k0);
+		msg0 = vsha1su1q_u32(msg0, msg3);
+		msg1 = vsha1su0q_u32(msg1, msg2, msg3);
+		// rounds 8-11
+		e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1cq_u32(abcd, e0, tmp0);
+		tmp0 = vaddq_u32(msg0, k0);
+		msg1 = vsha1su1q_u32(msg1, msg0);
+		msg2 = vsha1su0q_u32(msg2, msg3, msg0);
+		// rounds 12-15
+		e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1cq_u32(abcd, e1, tmp1);
+		tmp1 = vaddq_u32(msg1, k1);
+		msg2 = vsha1su1q_u32(msg2, msg1);
+		msg3 = vsha1su0q_u32(msg3, msg0, msg1);
+		// rounds 16-19
+		e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1cq_u32(abcd, e0, tmp0);
+		tmp0 = vaddq_u32(msg2, k1);
+		msg3 = vsha1su1q_u32(msg3, msg2);
+		msg0 = vsha1su0q_u32(msg0, msg1, msg2);
+		// rounds 20-23
+		e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1pq_u32(abcd, e1, tmp1);
+		tmp1 = vaddq_u32(msg3, k1);
+		msg0 = vsha1su1q_u32(msg0, msg3);
+		msg1 = vsha1su0q_u32(msg1, msg2, msg3);
+		// rounds 24-27
+		e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1pq_u32(abcd, e0, tmp0);
+		tmp0 = vaddq_u32(msg0, k1);
+		msg1 = vsha1su1q_u32(msg1, msg0);
+		msg2 = vsha1su0q_u32(msg2, msg3, msg0);
+		// rounds 28-31
+		e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1pq_u32(abcd, e1, tmp1);
+		tmp1 = vaddq_u32(msg1, k1);
+		msg2 = vsha1su1q_u32(msg2, msg1);
+		msg3 = vsha1su0q_u32(msg3, msg0, msg1);
+		// rounds 32-35
+		e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1pq_u32(abcd, e0, tmp0);
+		tmp0 = vaddq_u32(msg2, k2);
+		msg3 = vsha1su1q_u32(msg3, msg2);
+		msg0 = vsha1su0q_u32(msg0, msg1, msg2);
+		// rounds 36-39
+		e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1pq_u32(abcd, e1, tmp1);
+		tmp1 = vaddq_u32(msg3, k2);
+		msg0 = vsha1su1q_u32(msg0, msg3);
+		msg1 = vsha1su0q_u32(msg1, msg2, msg3);
+		// rounds 40-43
+		e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1mq_u32(abcd, e0, tmp0);
+		tmp0 = vaddq_u32(msg0, k2);
+		msg1 = vsha1su1q_u32(msg1, msg0);
+		msg2 = vsha1su0q_u32(msg2, msg3, msg0);
+		// rounds 44-47
+		e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1mq_u32(abcd, e1, tmp1);
+		tmp1 = vaddq_u32(msg1, k2);
+		msg2 = vsha1su1q_u32(msg2, msg1);
+		msg3 = vsha1su0q_u32(msg3, msg0, msg1);
+		// rounds 48-51
+		e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1mq_u32(abcd, e0, tmp0);
+		tmp0 = vaddq_u32(msg2, k2);
+		msg3 = vsha1su1q_u32(msg3, msg2);
+		msg0 = vsha1su0q_u32(msg0, msg1, msg2);
+		// rounds 52-55
+		e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1mq_u32(abcd, e1, tmp1);
+		tmp1 = vaddq_u32(msg3, k3);
+		msg0 = vsha1su1q_u32(msg0, msg3);
+		msg1 = vsha1su0q_u32(msg1, msg2, msg3);
+		// rounds 56-59
+		e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1mq_u32(abcd, e0, tmp0);
+		tmp0 = vaddq_u32(msg0, k3);
+		msg1 = vsha1su1q_u32(msg1, msg0);
+		msg2 = vsha1su0q_u32(msg2, msg3, msg0);
+		// rounds 60-63
+		e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1pq_u32(abcd, e1, tmp1);
+		tmp1 = vaddq_u32(msg1, k3);
+		msg2 = vsha1su1q_u32(msg2, msg1);
+		msg3 = vsha1su0q_u32(msg3, msg0, msg1);
+		// rounds 64-67
+		e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1pq_u32(abcd, e0, tmp0);
+		tmp0 = vaddq_u32(msg2, k3);
+		msg3 = vsha1su1q_u32(msg3, msg2);
+		// rounds 68-71
+		e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1pq_u32(abcd, e1, tmp1);
+		tmp1 = vaddq_u32(msg3, k3);
+		// rounds 72-75
+		e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1pq_u32(abcd, e0, tmp0);
+		// rounds 76-79
+		e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+		abcd = vsha1pq_u32(abcd, e1, tmp1);
+
+		e0 += e0Save;
+		abcd = vaddq_u32(abcd, abcdSave);
+	}
+
+	vst1q_u32(&state[0], abcd);
+	state[4] = e0;
+}
+#endif
+
+typedef void (*TransformFunc)(uint32_t state[5], const uint8_t* data, size_t num);
+static TransformFunc selectTransform()
+{
+#if defined(SHA1_X86_SHA)
+	return hasShaExt() ? transformShaExt : transformScalar;
+#elif defined(SHA1_ARM_SHA)
+	return transformShaExt;
+#else
+	return transformScalar;
+#endif
+}
+
+void SHA1::transform(const uint8_t* data, size_t num)
+{
+	static const TransformFunc func = selectTransform();
+	func(m_state.a, data, num);
 }
 
 // Use this function to hash in binary data and strings
@@ -249,13 +625,13 @@ void SHA1::update(const uint8_t* data, size_t len)
 
 	m_count += uint64_t(len) << 3;
 
-	uint32_t i;
+	size_t i;
 	if ((j + len) > 63) {
 		memcpy(&m_buffer[j], data, (i = 64 - j));
-		transform(m_buffer);
-		for (; i + 63 < len; i += 64) {
-			transform(&data[i]);
-		}
+		transform(m_buffer, 1);
+		size_t num = (len - i) / 64;
+		transform(&data[i], num);
+		i += num * 64;
 		j = 0;
 	} else {
 		i = 0;
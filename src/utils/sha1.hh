@@ -26,6 +26,13 @@ public:
 	void parse40(const char* str);
 	std::string toString() const;
 
+	/** Convert from/to a 20-byte binary representation (big endian).
+	  * Comparing two such representations with memcmp() gives the same
+	  * order as operator<.
+	  */
+	void fromBinary(const uint8_t* data);
+	void toBinary(uint8_t* data) const;
+
 	// Test or set 'null' value.
 	bool empty() const;
 	void clear();
@@ -76,7 +83,7 @@ public:
 			EventDistributor& distributor);
 
 private:
-	void transform(const uint8_t buffer[64]);
+	void transform(const uint8_t* data, size_t num);
 	void finalize();
 
 	uint64_t m_count;
@@ -3,6 +3,7 @@
 #include "Renderer.hh"
 #include "Math.hh"
 #include "SimpleDebuggable.hh"
+#include "MSXMotherBoard.hh"
 #include "serialize.hh"
 #include "memory.hh"
 #include <algorithm>
@@ -47,6 +48,8 @@ public:
 	explicit LogicalVRAMDebuggable(VDP& vdp);
 	virtual byte read(unsigned address, EmuTime::param time);
 	virtual void write(unsigned address, byte value, EmuTime::param time);
+	virtual void readBlock(unsigned start, byte* output, unsigned num);
+	virtual void writeBlock(unsigned start, const byte* input, unsigned num);
 private:
 	unsigned transform(unsigned address);
 	VDP& vdp;
@@ -79,6 +82,28 @@ void LogicalVRAMDebuggable::write(unsigned address, byte value, EmuTime::param t
 	vdp.getVRAM().cpuWrite(transform(address), value, time);
 }
 
+void LogicalVRAMDebuggable::readBlock(unsigned start, byte* output, unsigned num)
+{
+	auto time = getMotherBoard().getCurrentTime();
+	auto& vram = vdp.getVRAM();
+	if (!vdp.getDisplayMode().isPlanar()) {
+		vram.cpuReadBlock(start, output, num, time);
+	} else {
+		for (unsigned i = 0; i < num; ++i) {
+			output[i] = vram.cpuRead(transform(start + i), time);
+		}
+	}
+}
+
+void LogicalVRAMDebuggable::writeBlock(unsigned start, const byte* input, unsigned num)
+{
+	auto time = getMotherBoard().getCurrentTime();
+	auto& vram = vdp.getVRAM();
+	for (unsigned i = 0; i < num; ++i) {
+		vram.cpuWrite(transform(start + i), input[i], time);
+	}
+}
+
 
 // class PhysicalVRAMDebuggable
 
@@ -88,6 +113,8 @@ public:
 	PhysicalVRAMDebuggable(VDP& vdp, VDPVRAM& vram, unsigned actualSize);
 	virtual byte read(unsigned address, EmuTime::param time);
 	virtual void write(unsigned address, byte value, EmuTime::param time);
+	virtual void readBlock(unsigned start, byte* output, unsigned num);
+	virtual void writeBlock(unsigned start, const byte* input, unsigned num);
 private:
 	VDPVRAM& vram;
 };
@@ -113,6 +140,19 @@ void PhysicalVRAMDebuggable::write(unsigned address, byte value, EmuTime::param
 	vram.cpuWrite(address, value, time);
 }
 
+void PhysicalVRAMDebuggable::readBlock(unsigned start, byte* output, unsigned num)
+{
+	vram.cpuReadBlock(start, output, num, getMotherBoard().getCurrentTime());
+}
+
+void PhysicalVRAMDebuggable::writeBlock(unsigned start, const byte* input, unsigned num)
+{
+	auto time = getMotherBoard().getCurrentTime();
+	for (unsigned i = 0; i < num; ++i) {
+		vram.cpuWrite(start + i, input[i], time);
+	}
+}
+
 
 // class VDPVRAM
 
@@ -458,6 +458,23 @@ public:
 		return data[address];
 	}
 
+	/** Same as cpuRead() for 'num' consecutive addresses, but the
+	  * command engine is synced at most once.
+	  */
+	void cpuReadBlock(unsigned address, byte* output, unsigned num,
+	                  EmuTime::param time) {
+		assert(vdp.isInsideFrame(time));
+		bool synced = false;
+		for (unsigned i = 0; i < num; ++i) {
+			unsigned addr = (address + i) & sizeMask;
+			if (!synced && cmdWriteWindow.isInside(addr)) {
+				cmdEngine->sync(time);
+				synced = true;
+			}
+			output[i] = data[addr];
+		}
+	}
+
 	/** Used by the VDP to signal display mode changes.
 	  * VDPVRAM will inform the Renderer, command engine and the sprite
 	  * checker of this change.